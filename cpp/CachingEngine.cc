@@ -0,0 +1,133 @@
+//--------------------------------------------------------------------------
+//
+// Description:
+// 	class CachingEngine : see header file (CachingEngine.hh) for description.
+//
+//------------------------------------------------------------------------
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "CachingEngine.hh"
+//--------------------
+// C++
+//--------------------
+#include<algorithm>
+
+using namespace std;
+
+//key made of a header and of the values of the input spans
+template<typename T>
+static void append(vector<double>& key,Span<const T> x){
+  key.push_back(x.size());
+  key.insert(key.end(),x.begin(),x.end());
+}
+
+//---------------
+// Constructors --
+//----------------
+CachingEngine::CachingEngine(Engine& engine):
+  _engine(engine),_hasPar(false),_status(true),_hits(0),_misses(0)
+{
+  _lmax=engine.lmax();
+}
+
+//-----------------
+// Member functions --
+//-----------------
+bool
+CachingEngine::updateParValues(const std::vector<double>& par){
+  if (_hasPar && par==_par) return _status;
+  clear();
+  _par=par;
+  _hasPar=true;
+  _status=_engine.updateParValues(par);
+  return _status;
+}
+
+void
+CachingEngine::clear(){
+  _cache.clear();
+}
+
+bool
+CachingEngine::lookup(const Key& key, Span<double> out){
+  map<Key,vector<double> >::const_iterator it=_cache.find(key);
+  if (it==_cache.end()){
+    _misses++;
+    return false;
+  }
+  copy(it->second.begin(),it->second.end(),out.begin());
+  _hits++;
+  return true;
+}
+
+void
+CachingEngine::store(const Key& key, Span<const double> out){
+  _cache[key].assign(out.begin(),out.end());
+}
+
+void
+CachingEngine::evalHz(Span<const double> z, Span<double> Hz){
+  Key key(1,HZ);
+  append(key,z);
+  if (lookup(key,Hz)) return;
+  _engine.getHz(z,Hz);
+  store(key,Hz);
+}
+
+void
+CachingEngine::evalDa(Span<const double> z, Span<double> Da){
+  Key key(1,DA);
+  append(key,z);
+  if (lookup(key,Da)) return;
+  _engine.getDa(z,Da);
+  store(key,Da);
+}
+
+void
+CachingEngine::evalDv(Span<const double> z, Span<double> Dv){
+  Key key(1,DV);
+  append(key,z);
+  if (lookup(key,Dv)) return;
+  _engine.getDv(z,Dv);
+  store(key,Dv);
+}
+
+void
+CachingEngine::evalGrowthRate(Span<const double> z, Span<double> f){
+  Key key(1,GROWTH_RATE);
+  append(key,z);
+  if (lookup(key,f)) return;
+  _engine.getGrowthRate(z,f);
+  store(key,f);
+}
+
+void
+CachingEngine::evalSigma8(Span<const double> z, Span<double> sigma8){
+  Key key(1,SIGMA8);
+  append(key,z);
+  if (lookup(key,sigma8)) return;
+  _engine.getSigma8(z,sigma8);
+  store(key,sigma8);
+}
+
+void
+CachingEngine::evalPk(Span<const double> k, Span<const double> z, pktype t, Span<double> pk){
+  Key key(1,PK);
+  key.push_back(t);
+  append(key,k);
+  append(key,z);
+  if (lookup(key,pk)) return;
+  _engine.getPk(k,z,t,pk);
+  store(key,pk);
+}
+
+void
+CachingEngine::evalCl(Span<const cltype> types, Span<const unsigned> l, Span<double> cl){
+  Key key(1,CL);
+  append(key,types);
+  append(key,l);
+  if (lookup(key,cl)) return;
+  _engine.getCl(types,l,cl);
+  store(key,cl);
+}
@@ -0,0 +1,75 @@
+//--------------------------------------------------------------------------
+//
+// Description:
+// 	class CachingEngine :
+// decorator around any engine: updateParValues is a no-op when the
+// parameters did not change (e.g. when a sampler only moves nuisance
+// parameters), and the result of each batch query is kept until the
+// next parameter change, so that repeated queries on the same arrays
+// (the usual case in a likelihood) are served from memory.
+//
+//
+// History (add to end):
+//	creation:   Mon Oct 19 2026
+//
+//------------------------------------------------------------------------
+
+#ifndef CachingEngine_hh
+#define CachingEngine_hh
+
+#include"Engine.hh"
+//STD
+#include<vector>
+#include<map>
+
+///////////////////////////////////////////////////////////////////////////
+class CachingEngine : public Engine
+{
+
+public:
+  CachingEngine(Engine& engine);
+
+  ~CachingEngine(){};
+
+  //forwarded to the engine only if par differs from the last call
+  bool updateParValues(const std::vector<double>& par);
+
+  double z_drag() const {return _engine.z_drag();}
+  double rs_drag() const {return _engine.rs_drag();}
+  double getTauReio() const {return _engine.getTauReio();}
+
+  //drop all stored results
+  void clear();
+
+  //statistics of the cache
+  inline unsigned long hits() const {return _hits;}
+  inline unsigned long misses() const {return _misses;}
+
+protected:
+  void evalHz(Span<const double> z, Span<double> Hz);
+  void evalDa(Span<const double> z, Span<double> Da);
+  void evalDv(Span<const double> z, Span<double> Dv);
+  void evalGrowthRate(Span<const double> z, Span<double> f);
+  void evalSigma8(Span<const double> z, Span<double> sigma8);
+  void evalPk(Span<const double> k, Span<const double> z, pktype t, Span<double> pk);
+  void evalCl(Span<const cltype> types, Span<const unsigned> l, Span<double> cl);
+
+private:
+  enum quantity {HZ=0,DA,DV,GROWTH_RATE,SIGMA8,PK,CL};
+
+  //key of a query: quantity, options, then all inputs
+  typedef std::vector<double> Key;
+
+  //copies the stored result in out and returns true if key is known
+  bool lookup(const Key& key, Span<double> out);
+  void store(const Key& key, Span<const double> out);
+
+  Engine& _engine;
+  std::vector<double> _par;
+  bool _hasPar;
+  bool _status;
+  std::map<Key,std::vector<double> > _cache;
+  unsigned long _hits,_misses;
+};
+
+#endif
@@ -65,89 +65,82 @@ template string str(const unsigned long long &x);
 //---------------
 // Constructors --
 //----------------
-ClassEngine::ClassEngine(const ClassParams& pars, bool verbose): cl(0),dofree(true){
+ClassEngine::ClassEngine(const ClassParams& pars, bool verbose): cl(0),_stage(all_stages),dofree(true){
+  init(pars,NULL,verbose);
+}
 
-  //prepare fp structure
-  size_t n=pars.size();
-  //
-  parser_init(&fc,n,(char*)"pipo",_errmsg);
 
-  //config
-  for (size_t i=0;i<pars.size();i++){
-    strcpy(fc.name[i],pars.key(i).c_str());
-    strcpy(fc.value[i],pars.value(i).c_str());
-    //store
-    parNames.push_back(pars.key(i));
-    //identify lmax
-    if(verbose) cout << pars.key(i) << "\t" << pars.value(i) <<endl;
-    if (pars.key(i)=="l_max_scalars") {
-      istringstream strstrm(pars.value(i));
-      strstrm >> _lmax;
-    }
-  }
-  if( verbose ) cout << __FILE__ << " : using lmax=" << _lmax <<endl;
-  // assert(_lmax>0); // this collides with transfer function calculations
+ClassEngine::ClassEngine(const ClassParams& pars,const string & precision_file, bool verbose): cl(0),_stage(all_stages),dofree(true){
 
-    //input
-  if (input_read_from_file(&fc,&pr,&ba,&th,&pt,&tr,&pm,&sp,&nl,&le,&sd,&op,_errmsg) == _FAILURE_)
+  struct file_content fc_precision;
+  fc_precision.size = 0;
+  //decode pre structure
+  if (parser_read_file(const_cast<char*>(precision_file.c_str()),&fc_precision,_errmsg) == _FAILURE_){
     throw invalid_argument(_errmsg);
-
-  //proetction parametres mal defini
-  for (size_t i=0;i<pars.size();i++){
-    if (fc.read[i] !=_TRUE_) throw invalid_argument(string("invalid CLASS parameter: ")+fc.name[i]);
-  }
-
-  //calcul class
-  computeCls();
-
-  //cout <<"creating " << sp.ct_size << " arrays" <<endl;
-  if( pt.has_cl_cmb_temperature || pt.has_cl_cmb_polarization || pt.has_cl_lensing_potential ){
-    cl=new double[sp.ct_size];
   }
-
-  //printFC();
-
+  init(pars,&fc_precision,verbose);
 }
 
+ClassEngine::ClassEngine(const ClassParams& pars, stage last, bool verbose): cl(0),_stage(last),dofree(true){
+  init(pars,NULL,verbose);
+}
 
-ClassEngine::ClassEngine(const ClassParams& pars,const string & precision_file, bool verbose): cl(0),dofree(true){
+ClassEngine::ClassEngine(const ClassParams& pars,const string & precision_file, stage last, bool verbose): cl(0),_stage(last),dofree(true){
 
   struct file_content fc_precision;
   fc_precision.size = 0;
-  //decode pre structure
   if (parser_read_file(const_cast<char*>(precision_file.c_str()),&fc_precision,_errmsg) == _FAILURE_){
     throw invalid_argument(_errmsg);
   }
+  init(pars,&fc_precision,verbose);
+}
 
-  //pars
+BackgroundEngine::BackgroundEngine(const ClassParams& pars, bool verbose):
+  ClassEngine(pars,thermodynamics_stage,verbose){
+}
+
+BackgroundEngine::BackgroundEngine(const ClassParams& pars,const string & precision_file, bool verbose):
+  ClassEngine(pars,precision_file,thermodynamics_stage,verbose){
+}
+
+//common part of the constructors; fc_precision (if any) is freed here
+void ClassEngine::init(const ClassParams& pars, struct file_content * fc_precision, bool verbose){
+
+  //prepare fp structure
   struct file_content fc_input;
   fc_input.size = 0;
-  fc_input.filename=new char[1];
- //prepare fc par structure
   size_t n=pars.size();
+  //
   parser_init(&fc_input,n,(char*)"pipo",_errmsg);
+
   //config
   for (size_t i=0;i<pars.size();i++){
     strcpy(fc_input.name[i],pars.key(i).c_str());
     strcpy(fc_input.value[i],pars.value(i).c_str());
+    //store
+    parNames.push_back(pars.key(i));
+    //identify lmax
+    if(verbose) cout << pars.key(i) << "\t" << pars.value(i) <<endl;
     if (pars.key(i)=="l_max_scalars") {
       istringstream strstrm(pars.value(i));
       strstrm >> _lmax;
     }
   }
   if( verbose ) cout << __FILE__ << " : using lmax=" << _lmax <<endl;
-  assert(_lmax>0);
-
-
-
-  //concatenate both
-  if (parser_cat(&fc_input,&fc_precision,&fc,_errmsg) == _FAILURE_) throw invalid_argument(_errmsg);
+  // assert(_lmax>0); // this collides with transfer function calculations
 
-  //parser_free(&fc_input);
-  parser_free(&fc_precision);
+  if (fc_precision == NULL) {
+    fc=fc_input;
+  }
+  else {
+    //concatenate both
+    if (parser_cat(&fc_input,fc_precision,&fc,_errmsg) == _FAILURE_) throw invalid_argument(_errmsg);
+    parser_free(&fc_input);
+    parser_free(fc_precision);
+  }
 
   //input
-  if (input_read_from_file(&fc,&pr,&ba,&th,&pt,&tr,&pm,&sp,&nl,&le,&sd,&op,_errmsg) == _FAILURE_)
+  if (input_read_from_file(&fc,&pr,&ba,&th,&pt,&tr,&pm,&hr,&fo,&le,&sd,&op,_errmsg) == _FAILURE_)
     throw invalid_argument(_errmsg);
 
   //proetction parametres mal defini
@@ -158,12 +151,12 @@ ClassEngine::ClassEngine(const ClassParams& pars,const string & precision_file,
   //calcul class
   computeCls();
 
-  //cout <<"creating " << sp.ct_size << " arrays" <<endl;
-  if( pt.has_cl_cmb_temperature || pt.has_cl_cmb_polarization || pt.has_cl_lensing_potential ){
-    cl=new double[sp.ct_size];
+  //cout <<"creating " << hr.ct_size << " arrays" <<endl;
+  if( _stage == all_stages && (pt.has_cl_cmb_temperature || pt.has_cl_cmb_polarization || pt.has_cl_lensing_potential) ){
+    cl=new double[hr.ct_size];
   }
-  //printFC();
 
+  //printFC();
 
 }
 
@@ -178,9 +171,7 @@ ClassEngine::~ClassEngine()
   //printFC();
   dofree && freeStructs();
 
-  if( pt.has_cl_cmb_temperature || pt.has_cl_cmb_polarization || pt.has_cl_lensing_potential ){
-    delete [] cl;
-  }
+  delete [] cl;
 
 }
 
@@ -216,19 +207,19 @@ int ClassEngine::class_main(
 			    struct file_content *pfc,
 			    struct precision * ppr,
 			    struct background * pba,
-			    struct thermo * pth,
-			    struct perturbs * ppt,
-			    struct transfers * ptr,
+			    struct thermodynamics * pth,
+			    struct perturbations * ppt,
+			    struct transfer * ptr,
 			    struct primordial * ppm,
-			    struct spectra * psp,
-			    struct nonlinear * pnl,
+			    struct harmonic * phr,
+			    struct fourier * pfo,
 			    struct lensing * ple,
 			    struct distortions * psd,
 			    struct output * pop,
 			    ErrorMsg errmsg) {
 
 
-  if (input_read_from_file(pfc,ppr,pba,pth,ppt,ptr,ppm,psp,pnl,ple,psd,pop,errmsg) == _FAILURE_) {
+  if (input_read_from_file(pfc,ppr,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,pop,errmsg) == _FAILURE_) {
     printf("\n\nError running input_read_from_file \n=>%s\n",errmsg);
     dofree=false;
     return _FAILURE_;
@@ -247,8 +238,13 @@ int ClassEngine::class_main(
     return _FAILURE_;
   }
 
-  if (perturb_init(ppr,pba,pth,ppt) == _FAILURE_) {
-    printf("\n\nError in perturb_init \n=>%s\n",ppt->error_message);
+  if (_stage == thermodynamics_stage) {
+    dofree=true;
+    return _SUCCESS_;
+  }
+
+  if (perturbations_init(ppr,pba,pth,ppt) == _FAILURE_) {
+    printf("\n\nError in perturbations_init \n=>%s\n",ppt->error_message);
     thermodynamics_free(&th);
     background_free(&ba);
     dofree=false;
@@ -257,53 +253,53 @@ int ClassEngine::class_main(
 
   if (primordial_init(ppr,ppt,ppm) == _FAILURE_) {
     printf("\n\nError in primordial_init \n=>%s\n",ppm->error_message);
-    perturb_free(&pt);
+    perturbations_free(&pt);
     thermodynamics_free(&th);
     background_free(&ba);
     dofree=false;
     return _FAILURE_;
   }
 
-  if (nonlinear_init(ppr,pba,pth,ppt,ppm,pnl) == _FAILURE_)  {
-    printf("\n\nError in nonlinear_init \n=>%s\n",pnl->error_message);
+  if (fourier_init(ppr,pba,pth,ppt,ppm,pfo) == _FAILURE_)  {
+    printf("\n\nError in fourier_init \n=>%s\n",pfo->error_message);
     primordial_free(&pm);
-    perturb_free(&pt);
+    perturbations_free(&pt);
     thermodynamics_free(&th);
     background_free(&ba);
     dofree=false;
     return _FAILURE_;
   }
 
-  if (transfer_init(ppr,pba,pth,ppt,pnl,ptr) == _FAILURE_) {
+  if (transfer_init(ppr,pba,pth,ppt,pfo,ptr) == _FAILURE_) {
     printf("\n\nError in transfer_init \n=>%s\n",ptr->error_message);
-    nonlinear_free(&nl);
+    fourier_free(&fo);
     primordial_free(&pm);
-    perturb_free(&pt);
+    perturbations_free(&pt);
     thermodynamics_free(&th);
     background_free(&ba);
     dofree=false;
     return _FAILURE_;
   }
 
-  if (spectra_init(ppr,pba,ppt,ppm,pnl,ptr,psp) == _FAILURE_) {
-    printf("\n\nError in spectra_init \n=>%s\n",psp->error_message);
+  if (harmonic_init(ppr,pba,ppt,ppm,pfo,ptr,phr) == _FAILURE_) {
+    printf("\n\nError in harmonic_init \n=>%s\n",phr->error_message);
     transfer_free(&tr);
-    nonlinear_free(&nl);
+    fourier_free(&fo);
     primordial_free(&pm);
-    perturb_free(&pt);
+    perturbations_free(&pt);
     thermodynamics_free(&th);
     background_free(&ba);
     dofree=false;
     return _FAILURE_;
   }
 
-  if (lensing_init(ppr,ppt,psp,pnl,ple) == _FAILURE_) {
+  if (lensing_init(ppr,ppt,phr,pfo,ple) == _FAILURE_) {
     printf("\n\nError in lensing_init \n=>%s\n",ple->error_message);
-    spectra_free(&sp);
+    harmonic_free(&hr);
     transfer_free(&tr);
-    nonlinear_free(&nl);
+    fourier_free(&fo);
     primordial_free(&pm);
-    perturb_free(&pt);
+    perturbations_free(&pt);
     thermodynamics_free(&th);
     background_free(&ba);
     dofree=false;
@@ -313,11 +309,11 @@ int ClassEngine::class_main(
   if (distortions_init(ppr,pba,pth,ppt,ppm,psd) == _FAILURE_) {
     printf("\n\nError in distortions_init \n=>%s\n",psd->error_message);
     lensing_free(&le);
-    spectra_free(&sp);
+    harmonic_free(&hr);
     transfer_free(&tr);
-    nonlinear_free(&nl);
+    fourier_free(&fo);
     primordial_free(&pm);
-    perturb_free(&pt);
+    perturbations_free(&pt);
     thermodynamics_free(&th);
     background_free(&ba);
     dofree=false;
@@ -336,7 +332,7 @@ int ClassEngine::computeCls(){
   //printFC();
 #endif
 
-  int status=this->class_main(&fc,&pr,&ba,&th,&pt,&tr,&pm,&sp,&nl,&le,&sd,&op,_errmsg);
+  int status=this->class_main(&fc,&pr,&ba,&th,&pt,&tr,&pm,&hr,&fo,&le,&sd,&op,_errmsg);
 #ifdef DBUG
   cout <<"status=" << status << endl;
 #endif
@@ -347,40 +343,42 @@ int ClassEngine::computeCls(){
 int
 ClassEngine::freeStructs(){
 
+  if (_stage == all_stages) {
 
-  if (distortions_free(&sd) == _FAILURE_) {
-    printf("\n\nError in distortions_free \n=>%s\n",sd.error_message);
-    return _FAILURE_;
-  }
+    if (distortions_free(&sd) == _FAILURE_) {
+      printf("\n\nError in distortions_free \n=>%s\n",sd.error_message);
+      return _FAILURE_;
+    }
 
-  if (lensing_free(&le) == _FAILURE_) {
-    printf("\n\nError in spectra_free \n=>%s\n",le.error_message);
-    return _FAILURE_;
-  }
+    if (lensing_free(&le) == _FAILURE_) {
+      printf("\n\nError in lensing_free \n=>%s\n",le.error_message);
+      return _FAILURE_;
+    }
 
-  if (nonlinear_free(&nl) == _FAILURE_) {
-    printf("\n\nError in nonlinear_free \n=>%s\n",nl.error_message);
-    return _FAILURE_;
-  }
+    if (harmonic_free(&hr) == _FAILURE_) {
+      printf("\n\nError in harmonic_free \n=>%s\n",hr.error_message);
+      return _FAILURE_;
+    }
 
-  if (spectra_free(&sp) == _FAILURE_) {
-    printf("\n\nError in spectra_free \n=>%s\n",sp.error_message);
-    return _FAILURE_;
-  }
+    if (transfer_free(&tr) == _FAILURE_) {
+      printf("\n\nError in transfer_free \n=>%s\n",tr.error_message);
+      return _FAILURE_;
+    }
 
-  if (primordial_free(&pm) == _FAILURE_) {
-    printf("\n\nError in primordial_free \n=>%s\n",pm.error_message);
-    return _FAILURE_;
-  }
+    if (fourier_free(&fo) == _FAILURE_) {
+      printf("\n\nError in fourier_free \n=>%s\n",fo.error_message);
+      return _FAILURE_;
+    }
 
-  if (transfer_free(&tr) == _FAILURE_) {
-    printf("\n\nError in transfer_free \n=>%s\n",tr.error_message);
-    return _FAILURE_;
-  }
+    if (primordial_free(&pm) == _FAILURE_) {
+      printf("\n\nError in primordial_free \n=>%s\n",pm.error_message);
+      return _FAILURE_;
+    }
 
-  if (perturb_free(&pt) == _FAILURE_) {
-    printf("\n\nError in perturb_free \n=>%s\n",pt.error_message);
-    return _FAILURE_;
+    if (perturbations_free(&pt) == _FAILURE_) {
+      printf("\n\nError in perturbations_free \n=>%s\n",pt.error_message);
+      return _FAILURE_;
+    }
   }
 
   if (thermodynamics_free(&th) == _FAILURE_) {
@@ -403,12 +401,40 @@ void ClassEngine::call_perturb_sources_at_tau(
                            double tau,
                            double * psource
                            ) {
-  if( perturb_sources_at_tau( &pt, index_md, index_ic, index_tp, tau, psource ) == _FAILURE_){
+  if( perturbations_sources_at_tau( &pt, index_md, index_ic, index_tp, tau, psource ) == _FAILURE_){
     cerr << ">>>fail getting Tk type=" << (int)index_tp <<endl;
     throw out_of_range(pt.error_message);
   }
 }
 
+void
+ClassEngine::getSourcesAtZ( const std::vector<double>& z,
+   const std::vector<int>& index_tp,
+   std::vector<double>& k,
+   std::vector<double>& sources )
+{
+
+  if (!dofree) throw out_of_range("no sources available because CLASS failed");
+  if (_stage != all_stages) throw invalid_argument("no sources available in a background-only engine");
+
+  const int index_md = pt.index_md_scalars;
+  const size_t k_size = pt.k_size[index_md];
+
+  k.assign( pt.k[index_md], pt.k[index_md]+k_size );
+  sources.resize( index_tp.size()*z.size()*k_size );
+
+  if (sources.empty()) return;
+
+  // CLASS writes directly into the output vector, sources[(i_tp*z.size()+i_z)*k_size+i_k]
+  if( perturbations_sources_at_z_list( &ba, &pt, index_md, 0,
+                                       index_tp.size(), const_cast<int*>(index_tp.data()),
+                                       z.size(), const_cast<double*>(z.data()),
+                                       sources.data() ) == _FAILURE_){
+    cerr << ">>>fail getting sources at " << z.size() << " redshifts" <<endl;
+    throw out_of_range(pt.error_message);
+  }
+}
+
 void
 ClassEngine::getTk( double z,
    std::vector<double>& k,
@@ -423,6 +449,7 @@ ClassEngine::getTk( double z,
 {
 
   if (!dofree) throw out_of_range("no Tk available because CLASS failed");
+  if (_stage != all_stages) throw invalid_argument("no Tk available in a background-only engine");
 
   double tau;
   int index;
@@ -439,33 +466,32 @@ ClassEngine::getTk( double z,
   double fHa = pvecback[ba.index_bg_f] * (pvecback[ba.index_bg_a]*pvecback[ba.index_bg_H]);
   delete[] pvecback;
 
-  // copy transfer func data to temporary
+  // get all needed sources in one sweep through the table
   const size_t index_md = pt.index_md_scalars;
-  d_cdm.assign( pt.k_size[index_md], 0.0 );
-  d_b.assign( pt.k_size[index_md], 0.0 );
-  d_ncdm.assign( pt.k_size[index_md], 0.0 );
-  d_tot.assign( pt.k_size[index_md], 0.0 );
-  t_cdm.assign( pt.k_size[index_md], 0.0 );
-  t_b.assign( pt.k_size[index_md], 0.0 );
-  t_ncdm.assign( pt.k_size[index_md], 0.0 );
-  t_tot.assign( pt.k_size[index_md], 0.0 );
+  const size_t k_size = pt.k_size[index_md];
 
   if( pt.ic_size[index_md] > 1 ){
     cerr << ">>>have more than 1 ICs, will use first and ignore others" << endl;
   }
 
-  call_perturb_sources_at_tau(index_md, 0, pt.index_tp_delta_cdm, tau, &d_cdm[0]);
-  call_perturb_sources_at_tau(index_md, 0, pt.index_tp_delta_b, tau, &d_b[0]);
-  call_perturb_sources_at_tau(index_md, 0, pt.index_tp_delta_ncdm1, tau, &d_ncdm[0]);
-  call_perturb_sources_at_tau(index_md, 0, pt.index_tp_delta_tot, tau, &d_tot[0]);
-  call_perturb_sources_at_tau(index_md, 0, pt.index_tp_theta_b, tau, &t_b[0]);
-  call_perturb_sources_at_tau(index_md, 0, pt.index_tp_theta_ncdm1, tau, &t_ncdm[0]);
-  call_perturb_sources_at_tau(index_md, 0, pt.index_tp_theta_tot, tau, &d_tot[0]);
+  std::vector<int> index_tp = {pt.index_tp_delta_cdm, pt.index_tp_delta_b, pt.index_tp_delta_ncdm1, pt.index_tp_delta_tot,
+                               pt.index_tp_theta_b, pt.index_tp_theta_ncdm1, pt.index_tp_theta_tot,
+                               pt.index_tp_eta_prime, pt.index_tp_h_prime};
+  std::vector<double> kvec, sources;
+  getSourcesAtZ(std::vector<double>(1,z), index_tp, kvec, sources);
+
+  d_cdm.assign( sources.begin(), sources.begin()+k_size );
+  d_b.assign( sources.begin()+k_size, sources.begin()+2*k_size );
+  d_ncdm.assign( sources.begin()+2*k_size, sources.begin()+3*k_size );
+  d_tot.assign( sources.begin()+3*k_size, sources.begin()+4*k_size );
+  t_cdm.assign( k_size, 0.0 );
+  t_b.assign( sources.begin()+4*k_size, sources.begin()+5*k_size );
+  t_ncdm.assign( sources.begin()+5*k_size, sources.begin()+6*k_size );
+  t_tot.assign( sources.begin()+6*k_size, sources.begin()+7*k_size );
 
   //
-  std::vector<double> h_prime(pt.k_size[index_md],0.0), eta_prime(pt.k_size[index_md],0.0);
-  call_perturb_sources_at_tau(index_md, 0, pt.index_tp_eta_prime, tau, &eta_prime[0]);
-  call_perturb_sources_at_tau(index_md, 0, pt.index_tp_h_prime, tau, &h_prime[0]);
+  std::vector<double> eta_prime( sources.begin()+7*k_size, sources.begin()+8*k_size );
+  std::vector<double> h_prime( sources.begin()+8*k_size, sources.begin()+9*k_size );
 
   // gauge trafo velocities, store k-vector
   for (int index_k=0; index_k<pt.k_size[index_md]; index_k++)
@@ -486,257 +512,156 @@ ClassEngine::getTk( double z,
   }
 }
 
-double
-ClassEngine::getCl(Engine::cltype t,const long &l){
-
-  if (!dofree) throw out_of_range("no Cl available because CLASS failed");
-
-  if (output_total_cl_at_l(&sp,&le,&op,static_cast<double>(l),cl) == _FAILURE_){
-    cerr << ">>>fail getting Cl type=" << (int)t << " @l=" << l <<endl;
-    throw out_of_range(sp.error_message);
-  }
-
-  double zecl=-1;
-
-  double tomuk=1e6*Tcmb();
-  double tomuk2=tomuk*tomuk;
-
-  switch(t)
-    {
-    case TT:
-      (sp.has_tt==_TRUE_) ? zecl=tomuk2*cl[sp.index_ct_tt] : throw invalid_argument("no ClTT available");
-      break;
-    case TE:
-      (sp.has_te==_TRUE_) ? zecl=tomuk2*cl[sp.index_ct_te] : throw invalid_argument("no ClTE available");
-      break;
-    case EE:
-      (sp.has_ee==_TRUE_) ? zecl=tomuk2*cl[sp.index_ct_ee] : throw invalid_argument("no ClEE available");
-      break;
-    case BB:
-      (sp.has_bb==_TRUE_) ? zecl=tomuk2*cl[sp.index_ct_bb] : throw invalid_argument("no ClBB available");
-      break;
-    case PP:
-      (sp.has_pp==_TRUE_) ? zecl=cl[sp.index_ct_pp] : throw invalid_argument("no ClPhi-Phi available");
-      break;
-    case TP:
-      (sp.has_tp==_TRUE_) ? zecl=tomuk*cl[sp.index_ct_tp] : throw invalid_argument("no ClT-Phi available");
-      break;
-    case EP:
-      (sp.has_ep==_TRUE_) ? zecl=tomuk*cl[sp.index_ct_ep] : throw invalid_argument("no ClE-Phi available");
-      break;
-    }
-
-  return zecl;
-
-}
+//background quantity index_bg at all redshifts: one allocation, and
+//closeby interpolation after the first point (fastest for sorted z)
 void
-ClassEngine::getCls(const std::vector<unsigned>& lvec, //input
-		      std::vector<double>& cltt,
-		      std::vector<double>& clte,
-		      std::vector<double>& clee,
-		      std::vector<double>& clbb)
+ClassEngine::backgroundAtZ(Span<const double> z, int index_bg, Span<double> out)
 {
-  cltt.resize(lvec.size());
-  clte.resize(lvec.size());
-  clee.resize(lvec.size());
-  clbb.resize(lvec.size());
-
-  for (size_t i=0;i<lvec.size();i++){
-    try{
-      cltt[i]=getCl(ClassEngine::TT,lvec[i]);
-      clte[i]=getCl(ClassEngine::TE,lvec[i]);
-      clee[i]=getCl(ClassEngine::EE,lvec[i]);
-      clbb[i]=getCl(ClassEngine::BB,lvec[i]);
-    }
-    catch(exception &e){
-      throw e;
-    }
-  }
-
-}
+  if (!dofree) throw out_of_range("no background available because CLASS failed");
 
-bool
-ClassEngine::getLensing(const std::vector<unsigned>& lvec, //input
-		std::vector<double>& clpp    ,
-		std::vector<double>& cltp  ,
-		std::vector<double>& clep  ){
+  std::vector<double> pvecback(ba.bg_size);
+  int last_index=0;
 
-
-  clpp.resize(lvec.size());
-  cltp.resize(lvec.size());
-  clep.resize(lvec.size());
-
-  for (size_t i=0;i<lvec.size();i++){
-    try{
-      clpp[i]=getCl(ClassEngine::PP,lvec[i]);
-      cltp[i]=getCl(ClassEngine::TP,lvec[i]);
-      clep[i]=getCl(ClassEngine::EP,lvec[i]);
-    }
-    catch(exception &e){
-      cout << "plantage!" << endl;
-      cout << __FILE__ << e.what() << endl;
-      return false;
+  for (size_t i=0;i<z.size();i++){
+    if (background_at_z(&ba,z[i],long_info,(i==0) ? inter_normal : inter_closeby,&last_index,pvecback.data()) == _FAILURE_){
+      throw out_of_range(ba.error_message);
     }
+    out[i]=pvecback[index_bg];
   }
-  return true;
 }
 
-
-double ClassEngine::get_f(double z)
+void
+ClassEngine::evalHz(Span<const double> z, Span<double> Hz)
 {
-  double tau;
-  int index;
-  double *pvecback;
-  //transform redshift in conformal time
-  background_tau_of_z(&ba,z,&tau);
-
-  //pvecback must be allocated
-  pvecback=(double *)malloc(ba.bg_size*sizeof(double));
-
-  //call to fill pvecback
-  background_at_tau(&ba,tau,long_info,inter_normal, &index, pvecback);
-
-
-
-  double f_z=pvecback[ba.index_bg_f];
-#ifdef DBUG
-  cout << "f_of_z= "<< f_z <<endl;
-#endif
-  return f_z;
+  backgroundAtZ(z,ba.index_bg_H,Hz);
 }
 
-
-double ClassEngine::get_sigma8(double z)
+void
+ClassEngine::evalDa(Span<const double> z, Span<double> Da)
 {
-  double tau;
-  int index;
-  double *pvecback;
-  double sigma8 = 0.;
-  //transform redshift in conformal time
-  background_tau_of_z(&ba,z,&tau);
-
-  //pvecback must be allocated
-  pvecback=(double *)malloc(ba.bg_size*sizeof(double));
-
-  //call to fill pvecback
-  background_at_tau(&ba,tau,long_info,inter_normal, &index, pvecback);
-  //background_at_tau(pba,tau,pba->long_info,pba->inter_normal,&last_index,pvecback);
-  spectra_sigma(&ba,&pm,&sp,8./ba.h,z,&sigma8);
-
-#ifdef DBUG
-  cout << "sigma_8= "<< sigma8 <<endl;
-#endif
-  return sigma8;
+  backgroundAtZ(z,ba.index_bg_ang_distance,Da);
 }
 
-// ATTENTION FONCTION BIDON - GET omegam ! -------------------
-double ClassEngine::get_Az(double z)
+void
+ClassEngine::evalGrowthRate(Span<const double> z, Span<double> f)
 {
-  double Dv = get_Dv(z);
-  // A(z)=100DV(z)sqrt(~mh2)/cz
-  double omega_bidon = 0.12 ;
-  double Az = 100.*Dv*sqrt(omega_bidon)/(3.e8*z); // is there speed of light somewhere ?
-  return Az;
+  backgroundAtZ(z,ba.index_bg_f,f);
 }
-//      --------------------------
 
-double ClassEngine::get_Dv(double z)
+void
+ClassEngine::evalDv(Span<const double> z, Span<double> Dv)
 {
-  double tau;
-  int index;
-  double *pvecback;
-  //transform redshift in conformal time
-  background_tau_of_z(&ba,z,&tau);
-
-  //pvecback must be allocated
-  pvecback=(double *)malloc(ba.bg_size*sizeof(double));
+  if (!dofree) throw out_of_range("no background available because CLASS failed");
 
-  //call to fill pvecback
-  background_at_tau(&ba,tau,long_info,inter_normal, &index, pvecback);
-
-  double H_z=pvecback[ba.index_bg_H];
-  double D_ang=pvecback[ba.index_bg_ang_distance];
-#ifdef DBUG
-  cout << "H_z= "<< H_z <<endl;
-  cout << "D_ang= "<< D_ang <<endl;
-#endif
-  double D_v;
+  std::vector<double> pvecback(ba.bg_size);
+  int last_index=0;
 
-  D_v=pow(D_ang*(1+z),2)*z/H_z;
-  D_v=pow(D_v,1./3.);
+  for (size_t i=0;i<z.size();i++){
+    if (background_at_z(&ba,z[i],long_info,(i==0) ? inter_normal : inter_closeby,&last_index,pvecback.data()) == _FAILURE_){
+      throw out_of_range(ba.error_message);
+    }
+    double H_z=pvecback[ba.index_bg_H];
+    double D_ang=pvecback[ba.index_bg_ang_distance];
 #ifdef DBUG
-  cout << D_v << endl;
+    cout << "H_z= "<< H_z <<endl;
+    cout << "D_ang= "<< D_ang <<endl;
 #endif
-  return D_v;
+    Dv[i]=pow(pow(D_ang*(1+z[i]),2)*z[i]/H_z,1./3.);
+  }
 }
 
-double ClassEngine::get_Fz(double z)
+void
+ClassEngine::evalSigma8(Span<const double> z, Span<double> sigma8)
 {
-  double tau;
-  int index;
-  double *pvecback;
-  //transform redshift in conformal time
-  background_tau_of_z(&ba,z,&tau);
-
-  //pvecback must be allocated
-  pvecback=(double *)malloc(ba.bg_size*sizeof(double));
-
-  //call to fill pvecback
-  background_at_tau(&ba,tau,long_info,inter_normal, &index, pvecback);
-
+  if (!dofree) throw out_of_range("no sigma8 available because CLASS failed");
+  if (_stage != all_stages || (fo.has_pk_matter == _FALSE_ && fo.method == nl_none)) throw invalid_argument("no sigma8 available (needs mPk in output)");
 
-  double H_z=pvecback[ba.index_bg_H];
-  double D_ang=pvecback[ba.index_bg_ang_distance];
+  for (size_t i=0;i<z.size();i++){
+    if (fourier_sigmas_at_z(&pr,&ba,&fo,8./ba.h,z[i],fo.index_pk_m,out_sigma,&sigma8[i]) == _FAILURE_){
+      throw out_of_range(fo.error_message);
+    }
 #ifdef DBUG
-  cout << "H_z= "<< H_z <<endl;
-  cout << "D_ang= "<< D_ang <<endl;
+    cout << "sigma_8= "<< sigma8[i] <<endl;
 #endif
-  double F_z = (1.+z) * D_ang * H_z /(3.e8) ; // is there speed of light somewhere ?
-  return F_z;
+  }
 }
 
-double ClassEngine::get_Hz(double z)
+void
+ClassEngine::evalPk(Span<const double> k, Span<const double> z, pktype t, Span<double> pk)
 {
-  double tau;
-  int index;
-  double *pvecback;
-  //transform redshift in conformal time
-  background_tau_of_z(&ba,z,&tau);
-
-  //pvecback must be allocated
-  pvecback=(double *)malloc(ba.bg_size*sizeof(double));
-
-  //call to fill pvecback
-  background_at_tau(&ba,tau,long_info,inter_normal, &index, pvecback);
-
-
-  double H_z=pvecback[ba.index_bg_H];
+  if (!dofree) throw out_of_range("no P(k) available because CLASS failed");
+  if (_stage != all_stages || (fo.has_pk_matter == _FALSE_ && fo.method == nl_none)) throw invalid_argument("no P(k) available (needs mPk in output)");
+  if (t == PK_NONLINEAR && fo.method == nl_none) throw invalid_argument("no non-linear P(k) available (needs non_linear in input)");
 
-  return(H_z);
+  //CLASS also interpolates P_cb when it exists, and needs room for it
+  std::vector<double> pk_cb;
+  if (fo.has_pk_cb == _TRUE_) pk_cb.resize(pk.size());
 
+  //one spline in k per redshift, written directly into pk[i_z*k.size()+i_k]
+  if (fourier_pks_at_kvec_and_zvec(&ba,&fo,(t == PK_NONLINEAR) ? pk_nonlinear : pk_linear,
+                                   const_cast<double*>(k.data()),k.size(),
+                                   const_cast<double*>(z.data()),z.size(),
+                                   pk.data(),pk_cb.empty() ? NULL : pk_cb.data()) == _FAILURE_){
+    throw out_of_range(fo.error_message);
+  }
 }
 
-
-double ClassEngine::get_Da(double z)
+void
+ClassEngine::evalCl(Span<const cltype> types, Span<const unsigned> l, Span<double> zecl)
 {
-  double tau;
-  int index;
-  double *pvecback;
-  //transform redshift in conformal time
-  background_tau_of_z(&ba,z,&tau);
-
-  //pvecback must be allocated
-  pvecback=(double *)malloc(ba.bg_size*sizeof(double));
+  if (!dofree) throw out_of_range("no Cl available because CLASS failed");
+  if (cl == 0) throw invalid_argument("no Cl available");
 
-  //call to fill pvecback
-  background_at_tau(&ba,tau,long_info,inter_normal, &index, pvecback);
+  double tomuk=1e6*Tcmb();
+  double tomuk2=tomuk*tomuk;
 
+  //index and unit of each requested type
+  std::vector<int> index_ct(types.size());
+  std::vector<double> factor(types.size());
+
+  for (size_t i=0;i<types.size();i++){
+    switch(types[i])
+      {
+      case TT:
+        (hr.has_tt==_TRUE_) ? index_ct[i]=hr.index_ct_tt : throw invalid_argument("no ClTT available");
+        factor[i]=tomuk2;
+        break;
+      case TE:
+        (hr.has_te==_TRUE_) ? index_ct[i]=hr.index_ct_te : throw invalid_argument("no ClTE available");
+        factor[i]=tomuk2;
+        break;
+      case EE:
+        (hr.has_ee==_TRUE_) ? index_ct[i]=hr.index_ct_ee : throw invalid_argument("no ClEE available");
+        factor[i]=tomuk2;
+        break;
+      case BB:
+        (hr.has_bb==_TRUE_) ? index_ct[i]=hr.index_ct_bb : throw invalid_argument("no ClBB available");
+        factor[i]=tomuk2;
+        break;
+      case PP:
+        (hr.has_pp==_TRUE_) ? index_ct[i]=hr.index_ct_pp : throw invalid_argument("no ClPhi-Phi available");
+        factor[i]=1.;
+        break;
+      case TP:
+        (hr.has_tp==_TRUE_) ? index_ct[i]=hr.index_ct_tp : throw invalid_argument("no ClT-Phi available");
+        factor[i]=tomuk;
+        break;
+      case EP:
+        (hr.has_ep==_TRUE_) ? index_ct[i]=hr.index_ct_ep : throw invalid_argument("no ClE-Phi available");
+        factor[i]=tomuk;
+        break;
+      }
+  }
+
+  //all types from a single interpolation per l
+  for (size_t j=0;j<l.size();j++){
+    if (output_total_cl_at_l(&hr,&le,&op,static_cast<int>(l[j]),cl) == _FAILURE_){
+      cerr << ">>>fail getting Cl @l=" << l[j] <<endl;
+      throw out_of_range(op.error_message);
+    }
+    for (size_t i=0;i<types.size();i++){
+      zecl[i*l.size()+j]=factor[i]*cl[index_ct[i]];
+    }
+  }
 
-  double H_z=pvecback[ba.index_bg_H];
-  double D_ang=pvecback[ba.index_bg_ang_distance];
-#ifdef DBUG
-  cout << "H_z= "<< H_z <<endl;
-  cout << "D_ang= "<< D_ang <<endl;
-#endif
-  return D_ang;
 }
@@ -4,12 +4,16 @@
 // 	class ClassEngine :
 // encapsulation of class calls
 //
+// 	class BackgroundEngine :
+// same, running only the background and thermodynamics modules
+//
 //
 // Author List:
 //	Stephane Plaszczynski (plaszczy@lal.in2p3.fr)
 //
 // History (add to end):
 //	creation:   ven. nov. 4 11:02:20 CET 2011
+//	batch queries of the Engine interface, BackgroundEngine
 //
 //-----------------------------------------------------------------------
 
@@ -68,6 +72,9 @@ class ClassEngine : public Engine
   friend class ClassParams;
 
 public:
+  //modules run by the engine
+  enum stage {thermodynamics_stage=0,all_stages};
+
   //constructors
   ClassEngine(const ClassParams& pars, bool verbose=true );
   //with a class .pre file
@@ -81,21 +88,6 @@ public:
   bool updateParValues(const std::vector<double>& par);
 
 
-  //get value at l ( 2<l<lmax): in units = (micro-K)^2
-  //don't call if FAILURE returned previously
-  //throws std::execption if pb
-
-  double getCl(Engine::cltype t,const long &l);
-  void getCls(const std::vector<unsigned>& lVec, //input
-	      std::vector<double>& cltt,
-	      std::vector<double>& clte,
-	      std::vector<double>& clee,
-	      std::vector<double>& clbb);
-  bool getLensing(const std::vector<unsigned>& lVec, //input
-	      std::vector<double>& clphiphi,
-	      std::vector<double>& cltphi,
-	      std::vector<double>& clephi);
-
   void call_perturb_sources_at_tau(
                            int index_md,
                            int index_ic,
@@ -104,6 +96,13 @@ public:
                            double * psource
                            );
 
+  //sources of types index_tp (pt.index_tp_...) at all redshifts z, for the k values returned in k,
+  //in one sweep: sources[(i_tp*z.size()+i_z)*k.size()+i_k]
+  void getSourcesAtZ( const std::vector<double>& z,
+        const std::vector<int>& index_tp,
+        std::vector<double>& k,
+        std::vector<double>& sources );
+
   void getTk( double z,
         std::vector<double>& k,
         std::vector<double>& d_cdm,
@@ -118,20 +117,11 @@ public:
  //for BAO
   inline double z_drag() const {return th.z_d;}
   inline double rs_drag() const {return th.rs_d;}
-  double get_Dv(double z);
-
-  double get_Da(double z);
-  double get_sigma8(double z);
-  double get_f(double z);
-
-  double get_Fz(double z);
-  double get_Hz(double z);
-  double get_Az(double z);
 
   double getTauReio() const {return th.tau_reio;}
 
   //may need that
-  inline int numCls() const {return sp.ct_size;};
+  inline int numCls() const {return hr.ct_size;};
   inline double Tcmb() const {return ba.T_cmb;}
 
   inline int l_max_scalars() const {return _lmax;}
@@ -144,12 +134,12 @@ private:
   struct file_content fc;
   struct precision pr;        /* for precision parameters */
   struct background ba;       /* for cosmological background */
-  struct thermo th;           /* for thermodynamics */
-  struct perturbs pt;         /* for source functions */
-  struct transfers tr;        /* for transfer functions */
+  struct thermodynamics th;   /* for thermodynamics */
+  struct perturbations pt;    /* for source functions */
+  struct transfer tr;         /* for transfer functions */
   struct primordial pm;       /* for primordial spectra */
-  struct spectra sp;          /* for output spectra */
-  struct nonlinear nl;        /* for non-linear spectra */
+  struct harmonic hr;         /* for output spectra */
+  struct fourier fo;          /* for non-linear spectra */
   struct lensing le;          /* for lensed spectra */
   struct distortions sd;      /* for spectral distortions */
   struct output op;           /* for output files */
@@ -158,6 +148,7 @@ private:
   double * cl;
 
   //helpers
+  stage _stage;
   bool dofree;
   int freeStructs();
 
@@ -168,12 +159,12 @@ private:
 		 struct file_content *pfc,
 		 struct precision * ppr,
 		 struct background * pba,
-		 struct thermo * pth,
-		 struct perturbs * ppt,
-		 struct transfers * ptr,
+		 struct thermodynamics * pth,
+		 struct perturbations * ppt,
+		 struct transfer * ptr,
 		 struct primordial * ppm,
-		 struct spectra * psp,
-		 struct nonlinear * pnl,
+		 struct harmonic * phr,
+		 struct fourier * pfo,
 		 struct lensing * ple,
 		 struct distortions * psd,
 		 struct output * pop,
@@ -182,8 +173,34 @@ private:
   std::vector<std::string> parNames;
 
 protected:
+  //engine stopping after a given module
+  ClassEngine(const ClassParams& pars, stage last, bool verbose);
+  ClassEngine(const ClassParams& pars, const string & precision_file, stage last, bool verbose);
+
+  //batch queries
+  void evalHz(Span<const double> z, Span<double> Hz);
+  void evalDa(Span<const double> z, Span<double> Da);
+  void evalDv(Span<const double> z, Span<double> Dv);
+  void evalGrowthRate(Span<const double> z, Span<double> f);
+  void evalSigma8(Span<const double> z, Span<double> sigma8);
+  void evalPk(Span<const double> k, Span<const double> z, pktype t, Span<double> pk);
+  void evalCl(Span<const cltype> types, Span<const unsigned> l, Span<double> cl);
+
+private:
+  void init(const ClassParams& pars, struct file_content * fc_precision, bool verbose);
+  //background quantity index_bg at all z, in one sweep through the table
+  void backgroundAtZ(Span<const double> z, int index_bg, Span<double> out);
 
+};
 
+///////////////////////////////////////////////////////////////////////////
+//background and thermodynamics only: distances, H, growth rate, BAO scales
+//(queries of sigma8, P(k) or Cl throw std::invalid_argument)
+class BackgroundEngine : public ClassEngine
+{
+public:
+  BackgroundEngine(const ClassParams& pars, bool verbose=true );
+  BackgroundEngine(const ClassParams& pars, const string & precision_file, bool verbose=true);
 };
 
 #endif
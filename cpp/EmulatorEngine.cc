@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------
+//
+// Description:
+// 	class EmulatorEngine : see header file (EmulatorEngine.hh) for description.
+//
+//------------------------------------------------------------------------
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "EmulatorEngine.hh"
+//--------------------
+// C++
+//--------------------
+#include<stdexcept>
+#include<string>
+
+using namespace std;
+
+//---------------
+// Constructors --
+//----------------
+EmulatorEngine::EmulatorEngine(Engine& source,
+                               const vector<double>& fiducial,
+                               const vector<double>& steps,
+                               const vector<double>& z_bg,
+                               const vector<double>& z_pk,
+                               const vector<double>& k):
+  SnapshotEngine(source,z_bg,z_pk,k,false),_fiducial(fiducial),_derivative(fiducial.size())
+{
+  if (steps.size()!=fiducial.size()) throw invalid_argument("EmulatorEngine: one step per parameter needed");
+
+  vector<double> par(fiducial);
+  Tables minus;
+
+  for (size_t i=0;i<par.size();i++){
+    //d(tables)/dpar_i = (tables(par_i+step)-tables(par_i-step))/(2 step)
+    par[i]=fiducial[i]+steps[i];
+    if (!_source.updateParValues(par)) throw runtime_error("EmulatorEngine: source failed at parameter #"+to_string(i)+" + step");
+    tabulate(_derivative[i]);
+    par[i]=fiducial[i]-steps[i];
+    if (!_source.updateParValues(par)) throw runtime_error("EmulatorEngine: source failed at parameter #"+to_string(i)+" - step");
+    tabulate(minus);
+    par[i]=fiducial[i];
+
+    _derivative[i].axpy(-1.,minus);
+    _derivative[i].scale(1./(2.*steps[i]));
+  }
+
+  //leave the source at the fiducial point
+  if (!_source.updateParValues(fiducial)) throw runtime_error("EmulatorEngine: source failed at the fiducial point");
+  tabulate(_fid);
+  _tab=_fid;
+}
+
+//-----------------
+// Member functions --
+//-----------------
+bool
+EmulatorEngine::updateParValues(const std::vector<double>& par){
+  if (par.size()!=_fiducial.size()) throw invalid_argument("EmulatorEngine: wrong number of parameters");
+  _tab=_fid;
+  for (size_t i=0;i<par.size();i++){
+    _tab.axpy(par[i]-_fiducial[i],_derivative[i]);
+  }
+  return true;
+}
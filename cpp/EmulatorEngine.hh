@@ -0,0 +1,53 @@
+//--------------------------------------------------------------------------
+//
+// Description:
+// 	class EmulatorEngine :
+// snapshot of a source engine at a fiducial parameter point, plus its
+// derivatives with respect to each parameter (central finite
+// differences, two runs of the source per parameter, done once at
+// construction). updateParValues does not call the source: the tables
+// are extrapolated linearly from the fiducial point (ln P(k) for the
+// power spectra), and interpolated as in SnapshotEngine. Only
+// accurate close to the fiducial point, e.g. for fast burn-in or
+// for the nuisance-dominated steps of a sampler.
+//
+//
+// History (add to end):
+//	creation:   Mon Oct 19 2026
+//
+//------------------------------------------------------------------------
+
+#ifndef EmulatorEngine_hh
+#define EmulatorEngine_hh
+
+#include"SnapshotEngine.hh"
+//STD
+#include<vector>
+
+///////////////////////////////////////////////////////////////////////////
+class EmulatorEngine : public SnapshotEngine
+{
+
+public:
+  //fiducial: parameter values (in the order of the source parameters)
+  //steps: finite difference step of each parameter
+  //throws std::runtime_error if the source fails around the fiducial point
+  EmulatorEngine(Engine& source,
+                 const std::vector<double>& fiducial,
+                 const std::vector<double>& steps,
+                 const std::vector<double>& z_bg,
+                 const std::vector<double>& z_pk,
+                 const std::vector<double>& k);
+
+  ~EmulatorEngine(){};
+
+  //linear prediction at par, no call to the source
+  bool updateParValues(const std::vector<double>& par);
+
+private:
+  std::vector<double> _fiducial;
+  Tables _fid;
+  std::vector<Tables> _derivative;
+};
+
+#endif
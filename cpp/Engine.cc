@@ -17,6 +17,8 @@
 #include<numeric>
 #include<iostream>
 #include<stdexcept>
+#include<string>
+#include<cmath>
 //--------------------
 // C 
 //----------------
@@ -36,6 +38,163 @@ Engine::Engine():_lmax(-1)
 // Member functions --
 //-----------------
 
+static void checkSize(size_t out,size_t expected,const char* what){
+  if (out!=expected)
+    throw invalid_argument(string(what)+": output span of size "+to_string(out)+", expected "+to_string(expected));
+}
+
+void
+Engine::getHz(Span<const double> z, Span<double> Hz){
+  checkSize(Hz.size(),z.size(),"getHz");
+  if (!z.empty()) evalHz(z,Hz);
+}
+
+void
+Engine::getDa(Span<const double> z, Span<double> Da){
+  checkSize(Da.size(),z.size(),"getDa");
+  if (!z.empty()) evalDa(z,Da);
+}
+
+void
+Engine::getDv(Span<const double> z, Span<double> Dv){
+  checkSize(Dv.size(),z.size(),"getDv");
+  if (!z.empty()) evalDv(z,Dv);
+}
+
+void
+Engine::getGrowthRate(Span<const double> z, Span<double> f){
+  checkSize(f.size(),z.size(),"getGrowthRate");
+  if (!z.empty()) evalGrowthRate(z,f);
+}
+
+void
+Engine::getSigma8(Span<const double> z, Span<double> sigma8){
+  checkSize(sigma8.size(),z.size(),"getSigma8");
+  if (!z.empty()) evalSigma8(z,sigma8);
+}
+
+void
+Engine::getPk(Span<const double> k, Span<const double> z, pktype t, Span<double> pk){
+  checkSize(pk.size(),z.size()*k.size(),"getPk");
+  for (size_t i=1;i<k.size();i++){
+    if (k[i]<k[i-1]) throw invalid_argument("getPk: k must be in ascending order");
+  }
+  if (!pk.empty()) evalPk(k,z,t,pk);
+}
+
+void
+Engine::getCl(Span<const cltype> types, Span<const unsigned> l, Span<double> cl){
+  checkSize(cl.size(),types.size()*l.size(),"getCl");
+  if (!cl.empty()) evalCl(types,l,cl);
+}
+
+//default Dv: two batch lookups
+void
+Engine::evalDv(Span<const double> z, Span<double> Dv){
+  vector<double> Hz(z.size());
+  evalHz(z,Hz);
+  evalDa(z,Dv);
+  for (size_t i=0;i<z.size();i++){
+    Dv[i]=pow(pow(Dv[i]*(1+z[i]),2)*z[i]/Hz[i],1./3.);
+  }
+}
+
+double Engine::get_Dv(double z){
+  double res;
+  getDv(Span<const double>(&z,1),Span<double>(&res,1));
+  return res;
+}
+
+double Engine::get_Da(double z){
+  double res;
+  getDa(Span<const double>(&z,1),Span<double>(&res,1));
+  return res;
+}
+
+double Engine::get_sigma8(double z){
+  double res;
+  getSigma8(Span<const double>(&z,1),Span<double>(&res,1));
+  return res;
+}
+
+double Engine::get_f(double z){
+  double res;
+  getGrowthRate(Span<const double>(&z,1),Span<double>(&res,1));
+  return res;
+}
+
+double Engine::get_Hz(double z){
+  double res;
+  getHz(Span<const double>(&z,1),Span<double>(&res,1));
+  return res;
+}
+
+double Engine::get_Fz(double z){
+  double H_z=get_Hz(z);
+  double D_ang=get_Da(z);
+  double F_z = (1.+z) * D_ang * H_z /(3.e8) ; // is there speed of light somewhere ?
+  return F_z;
+}
+
+// ATTENTION FONCTION BIDON - GET omegam ! -------------------
+double Engine::get_Az(double z){
+  double Dv = get_Dv(z);
+  // A(z)=100DV(z)sqrt(~mh2)/cz
+  double omega_bidon = 0.12 ;
+  double Az = 100.*Dv*sqrt(omega_bidon)/(3.e8*z); // is there speed of light somewhere ?
+  return Az;
+}
+//      --------------------------
+
+double
+Engine::getCl(cltype t,const long &l){
+  double res;
+  unsigned ul=static_cast<unsigned>(l);
+  getCl(Span<const cltype>(&t,1),Span<const unsigned>(&ul,1),Span<double>(&res,1));
+  return res;
+}
+
+void
+Engine::getCls(const std::vector<unsigned>& lvec, //input
+	       std::vector<double>& cltt,
+	       std::vector<double>& clte,
+	       std::vector<double>& clee,
+	       std::vector<double>& clbb)
+{
+  const cltype types[4]={TT,TE,EE,BB};
+  const size_t n=lvec.size();
+  vector<double> cl(4*n);
+  getCl(Span<const cltype>(types,4),lvec,cl);
+
+  cltt.assign(cl.begin(),cl.begin()+n);
+  clte.assign(cl.begin()+n,cl.begin()+2*n);
+  clee.assign(cl.begin()+2*n,cl.begin()+3*n);
+  clbb.assign(cl.begin()+3*n,cl.end());
+}
+
+bool
+Engine::getLensing(const std::vector<unsigned>& lvec, //input
+		   std::vector<double>& clpp,
+		   std::vector<double>& cltp,
+		   std::vector<double>& clep)
+{
+  const cltype types[3]={PP,TP,EP};
+  const size_t n=lvec.size();
+  vector<double> cl(3*n);
+  try{
+    getCl(Span<const cltype>(types,3),lvec,cl);
+  }
+  catch(exception &e){
+    cout << __FILE__ << " : " << e.what() << endl;
+    return false;
+  }
+
+  clpp.assign(cl.begin(),cl.begin()+n);
+  cltp.assign(cl.begin()+n,cl.begin()+2*n);
+  clep.assign(cl.begin()+2*n,cl.end());
+  return true;
+}
+
 void 
 Engine::writeCls(std::ostream &of){
 
@@ -4,12 +4,27 @@
 // 	class Engine :
 //base class for Boltzmann code
 //
+// All observables are queried in batches: the caller passes the whole
+// array of redshifts (wavenumbers, multipoles) and an output array of
+// the right size, so that the cost of the virtual dispatch and of the
+// table lookups of the backend is paid once per array, not once per
+// point. The scalar accessors of the original interface are kept as
+// thin wrappers around the batch ones.
+//
+// Implementations (see the corresponding headers):
+//   ClassEngine     : full CLASS run
+//   BackgroundEngine: CLASS background and thermodynamics only
+//   SnapshotEngine  : tables of another engine, interpolated
+//   EmulatorEngine  : snapshot linearised in the cosmological parameters
+//   CachingEngine   : decorator memoising the queries of another engine
+//
 //
 // Author List:
 //	Stephane Plaszczynski (plaszczy@lal.in2p3.fr)
 //
 // History (add to end):
-//	creation:   Tue Mar 13 15:28:50 CET 2012 
+//	creation:   Tue Mar 13 15:28:50 CET 2012
+//	batch queries over spans, several backends
 //
 //------------------------------------------------------------------------
 
@@ -18,13 +33,39 @@
 
 #include<vector>
 #include<ostream>
+#include<cstddef>
+
+//////////////////////////////////////////////////////////////////////////
+//non-owning view on a contiguous array (pointer+size)
+//can be built from any container with data() and size() (std::vector...)
+template<typename T>
+class Span
+{
+public:
+  Span():_data(0),_size(0){};
+  Span(T* data,size_t size):_data(data),_size(size){};
+  template<typename C> Span(C& c):_data(c.data()),_size(c.size()){};
+
+  inline T* data() const {return _data;}
+  inline size_t size() const {return _size;}
+  inline bool empty() const {return _size==0;}
+  inline T& operator[](size_t i) const {return _data[i];}
+  inline T* begin() const {return _data;}
+  inline T* end() const {return _data+_size;}
+
+private:
+  T* _data;
+  size_t _size;
+};
 
+///////////////////////////////////////////////////////////////////////////
 class Engine
 {
 
 public:
 
   enum cltype {TT=0,EE,TE,BB,PP,TP,EP}; //P stands for phi (lensing potential)
+  enum pktype {PK_LINEAR=0,PK_NONLINEAR};
 
   //constructors
   Engine();
@@ -32,33 +73,56 @@ public:
   //pure virtual:
   virtual bool updateParValues(const std::vector<double>& cosmopars)=0;
 
-  // units = (micro-K)^2
-  virtual void getCls(const std::vector<unsigned>& lVec, //input 
-		      std::vector<double>& cltt, 
-		      std::vector<double>& clte, 
-		      std::vector<double>& clee, 
-		      std::vector<double>& clbb)=0;
-  
+  virtual double z_drag() const=0;
+  virtual double rs_drag() const =0;
 
-  virtual bool getLensing(const std::vector<unsigned>& lVec, //input 
-			  std::vector<double>& clpp, 
-			  std::vector<double>& cltp, 
-			  std::vector<double>& clep)=0;
+  virtual double getTauReio() const=0;
 
+  //batch queries: the output span must have the size of the input one
+  //(for getPk, z.size()*k.size(); for getCl, types.size()*l.size())
+  //throw std::invalid_argument if the quantity is not available,
+  //std::out_of_range if the backend fails
+
+  //H(z) in 1/Mpc
+  void getHz(Span<const double> z, Span<double> Hz);
+  //angular diameter distance in Mpc
+  void getDa(Span<const double> z, Span<double> Da);
+  //volume averaged distance (Da^2 (1+z)^2 z/H)^1/3 in Mpc
+  void getDv(Span<const double> z, Span<double> Dv);
+  //growth rate f = dlnD/dlna
+  void getGrowthRate(Span<const double> z, Span<double> f);
+  //sigma8 of the total matter at each z
+  void getSigma8(Span<const double> z, Span<double> sigma8);
+  //P(k,z) of the total matter in Mpc^3 for k in 1/Mpc (ascending):
+  //pk[i_z*k.size()+i_k]
+  void getPk(Span<const double> k, Span<const double> z, pktype t, Span<double> pk);
+  //Cl of each type (units = (micro-K)^2, or micro-K for TP and EP):
+  //cl[i_type*l.size()+i_l]
+  void getCl(Span<const cltype> types, Span<const unsigned> l, Span<double> cl);
+
+  //scalar interface, one-point batches
+  double get_Dv(double z);
+  double get_Da(double z);
+  double get_sigma8(double z);
+  double get_f(double z);
+  double get_Fz(double z);
+  double get_Az(double z);
+  double get_Hz(double z);
 
-  virtual double z_drag() const=0;
-  virtual double rs_drag() const =0;
+  // units = (micro-K)^2
+  double getCl(cltype t,const long &l);
 
-  virtual double get_Dv(double z)=0;
-  
-  virtual double get_Da(double z)=0;
-  virtual double get_sigma8(double z)=0;
-  virtual double get_f(double z)=0;
-  virtual double get_Fz(double z)=0;
-  virtual double get_Az(double z)=0;
-  virtual double get_Hz(double z)=0;
+  void getCls(const std::vector<unsigned>& lVec, //input
+	      std::vector<double>& cltt,
+	      std::vector<double>& clte,
+	      std::vector<double>& clee,
+	      std::vector<double>& clbb);
 
-  virtual double getTauReio() const=0;
+  //false if lensing is not available
+  bool getLensing(const std::vector<unsigned>& lVec, //input
+		  std::vector<double>& clpp,
+		  std::vector<double>& cltp,
+		  std::vector<double>& clep);
 
   // destructor
   virtual ~Engine(){};
@@ -70,6 +134,17 @@ public:
 protected:
   int _lmax;
 
+  //backend implementations of the batch queries, called with spans of
+  //checked sizes
+  virtual void evalHz(Span<const double> z, Span<double> Hz)=0;
+  virtual void evalDa(Span<const double> z, Span<double> Da)=0;
+  //default: from evalDa and evalHz
+  virtual void evalDv(Span<const double> z, Span<double> Dv);
+  virtual void evalGrowthRate(Span<const double> z, Span<double> f)=0;
+  virtual void evalSigma8(Span<const double> z, Span<double> sigma8)=0;
+  virtual void evalPk(Span<const double> k, Span<const double> z, pktype t, Span<double> pk)=0;
+  virtual void evalCl(Span<const cltype> types, Span<const unsigned> l, Span<double> cl)=0;
+
 };
 
 #endif
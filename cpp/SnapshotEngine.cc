@@ -0,0 +1,238 @@
+//--------------------------------------------------------------------------
+//
+// Description:
+// 	class SnapshotEngine : see header file (SnapshotEngine.hh) for description.
+//
+//------------------------------------------------------------------------
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "SnapshotEngine.hh"
+//--------------------
+// C++
+//--------------------
+#include<cmath>
+#include<algorithm>
+#include<stdexcept>
+#include<string>
+
+using namespace std;
+
+//position of x in the ascending grid: index i of the lower node, weight w of the upper one
+//(out of range if x is outside the grid)
+static void locate(const vector<double>& grid,double x,size_t& i,double& w,const char* what){
+  if (grid.size()<2 || x<grid.front() || x>grid.back())
+    throw out_of_range(string(what)+": "+to_string(x)+" outside of the snapshot range");
+  i=upper_bound(grid.begin(),grid.end(),x)-grid.begin();
+  if (i==grid.size()) i--;
+  i--;
+  w=(x-grid[i])/(grid[i+1]-grid[i]);
+}
+
+//---------------
+// Constructors --
+//----------------
+SnapshotEngine::SnapshotEngine(Engine& source,
+                               const vector<double>& z_bg,
+                               const vector<double>& z_pk,
+                               const vector<double>& k):
+  _source(source),_z_bg(z_bg),_z_pk(z_pk),_k(k)
+{
+  _lmax=source.lmax();
+  for (size_t i=0;i<_k.size();i++) _lnk.push_back(log(_k[i]));
+  take();
+}
+
+SnapshotEngine::SnapshotEngine(Engine& source,
+                               const vector<double>& z_bg,
+                               const vector<double>& z_pk,
+                               const vector<double>& k,
+                               bool take_now):
+  _source(source),_z_bg(z_bg),_z_pk(z_pk),_k(k)
+{
+  _lmax=source.lmax();
+  for (size_t i=0;i<_k.size();i++) _lnk.push_back(log(_k[i]));
+  if (take_now) take();
+}
+
+//-----------------
+// Member functions --
+//-----------------
+bool
+SnapshotEngine::updateParValues(const std::vector<double>& par){
+  if (!_source.updateParValues(par)) return false;
+  take();
+  return true;
+}
+
+void
+SnapshotEngine::take(){
+  tabulate(_tab);
+}
+
+void
+SnapshotEngine::tabulate(Tables& t){
+
+  t.z_drag=_source.z_drag();
+  t.rs_drag=_source.rs_drag();
+  t.tau_reio=_source.getTauReio();
+
+  t.Hz.resize(_z_bg.size());
+  t.Da.resize(_z_bg.size());
+  t.f.resize(_z_bg.size());
+  _source.getHz(_z_bg,t.Hz);
+  _source.getDa(_z_bg,t.Da);
+  _source.getGrowthRate(_z_bg,t.f);
+
+  //quantities the source may not provide: empty tables
+  t.sigma8.resize(_z_pk.size());
+  try{
+    _source.getSigma8(_z_pk,t.sigma8);
+  }
+  catch(invalid_argument &e){
+    t.sigma8.clear();
+  }
+
+  t.lnpk.resize(_z_pk.size()*_k.size());
+  try{
+    _source.getPk(_k,_z_pk,PK_LINEAR,t.lnpk);
+  }
+  catch(invalid_argument &e){
+    t.lnpk.clear();
+  }
+  t.lnpk_nl.resize(_z_pk.size()*_k.size());
+  try{
+    _source.getPk(_k,_z_pk,PK_NONLINEAR,t.lnpk_nl);
+  }
+  catch(invalid_argument &e){
+    t.lnpk_nl.clear();
+  }
+  for (size_t i=0;i<t.lnpk.size();i++) t.lnpk[i]=log(t.lnpk[i]);
+  for (size_t i=0;i<t.lnpk_nl.size();i++) t.lnpk_nl[i]=log(t.lnpk_nl[i]);
+
+  //find the available Cl types, then get them all in one call
+  vector<cltype> types;
+  for (int type=TT;type<=EP;type++){
+    t.cl[type].clear();
+    if (_lmax<2) continue;
+    try{
+      _source.getCl(static_cast<cltype>(type),2);
+      types.push_back(static_cast<cltype>(type));
+    }
+    catch(invalid_argument &e){
+    }
+  }
+  if (!types.empty()){
+    vector<unsigned> l(_lmax-1);
+    for (size_t i=0;i<l.size();i++) l[i]=i+2;
+    vector<double> cl(types.size()*l.size());
+    _source.getCl(types,l,cl);
+    for (size_t i=0;i<types.size();i++){
+      t.cl[types[i]].assign(cl.begin()+i*l.size(),cl.begin()+(i+1)*l.size());
+    }
+  }
+}
+
+void
+SnapshotEngine::Tables::axpy(double a,const Tables& x){
+  for (size_t i=0;i<Hz.size();i++) Hz[i]+=a*x.Hz[i];
+  for (size_t i=0;i<Da.size();i++) Da[i]+=a*x.Da[i];
+  for (size_t i=0;i<f.size();i++) f[i]+=a*x.f[i];
+  for (size_t i=0;i<sigma8.size();i++) sigma8[i]+=a*x.sigma8[i];
+  for (size_t i=0;i<lnpk.size();i++) lnpk[i]+=a*x.lnpk[i];
+  for (size_t i=0;i<lnpk_nl.size();i++) lnpk_nl[i]+=a*x.lnpk_nl[i];
+  for (int type=TT;type<=EP;type++){
+    for (size_t i=0;i<cl[type].size();i++) cl[type][i]+=a*x.cl[type][i];
+  }
+  z_drag+=a*x.z_drag;
+  rs_drag+=a*x.rs_drag;
+  tau_reio+=a*x.tau_reio;
+}
+
+void
+SnapshotEngine::Tables::scale(double a){
+  for (size_t i=0;i<Hz.size();i++) Hz[i]*=a;
+  for (size_t i=0;i<Da.size();i++) Da[i]*=a;
+  for (size_t i=0;i<f.size();i++) f[i]*=a;
+  for (size_t i=0;i<sigma8.size();i++) sigma8[i]*=a;
+  for (size_t i=0;i<lnpk.size();i++) lnpk[i]*=a;
+  for (size_t i=0;i<lnpk_nl.size();i++) lnpk_nl[i]*=a;
+  for (int type=TT;type<=EP;type++){
+    for (size_t i=0;i<cl[type].size();i++) cl[type][i]*=a;
+  }
+  z_drag*=a;
+  rs_drag*=a;
+  tau_reio*=a;
+}
+
+void
+SnapshotEngine::interpolateInZ(const vector<double>& table,const vector<double>& zgrid,
+                               Span<const double> z, Span<double> out, const char* what) const
+{
+  if (table.empty()) throw invalid_argument(string("no ")+what+" in snapshot");
+  size_t i;
+  double w;
+  for (size_t j=0;j<z.size();j++){
+    locate(zgrid,z[j],i,w,what);
+    out[j]=(1.-w)*table[i]+w*table[i+1];
+  }
+}
+
+void
+SnapshotEngine::evalHz(Span<const double> z, Span<double> Hz){
+  interpolateInZ(_tab.Hz,_z_bg,z,Hz,"H(z)");
+}
+
+void
+SnapshotEngine::evalDa(Span<const double> z, Span<double> Da){
+  interpolateInZ(_tab.Da,_z_bg,z,Da,"Da(z)");
+}
+
+void
+SnapshotEngine::evalGrowthRate(Span<const double> z, Span<double> f){
+  interpolateInZ(_tab.f,_z_bg,z,f,"f(z)");
+}
+
+void
+SnapshotEngine::evalSigma8(Span<const double> z, Span<double> sigma8){
+  interpolateInZ(_tab.sigma8,_z_pk,z,sigma8,"sigma8(z)");
+}
+
+void
+SnapshotEngine::evalPk(Span<const double> k, Span<const double> z, pktype t, Span<double> pk){
+
+  const vector<double>& lnpk = (t==PK_NONLINEAR) ? _tab.lnpk_nl : _tab.lnpk;
+  if (lnpk.empty()) throw invalid_argument((t==PK_NONLINEAR) ? "no non-linear P(k) in snapshot" : "no P(k) in snapshot");
+
+  const size_t nk=_k.size();
+
+  //positions in ln k are common to all redshifts
+  vector<size_t> ik(k.size());
+  vector<double> wk(k.size());
+  for (size_t j=0;j<k.size();j++) locate(_lnk,log(k[j]),ik[j],wk[j],"k");
+
+  size_t iz;
+  double wz;
+  for (size_t m=0;m<z.size();m++){
+    locate(_z_pk,z[m],iz,wz,"z");
+    const double* lo=&lnpk[iz*nk];
+    const double* hi=&lnpk[(iz+1)*nk];
+    for (size_t j=0;j<k.size();j++){
+      double a=(1.-wk[j])*lo[ik[j]]+wk[j]*lo[ik[j]+1];
+      double b=(1.-wk[j])*hi[ik[j]]+wk[j]*hi[ik[j]+1];
+      pk[m*k.size()+j]=exp((1.-wz)*a+wz*b);
+    }
+  }
+}
+
+void
+SnapshotEngine::evalCl(Span<const cltype> types, Span<const unsigned> l, Span<double> cl){
+  for (size_t i=0;i<types.size();i++){
+    const vector<double>& table=_tab.cl[types[i]];
+    if (table.empty()) throw invalid_argument("Cl type "+to_string((int)types[i])+" not in snapshot");
+    for (size_t j=0;j<l.size();j++){
+      if (l[j]<2 || l[j]-2>=table.size()) throw out_of_range("l="+to_string(l[j])+" outside of the snapshot range");
+      cl[i*l.size()+j]=table[l[j]-2];
+    }
+  }
+}
@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------
+//
+// Description:
+// 	class SnapshotEngine :
+// tables of the observables of another engine, taken once per
+// parameter point and interpolated afterwards: background quantities
+// linearly in z, ln P(k,z) linearly in (ln k, z), Cl exactly for
+// 2<=l<=lmax. A query outside the tabulated range throws
+// std::out_of_range, a quantity the source could not provide throws
+// std::invalid_argument.
+//
+//
+// History (add to end):
+//	creation:   Mon Oct 19 2026
+//
+//------------------------------------------------------------------------
+
+#ifndef SnapshotEngine_hh
+#define SnapshotEngine_hh
+
+#include"Engine.hh"
+//STD
+#include<vector>
+
+///////////////////////////////////////////////////////////////////////////
+class SnapshotEngine : public Engine
+{
+
+public:
+  //z_bg: redshifts (ascending) for H, Da, Dv and f
+  //z_pk: redshifts (ascending) for sigma8 and P(k), k: wavenumbers (ascending) for P(k)
+  //(z_pk or k may be empty if not needed)
+  SnapshotEngine(Engine& source,
+                 const std::vector<double>& z_bg,
+                 const std::vector<double>& z_pk,
+                 const std::vector<double>& k);
+
+  ~SnapshotEngine(){};
+
+  //updates the source and takes a new snapshot
+  bool updateParValues(const std::vector<double>& par);
+
+  //takes a new snapshot of the current state of the source
+  void take();
+
+  double z_drag() const {return _tab.z_drag;}
+  double rs_drag() const {return _tab.rs_drag;}
+  double getTauReio() const {return _tab.tau_reio;}
+
+protected:
+
+  //all tables of a snapshot; an empty table means not available
+  struct Tables {
+    std::vector<double> Hz,Da,f;    //[i_z_bg]
+    std::vector<double> sigma8;     //[i_z_pk]
+    std::vector<double> lnpk,lnpk_nl; //[i_z_pk*k_size+i_k]
+    std::vector<double> cl[EP+1];   //[l-2], per cltype
+    double z_drag,rs_drag,tau_reio;
+
+    //this += a*x, tables of the same shape
+    void axpy(double a,const Tables& x);
+    //this *= a
+    void scale(double a);
+  };
+
+  //for derived classes filling the tables themselves
+  SnapshotEngine(Engine& source,
+                 const std::vector<double>& z_bg,
+                 const std::vector<double>& z_pk,
+                 const std::vector<double>& k,
+                 bool take_now);
+
+  //tabulate the current state of the source
+  void tabulate(Tables& t);
+
+  void evalHz(Span<const double> z, Span<double> Hz);
+  void evalDa(Span<const double> z, Span<double> Da);
+  void evalGrowthRate(Span<const double> z, Span<double> f);
+  void evalSigma8(Span<const double> z, Span<double> sigma8);
+  void evalPk(Span<const double> k, Span<const double> z, pktype t, Span<double> pk);
+  void evalCl(Span<const cltype> types, Span<const unsigned> l, Span<double> cl);
+
+  Engine& _source;
+  std::vector<double> _z_bg,_z_pk,_k,_lnk;
+  Tables _tab;
+
+private:
+  void interpolateInZ(const std::vector<double>& table,const std::vector<double>& zgrid,
+                      Span<const double> z, Span<double> out, const char* what) const;
+};
+
+#endif
@@ -1,5 +1,7 @@
 //KLASS
 #include"ClassEngine.hh"
+#include"CachingEngine.hh"
+#include"SnapshotEngine.hh"
 
 #include <iostream>
 #include <fstream>
@@ -26,7 +28,7 @@ int main(int argc,char** argv){
 
   pars.add("k_pivot",0.05);
   pars.add("YHe",0.25);
-  pars.add("output","tCl,pCl,lCl"); //pol +clphi
+  pars.add("output","tCl,pCl,lCl,mPk"); //pol +clphi +P(k)
 
   pars.add("l_max_scalars",l_max_scalars);
   pars.add("lensing",true); //note boolean
@@ -36,8 +38,8 @@ int main(int argc,char** argv){
   pars.add("perturbations_verbose",1);
   pars.add("transfer_verbose",1);
   pars.add("primordial_verbose",1);
-  pars.add("spectra_verbose",1);
-  pars.add("nonlinear_verbose",1);
+  pars.add("harmonic_verbose",1);
+  pars.add("fourier_verbose",1);
   pars.add("lensing_verbose",1);
 
   ClassEngine* tKlass(0);
@@ -60,6 +62,27 @@ int main(int argc,char** argv){
     outfile.open(outfile_name, ios::out | ios::trunc );
     tKlass->writeCls(outfile);
     cout << "Cl's written in file " << outfile_name << endl;
+
+    //batch queries: one call per array, through any backend
+    vector<double> z={0.38,0.51,0.61,1.0,1.5};
+    vector<double> Dv(z.size()),Hz(z.size());
+
+    CachingEngine cached(*tKlass);
+    cached.getDv(z,Dv);
+    cached.getHz(z,Hz);
+    cached.getDv(z,Dv); //from the cache
+
+    //tables on a grid, interpolated
+    vector<double> zgrid(201);
+    for (size_t i=0;i<zgrid.size();i++) zgrid[i]=0.01*i;
+    SnapshotEngine snapshot(*tKlass,zgrid,vector<double>(),vector<double>());
+    vector<double> Dv_snapshot(z.size());
+    snapshot.getDv(z,Dv_snapshot);
+
+    for (size_t i=0;i<z.size();i++){
+      cout << "z=" << z[i] << "\tH=" << Hz[i] << "/Mpc\tDv=" << Dv[i] << " Mpc (snapshot: " << Dv_snapshot[i] << ")" << endl;
+    }
+    cout << "cache: " << cached.hits() << " hits, " << cached.misses() << " misses" << endl;
   }
   catch (std::exception &e){
     cout << "GOSH" << e.what() << endl;
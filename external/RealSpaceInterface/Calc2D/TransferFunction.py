@@ -25,7 +25,9 @@ def ComputeTransferData(settings, redshift):
         cosmo.set(settings)
         cosmo.compute()
 
-        outputData = [cosmo.get_transfer(z) for z in redshift]
+        # all redshifts in a single sweep through the table of sources
+        transfers = cosmo.get_transfer(np.asarray(redshift, dtype=float))
+        outputData = [{field: transfers[field][i] for field in transfers} for i in range(len(redshift))]
         # Calculate d_g/4+psi
         for transfer_function_dict in outputData:
             transfer_function_dict["d_g/4 + psi"] = transfer_function_dict["d_g"]/4 + transfer_function_dict["psi"]
@@ -463,11 +463,23 @@ extern "C" {
                                     double * test
                                     );
 
+  int background_ncdm_psd_file(
+                               struct background * pba,
+                               char * filename,
+                               struct background_parameters_for_distributions * pbadist
+                               );
+
   int background_ncdm_init(
                            struct precision *ppr,
                            struct background *pba
                            );
 
+  int background_ncdm_sampling(
+                               struct precision *ppr,
+                               struct background *pba,
+                               struct background_parameters_for_distributions * pbadist
+                               );
+
   int background_ncdm_momenta(
                               double * qvec,
                               double * wvec,
@@ -627,6 +639,8 @@ extern "C" {
 #define _PSD_DERIVATIVE_EXP_MIN_ -30 /**< for ncdm, for accurate computation of dlnf0/dlnq, q step is varied in range specified by these parameters */
 #define _PSD_DERIVATIVE_EXP_MAX_ 2  /**< for ncdm, for accurate computation of dlnf0/dlnq, q step is varied in range specified by these parameters */
 
+#define _NCDM_SAMPLING_COST_ 2.e-4 /**< calibrated cost in seconds of the q-sampling of one ncdm species, used to choose the number of threads */
+
 #define _zeta3_ 1.2020569031595942853997381615114499907649862923404988817922 /**< for quandrature test function */
 #define _zeta5_ 1.0369277551433699263313654864570341680570809195019128119741 /**< for quandrature test function */
 
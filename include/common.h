@@ -59,6 +59,8 @@ typedef char FileName[_FILENAMESIZE_];
 
 #define _EPSILON_ 1.e-10
 
+#define _THREAD_OVERHEAD_ 1.e-5 /**< default estimate of the cost in seconds of each thread taking part in a parallel region (fork/join, workspace allocation, false sharing), see class_number_of_threads() */
+
 #define _OUTPUTPRECISION_ 12 /**< Number of significant digits in some output files */
 
 #define _COLUMNWIDTH_ 24 /**< Must be at least _OUTPUTPRECISION_+8 for guaranteed fixed width columns */
@@ -92,6 +94,8 @@ int file_exists(const char *fname);
 int compare_doubles(const void * a,
                     const void * b);
 int string_begins_with(char* thestring, char beginchar);
+int class_memory_usage(double * resident, double * peak);
+int class_number_of_threads(double items, double cost_per_item, double thread_overhead, int threads_requested);
 
 /* general CLASS macros */
 
@@ -404,4 +408,6 @@ struct precision
 
 };
 
+int class_precision_equal(struct precision * ppr1, struct precision * ppr2);
+
 #endif
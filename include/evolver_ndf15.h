@@ -82,6 +82,8 @@ extern "C" {
                    double tolx,
                    double tolF,
                    void *param,
+                   double *jacobian,
+                   int *has_jacobian,
                    int *fevals,
                    ErrorMsg error_message);
 
@@ -115,6 +117,31 @@ int evolver_ndf15(
 		ErrorMsg error_message),
 	ErrorMsg error_message);
 
+int evolver_ndf15_with_experience(
+	int (*derivs)(double x,double * y,double * dy,
+		void * parameters_and_workspace, ErrorMsg error_message),
+	double x_ini,
+	double x_final,
+	double * y_inout,
+ 	int * used_in_output,
+	int neq,
+	void * parameters_and_workspace_for_derivs,
+	double rtol,
+	double minimum_variation,
+	int (*timescale_and_approximation)(double x,
+					   void * parameters_and_workspace,
+					   double * timescales,
+					   ErrorMsg error_message),
+	double timestep_over_timescale,
+	double * t_vec,
+	int t_res,
+	int (*output)(double x,double y[],double dy[],int index_x,void * parameters_and_workspace,
+		ErrorMsg error_message),
+	int (*print_variables)(double x, double y[], double dy[], void *parameters_and_workspace,
+		ErrorMsg error_message),
+	double * jacvec_inout,
+	ErrorMsg error_message);
+
 
 #ifdef __cplusplus
 }
@@ -48,6 +48,7 @@ struct fourier {
   double c_min;      /** for HMcode: minimum concentration in Bullock 2001 mass-concentration relation */
   double eta_0;      /** for HMcode: halo bloating parameter */
   double z_infinity; /** for HMcode: z value at which Dark Energy correction is evaluated needs to be at early times (default */
+  short hmcode_fast_feedback; /** for HMcode: store the halo tables needed to re-evaluate P_NL for new (c_min, eta_0) with fourier_hmcode_update_feedback() */
 
   short has_pk_eq;  /**< flag: in case wa_fld is defined and non-zero, should we use the pk_eq method? */
 
@@ -98,6 +99,13 @@ struct fourier {
   double * k;      /**< k[index_k] = list of k values */
   double * ln_k;   /**< ln_k[index_k] = list of log(k) values */
 
+  int k_size_solved;  /**< number of k values for which the sources were integrated by the perturbation module;
+                         smaller than k_size when P(k,z) is extended by an analytic tail up to ppt->k_max_pk_tail */
+  int tail_fit_size;  /**< number of last integrated k values used to fit the slope of the analytic tail */
+  double * tail_cb_fraction; /**< tail_cb_fraction[index_tau] = rho_cb/rho_m at each time of the source table,
+                                giving the asymptotic ratio delta_m/delta_cb in the analytic tail
+                                (only allocated with an analytic tail and massive neutrinos) */
+
   double * ln_tau;     /**< log(tau) array, only needed if user wants
                           some output at z>0, instead of only z=0.  This
                           array only covers late times, used for the
@@ -169,6 +177,32 @@ struct fourier {
 
   //@}
 
+  /** @name - HMcode tables stored when hmcode_fast_feedback is true.
+      They contain all the quantities entering the 1-halo and 2-halo
+      terms that do not depend on the baryonic feedback parameters
+      (c_min, eta_0) */
+
+  //@{
+
+  int hm_mass_size;       /**< number of masses in the 1-halo integral (= nsteps_for_p1h_integral) */
+  double * hm_mass;       /**< hm_mass[index_mass] = mass in M_sun, identical for all pk types and times */
+
+  short ** hm_computable; /**< hm_computable[index_pk][index_tau]: could P_NL be computed at this time? */
+  int ** hm_index_cut;    /**< hm_index_cut[index_pk][index_tau]: number of masses below the cut nu=10 */
+  double ** hm_sigma8;    /**< hm_sigma8[index_pk][index_tau] */
+  double ** hm_sigma_disp;/**< hm_sigma_disp[index_pk][index_tau] */
+  double ** hm_fdamp;     /**< hm_fdamp[index_pk][index_tau]: damping factor of the 2-halo term */
+  double ** hm_alpha;     /**< hm_alpha[index_pk][index_tau]: smoothing parameter of the 1-halo to 2-halo transition */
+  double * hm_rho_m;      /**< hm_rho_m[index_pk] = matter density today (cb or total) in M_sun/Mpc^3 */
+
+  double ** hm_nu;        /**< hm_nu[index_pk][index_tau * pfo->hm_mass_size + index_mass] = delta_c/sigma(M) */
+  double ** hm_r_virial;  /**< hm_r_virial[index_pk][index_tau * pfo->hm_mass_size + index_mass] */
+  double ** hm_conc1;     /**< hm_conc1[index_pk][index_tau * pfo->hm_mass_size + index_mass] = halo concentration divided by c_min */
+
+  double ** hm_ln_pk_l;   /**< hm_ln_pk_l[index_pk][index_tau * pfo->k_size + index_k] = linear spectrum used by HMcode at each time */
+
+  //@}
+
   /** @name - parameters for the pk_eq method */
 
   //@{
@@ -330,6 +364,14 @@ extern "C" {
                         double * k_nl_cb
                         );
 
+  int fourier_hmcode_update_feedback(
+                                     struct background *pba,
+                                     struct fourier *pfo,
+                                     enum hmcode_baryonic_feedback_model feedback,
+                                     double c_min,
+                                     double eta_0
+                                     );
+
   /* internal functions */
 
   int fourier_init(
@@ -364,6 +406,12 @@ extern "C" {
                            struct fourier * pfo
                            );
 
+  int fourier_tail_init(
+                        struct background * pba,
+                        struct perturbations * ppt,
+                        struct fourier * pfo
+                        );
+
   int fourier_get_source(
                          struct background * pba,
                          struct perturbations * ppt,
@@ -375,6 +423,16 @@ extern "C" {
                          double ** sources,
                          double * source);
 
+  int fourier_get_source_tail(
+                              struct perturbations * ppt,
+                              struct fourier * pfo,
+                              int index_k,
+                              int index_ic,
+                              int index_tp,
+                              int index_tau,
+                              double ** sources,
+                              double * source);
+
   int fourier_pk_linear(
                         struct background *pba,
                         struct perturbations *ppt,
@@ -454,6 +512,33 @@ extern "C" {
                      struct fourier_workspace * pnw
                      );
 
+  int fourier_hmcode_pk_nl(
+                           struct fourier *pfo,
+                           double *lnpk_l,
+                           double *mass,
+                           double *nu_arr,
+                           double *r_virial,
+                           double *conc,
+                           int index_cut,
+                           double eta,
+                           double k_star,
+                           double sigma_disp,
+                           double fdamp,
+                           double alpha,
+                           double rho_m_today,
+                           double *pk_nl
+                           );
+
+  int fourier_hmcode_tables_init(
+                                 struct precision *ppr,
+                                 struct background *pba,
+                                 struct fourier *pfo
+                                 );
+
+  int fourier_hmcode_tables_free(
+                                 struct fourier *pfo
+                                 );
+
   int fourier_hmcode_workspace_init(
                                     struct precision *ppr,
                                     struct background *pba,
@@ -5,6 +5,9 @@
 
 #include "transfer.h"
 
+/* calibrated cost in seconds of one wavenumber in the integral giving one column of the C_l's at one l, used to choose the number of threads */
+#define _HARMONIC_COST_ 3.e-8
+
 /**
  * Structure containing everything about anisotropy and Fourier power spectra that other modules need to know.
  *
@@ -82,6 +85,30 @@ struct harmonic {
 
   //@}
 
+  /** @name - nuisance-separable components of number count spectra */
+
+  //@{
+
+  int has_nc_components; /**< do we store the number count spectra split in components with a simple dependence on the light-to-mass bias b and magnification bias s? (only if the same flag is set in the transfer structure) */
+
+  int has_ncc_density;  /**< is there a component proportional to b? */
+  int has_ncc_unbiased; /**< are there components independent of b (and proportional to s)? */
+
+  int index_ncc_density;       /**< index for the number count component proportional to b (density term) */
+  int index_ncc_unbiased;      /**< index for the number count component independent of b and s (rsd, doppler, lensing and gr terms at s=0) */
+  int index_ncc_magnification; /**< index for the number count component proportional to s */
+  int ncc_size;                /**< number of number count components */
+
+  int index_ncct_dd; /**< first index for components of \f$ C_l^{dd} \f$ (ncc_size*ncc_size values for each pair of bins) */
+  int index_ncct_td; /**< first index for components of \f$ C_l^{Td} \f$ (ncc_size values for each bin) */
+  int index_ncct_pd; /**< first index for components of \f$ C_l^{pd} \f$ (ncc_size values for each bin) */
+  int index_ncct_dl; /**< first index for components of \f$ C_l^{dl} \f$ (ncc_size values for each pair of bins) */
+  int ncct_size;     /**< number of component spectra */
+
+  double * cl_nc; /**< table of component spectra for scalar modes, cl_nc[(index_l * phr->ic_ic_size[index_md_scalars] + index_ic1_ic2) * phr->ncct_size + index_ncct]. For dd, the component (c1,c2) of the pair of bins (d1,d2) is at index_ncct_dd + (index_pair*ncc_size + c1)*ncc_size + c2, with pairs ordered like in cl */
+
+  //@}
+
   /** @name - table of pre-computed C_l values, and related quantities */
 
   //@{
@@ -156,6 +183,29 @@ extern "C" {
                        double ** cl_md_ic
                        );
 
+  int harmonic_cl_number_count_recombine(
+                                         struct harmonic * phr,
+                                         double * selection_bias,
+                                         double * selection_magnification_bias
+                                         );
+
+  int harmonic_cl_covariance(
+                             struct harmonic * phr,
+                             int l_min,
+                             int l_max,
+                             int delta_l,
+                             double fsky,
+                             double * noise,
+                             double * covariance
+                             );
+
+  int harmonic_cl_covariance_fields(
+                                    struct harmonic * phr,
+                                    int * field_size,
+                                    int * ct_field1,
+                                    int * ct_field2
+                                    );
+
   /* internal functions */
 
   int harmonic_init(
@@ -181,6 +231,7 @@ extern "C" {
                        );
 
   int harmonic_cls(
+                   struct precision * ppr,
                    struct background * pba,
                    struct perturbations * ppt,
                    struct transfer * ptr,
@@ -205,6 +256,17 @@ extern "C" {
                           double * transfer_ic2
                           );
 
+  int harmonic_integrate_cl(
+                            struct background * pba,
+                            struct transfer * ptr,
+                            struct harmonic * phr,
+                            int cl_integrand_num_columns,
+                            double * cl_integrand,
+                            int index_column,
+                            int index_ddcolumn,
+                            double * clvalue
+                            );
+
   int harmonic_k_and_tau(
                          struct background * pba,
                          struct perturbations * ppt,
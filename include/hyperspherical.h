@@ -12,7 +12,10 @@
 #define _TRIG_PRECISSION_ 1e-7
 #define _HYPER_BLOCK_ 8
 #define _HYPER_CHUNK_ 16
+#define _HYPER_COST_ 4.e-9 /**< calibrated cost in seconds of one multipole at one x in the table of hyperspherical Bessel functions, used to choose the number of threads */
 #define _TWO_OVER_THREE_ 0.666666666666666666666666666667e0
+#define _CHEB_SIZE_MAX_ 32
+#define _AIRY_XI_MIN_ 12.3468394516 //(2/3)*7^(3/2): beyond it, Ai(z) is given by coef1() or coef4()
 #define _HIS_BYTE_ALIGNMENT_ 16
 
 typedef struct HypersphericalInterpolationStructure{
@@ -21,13 +24,14 @@ typedef struct HypersphericalInterpolationStructure{
   double delta_x;         //x-spacing. (xvec is uniformly spaced)
   int trig_order;        //Order of the interpolation formula for SinK and CosK.
   int l_size;                //Number of l values
+  int l_size_table;          //Number of (lowest) l values for which phi and dphi are tabulated
   int *l;             //Vector of l values stored
   double * chi_at_phimin;     // vector x_min[index-l] below which neglect Bessels
   int x_size;                //Number of x-values
   double *x;          //Pointer to x-values
   double *sinK;          //Vector of sin_K(xvec)
   double *cotK;          //Vector of cot_K(xvec)
-  double *phi;        //array of size nl*nx. [y_{l1}(x1) t_{l1}(x2)...]
+  double *phi;        //array of size l_size_table*nx. [y_{l1}(x1) t_{l1}(x2)...]
   double *dphi;       //Same as phivec, but containing derivatives.
 } HyperInterpStruct;
 
@@ -107,6 +111,14 @@ int hyperspherical_forwards_recurrence_chunk(int K,
                              double *sinK_vec,
                              int size_sinK_vec,
                              double *Phi);
+  int hyperspherical_flat_asymptotic_vector(int l,
+                                            double beta,
+                                            int x_size,
+                                            double *x,
+                                            double *Phi,
+                                            double *dPhi,
+                                            double *d2Phi);
+  double hyperspherical_flat_asymptotic(double nu, double x, double *dPhi);
   int ClosedModY(int l, int beta, double *y, int * phisign, int * dphisign);
   int get_CF1(int K,int l,double beta, double cotK, double *CF, int *isign);
   int CF1_from_Gegenbauer(int l, int beta, double sinK, double cotK, double *CF);
@@ -115,7 +127,10 @@ int hyperspherical_forwards_recurrence_chunk(int K,
   double coef2(double z);
   double coef3(double z);
   double coef4(double z);
+  double airy_scaled_oscillating(double xi, double *dF);
+  double airy_scaled_decaying(double xi, double *dF);
   double cheb(double x, int n, const double A[]);
+  double cheb_derivative(double x, int n, const double A[]);
   double get_value_at_small_phi(int K,int l,double beta,double Phi);
 
   double PhiWKB_minus_phiminabs(double x, void *param);
@@ -184,6 +199,12 @@ int hyperspherical_forwards_recurrence_chunk(int K,
   int hyperspherical_Hermite6_interpolation_vector_dPhid2Phi(HyperInterpStruct *pHIS,int nxi,int lnum,double *xinterp,double *dPhi,double *d2Phi, ErrorMsg error_message);
   int hyperspherical_Hermite6_interpolation_vector_PhidPhid2Phi(HyperInterpStruct *pHIS,int nxi,int lnum,double *xinterp,double *Phi,double *dPhi,double *d2Phi, ErrorMsg error_message);
 
+  int hyperspherical_asymptotic_vector_Phi(HyperInterpStruct *pHIS,int nxi,int lnum,double *xinterp,double *Phi, ErrorMsg error_message);
+  int hyperspherical_asymptotic_vector_dPhi(HyperInterpStruct *pHIS,int nxi,int lnum,double *xinterp,double *dPhi, ErrorMsg error_message);
+  int hyperspherical_asymptotic_vector_PhidPhi(HyperInterpStruct *pHIS,int nxi,int lnum,double *xinterp,double *Phi,double *dPhi, ErrorMsg error_message);
+  int hyperspherical_asymptotic_vector_Phid2Phi(HyperInterpStruct *pHIS,int nxi,int lnum,double *xinterp,double *Phi,double *d2Phi, ErrorMsg error_message);
+  int hyperspherical_asymptotic_vector_PhidPhid2Phi(HyperInterpStruct *pHIS,int nxi,int lnum,double *xinterp,double *Phi,double *dPhi,double *d2Phi, ErrorMsg error_message);
+
 
 #ifdef __cplusplus
 }
@@ -209,6 +209,15 @@ enum target_names {theta_s, Omega_dcdmdr, omega_dcdmdr, Omega_scf, Omega_ini_dcd
 /* Important: add one for each new target_names */
 enum computation_stage {cs_background, cs_thermodynamics, cs_perturbations, cs_primordial, cs_nonlinear, cs_transfer, cs_spectra};
 
+/**
+ * Modules run by input_compute_modules(), in the order of main/class.c
+ * (each one needs all the previous ones). The modules allocated in a
+ * set of structures are recorded in a bit mask, with the bit
+ * (1 << module) set for each of them.
+ */
+
+enum input_module {im_input, im_background, im_thermodynamics, im_perturbations, im_primordial, im_fourier, im_transfer, im_harmonic, im_lensing, im_distortions};
+
 /**
  * Structure for all temporary parameters for background fzero function
  */
@@ -274,6 +283,38 @@ extern "C" {
                            struct output *pop,
                            ErrorMsg errmsg);
 
+  int input_compute_modules(struct file_content * pfc,
+                            int size,
+                            char * names,
+                            char * values,
+                            enum input_module last_module,
+                            int * modules,
+                            enum input_module * failed_module,
+                            struct precision * ppr,
+                            struct background *pba,
+                            struct thermodynamics *pth,
+                            struct perturbations *ppt,
+                            struct transfer *ptr,
+                            struct primordial *ppm,
+                            struct harmonic *phr,
+                            struct fourier *pfo,
+                            struct lensing *ple,
+                            struct distortions *psd,
+                            struct output *pop,
+                            ErrorMsg errmsg);
+
+  int input_free_modules(int * modules,
+                         struct background *pba,
+                         struct thermodynamics *pth,
+                         struct perturbations *ppt,
+                         struct transfer *ptr,
+                         struct primordial *ppm,
+                         struct harmonic *phr,
+                         struct fourier *pfo,
+                         struct lensing *ple,
+                         struct distortions *psd,
+                         ErrorMsg errmsg);
+
   /* Functions related to shooting */
 
   int input_shooting(struct file_content * pfc,
@@ -292,6 +333,14 @@ extern "C" {
                      int * has_shooting,
                      ErrorMsg errmsg);
 
+  int input_shooting_jacobian_key(struct file_content * pfc,
+                                  struct fzerofun_workspace * pfzw,
+                                  char ** key,
+                                  int * key_size,
+                                  ErrorMsg errmsg);
+
+  int input_free_shooting_jacobians(void);
+
   int input_needs_shooting_for_target(struct file_content * pfc,
                                       enum target_names target_name,
                                       double target_value,
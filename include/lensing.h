@@ -5,6 +5,9 @@
 
 #include "harmonic.h"
 
+/* calibrated cost in seconds of one (mu,l) point in each loop of the lensing module, used to choose the number of threads */
+#define _LENSING_COST_ 1.e-9
+
 /**
  * Structure containing everything about lensed spectra that other modules need to know.
  *
@@ -87,6 +90,8 @@ struct lensing {
 
   short lensing_verbose; /**< flag regulating the amount of information sent to standard output (none if set to zero) */
 
+  int number_of_threads; /**< number of threads of the parallel loops over angles or multipoles, chosen by lensing_init() from the amount of work */
+
   ErrorMsg error_message; /**< zone for writing error messages */
 
   //@}
@@ -235,84 +240,96 @@ extern "C" {
                   double * mu,
                   int num_mu,
                   int lmax,
-                  double ** d00
+                  double ** d00,
+                  int number_of_threads
                   );
 
   int lensing_d11(
                   double * mu,
                   int num_mu,
                   int lmax,
-                  double ** d11
+                  double ** d11,
+                  int number_of_threads
                   );
 
   int lensing_d1m1(
                    double * mu,
                    int num_mu,
                    int lmax,
-                   double ** d1m1
+                   double ** d1m1,
+                   int number_of_threads
                    );
 
   int lensing_d2m2(
                    double * mu,
                    int num_mu,
                    int lmax,
-                   double ** d2m2
+                   double ** d2m2,
+                   int number_of_threads
                    );
 
   int lensing_d22(
                   double * mu,
                   int num_mu,
                   int lmax,
-                  double ** d22
+                  double ** d22,
+                  int number_of_threads
                   );
 
   int lensing_d20(
                   double * mu,
                   int num_mu,
                   int lmax,
-                  double ** d20
+                  double ** d20,
+                  int number_of_threads
                   );
 
   int lensing_d31(
                   double * mu,
                   int num_mu,
                   int lmax,
-                  double ** d3m1
+                  double ** d3m1,
+                  int number_of_threads
                   );
 
   int lensing_d3m1(
                    double * mu,
                    int num_mu,
                    int lmax,
-                   double ** d3m1
+                   double ** d3m1,
+                   int number_of_threads
                    );
 
   int lensing_d3m3(
                    double * mu,
                    int num_mu,
                    int lmax,
-                   double ** d3m3
+                   double ** d3m3,
+                   int number_of_threads
                    );
 
   int lensing_d40(
                   double * mu,
                   int num_mu,
                   int lmax,
-                  double ** d40
+                  double ** d40,
+                  int number_of_threads
                   );
 
   int lensing_d4m2(
                    double * mu,
                    int num_mu,
                    int lmax,
-                   double ** d4m2
+                   double ** d4m2,
+                   int number_of_threads
                    );
 
   int lensing_d4m4(
                    double * mu,
                    int num_mu,
                    int lmax,
-                   double ** d4m4
+                   double ** d4m4,
+                   int number_of_threads
                    );
 
 #ifdef __cplusplus
@@ -33,6 +33,12 @@ extern "C" {
 
   int parser_free(struct file_content * pfc);
 
+  int parser_set_packed(struct file_content * pfc,
+                        int size,
+                        char * names,
+                        char * values,
+                        ErrorMsg errmsg);
+
 
   int parser_read_file(char * filename,
                        struct file_content * pfc,
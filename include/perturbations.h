@@ -11,6 +11,37 @@
 
 #define _set_source_(index) ppt->sources[index_md][index_ic * ppt->tp_size[index_md] + index][index_tau * ppt->k_size[index_md] + index_k]
 
+/**
+ * Free-streaming part of a Boltzmann hierarchy, for l_min <= l < l_max:
+ * dy[l] = k/(2l+1) (l s_l[l] y[l-1] - (l+1) s_l[l+1] y[l+1]) - rate y[l]
+ */
+#define class_hierarchy_loop(dy,y,s_l,k,rate,l_min,l_max) {                           \
+    int l_loop_;                                                                        \
+    for (l_loop_=(l_min); l_loop_<(l_max); l_loop_++)                                   \
+      (dy)[l_loop_] = (k)/(2.*l_loop_+1.)*(l_loop_*(s_l)[l_loop_]*(y)[l_loop_-1]         \
+                                           -(l_loop_+1.)*(s_l)[l_loop_+1]*(y)[l_loop_+1]) \
+        - (rate)*(y)[l_loop_];                                                          \
+  }
+
+/**
+ * Same loop, dispatched on the bound frozen at compile time by a
+ * precision profile ("make PRECISION_PROFILE=file.pre", see
+ * tools/freeze_precision.py): when the runtime bound agrees, the loop
+ * is compiled with a constant trip count and can be unrolled and
+ * vectorised; otherwise the generic loop is used.
+ */
+#ifdef _PRECISION_PROFILE_
+#include "precision_profile.h"
+#define class_hierarchy(dy,y,s_l,k,rate,l_min,l_max,l_max_frozen)       \
+  if ((l_max) == (l_max_frozen))                                        \
+    class_hierarchy_loop(dy,y,s_l,k,rate,l_min,l_max_frozen)            \
+  else                                                                  \
+    class_hierarchy_loop(dy,y,s_l,k,rate,l_min,l_max)
+#else
+#define class_hierarchy(dy,y,s_l,k,rate,l_min,l_max,l_max_frozen)       \
+  class_hierarchy_loop(dy,y,s_l,k,rate,l_min,l_max)
+#endif
+
 /**
  * flags for various approximation schemes
  * (tca = tight-coupling approximation,
@@ -27,6 +58,8 @@
 enum tca_flags {tca_on, tca_off};
 enum rsa_flags {rsa_off, rsa_on};
 enum tca_idm_dr_flags {tca_idm_dr_on, tca_idm_dr_off};
+enum tca_idm_b_flags {tca_idm_b_on, tca_idm_b_off};
+enum tca_idm_g_flags {tca_idm_g_on, tca_idm_g_off};
 enum rsa_idr_flags {rsa_idr_off, rsa_idr_on};
 enum ufa_flags {ufa_off, ufa_on};
 enum ncdmfa_flags {ncdmfa_off, ncdmfa_on};
@@ -82,6 +115,25 @@ enum selection_type {gaussian,tophat,dirac};
 
 //@}
 
+//@{
+
+/**
+ * calibrated cost in seconds of the evolution of one wavenumber, used to choose the number of threads
+ */
+#define _PERTURBATIONS_COST_PER_K_ 1.e-2
+
+/**
+ * calibrated cost in seconds of the interpolation of one source at one (k,z), used to choose the number of threads
+ */
+#define _SOURCES_AT_Z_COST_ 2.e-9
+
+/**
+ * number of consecutive wavenumbers treated by the same thread in perturbations_sources_at_z_list()
+ */
+#define _SOURCES_K_BLOCK_ 64
+
+//@}
+
 
 
 /**
@@ -149,6 +201,7 @@ struct perturbations
   int l_tensor_max; /**< maximum l value for CMB tensors \f$ C_l \f$'s */
   int l_lss_max; /**< maximum l value for LSS \f$ C_l \f$'s (density and lensing potential in  bins) */
   double k_max_for_pk; /**< maximum value of k in 1/Mpc required for the output of P(k,z) and T(k,z) */
+  double k_max_for_pk_solved; /**< if positive, maximum value of k in 1/Mpc up to which perturbations are integrated for P(k,z); beyond it, the fourier module extends P(k,z) up to k_max_for_pk with a calibrated analytic tail */
 
   int selection_num;                            /**< number of selection functions
                                                    (i.e. bins) for matter density \f$ C_l \f$'s */
@@ -177,6 +230,9 @@ struct perturbations
 
   int idr_nature; /**< Nature of the interacting dark radiation (free streaming or fluid) */
 
+  double checkpoint_z; /**< if positive, redshift at which the state of each wavenumber is stored, so that a later run differing only at lower redshift can restart from there */
+  struct perturbations * checkpoint_from; /**< if not NULL, previous run (with the same checkpoint_z and the same early-time cosmology) from which wavenumbers are restarted at checkpoint_z. Not set by the input module: the caller points it to a structure that has not been freed yet */
+
   //@}
 
   /** @name - useful flags inferred from the ones above */
@@ -349,6 +405,8 @@ struct perturbations
   double k_min;     /**< minimum value (over all modes) */
   double k_max;     /**< maximum value (over all modes) */
 
+  double k_max_pk_tail; /**< if positive, maximum value of k in 1/Mpc that the fourier module must reach by extending the sources with an analytic tail (the integration having stopped at a smaller k, set by k_max_for_pk_solved) */
+
   //@}
 
   /** @name - list of conformal time values in the source table
@@ -380,6 +438,9 @@ struct perturbations
                          [index_ic * ppt->tp_size[index_md] + index_tp]
                          [index_tau * ppt->k_size + index_k] */
 
+  short release_sources;  /**< if _TRUE_, the source tables are freed by perturbations_release_sources() as soon as the last module using them is done */
+  short sources_released; /**< have the source tables been freed? (if so, perturbations_sources_at_tau() and related functions cannot be called anymore) */
+
   //@}
 
   /** @name - arrays related to the interpolation table for sources at late times, corresponding to z < z_max_pk (used for Fourier transfer function and spectra output) */
@@ -431,6 +492,37 @@ struct perturbations
 
   //@}
 
+  /** @name - states of all wavenumbers at checkpoint_z, filled when checkpoint_z > 0 */
+
+  //@{
+
+  short has_checkpoint;        /**< were states stored at checkpoint_z in this run? */
+  short checkpoint_restart;    /**< can wavenumbers be restarted from checkpoint_from in this run? */
+
+  double checkpoint_tau;       /**< conformal time at checkpoint_z */
+  int checkpoint_index_tau;    /**< first index in tau_sampling such that tau_sampling >= checkpoint_tau; sources below are copied on restart */
+
+  double checkpoint_a;           /**< scale factor at checkpoint_tau, compared between runs */
+  double checkpoint_H;           /**< Hubble rate at checkpoint_tau, compared between runs */
+  double checkpoint_dkappa;      /**< Thomson scattering rate at checkpoint_tau, compared between runs */
+  double checkpoint_exp_m_kappa; /**< \f$ e^{-\kappa} \f$ at checkpoint_tau, used to rescale the restored CMB sources */
+
+  double * checkpoint_key;       /**< early-time inputs of this run (see perturbations_early_key()), compared between runs */
+  int checkpoint_key_size;       /**< size of checkpoint_key */
+  struct precision * checkpoint_precision; /**< copy of the precision parameters of this run, compared between runs */
+
+  int * checkpoint_ap_size;      /**< checkpoint_ap_size[index_md] = number of approximations */
+  int * checkpoint_pt_size_max;  /**< checkpoint_pt_size_max[index_md] = size of the vector with all approximations off */
+
+  short ** checkpoint_stored;    /**< checkpoint_stored[index_md][index_ic * ppt->k_size[index_md] + index_k]: was the state stored for this wavenumber? */
+  int ** checkpoint_approx;      /**< checkpoint_approx[index_md][(index_ic * ppt->k_size[index_md] + index_k) * ap_size + index_ap] */
+  int ** checkpoint_pt_size;     /**< checkpoint_pt_size[index_md][index_ic * ppt->k_size[index_md] + index_k] */
+  double ** checkpoint_y;        /**< checkpoint_y[index_md][(index_ic * ppt->k_size[index_md] + index_k) * pt_size_max + index_pt] */
+  double ** checkpoint_jacvec;   /**< same for the Jacobian experience of ndf15 */
+  int ** checkpoint_used_in_sources; /**< same for the flags used_in_sources */
+
+  //@}
+
   /** @name - technical parameters */
 
   //@{
@@ -516,6 +608,15 @@ struct perturbations_vector
                             perturbations enter in the calculation of
                             source functions */
 
+  int * index_full;       /**< position of each variable in the layout
+                             with all approximations turned off (-1 if
+                             the variable exists only within an
+                             approximation) */
+
+  double * jacvec;        /**< experience of the ndf15 evolver on the
+                             increments of the numerical Jacobian, for
+                             each variable (0 if none) */
+
 };
 
 
@@ -562,6 +663,18 @@ struct perturbations_workspace
                                        perturbations and their
                                        time-derivatives */
 
+  struct perturbations_vector * pv_buffer[2]; /**< two buffers of maximum
+                                                 size, recycled for all
+                                                 wavenumbers and approximation
+                                                 schemes (pv points to one of
+                                                 them) */
+
+  struct perturbations_vector * pv_full; /**< indices of the largest vector
+                                            (all approximations off); no
+                                            values are stored here */
+
+  double * jacvec_full; /**< Jacobian experience in the layout of pv_full, used when switching approximations */
+
   double delta_rho;		    /**< total density perturbation (gives delta Too) */
   double rho_plus_p_theta;	/**< total (rho+p)*theta perturbation (gives delta Toi) */
   double rho_plus_p_shear;	/**< total (rho+p)*shear (gives delta Tij) */
@@ -585,6 +698,8 @@ struct perturbations_workspace
 
   double theta_idm; /**< interacting dark matter velocity */
   double theta_idm_prime; /**< derivative of interacting dark matter velocity in regard to conformal time */
+  double drag_idm_b; /**< idm-baryon momentum exchange rate \f$ R_{idm\_b} (\theta_{idm}-\theta_b) \f$, algebraic when tca_idm_b is on */
+  double drag_idm_g; /**< idm-photon momentum exchange rate \f$ \dot{\mu}_{idm\_g} (\theta_{idm}-\theta_g) \f$, algebraic when tca_idm_g is on */
 
   double * delta_ncdm;	/**< relative density perturbation of each ncdm species */
   double * theta_ncdm;	/**< velocity divergence theta of each ncdm species */
@@ -625,6 +740,8 @@ struct perturbations_workspace
   int index_ap_tca; /**< index for tight-coupling approximation */
   int index_ap_rsa; /**< index for radiation streaming approximation */
   int index_ap_tca_idm_dr; /**< index for dark tight-coupling approximation (idm-idr) */
+  int index_ap_tca_idm_b; /**< index for idm-baryon tight-coupling approximation */
+  int index_ap_tca_idm_g; /**< index for idm-photon tight-coupling approximation */
   int index_ap_rsa_idr; /**< index for dark radiation streaming approximation */
   int index_ap_ufa; /**< index for ur fluid approximation */
   int index_ap_ncdmfa; /**< index for ncdm fluid approximation */
@@ -674,6 +791,10 @@ struct perturbations_parameters_and_workspace {
 extern "C" {
 #endif
 
+  int perturbations_release_sources(
+                                    struct perturbations * ppt
+                                    );
+
   int perturbations_sources_at_tau(
                                    struct perturbations * ppt,
                                    int index_md,
@@ -704,6 +825,18 @@ extern "C" {
                                         double * psource_at_k_and_z
                                         );
 
+  int perturbations_sources_at_z_list(
+                                      struct background * pba,
+                                      struct perturbations * ppt,
+                                      int index_md,
+                                      int index_ic,
+                                      int tp_num,
+                                      int * index_tp,
+                                      int z_size,
+                                      double * z,
+                                      double * psources
+                                      );
+
   int perturbations_output_data_at_z(
                                      struct background * pba,
                                      struct perturbations * ppt,
@@ -713,6 +846,16 @@ extern "C" {
                                      double *data
                                      );
 
+  int perturbations_output_data_at_z_list(
+                                          struct background * pba,
+                                          struct perturbations * ppt,
+                                          enum file_format output_format,
+                                          int z_size,
+                                          double * z,
+                                          int number_of_titles,
+                                          double *data
+                                          );
+
   int perturbations_output_data_at_index_tau(
                                              struct background * pba,
                                              struct perturbations * ppt,
@@ -806,6 +949,53 @@ extern "C" {
                           struct perturbations_workspace * ppw
                           );
 
+  int perturbations_checkpoint_init(
+                                    struct precision * ppr,
+                                    struct background * pba,
+                                    struct thermodynamics * pth,
+                                    struct perturbations * ppt
+                                    );
+
+  int perturbations_early_key(
+                              struct precision * ppr,
+                              struct background * pba,
+                              struct thermodynamics * pth,
+                              struct perturbations * ppt,
+                              double * pvecback,
+                              double ** key,
+                              int * key_size
+                              );
+
+  int perturbations_checkpoint_alloc(
+                                     struct perturbations * ppt,
+                                     int index_md,
+                                     struct perturbations_workspace * ppw
+                                     );
+
+  int perturbations_checkpoint_store(
+                                     struct perturbations * ppt,
+                                     int index_md,
+                                     int index_ic,
+                                     int index_k,
+                                     struct perturbations_workspace * ppw
+                                     );
+
+  int perturbations_checkpoint_restore(
+                                       struct precision * ppr,
+                                       struct background * pba,
+                                       struct perturbations * ppt,
+                                       int index_md,
+                                       int index_ic,
+                                       int index_k,
+                                       int * approx,
+                                       struct perturbations_workspace * ppw,
+                                       short * restored
+                                       );
+
+  int perturbations_checkpoint_free(
+                                    struct perturbations * ppt
+                                    );
+
   int perturbations_prepare_k_output(
                                      struct background * pba,
                                      struct perturbations * ppt
@@ -855,6 +1045,38 @@ extern "C" {
                                 int * pa_old
                                 );
 
+  int perturbations_vector_indices(
+                                   struct precision * ppr,
+                                   struct background * pba,
+                                   struct perturbations * ppt,
+                                   int index_md,
+                                   struct perturbations_workspace * ppw,
+                                   int * approx,
+                                   struct perturbations_vector * ppv
+                                   );
+
+  int perturbations_vector_index_full(
+                                      struct background * pba,
+                                      struct perturbations * ppt,
+                                      int index_md,
+                                      struct perturbations_workspace * ppw,
+                                      struct perturbations_vector * ppv
+                                      );
+
+  int perturbations_vector_map_block(
+                                     struct perturbations_vector * ppv,
+                                     int index_pt,
+                                     int index_full,
+                                     int size
+                                     );
+
+  int perturbations_vector_alloc(
+                                 struct background * pba,
+                                 struct perturbations * ppt,
+                                 int pt_size_max,
+                                 struct perturbations_vector ** pv
+                                 );
+
   int perturbations_vector_free(
                                 struct perturbations_vector * pv
                                 );
@@ -14,7 +14,7 @@ class_precision_parameter(a_ini_over_a_today_default,double,1.e-14)
  */
 class_precision_parameter(background_Nloga,int,3000)
 /**
- * Evolver to be used for thermodynamics (rk, ndf15)
+ * Evolver to be used for background (rk, ndf15)
  */
 class_type_parameter(background_evolver,int,enum evolver_type,ndf15)
 /**
@@ -84,6 +84,10 @@ class_precision_parameter(tol_shooting_deltax,double,1.e-4)
  * Absolute tolerance of function value F during shooting (only 2D case)
  */
 class_precision_parameter(tol_shooting_deltaF,double,1.e-6)
+/**
+ * Start each shooting from the jacobian of a previous one with exactly the same input in the same process, until input_free_shooting_jacobians() (only 2D case)
+ */
+class_precision_parameter(shooting_jacobian_reuse,int,_FALSE_)
 /**
  * Relative tolerance of root x during shooting (only 1D case)
  */
@@ -145,6 +149,12 @@ class_type_parameter(thermo_evolver,int,enum evolver_type,ndf15)
  * (used by both evolvers)
  */
 class_precision_parameter(tol_thermo_integration,double,1.0e-6)
+/**
+ * Relative tolerance on the background quantities identifying the
+ * history before reionization, below which that of a previous run
+ * can be reused
+ */
+class_precision_parameter(tol_recombination_reuse,double,1.0e-10)
 /**
  * Only relevant for rk evolver: the default integration step is given
  * by this number multiplied by the timescale defined in
@@ -304,6 +314,19 @@ class_precision_parameter(tight_coupling_approximation,int,(int)compromise_CLASS
 class_precision_parameter(idm_dr_tight_coupling_trigger_tau_c_over_tau_k,double,0.01)  /**< when to switch off the dark-tight-coupling approximation, first condition (see normal tca for full definition) */
 class_precision_parameter(idm_dr_tight_coupling_trigger_tau_c_over_tau_h,double,0.015) /**< when to switch off the dark-tight-coupling approximation, second condition (see normal tca for full definition) */
 
+/**
+ * when to switch off the idm-baryon and idm-photon tight-coupling
+ * approximations, in which the idm velocity is slaved to that of its
+ * partner: first condition compares the idm relaxation time
+ * (1/R_idm_b or 1/(S_idm_g dmu_idm_g)) to the Hubble time, second
+ * condition to the Fourier time scale. Set to zero to always integrate
+ * the interaction explicitly.
+ */
+class_precision_parameter(idm_b_tight_coupling_trigger_tau_c_over_tau_h,double,0.015)
+class_precision_parameter(idm_b_tight_coupling_trigger_tau_c_over_tau_k,double,0.01)
+class_precision_parameter(idm_g_tight_coupling_trigger_tau_c_over_tau_h,double,0.015)
+class_precision_parameter(idm_g_tight_coupling_trigger_tau_c_over_tau_k,double,0.01)
+
 class_precision_parameter(l_max_g,int,12)     /**< number of momenta in Boltzmann hierarchy for photon temperature (scalar), at least 4 */
 class_precision_parameter(l_max_pol_g,int,10) /**< number of momenta in Boltzmann hierarchy for photon polarization (scalar), at least 4 */
 class_precision_parameter(l_max_dr,int,17)   /**< number of momenta in Boltzmann hierarchy for decay radiation, at least 4 */
@@ -343,6 +366,12 @@ class_precision_parameter(c_gamma_k_H_square_max,double,1.0e3)
  * approximations must be switched on/off (units of Mpc)
  */
 class_precision_parameter(tol_tau_approx,double,1.0e-10)
+/**
+ * relative tolerance on the time sampling and on the background and
+ * thermodynamical quantities at checkpoint_z, below which the
+ * checkpoint of perturbations from a previous run can be used
+ */
+class_precision_parameter(tol_perturbations_checkpoint,double,1.0e-4)
 /**
  * method for switching off photon perturbations
  */
@@ -426,6 +455,7 @@ class_precision_parameter(hyper_sampling_curved_high_nu,double,3.0) /**< open/cl
 class_precision_parameter(hyper_nu_sampling_step,double,1000.0)  /**< open/closed cases: value of nu at which sampling changes  */
 class_precision_parameter(hyper_phi_min_abs,double,1.0e-10)  /**< small value of Bessel function used in calculation of first point x (\f$ \Phi_l^{\nu}(x) \f$ equals hyper_phi_min_abs) */
 class_precision_parameter(hyper_x_tol,double,1.0e-4)  /**< tolerance parameter used to determine first value of x */
+class_precision_parameter(hyper_l_flat_asymptotic,int,1000000)  /**< flat case: the spherical Bessel functions \f$ j_l(x)\f$ with l larger or equal to this value are not tabulated, but evaluated on the fly from their uniform asymptotic (Airy) expansion (more accurate than the interpolation tables above l~100, but about 20 times slower); the memory needed for Bessel functions then stops growing with l_max, but the code is slower (about twice at l_max=12000). With the default value, all multipoles are tabulated */
 class_precision_parameter(hyper_flat_approximation_nu,double,4000.0)  /**< value of nu below which the flat approximation is used to compute Bessel function */
 
 class_precision_parameter(q_linstep,double,0.45)         /**< asymptotic linear sampling step in q
@@ -475,6 +505,8 @@ class_precision_parameter(transfer_neglect_delta_k_T_b,double,0.1)  /**< same fo
 
 class_precision_parameter(transfer_neglect_late_source,double,400.0)  /**< value of l below which the CMB source functions can be neglected at late time, excepted when there is a Late ISW contribution */
 
+class_precision_parameter(tol_transfer_split,double,1.0e-6)  /**< relative tolerance on the conformal age and on the background and thermodynamical quantities at split_z, below which the early contributions to the transfer functions of a previous run can be used */
+
 class_precision_parameter(l_switch_limber,double,10.) /**< when to use the Limber approximation for project gravitational potential cl's */
 // For density Cl, we recommend not to use the Limber approximation
 // at all, and hence to put here a very large number (e.g. 10000); but
@@ -513,6 +545,12 @@ class_precision_parameter(nonlinear_min_k_max,double,5.0) /**< when
 class_precision_parameter(k_max_for_pk_sigma8_min,double,10.) /**< minimal k_max for computation of sigma8 */
 class_precision_parameter(k_max_for_pk_sigma8_max,double,100.) /**< maximal k_max for computation of sigma8 */
 
+class_precision_parameter(pk_tail_fit_decades,double,0.3) /**< when P(k,z) is extended
+                               beyond P_k_max_solved with an analytic tail,
+                               number of decades in k, below the last
+                               integrated wavenumber, over which the
+                               logarithmic slope of the sources is fitted */
+
 /** parameters relevant for HALOFIT computation */
 
 class_precision_parameter(halofit_min_k_nonlinear,double,1.0e-4)/**< value of k in 1/Mpc below which non-linear corrections will be neglected */
@@ -577,6 +615,23 @@ class_precision_parameter(num_mu_minus_lmax,int,70) /**< difference between num_
 class_precision_parameter(delta_l_max,int,500)/**< difference between l_max in unlensed and lensed spectra */
 class_precision_parameter(tol_gauss_legendre,double,ppr->smallest_allowed_variation) /**< tolerance with which quadrature points are found: must be very small for an accurate integration (if not entered manually, set automatically to match machine precision) */
 
+/*
+ * Parallelisation parameters
+ */
+
+/**
+ * Each stage estimates its work and chooses its number of threads with
+ * class_number_of_threads(), such that small problems do not pay for
+ * threads they cannot use. The overhead is machine-dependent: set it to
+ * zero to always use all OMP_NUM_THREADS threads.
+ */
+class_precision_parameter(thread_overhead,double,_THREAD_OVERHEAD_)
+class_precision_parameter(threads_primordial,int,0) /**< number of threads in the primordial module (automatic choice if zero) */
+class_precision_parameter(threads_perturbations,int,0) /**< number of threads in the perturbation module (automatic choice if zero) */
+class_precision_parameter(threads_transfer,int,0) /**< number of threads in the transfer module (automatic choice if zero) */
+class_precision_parameter(threads_harmonic,int,0) /**< number of threads in the harmonic module (automatic choice if zero) */
+class_precision_parameter(threads_lensing,int,0) /**< number of threads in the lensing module (automatic choice if zero) */
+
 /*
  * Spectral distortions precision parameters
  */
@@ -531,5 +531,15 @@ extern "C" {
 
 //@}
 
+/**
+ * @name Cost model of parallel loops:
+ */
+
+//@{
+
+#define _PRIMORDIAL_COST_PER_K_ 3.e-3 /**< calibrated cost in seconds of the inflationary evolution of one wavenumber, used to choose the number of threads */
+
+//@}
+
 #endif
 /* @endcond */
@@ -25,6 +25,14 @@ typedef struct adaptive_integration_tree_node{
   struct  adaptive_integration_tree_node *left, *right;	/* Pointer to left child. */
 } qss_node;
 
+/* Adaptive trees of get_qsampling for one distribution, built once for
+   the smallest tolerance and pruned for each sampling: */
+typedef struct adaptive_integration_trees{
+  qss_node *root;	/* Tree on the compactified interval [0;1] */
+  qss_node *root_comb;	/* Tree on [qmin;qmax] of the tabulated q vector, or NULL */
+  double rtol;		/* Smallest tolerance the trees can be pruned to */
+} qss_trees;
+
     /**
      * Boilerplate for C++
      */
@@ -41,6 +49,26 @@ typedef struct adaptive_integration_tree_node{
 			int (*function)(void * params_for_function, double q, double *f0),
 			void * params_for_function,
 			ErrorMsg errmsg);
+      int get_qsampling_trees(qss_trees *trees,
+			      double rtol,
+			      double *qvec,
+			      int qsiz,
+			      int (*test)(void * params_for_function, double q, double *psi),
+			      int (*function)(void * params_for_function, double q, double *f0),
+			      void * params_for_function,
+			      ErrorMsg errmsg);
+      int get_qsampling_from_trees(double *x,
+				   double *w,
+				   int *N,
+				   int N_max, double rtol,
+				   double *qvec,
+				   int qsiz,
+				   int (*test)(void * params_for_function, double q, double *psi),
+				   int (*function)(void * params_for_function, double q, double *f0),
+				   void * params_for_function,
+				   qss_trees *trees,
+				   ErrorMsg errmsg);
+      int free_qsampling_trees(qss_trees *trees);
        int get_qsampling_manual(double *x,
 				double *w,
 				int N,
@@ -56,6 +84,7 @@ typedef struct adaptive_integration_tree_node{
       int get_leaf_x_and_w(qss_node *node, int *ind, double *x, double *w,int isindefinite);
       int reduce_tree(qss_node *node, int level);
       int burn_tree(qss_node *node);
+      int prune_tree(qss_node **copy, qss_node *node, double tol, ErrorMsg errmsg);
       int leaf_count(qss_node *node);
       double get_integral(qss_node *node, int level);
       int gk_adapt(
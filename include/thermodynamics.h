@@ -175,6 +175,8 @@ struct thermodynamics
 
   short has_varconst; /**< presence of varying fundamental constants? */
 
+  struct thermodynamics * recombination_from; /**< thermodynamics structure of a previous run (not yet freed) whose history before reionization can be reused, or NULL (never set by the input module, only by codes calling CLASS) */
+
   //@}
 
   /** @name - all indices for the vector of thermodynamical (=th) quantities stored in table */
@@ -306,6 +308,29 @@ struct thermodynamics
   double u_idm_g;        /**< ratio between idm_g cross section and idm mass */
   int n_index_idm_g;     /**< temperature dependence of the interactions between dark matter and photons */
 
+  double dmu_idm_g_coeff;  /**< redshift-independent prefactor of the idm_g rate, \f$ d\mu_{idm\_g}/d\tau = \f$ dmu_idm_g_coeff \f$ (1+z)^{2+n} \f$ */
+  double R_idm_b_coeff;    /**< redshift-independent prefactor of the idm_b rate, \f$ R_{idm\_b} = \f$ R_idm_b_coeff \f$ a \rho_b T_{diff}^{(n+1)/2} \f$ */
+  double dmu_idm_dr_coeff; /**< redshift-independent prefactor of the idm_dr rate, \f$ d\mu_{idm\_dr}/d\tau = \f$ dmu_idm_dr_coeff \f$ (1+z)^n \f$ */
+  double dmu_idr_coeff;    /**< redshift-independent prefactor of the idr self-interaction rate, \f$ d\mu_{idr}/d\tau = \f$ dmu_idr_coeff \f$ (1+z)^n \f$ */
+
+  //@}
+
+  /** @name - state at the beginning of the reionization approximation, from which a run differing only by reionization parameters can restart */
+
+  //@{
+
+  short has_recombination_reused; /**< was the history before reionization taken from recombination_from? */
+
+  double reco_z_restart; /**< redshift at which the reionization approximation starts */
+  double reco_D_Tmat;    /**< difference between baryon and photon temperature at reco_z_restart */
+  double reco_x_H;       /**< hydrogen ionization fraction at reco_z_restart */
+  double reco_x_He;      /**< helium ionization fraction at reco_z_restart */
+
+  int reco_key_size;     /**< size of the array below */
+  double * reco_key_H;   /**< Hubble rate on all redshifts of z_table above reco_z_restart, which identifies (together with T_cmb, fHe and n_e) the background the history before reionization depends on */
+  double reco_Tcmb;      /**< CMB temperature today */
+  struct precision * reco_precision; /**< copy of the precision parameters of this run, compared between runs */
+
   //@}
 
   /**
@@ -438,6 +463,19 @@ struct thermo_reionization_parameters{
 
   double * reionization_parameters; /**< vector containing all reionization parameters necessary to compute xe(z) */
   int re_size;              /**< length of vector reionization_parameters */
+
+  /* coefficients derived from reionization_parameters by
+     thermodynamics_reionization_prepare(), each time the latter
+     change. They do not depend on xe_before, which enters linearly in
+     all schemes. */
+
+  double reio_redshift_pow;    /**< \f$ (1+z_{reio})^{exponent} \f$ (reio_camb, reio_half_tanh) */
+  double reio_inverse_width;   /**< \f$ 1/(exponent (1+z_{reio})^{exponent-1} width) \f$ (reio_camb, reio_half_tanh) */
+  double helium_inverse_width; /**< inverse of helium_fullreio_width (reio_camb) */
+  double inverse_sharpness;    /**< inverse of step_sharpness (reio_bins_tanh, reio_many_tanh) */
+  double * jump_center;        /**< redshift of the tanh jump in each interval [z_i,z_{i+1}] (reio_bins_tanh), or of each jump (reio_many_tanh) */
+  double * jump_coefficient;   /**< height of each jump, xe_before excluded (reio_many_tanh), or \f$ 1/(z_{i+1}-z_i) \f$ (reio_inter) */
+  int index_last_interval;     /**< interval [z_i,z_{i+1}] of the last evaluation, starting point of the next search */
 };
 
 /**
@@ -554,6 +592,13 @@ extern "C" {
                            struct thermo_workspace* ptw,
                            double * pvecback);
 
+  int thermodynamics_recombination_reuse(struct precision * ppr,
+                                         struct background * pba,
+                                         struct thermodynamics * pth,
+                                         struct thermo_workspace * ptw,
+                                         double * interval_limit,
+                                         double * pvecback);
+
   int thermodynamics_calculate_remaining_quantities(struct precision * ppr,
                                                     struct background * pba,
                                                     struct thermodynamics* pth,
@@ -639,6 +684,16 @@ extern "C" {
                                            struct thermo_reionization_parameters * preio,
                                            double * x);
 
+  int thermodynamics_reionization_prepare(struct thermodynamics * pth,
+                                          struct thermo_reionization_parameters * preio);
+
+  int thermodynamics_reionization_function_list(double * z,
+                                                double * xe_before,
+                                                int z_size,
+                                                struct thermodynamics * pth,
+                                                struct thermo_reionization_parameters * preio,
+                                                double * x);
+
   int thermodynamics_obtain_z_ini(
                                   struct precision * ppr,
                                   struct background *pba,
@@ -9,13 +9,22 @@
 #include <sys/stat.h>
 #include "errno.h"
 
+/* calibrated cost in seconds of one (q,l,tau) point of the line-of-sight integrals, used to choose the number of threads */
+#define _TRANSFER_COST_ 1.5e-8
+
+/* flags for the derivatives of the hyperspherical Bessel functions needed by a radial function */
+#define _RADIAL_PHI_   1
+#define _RADIAL_DPHI_  2
+#define _RADIAL_D2PHI_ 4
+
 /* macro: test if index_tt is in the range between index and index+num, while the flag is true */
 #define _index_tt_in_range_(index,num,flag) (flag == _TRUE_) && (index_tt >= index) && (index_tt < index+num)
 /* macro: test if index_tt corresponds to an integrated nCl/sCl contribution */
 #define _integrated_ncl_ (_index_tt_in_range_(ptr->index_tt_lensing, ppt->selection_num, ppt->has_cl_lensing_potential)) || \
   (_index_tt_in_range_(ptr->index_tt_nc_lens, ppt->selection_num, ppt->has_nc_lens)) || \
     (_index_tt_in_range_(ptr->index_tt_nc_g4,   ppt->selection_num, ppt->has_nc_gr)) || \
-    (_index_tt_in_range_(ptr->index_tt_nc_g5,   ppt->selection_num, ppt->has_nc_gr))
+    (_index_tt_in_range_(ptr->index_tt_nc_g5,   ppt->selection_num, ppt->has_nc_gr)) || \
+    (_index_tt_in_range_(ptr->index_tt_nc_g5_mag, ppt->selection_num, ptr->has_nc_gr_mag))
 /* macro: test if index_tt corresponds to an non-integrated nCl/sCl contribution */
 #define _nonintegrated_ncl_ (_index_tt_in_range_(ptr->index_tt_density, ppt->selection_num, ppt->has_nc_density)) || \
   (_index_tt_in_range_(ptr->index_tt_rsd,     ppt->selection_num, ppt->has_nc_rsd)) || \
@@ -23,7 +32,9 @@
     (_index_tt_in_range_(ptr->index_tt_d1,      ppt->selection_num, ppt->has_nc_rsd)) || \
     (_index_tt_in_range_(ptr->index_tt_nc_g1,   ppt->selection_num, ppt->has_nc_gr))  || \
     (_index_tt_in_range_(ptr->index_tt_nc_g2,   ppt->selection_num, ppt->has_nc_gr))  || \
-    (_index_tt_in_range_(ptr->index_tt_nc_g3,   ppt->selection_num, ppt->has_nc_gr))
+    (_index_tt_in_range_(ptr->index_tt_nc_g3,   ppt->selection_num, ppt->has_nc_gr))  || \
+    (_index_tt_in_range_(ptr->index_tt_d1_mag,  ppt->selection_num, ptr->has_nc_rsd_mag)) || \
+    (_index_tt_in_range_(ptr->index_tt_nc_g2_mag, ppt->selection_num, ptr->has_nc_gr_mag))
 /* macro: bin number associated to particular redshift bin and selection function for non-integrated contributions*/
 #define _get_bin_nonintegrated_ncl_(index_tt)                           \
   if (_index_tt_in_range_(ptr->index_tt_density, ppt->selection_num, ppt->has_nc_density)) \
@@ -39,7 +50,11 @@
   if (_index_tt_in_range_(ptr->index_tt_nc_g2,   ppt->selection_num, ppt->has_nc_gr)) \
     bin = index_tt - ptr->index_tt_nc_g2;                               \
   if (_index_tt_in_range_(ptr->index_tt_nc_g3,   ppt->selection_num, ppt->has_nc_gr)) \
-    bin = index_tt - ptr->index_tt_nc_g3;
+    bin = index_tt - ptr->index_tt_nc_g3;                               \
+  if (_index_tt_in_range_(ptr->index_tt_d1_mag,  ppt->selection_num, ptr->has_nc_rsd_mag)) \
+    bin = index_tt - ptr->index_tt_d1_mag;                              \
+  if (_index_tt_in_range_(ptr->index_tt_nc_g2_mag, ppt->selection_num, ptr->has_nc_gr_mag)) \
+    bin = index_tt - ptr->index_tt_nc_g2_mag;
 /* macro: bin number associated to particular redshift bin and selection function for integrated contributions*/
 #define _get_bin_integrated_ncl_(index_tt)                              \
   if (_index_tt_in_range_(ptr->index_tt_lensing, ppt->selection_num, ppt->has_cl_lensing_potential)) \
@@ -49,7 +64,9 @@
   if (_index_tt_in_range_(ptr->index_tt_nc_g4,   ppt->selection_num, ppt->has_nc_gr)) \
     bin = index_tt - ptr->index_tt_nc_g4;                               \
   if (_index_tt_in_range_(ptr->index_tt_nc_g5,   ppt->selection_num, ppt->has_nc_gr)) \
-    bin = index_tt - ptr->index_tt_nc_g5;
+    bin = index_tt - ptr->index_tt_nc_g5;                               \
+  if (_index_tt_in_range_(ptr->index_tt_nc_g5_mag, ppt->selection_num, ptr->has_nc_gr_mag)) \
+    bin = index_tt - ptr->index_tt_nc_g5_mag;
 /**
  * Structure containing everything about transfer functions in
  * harmonic space \f$ \Delta_l^{X} (q) \f$ that other modules need to
@@ -93,6 +110,8 @@ struct transfer {
   double selection_bias[_SELECTION_NUM_MAX_];               /**< light-to-mass bias in the transfer function of density number count */
   double selection_magnification_bias[_SELECTION_NUM_MAX_]; /**< magnification bias in the transfer function of density number count */
 
+  short has_nc_components; /**< if true, number count transfer functions are computed for unit light-to-mass bias, and their terms linear in the magnification bias are stored separately, so that the harmonic module can keep nuisance-separable spectra */
+
   short has_nz_file;     /**< Has dN/dz (selection function) input file? */
   short has_nz_analytic; /**< Use analytic form for dN/dz (selection function) distribution? */
   FileName nz_file_name; /**< dN/dz (selection function) input file name */
@@ -110,6 +129,9 @@ struct transfer {
   double * nz_evo_dlog_nz;    /**< log of tabulated values of evolution function */
   double * nz_evo_dd_dlog_nz; /**< second derivatives in splined log of evolution function */
 
+  double split_z;                /**< if positive, the contributions to the line-of-sight integrals from z > split_z (early) and z < split_z (late) are stored separately */
+  struct transfer * early_from;  /**< transfer structure of a previous run (not yet freed) from which the early contributions can be taken, or NULL (never set by the input module, only by codes calling CLASS) */
+
   //@}
 
   /** @name - flag stating whether we need transfer functions at all */
@@ -144,6 +166,12 @@ struct transfer {
   int index_tt_nc_g3;   /**< index for first bin of transfer type = gravity term G3 for of number count */
   int index_tt_nc_g4;   /**< index for first bin of transfer type = gravity term G3 for of number count */
   int index_tt_nc_g5;   /**< index for first bin of transfer type = gravity term G3 for of number count */
+  int index_tt_d1_mag;    /**< index for first bin of transfer type = coefficient of the magnification bias in the doppler term d1 (only if has_nc_components) */
+  int index_tt_nc_g2_mag; /**< index for first bin of transfer type = coefficient of the magnification bias in the gravity term G2 (only if has_nc_components) */
+  int index_tt_nc_g5_mag; /**< index for first bin of transfer type = coefficient of the magnification bias in the gravity term G5 (only if has_nc_components) */
+
+  short has_nc_rsd_mag; /**< do we need the index_tt_d1_mag types? */
+  short has_nc_gr_mag;  /**< do we need the index_tt_nc_g2_mag and index_tt_nc_g5_mag types? */
 
   int * tt_size;     /**< number of requested transfer types tt_size[index_md] for each mode */
 
@@ -187,6 +215,33 @@ struct transfer {
 
   double ** transfer; /**< table of transfer functions for each mode, initial condition, type, multipole and wavenumber, with argument transfer[index_md][((index_ic * ptr->tt_size[index_md] + index_tt) * ptr->l_size[index_md] + index_l) * ptr->q_size + index_q] */
 
+  short release_transfer;  /**< if _TRUE_, the table of transfer functions is freed by transfer_release_tables() at the end of harmonic_init() */
+  short transfer_released; /**< has the table of transfer functions been freed? (if so, transfer_functions_at_q() cannot be called anymore) */
+
+  //@}
+
+  /** @name - early contributions to the transfer functions (only if split_z > 0) */
+
+  //@{
+
+  short has_split;        /**< are the early contributions stored separately? */
+  short has_early_reused; /**< were the early contributions taken from early_from rather than computed? */
+
+  double tau_split;       /**< conformal time at split_z */
+  double split_tau0;      /**< conformal age */
+  double split_a;         /**< scale factor at split_z */
+  double split_H;         /**< Hubble rate at split_z */
+  double split_dkappa;    /**< Thomson scattering rate at split_z */
+  double split_exp_m_kappa; /**< \f$ e^{-\kappa} \f$ at split_z, relating the CMB sources of two runs differing only by reionisation */
+
+  int * split_ic_size;    /**< number of initial conditions for each mode, split_ic_size[index_md] */
+
+  double * split_key;     /**< early-time inputs of this run (see perturbations_early_key()), compared between runs */
+  int split_key_size;     /**< size of split_key */
+  struct precision * split_precision; /**< copy of the precision parameters of this run, compared between runs */
+
+  double ** transfer_early; /**< contribution of times before tau_split to the transfer functions, with the same argument as transfer[index_md][...]; the late contribution is the difference */
+
   //@}
 
   /** @name - technical parameters */
@@ -229,7 +284,9 @@ struct transfer_workspace {
 
   int tau_size;                  /**< number of discrete time values for a given type */
   int tau_size_max;              /**< maximum number of discrete time values for all types */
-  double * interpolated_sources; /**< interpolated_sources[index_tau]:
+  int ic_size;                   /**< maximum number of initial conditions for all modes */
+  int perturbations_tau_size;    /**< number of discrete time values in the perturbation module */
+  double * interpolated_sources; /**< interpolated_sources[index_ic*perturbations_tau_size+index_tau]:
                                     sources interpolated from the
                                     perturbation module at the right
                                     value of k */
@@ -237,9 +294,23 @@ struct transfer_workspace {
                                     used in transfer module, possibly
                                     differing from those in the
                                     perturbation module by some
-                                    resampling or rescaling */
+                                    resampling or rescaling (points
+                                    to the current source in source_table) */
+  double * source_table;         /**< source_table[(index_group*ic_size+index_ic)*tau_size_max+index_tau]:
+                                    sources of all consecutive types sharing the
+                                    same time sampling, and of all initial
+                                    conditions. They are convolved with the same
+                                    radial functions. */
+  int * index_tau_min_table;     /**< index_tau_min_table[index_group*ic_size+index_ic]: first time
+                                    in the convolution integral for each source of
+                                    source_table at a given l */
+  int * index_tau_max_table;     /**< index_tau_max_table[index_group*ic_size+index_ic]: last time
+                                    in the convolution integral (-1 if not integrated) */
+  int group_size_max;            /**< number of types for which source_table is allocated */
   double * tau0_minus_tau;       /**< tau0_minus_tau[index_tau]: values of (tau0 - tau) */
   double * w_trapz;              /**< w_trapz[index_tau]: values of weights in trapezoidal integration (related to time steps) */
+  double * tau0_minus_tau_next;  /**< same as tau0_minus_tau, for the next type (compared to the current sampling) */
+  double * w_trapz_next;         /**< same as w_trapz, for the next type */
   double * chi;                  /**< chi[index_tau]: value of argument of bessel
                                     function: k(tau0-tau) (flat case)
                                     or sqrt(|K|)(tau0-tau) (non-flat
@@ -249,6 +320,23 @@ struct transfer_workspace {
 
   //@}
 
+  /** @name - radial functions at a given (q,l), shared by all sources with the same time sampling */
+
+  //@{
+
+  double * chireverse;           /**< chireverse[index_x]: rescaled argument of the radial functions, in increasing order */
+  double * Phi;                  /**< Phi[index_x]: hyperspherical Bessel function at chireverse[index_x] */
+  double * dPhi;                 /**< dPhi[index_x]: its first derivative */
+  double * d2Phi;                /**< d2Phi[index_x]: its second derivative */
+  double * rescale_function;     /**< rescale_function[index_x]: amplitude rescaling (non-flat case with flat Bessel functions) */
+  double rescale_argument;       /**< argument rescaling (idem) */
+  int radial_derivatives;        /**< which of Phi, dPhi, d2Phi are known (combination of _RADIAL_PHI_, _RADIAL_DPHI_, _RADIAL_D2PHI_) */
+  int index_tau_min_radial;      /**< Phi, dPhi, d2Phi are known for index_tau_min_radial <= index_tau <= index_tau_max_radial ... */
+  int index_tau_max_radial;      /**< ... with index_x = index_tau_max_radial - index_tau */
+  double * radial_function;      /**< radial_function[index_tau-index_tau_min]: radial function of the source being integrated */
+
+  //@}
+
   /** @name - parameters defining the spatial curvature (copied from background structure) */
 
   //@{
@@ -258,6 +346,8 @@ struct transfer_workspace {
 
   //@}
 
+  int tau_size_early;      /**< number of discrete time values before tau_split for a given type (only if ptr->has_split) */
+
   double tau0_minus_tau_cut; /**< critical value of (tau0-tau) in time cut approximation for the wavenumber at hand */
   short neglect_late_source; /**< flag stating whether we use the time cut approximation for the wavenumber at hand */
 };
@@ -303,6 +393,11 @@ extern "C" {
                               double * ptransfer_local
                               );
 
+  int transfer_release_tables(
+                              struct perturbations * ppt,
+                              struct transfer * ptr
+                              );
+
   int transfer_init(
                     struct precision * ppr,
                     struct background * pba,
@@ -536,6 +631,18 @@ extern "C" {
                                  double tau0,
                                  int bin);
 
+  int transfer_compute_for_each_sampling(
+                                         struct precision * ppr,
+                                         struct perturbations * ppt,
+                                         struct transfer * ptr,
+                                         int index_q,
+                                         int index_md,
+                                         int index_tt_first,
+                                         int group_size,
+                                         double ra_rec,
+                                         struct transfer_workspace * ptw
+                                         );
+
   int transfer_compute_for_each_l(
                                   struct transfer_workspace * ptw,
                                   struct precision * ppr,
@@ -543,14 +650,22 @@ extern "C" {
                                   struct transfer * ptr,
                                   int index_q,
                                   int index_md,
-                                  int index_ic,
-                                  int index_tt,
+                                  int index_tt_first,
+                                  int group_size,
                                   int index_l,
                                   double l,
-                                  double q_max_bessel,
-                                  radial_function_type radial_type
+                                  double ra_rec,
+                                  double q_max_bessel
                                   );
 
+  int transfer_store(
+                     struct transfer * ptr,
+                     int index_md,
+                     size_t index,
+                     double transfer_function,
+                     double transfer_early
+                     );
+
   int transfer_use_limber(
                           struct precision * ppr,
                           struct perturbations * ppt,
@@ -563,18 +678,29 @@ extern "C" {
                           short * use_limber
                           );
 
+  int transfer_integration_range(
+                                 struct transfer * ptr,
+                                 struct transfer_workspace *ptw,
+                                 int index_q,
+                                 double l,
+                                 int index_l,
+                                 double k,
+                                 double * sources,
+                                 int * index_tau_min,
+                                 int * index_tau_max,
+                                 double * tau0_minus_tau_min_bessel
+                                 );
+
   int transfer_integrate(
-                         struct perturbations * ppt,
                          struct transfer * ptr,
                          struct transfer_workspace *ptw,
-                         int index_q,
-                         int index_md,
-                         int index_tt,
-                         double l,
-                         int index_l,
-                         double q,
-                         radial_function_type radial_type,
-                         double * trsf
+                         double * sources,
+                         double * radial_function,
+                         int index_tau_min,
+                         int index_tau_max,
+                         double tau0_minus_tau_min_bessel,
+                         double * trsf,
+                         double * trsf_early
                          );
 
   int transfer_limber(
@@ -640,6 +766,22 @@ extern "C" {
                                       radial_function_type *radial_type
                                       );
 
+  int transfer_radial_basis(
+                            struct transfer_workspace * ptw,
+                            struct transfer * ptr,
+                            double k,
+                            int index_q,
+                            int index_l,
+                            int index_tau_min,
+                            int index_tau_max,
+                            int derivatives
+                            );
+
+  int transfer_radial_derivatives(
+                                  radial_function_type radial_type,
+                                  int * derivatives
+                                  );
+
   int transfer_radial_function(
                                struct transfer_workspace * ptw,
                                struct perturbations * ppt,
@@ -647,6 +789,7 @@ extern "C" {
                                double k,
                                int index_q,
                                int index_l,
+                               int index_tau_min,
                                int x_size,
                                double * radial_function,
                                radial_function_type radial_type
@@ -661,11 +804,20 @@ extern "C" {
                                      struct transfer * ptr
                                      );
 
+  int transfer_split_init(
+                          struct precision * ppr,
+                          struct background * pba,
+                          struct thermodynamics * pth,
+                          struct perturbations * ppt,
+                          struct transfer * ptr
+                          );
+
   int transfer_workspace_init(
                               struct transfer * ptr,
                               struct precision * ppr,
                               struct transfer_workspace **ptw,
                               int perturbations_tau_size,
+                              int ic_size,
                               int tau_size_max,
                               double K,
                               int sgnK,
@@ -673,6 +825,12 @@ extern "C" {
                               HyperInterpStruct * pBIS
                               );
 
+  int transfer_workspace_source_table(
+                                      struct transfer * ptr,
+                                      struct transfer_workspace * ptw,
+                                      int group_size
+                                      );
+
   int transfer_workspace_free(
                               struct transfer * ptr,
                               struct transfer_workspace *ptw
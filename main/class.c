@@ -18,6 +18,7 @@ int main(int argc, char **argv) {
   struct distortions sd;      /* for spectral distortions */
   struct output op;           /* for output files */
   ErrorMsg errmsg;            /* for error messages */
+  double resident, peak;      /* for memory usage in MB */
 
   if (input_init(argc, argv,&pr,&ba,&th,&pt,&tr,&pm,&hr,&fo,&le,&sd,&op,errmsg) == _FAILURE_) {
     printf("\n\nError running input_init \n=>%s\n",errmsg);
@@ -74,6 +75,12 @@ int main(int argc, char **argv) {
     return _FAILURE_;
   }
 
+  if (op.output_verbose > 0) {
+    class_memory_usage(&resident,&peak);
+    if (peak > 0.)
+      printf("Memory usage: resident %.1f MB, peak %.1f MB\n",resident,peak);
+  }
+
   /****** all calculations done, now free the structures ******/
 
   if (distortions_free(&sd) == _FAILURE_) {
@@ -44,6 +44,14 @@ cdef extern from "class.h":
         nl_halofit
         nl_HMcode
 
+    cdef enum hmcode_baryonic_feedback_model:
+        nl_emu_dmonly
+        nl_owls_dmonly
+        nl_owls_ref
+        nl_owls_agn
+        nl_owls_dblim
+        nl_user_defined
+
     cdef enum pk_outputs:
         pk_linear
         pk_nonlinear
@@ -53,6 +61,18 @@ cdef extern from "class.h":
         out_sigma_prime
         out_sigma_disp
 
+    cdef enum input_module:
+        im_input
+        im_background
+        im_thermodynamics
+        im_perturbations
+        im_primordial
+        im_fourier
+        im_transfer
+        im_harmonic
+        im_lensing
+        im_distortions
+
     cdef struct precision:
         double nonlinear_min_k_max
         ErrorMsg error_message
@@ -269,6 +289,7 @@ cdef extern from "class.h":
 
 
         double *** sources
+        short sources_released
         double * tau_sampling
         int tau_size
         int k_size_pk
@@ -337,12 +358,27 @@ cdef extern from "class.h":
         int md_size
         int d_size
         int non_diag
+        int has_nc_components
+        int has_tt
+        int has_te
+        int has_ee
+        int has_bb
+        int has_pp
+        int has_tp
+        int has_ep
+        int has_dd
+        int has_td
+        int has_pd
+        int has_ll
+        int has_dl
+        int has_tl
         int index_ct_tt
         int index_ct_te
         int index_ct_ee
         int index_ct_bb
         int index_ct_pp
         int index_ct_tp
+        int index_ct_ep
         int index_ct_dd
         int index_ct_td
         int index_ct_pd
@@ -422,6 +458,7 @@ cdef extern from "class.h":
         int index_pk_cb
         int index_pk_total
         int index_pk_cluster
+        short hmcode_fast_feedback
         ErrorMsg error_message
 
     cdef struct file_content:
@@ -447,6 +484,10 @@ cdef extern from "class.h":
 
     int input_read_from_file(void*, void*, void*, void*, void*, void*, void*, void*, void*,
         void*, void*, void*, char*)
+    int input_compute_modules(void*, int, char*, char*, input_module, int*, input_module*, void*, void*, void*, void*,
+        void*, void*, void*, void*, void*, void*, void*, char*)
+    int input_free_modules(int*, void*, void*, void*, void*, void*, void*, void*, void*, void*, char*)
+    int input_free_shooting_jacobians()
     int background_init(void*,void*)
     int thermodynamics_init(void*,void*,void*)
     int perturbations_init(void*,void*,void*,void*)
@@ -469,6 +510,8 @@ cdef extern from "class.h":
     int thermodynamics_output_data(void *pba, void *pth, int number_of_titles, double *data)
 
     int perturbations_output_data_at_z(void *pba,void *ppt, file_format output_format, double z, int number_of_titles, double *data)
+    int perturbations_output_data_at_z_list(void *pba,void *ppt, file_format output_format, int z_size, double * z, int number_of_titles, double *data)
+    int perturbations_sources_at_z_list(void *pba, void *ppt, int index_md, int index_ic, int tp_num, int * index_tp, int z_size, double * z, double * psources)
     int perturbations_output_data_at_index_tau(void *pba,void *ppt, file_format output_format, int ondex_tau, int number_of_titles, double *data)
     int perturbations_output_data(void *pba,void *ppt, file_format output_format, double * tkfull, int number_of_titles, double *data)
     int perturbations_output_firstline_and_ic_suffix(void *ppt, int index_ic, char first_line[_LINE_LENGTH_MAX_], FileName ic_suffix)
@@ -478,7 +521,10 @@ cdef extern from "class.h":
     int primordial_output_data(void *ppt, void *ppm, int number_of_titles, double *data)
 
     int harmonic_cl_at_l(void* phr,double l,double * cl,double * * cl_md,double * * cl_md_ic)
+    int harmonic_cl_number_count_recombine(void* phr,double * selection_bias,double * selection_magnification_bias)
+    int harmonic_cl_covariance(void* phr,int l_min,int l_max,int delta_l,double fsky,double * noise,double * covariance)
     int lensing_cl_at_l(void * ple,int l,double * cl_lensed)
+    int class_memory_usage(double * resident, double * peak)
 
     int harmonic_pk_at_z(
         void * pba,
@@ -568,6 +614,7 @@ cdef extern from "class.h":
     int fourier_hmcode_window_nfw(void* pfo, double k, double rv, double c, double* window_nfw)
 
     int fourier_k_nl_at_z(void* pba, void* pfo, double z, double* k_nl, double* k_nl_cb)
+    int fourier_hmcode_update_feedback(void* pba, void* pfo, hmcode_baryonic_feedback_model feedback, double c_min, double eta_0)
 
     int harmonic_firstline_and_ic_suffix(void *ppt, int index_ic, char first_line[_LINE_LENGTH_MAX_], FileName ic_suffix)
 
@@ -76,6 +76,19 @@ class CosmoComputationError(CosmoError):
     pass
 
 
+# Modules that can be requested in Class.compute(level=...), and their index
+# in the bit mask of the modules allocated by input_compute_modules
+_MODULES = {"input": im_input,
+            "background": im_background,
+            "thermodynamics": im_thermodynamics,
+            "perturb": im_perturbations,
+            "primordial": im_primordial,
+            "fourier": im_fourier,
+            "transfer": im_transfer,
+            "harmonic": im_harmonic,
+            "lensing": im_lensing,
+            "distortions": im_distortions}
+
 cdef class Class:
     """
     Class wrapping, creates the glue between C and python
@@ -103,7 +116,9 @@ cdef class Class:
     cpdef int computed # Flag to see if classy has already computed with the given pars
     cpdef int allocated # Flag to see if classy structs are allocated already
     cpdef object _pars # Dictionary of the parameters
-    cpdef object ncp   # Keeps track of the structures initialized, in view of cleaning.
+    cpdef int modules  # Bit mask of the modules initialized (1 << im_...), in view of cleaning.
+    cpdef object _keys # Parameter names passed to Class at the last compute()
+    cpdef bytes _names # The same names, packed as null-terminated strings
 
     # Defining two new properties to recover, respectively, the parameters used
     # or the age (set after computation). Follow this syntax if you want to
@@ -137,7 +152,9 @@ cdef class Class:
         assert(self.fc.filename!=NULL)
         dumc = "NOFILE"
         sprintf(self.fc.filename,"%s",dumc)
-        self.ncp = set()
+        self.modules = 0
+        self._keys = None
+        self._names = b""
         if default: self.set_default()
 
     def __dealloc__(self):
@@ -169,111 +186,18 @@ cdef class Class:
         self._pars = {}
         self.computed = False
 
-    # Create an equivalent of the parameter file. Non specified values will be
-    # taken at their default (in Class)
-    def _fillparfile(self):
-        cdef char* dumc
-
-        if self.fc.size!=0:
-            free(self.fc.name)
-            free(self.fc.value)
-            free(self.fc.read)
-        self.fc.size = len(self._pars)
-        self.fc.name = <FileArg*> malloc(sizeof(FileArg)*len(self._pars))
-        assert(self.fc.name!=NULL)
-
-        self.fc.value = <FileArg*> malloc(sizeof(FileArg)*len(self._pars))
-        assert(self.fc.value!=NULL)
-
-        self.fc.read = <short*> malloc(sizeof(short)*len(self._pars))
-        assert(self.fc.read!=NULL)
-
-        # fill parameter file
-        i = 0
-        for kk in self._pars:
-
-            dumcp = kk.encode()
-            dumc = dumcp
-            sprintf(self.fc.name[i],"%s",dumc)
-            dumcp = str(self._pars[kk]).strip().encode()
-            dumc = dumcp
-            sprintf(self.fc.value[i],"%s",dumc)
-            self.fc.read[i] = _FALSE_
-            i+=1
-
-    # Called at the end of a run, to free memory
+    # Called at the end of a run, to free memory (including the shooting
+    # jacobians kept with shooting_jacobian_reuse, shared by the process)
     def struct_cleanup(self):
+        cdef ErrorMsg errmsg
+        input_free_shooting_jacobians()
         if(self.allocated != True):
           return
-        if "distortions" in self.ncp:
-            distortions_free(&self.sd)
-        if "lensing" in self.ncp:
-            lensing_free(&self.le)
-        if "harmonic" in self.ncp:
-            harmonic_free(&self.hr)
-        if "transfer" in self.ncp:
-            transfer_free(&self.tr)
-        if "fourier" in self.ncp:
-            fourier_free(&self.fo)
-        if "primordial" in self.ncp:
-            primordial_free(&self.pm)
-        if "perturb" in self.ncp:
-            perturbations_free(&self.pt)
-        if "thermodynamics" in self.ncp:
-            thermodynamics_free(&self.th)
-        if "background" in self.ncp:
-            background_free(&self.ba)
+        input_free_modules(&self.modules, &self.ba, &self.th, &self.pt, &self.tr,
+                           &self.pm, &self.hr, &self.fo, &self.le, &self.sd, errmsg)
         self.allocated = False
         self.computed = False
 
-    def _check_task_dependency(self, level):
-        """
-        Fill the level list with all the needed modules
-
-        .. warning::
-
-            the ordering of modules is obviously dependent on CLASS module order
-            in the main.c file. This has to be updated in case of a change to
-            this file.
-
-        Parameters
-        ----------
-
-        level : list
-            list of strings, containing initially only the last module required.
-            For instance, to recover all the modules, the input should be
-            ['lensing']
-
-        """
-        if "distortions" in level:
-            if "lensing" not in level:
-                level.append("lensing")
-        if "lensing" in level:
-            if "harmonic" not in level:
-                level.append("harmonic")
-        if "harmonic" in level:
-            if "transfer" not in level:
-                level.append("transfer")
-        if "transfer" in level:
-            if "fourier" not in level:
-                level.append("fourier")
-        if "fourier" in level:
-            if "primordial" not in level:
-                level.append("primordial")
-        if "primordial" in level:
-            if "perturb" not in level:
-                level.append("perturb")
-        if "perturb" in level:
-            if "thermodynamics" not in level:
-                level.append("thermodynamics")
-        if "thermodynamics" in level:
-            if "background" not in level:
-                level.append("background")
-        if len(level)!=0 :
-            if "input" not in level:
-                level.append("input")
-        return level
-
     def _pars_check(self, key, value, contains=False, add=""):
         val = ""
         if key in self._pars:
@@ -305,140 +229,63 @@ cdef class Class:
         of this class contains all the relevant quantities. Then, one can deduce
         Pk, Cl, etc...
 
+        The whole computation (setting the parameters, running the modules,
+        cleaning up after a failure) is done by a single call to
+        input_compute_modules in C.
+
         Parameters
         ----------
         level : list
-                list of the last module desired. The internal function
-                _check_task_dependency will then add to this list all the
-                necessary modules to compute in order to initialize this last
-                one. The default last module is "lensing".
-
-        .. warning::
-
-            level default value should be left as an array (it was creating
-            problem when casting as a set later on, in _check_task_dependency)
+                list of the last module desired. All the modules needed to
+                initialize it are computed as well, in the order of main.c.
+                The default last module is "distortions".
 
         """
         cdef ErrorMsg errmsg
+        cdef input_module last_module = im_input
+        cdef int required
+        cdef input_module failed_module = im_input
+        cdef char* names = NULL
+        cdef bytes values
 
-        # Append to the list level all the modules necessary to compute.
-        level = self._check_task_dependency(level)
+        # The last module requested: all the previous ones are needed too
+        for module in level:
+            last_module = max(last_module, _MODULES.get(module, im_input))
+        required = (2 << last_module) - 1
 
         # Check if this function ran before (self.computed should be true), and
-        # if no other modules were requested, i.e. if self.ncp contains (or is
-        # equivalent to) level. If it is the case, simply stop the execution of
-        # the function.
-        if self.computed and self.ncp.issuperset(level):
+        # if no other modules were requested. If it is the case, simply stop the
+        # execution of the function.
+        if self.computed and (self.modules & required) == required:
             return
 
-        # Check if already allocated to prevent memory leaks
-        if self.allocated:
-            self.struct_cleanup()
-
-        # Otherwise, proceed with the normal computation.
+        # Equivalent of writing a parameter file: names and values packed as
+        # null-terminated strings. The names are passed again only when the
+        # set of parameters changed, otherwise Class keeps those of the last call.
+        keys = tuple(self._pars)
+        if keys != self._keys:
+            self._names = "".join([key+"\0" for key in keys]).encode()
+            self._keys = keys
+            names = self._names
+        values = "".join([str(value).strip()+"\0" for value in self._pars.values()]).encode()
+
+        # Free the modules of the previous run, read the parameters and run
+        # all modules up to the last one. The input module raises a
+        # CosmoSevereError, because non-understood parameters asked to the
+        # wrapper is a problematic situation; the other modules raise a
+        # CosmoComputationError with the error message of the faulty module.
         self.computed = False
-
-        # Equivalent of writing a parameter file
-        self._fillparfile()
-
-        # self.ncp will contain the list of computed modules (under the form of
-        # a set, instead of a python list)
-        self.ncp=set()
-        # Up until the empty set, all modules are allocated
-        # (And then we successively keep track of the ones we allocate additionally)
-        self.allocated = True
-
-        # --------------------------------------------------------------------
-        # Check the presence for all CLASS modules in the list 'level'. If a
-        # module is found in level, executure its "_init" method.
-        # --------------------------------------------------------------------
-        # The input module should raise a CosmoSevereError, because
-        # non-understood parameters asked to the wrapper is a problematic
-        # situation.
-        if "input" in level:
-            if input_read_from_file(&self.fc, &self.pr, &self.ba, &self.th,
-                                    &self.pt, &self.tr, &self.pm, &self.hr,
-                                    &self.fo, &self.le, &self.sd, &self.op, errmsg) == _FAILURE_:
+        if input_compute_modules(&self.fc, len(keys), names, values, last_module,
+                                 &self.modules, &failed_module,
+                                 &self.pr, &self.ba, &self.th, &self.pt, &self.tr,
+                                 &self.pm, &self.hr, &self.fo, &self.le, &self.sd,
+                                 &self.op, errmsg) == _FAILURE_:
+            self.allocated = False
+            self._keys = None
+            if failed_module == im_input:
                 raise CosmoSevereError(errmsg)
-            self.ncp.add("input")
-            # This part is done to list all the unread parameters, for debugging
-            problem_flag = False
-            problematic_parameters = []
-            for i in range(self.fc.size):
-                if self.fc.read[i] == _FALSE_:
-                    problem_flag = True
-                    problematic_parameters.append(self.fc.name[i].decode())
-            if problem_flag:
-                raise CosmoSevereError(
-                    "Class did not read input parameter(s): %s\n" % ', '.join(
-                    problematic_parameters))
-
-        # The following list of computation is straightforward. If the "_init"
-        # methods fail, call `struct_cleanup` and raise a CosmoComputationError
-        # with the error message from the faulty module of CLASS.
-        if "background" in level:
-            if background_init(&(self.pr), &(self.ba)) == _FAILURE_:
-                self.struct_cleanup()
-                raise CosmoComputationError(self.ba.error_message)
-            self.ncp.add("background")
-
-        if "thermodynamics" in level:
-            if thermodynamics_init(&(self.pr), &(self.ba),
-                                   &(self.th)) == _FAILURE_:
-                self.struct_cleanup()
-                raise CosmoComputationError(self.th.error_message)
-            self.ncp.add("thermodynamics")
-
-        if "perturb" in level:
-            if perturbations_init(&(self.pr), &(self.ba),
-                            &(self.th), &(self.pt)) == _FAILURE_:
-                self.struct_cleanup()
-                raise CosmoComputationError(self.pt.error_message)
-            self.ncp.add("perturb")
-
-        if "primordial" in level:
-            if primordial_init(&(self.pr), &(self.pt),
-                               &(self.pm)) == _FAILURE_:
-                self.struct_cleanup()
-                raise CosmoComputationError(self.pm.error_message)
-            self.ncp.add("primordial")
-
-        if "fourier" in level:
-            if fourier_init(&self.pr, &self.ba, &self.th,
-                              &self.pt, &self.pm, &self.fo) == _FAILURE_:
-                self.struct_cleanup()
-                raise CosmoComputationError(self.fo.error_message)
-            self.ncp.add("fourier")
-
-        if "transfer" in level:
-            if transfer_init(&(self.pr), &(self.ba), &(self.th),
-                             &(self.pt), &(self.fo), &(self.tr)) == _FAILURE_:
-                self.struct_cleanup()
-                raise CosmoComputationError(self.tr.error_message)
-            self.ncp.add("transfer")
-
-        if "harmonic" in level:
-            if harmonic_init(&(self.pr), &(self.ba), &(self.pt),
-                            &(self.pm), &(self.fo), &(self.tr),
-                            &(self.hr)) == _FAILURE_:
-                self.struct_cleanup()
-                raise CosmoComputationError(self.hr.error_message)
-            self.ncp.add("harmonic")
-
-        if "lensing" in level:
-            if lensing_init(&(self.pr), &(self.pt), &(self.hr),
-                            &(self.fo), &(self.le)) == _FAILURE_:
-                self.struct_cleanup()
-                raise CosmoComputationError(self.le.error_message)
-            self.ncp.add("lensing")
-
-        if "distortions" in level:
-            if distortions_init(&(self.pr), &(self.ba), &(self.th),
-                                &(self.pt), &(self.pm), &(self.sd)) == _FAILURE_:
-                self.struct_cleanup()
-                raise CosmoComputationError(self.sd.error_message)
-            self.ncp.add("distortions")
-
+            raise CosmoComputationError(errmsg)
+        self.allocated = True
         self.computed = True
 
         # At this point, the cosmological instance contains everything needed. The
@@ -712,6 +559,204 @@ cdef class Class:
 
         return cl
 
+    def set_number_count_nuisance(self, bias, magnification_bias):
+        """
+        set_number_count_nuisance(bias, magnification_bias)
+
+        Rebuild the number count spectra for new values of the light-to-mass
+        bias and magnification bias of each bin, as a linear combination of
+        the components stored with 'number_count_components = yes'. Nothing is
+        recomputed apart from the lensing module (if it was run), so that
+        density_cl() and lensed_cl() then return the new spectra.
+
+        Parameters
+        ----------
+        bias : float or array
+            Light-to-mass bias, common to all bins or one value per bin
+        magnification_bias : float or array
+            Magnification bias, common to all bins or one value per bin
+        """
+        cdef int index_d
+        cdef double * b
+        cdef double * s
+
+        if not self.hr.has_nc_components:
+            raise CosmoSevereError("number count components were not stored: set 'number_count_components' to yes")
+
+        bias = np.broadcast_to(np.asarray(bias, dtype=np.double), (self.hr.d_size,))
+        magnification_bias = np.broadcast_to(np.asarray(magnification_bias, dtype=np.double), (self.hr.d_size,))
+
+        b = <double*> malloc(sizeof(double)*self.hr.d_size)
+        s = <double*> malloc(sizeof(double)*self.hr.d_size)
+        for index_d in range(self.hr.d_size):
+            b[index_d] = bias[index_d]
+            s[index_d] = magnification_bias[index_d]
+
+        if harmonic_cl_number_count_recombine(&self.hr, b, s) == _FAILURE_:
+            free(b)
+            free(s)
+            raise CosmoSevereError(self.hr.error_message)
+        free(b)
+        free(s)
+
+        if self.modules & (1 << im_lensing):
+            lensing_free(&self.le)
+            self.modules &= ~(1 << im_lensing)
+            if lensing_init(&(self.pr), &(self.pt), &(self.hr),
+                            &(self.fo), &(self.le)) == _FAILURE_:
+                self.struct_cleanup()
+                raise CosmoComputationError(self.le.error_message)
+            self.modules |= (1 << im_lensing)
+
+    def cl_covariance(self, l_min, l_max, delta_l=1, fsky=1., noise=None):
+        """
+        cl_covariance(l_min, l_max, delta_l=1, fsky=1., noise=None)
+
+        Return the Gaussian (Knox) covariance of all the unlensed C_l types
+        computed by CLASS (tt, te, ..., dd, ll, ...), for bands of delta_l
+        multipoles between l_min and l_max. The covariance is block-diagonal
+        in l, so only the block of each band is returned. Cross-spectra not
+        computed by CLASS (e.g. between distant bins when non_diagonal is
+        small) are assumed to vanish.
+
+        Parameters
+        ----------
+        l_min : int
+            First multipole
+        l_max : int
+            Last multipole (the last band stops there)
+        delta_l : int, optional
+            Width of the bands (1 for no binning)
+        fsky : float, optional
+            Observed fraction of the sky
+        noise : dict, optional
+            Noise on the auto-spectra, in the units of raw_cl() and
+            density_cl(). Keys 'tt', 'ee', 'bb', 'pp' take a number or an
+            array of l_max-l_min+1 values. Keys 'dd', 'll' take a number, an
+            array of one value per bin (e.g. shot noise), or an array of shape
+            (number of bins, l_max-l_min+1)
+
+        Returns
+        -------
+        cov : dict
+            'ell': mean multipole of each band, 'cov': array of shape (number
+            of bands, ct_size, ct_size), and 'index_ct': index of each type in
+            the last two dimensions (first index for dd, td, ..., ordered like
+            in density_cl())
+        """
+        cdef int l_size = l_max-l_min+1
+        cdef int lb_size
+        cdef int index_d1
+        cdef np.ndarray[DTYPE_t, ndim=2] noise_l
+        cdef np.ndarray[DTYPE_t, ndim=3] cov
+        cdef double * noise_pointer = NULL
+
+        if delta_l < 1 or l_size < 1:
+            raise CosmoSevereError("wrong multipole range l_min=%d, l_max=%d, delta_l=%d" % (l_min, l_max, delta_l))
+        lb_size = (l_max-l_min)//delta_l+1
+
+        index_ct = {}
+        for flag, name, index in [
+            (self.hr.has_tt, 'tt', self.hr.index_ct_tt), (self.hr.has_ee, 'ee', self.hr.index_ct_ee),
+            (self.hr.has_te, 'te', self.hr.index_ct_te), (self.hr.has_bb, 'bb', self.hr.index_ct_bb),
+            (self.hr.has_pp, 'pp', self.hr.index_ct_pp), (self.hr.has_tp, 'tp', self.hr.index_ct_tp),
+            (self.hr.has_ep, 'ep', self.hr.index_ct_ep), (self.hr.has_dd, 'dd', self.hr.index_ct_dd),
+            (self.hr.has_td, 'td', self.hr.index_ct_td), (self.hr.has_pd, 'pd', self.hr.index_ct_pd),
+            (self.hr.has_ll, 'll', self.hr.index_ct_ll), (self.hr.has_tl, 'tl', self.hr.index_ct_tl),
+            (self.hr.has_dl, 'dl', self.hr.index_ct_dl)]:
+            if flag:
+                index_ct[name] = index
+
+        if noise is not None:
+            noise_l = np.zeros((l_size, self.hr.ct_size), 'float64')
+            for name, value in noise.items():
+                if name not in index_ct:
+                    raise CosmoSevereError("no '%s' spectrum to add noise to" % name)
+                if name in ['dd', 'll']:
+                    value = np.asarray(value, dtype=np.double)
+                    if value.ndim == 1:
+                        value = value[:, None]
+                    value = np.broadcast_to(value, (self.hr.d_size, l_size))
+                    # auto-correlation of each bin, with pairs ordered like in density_cl()
+                    index = index_ct[name]
+                    for index_d1 in range(self.hr.d_size):
+                        noise_l[:, index] = value[index_d1]
+                        index += min(self.hr.non_diag, self.hr.d_size-1-index_d1)+1
+                elif name in ['tt', 'ee', 'bb', 'pp']:
+                    noise_l[:, index_ct[name]] = np.broadcast_to(np.asarray(value, dtype=np.double), (l_size,))
+                else:
+                    raise CosmoSevereError("noise can only be added to auto-spectra, not to '%s'" % name)
+            noise_pointer = <double*> noise_l.data
+
+        cov = np.zeros((lb_size, self.hr.ct_size, self.hr.ct_size), 'float64')
+        if harmonic_cl_covariance(&self.hr, l_min, l_max, delta_l, fsky, noise_pointer, <double*> cov.data) == _FAILURE_:
+            raise CosmoSevereError(self.hr.error_message)
+
+        ell = np.array([np.mean(np.arange(l_min+index*delta_l, min(l_min+(index+1)*delta_l-1, l_max)+1)) for index in range(lb_size)])
+
+        return {'ell': ell, 'cov': cov, 'index_ct': index_ct}
+
+    def set_hmcode_feedback(self, c_min=None, eta_0=None):
+        """
+        set_hmcode_feedback(c_min=None, eta_0=None)
+
+        Re-evaluate the HMcode nonlinear power spectrum for new baryonic
+        feedback parameters, reusing the halo tables stored with
+        'hmcode_fast_feedback = yes'. If only one parameter is passed, the
+        other one follows from equation (30) of Mead et al. 2015, as in the
+        input module. The transfer, harmonic and lensing modules are re-run
+        if they were computed, since they depend on the nonlinear corrections.
+
+        Parameters
+        ----------
+        c_min : float
+            Minimum concentration in the mass-concentration relation
+        eta_0 : float
+            Halo bloating parameter
+        """
+        if not (self.modules & (1 << im_fourier)) or self.fo.method != nl_HMcode or not self.fo.hmcode_fast_feedback:
+            raise CosmoSevereError("HMcode halo tables were not stored: set 'non_linear' to hmcode and 'hmcode_fast_feedback' to yes")
+        if c_min is None and eta_0 is None:
+            raise CosmoSevereError("pass at least one of c_min and eta_0")
+        if c_min is None:
+            c_min = (0.98 - eta_0)/0.12
+        if eta_0 is None:
+            eta_0 = 0.98 - 0.12*c_min
+
+        if fourier_hmcode_update_feedback(&self.ba, &self.fo, nl_user_defined, c_min, eta_0) == _FAILURE_:
+            raise CosmoSevereError(self.fo.error_message)
+
+        rerun = [module for module in [im_transfer, im_harmonic, im_lensing] if self.modules & (1 << module)]
+        if im_lensing in rerun:
+            lensing_free(&self.le)
+            self.modules &= ~(1 << im_lensing)
+        if im_harmonic in rerun:
+            harmonic_free(&self.hr)
+            self.modules &= ~(1 << im_harmonic)
+        if im_transfer in rerun:
+            transfer_free(&self.tr)
+            self.modules &= ~(1 << im_transfer)
+
+        if im_transfer in rerun:
+            if transfer_init(&(self.pr), &(self.ba), &(self.th),
+                             &(self.pt), &(self.fo), &(self.tr)) == _FAILURE_:
+                self.struct_cleanup()
+                raise CosmoComputationError(self.tr.error_message)
+            self.modules |= (1 << im_transfer)
+        if im_harmonic in rerun:
+            if harmonic_init(&(self.pr), &(self.ba), &(self.pt),
+                            &(self.pm), &(self.fo), &(self.tr),
+                            &(self.hr)) == _FAILURE_:
+                self.struct_cleanup()
+                raise CosmoComputationError(self.hr.error_message)
+            self.modules |= (1 << im_harmonic)
+        if im_lensing in rerun:
+            if lensing_init(&(self.pr), &(self.pt), &(self.hr),
+                            &(self.fo), &(self.le)) == _FAILURE_:
+                self.struct_cleanup()
+                raise CosmoComputationError(self.le.error_message)
+            self.modules |= (1 << im_lensing)
+
     def z_of_r (self,z_array):
         cdef int last_index=0 #junk
         cdef double * pvecback
@@ -1248,6 +1293,10 @@ cdef class Class:
         psi = tk_and_k_and_z['psi']
         d_m = tk_and_k_and_z['d_m']
 
+        # with an analytic tail of P(k) (P_k_max_solved), transfer functions only cover the integrated wavenumbers
+        pk = pk[:np.size(k),:]
+        k4 = k4[:np.size(k),:]
+
         # get an array containing k**4 (same for all redshifts)
         for index_z in range(self.fo.ln_tau_size-self.pt.index_ln_tau_pk):
             k4[:,index_z] = k**4
@@ -2117,9 +2166,13 @@ cdef class Class:
         'output'. The transfer functions can also be computed at higher redshift z
         provided that 'z_pk' has been set and that 0<z<z_pk.
 
+        If z is an array, the transfer functions are computed at all
+        redshifts in a single sweep through the table of sources, and each
+        entry of the dictionary has shape (len(z), len(k)).
+
         Parameters
         ----------
-        z  : redshift (default = 0)
+        z  : redshift or array of redshifts (default = 0)
         output_format  : ('class' or 'camb') Format transfer functions according to
                          CLASS convention (default) or CAMB convention.
 
@@ -2128,10 +2181,11 @@ cdef class Class:
         tk : dictionary containing transfer functions.
         """
         cdef char *titles
-        cdef double* data
         cdef char ic_info[1024]
         cdef FileName ic_suffix
         cdef file_format outf
+        cdef double [::1] z_array
+        cdef double [:,:,:,::1] data
 
         if (not self.pt.has_density_transfers) and (not self.pt.has_velocity_transfers):
             return {}
@@ -2153,13 +2207,20 @@ cdef class Class:
         number_of_titles = len(names)
         timesteps = self.pt.k_size[index_md]
 
-        size_ic_data = timesteps*number_of_titles;
         ic_num = self.pt.ic_size[index_md];
 
-        data = <double*>malloc(sizeof(double)*size_ic_data*ic_num)
+        z_array = np.ascontiguousarray(np.atleast_1d(z), dtype=np.double)
+        data = np.empty((z_array.shape[0], ic_num, timesteps, number_of_titles))
 
-        if perturbations_output_data_at_z(&self.ba, &self.pt, outf, <double> z, number_of_titles, data)==_FAILURE_:
-            raise CosmoSevereError(self.pt.error_message)
+        if z_array.shape[0] > 0:
+            if perturbations_output_data_at_z_list(&self.ba, &self.pt, outf, z_array.shape[0], &z_array[0], number_of_titles, &data[0,0,0,0])==_FAILURE_:
+                raise CosmoSevereError(self.pt.error_message)
+
+        data_np = np.asarray(data)
+        if np.ndim(z) == 0:
+            data_np = data_np[0]
+        else:
+            data_np = np.moveaxis(data_np, 0, 1)
 
         transfers = {}
 
@@ -2170,9 +2231,7 @@ cdef class Class:
 
             tmpdict = {}
             for i in range(number_of_titles):
-                tmpdict[names[i]] = np.zeros(timesteps, dtype=np.double)
-                for index in range(timesteps):
-                    tmpdict[names[i]][index] = data[index_ic*size_ic_data+index*number_of_titles+i]
+                tmpdict[names[i]] = data_np[index_ic,...,i]
 
             if ic_num==1:
                 transfers = tmpdict
@@ -2180,7 +2239,6 @@ cdef class Class:
                 transfers[ic_key] = tmpdict
 
         free(titles)
-        free(data)
 
         return transfers
 
@@ -2702,40 +2760,17 @@ make        nonlinear_scale_cb(z, z_size)
         return sd_nu,sd_amp
 
 
-    def get_sources(self):
+    def _source_indices_and_names(self):
         """
-        Return the source functions for all k, tau in the grid.
+        Return the indices in the table of sources and the names of all
+        computed source functions (scalar mode)
 
         Returns
         -------
-        sources : dictionary containing source functions.
-        k_array : numpy array containing k values.
-        tau_array: numpy array containing tau values.
+        indices : list of source type indices
+        names : list of corresponding names
         """
-        sources = {}
-
-        cdef: 
-            int index_k, index_tau, i_index_type;
-            int index_type;
-            int index_md = self.pt.index_md_scalars;
-            double * k = self.pt.k[index_md];
-            double * tau = self.pt.tau_sampling;
-            int index_ic = self.pt.index_ic_ad;
-            int k_size = self.pt.k_size[index_md];
-            int tau_size = self.pt.tau_size;
-            int tp_size = self.pt.tp_size[index_md];
-            double *** sources_ptr = self.pt.sources;
-            double [:,:] tmparray = np.zeros((k_size, tau_size)) ;
-            double [:] k_array = np.zeros(k_size);
-            double [:] tau_array = np.zeros(tau_size);
-
         names = []
-
-        for index_k in range(k_size):
-            k_array[index_k] = k[index_k]
-        for index_tau in range(tau_size):
-            tau_array[index_tau] = tau[index_tau]
-
         indices = []
 
         if self.pt.has_source_t:
@@ -2869,6 +2904,45 @@ make        nonlinear_scale_cb(z, z_size)
               indices.append(self.pt.index_tp_theta_ncdm1+incdm)
               names.append("theta_ncdm[{}]".format(incdm))
 
+        return indices, names
+
+    def get_sources(self):
+        """
+        Return the source functions for all k, tau in the grid.
+
+        Returns
+        -------
+        sources : dictionary containing source functions.
+        k_array : numpy array containing k values.
+        tau_array: numpy array containing tau values.
+        """
+        sources = {}
+
+        cdef: 
+            int index_k, index_tau, i_index_type;
+            int index_type;
+            int index_md = self.pt.index_md_scalars;
+            double * k = self.pt.k[index_md];
+            double * tau = self.pt.tau_sampling;
+            int index_ic = self.pt.index_ic_ad;
+            int k_size = self.pt.k_size[index_md];
+            int tau_size = self.pt.tau_size;
+            int tp_size = self.pt.tp_size[index_md];
+            double *** sources_ptr = self.pt.sources;
+            double [:,:] tmparray = np.zeros((k_size, tau_size)) ;
+            double [:] k_array = np.zeros(k_size);
+            double [:] tau_array = np.zeros(tau_size);
+
+        if self.pt.sources_released:
+            raise CosmoSevereError("Source functions have been released by 'free_as_you_go'; add 'sources' to 'queries' to keep them")
+
+        for index_k in range(k_size):
+            k_array[index_k] = k[index_k]
+        for index_tau in range(tau_size):
+            tau_array[index_tau] = tau[index_tau]
+
+        indices, names = self._source_indices_and_names()
+
         for index_type, name in zip(indices, names):
             tmparray = np.empty((k_size,tau_size))
             for index_k in range(k_size):                 
@@ -2878,3 +2952,306 @@ make        nonlinear_scale_cb(z, z_size)
             sources[name] = np.asarray(tmparray)
 
         return (sources, np.asarray(k_array), np.asarray(tau_array))
+
+    def get_sources_at_z(self, z, names=None):
+        """
+        Return source functions for all k at a list of redshifts, computed
+        in a single sweep through the table of sources
+
+        All requested types and redshifts are written by one C call into a
+        single array of shape (number of types, number of redshifts,
+        number of k); the returned dictionary contains views of this
+        array (no copy).
+
+        Parameters
+        ----------
+        z : float or array of redshifts
+        names : list of source names (see get_sources()), or None for all
+
+        Returns
+        -------
+        sources : dictionary of arrays with shape (len(z), len(k)), or (len(k),) if z is a number
+        k_array : numpy array containing k values.
+        """
+        cdef:
+            int index_md = self.pt.index_md_scalars
+            int index_ic = self.pt.index_ic_ad
+            int k_size = self.pt.k_size[index_md]
+            int index_k
+            int [::1] index_tp
+            double [::1] z_array
+            double [:,:,::1] sources
+            double [::1] k_array = np.zeros(k_size)
+
+        if self.pt.sources_released:
+            raise CosmoSevereError("Source functions have been released by 'free_as_you_go'; add 'sources' to 'queries' to keep them")
+
+        all_indices, all_names = self._source_indices_and_names()
+        if names is None:
+            names = all_names
+        for name in names:
+            if name not in all_names:
+                raise CosmoSevereError("Source function '%s' was not computed; available: %s" % (name, all_names))
+        index_tp = np.array([all_indices[all_names.index(name)] for name in names], dtype=np.intc)
+
+        z_array = np.ascontiguousarray(np.atleast_1d(z), dtype=np.double)
+        sources = np.empty((len(names), z_array.shape[0], k_size))
+
+        if len(names) > 0 and z_array.shape[0] > 0:
+            if perturbations_sources_at_z_list(&self.ba, &self.pt, index_md, index_ic, len(names), &index_tp[0], z_array.shape[0], &z_array[0], &sources[0,0,0])==_FAILURE_:
+                raise CosmoSevereError(self.pt.error_message)
+
+        for index_k in range(k_size):
+            k_array[index_k] = self.pt.k[index_md][index_k]
+
+        sources_np = np.asarray(sources)
+        if np.ndim(z) == 0:
+            result = {name: sources_np[i,0] for i, name in enumerate(names)}
+        else:
+            result = {name: sources_np[i] for i, name in enumerate(names)}
+
+        return (result, np.asarray(k_array))
+
+    def memory_usage(self):
+        """
+        Return the resident and peak memory of the current process (in MB)
+
+        With 'free_as_you_go' set to 'yes', the intermediate tables of each
+        module are released as soon as no other module needs them, which
+        lowers both numbers. Values which cannot be determined on this
+        platform are set to -1.
+
+        Returns
+        -------
+        memory : dict with keys 'resident' and 'peak'
+        """
+        cdef double resident, peak
+        class_memory_usage(&resident, &peak)
+        return {'resident': resident, 'peak': peak}
+
+
+def read_precision_file(filename):
+    """
+    read_precision_file(filename)
+
+    Read a precision file like cl_permille.pre or cl_ref.pre, and return
+    its 'name = value' lines as a dictionary that can be passed to
+    Class.set()
+    """
+    pars = {}
+    with open(filename) as f:
+        for line in f:
+            line = line.split('#')[0].strip()
+            if '=' in line:
+                name, value = line.split('=', 1)
+                pars[name.strip()] = value.strip()
+    return pars
+
+
+class MultiFidelityClass(object):
+    """
+    Multi-fidelity evaluation: fast runs with low precision settings,
+    corrected by the ratio high/low of the same outputs computed with both
+    settings at a reference point.
+
+    The ratio (for auto-spectra and P(k)) or difference (for
+    cross-spectra, which cross zero) is cached, and refreshed by a new
+    high-precision run at the requested point whenever:
+
+    - the distance to the reference point, max_i |p_i-p_ref_i|/scale_i over
+      all numerical parameters, exceeds 'drift';
+    - or the estimated error of the corrected result exceeds 'tolerance'.
+      This estimate is the relative change of the correction between the
+      last two reference points, rescaled linearly to the distance from
+      the current reference.
+
+    Since the error estimate needs two reference points, the first two
+    distinct points are always computed with high precision: corrected
+    results are only returned once the error is controlled.
+
+    Parameters
+    ----------
+    low_precision : dict or str
+        Precision parameters (or name of a precision file) for fast runs
+    high_precision : dict or str
+        Precision parameters (or name of a precision file) for reference runs
+    scales : dict, optional
+        Scale of each parameter in the distance (default: |p_ref|, or 1 if p_ref=0)
+    drift : float, optional
+        Distance beyond which the reference is refreshed
+    tolerance : float, optional
+        Largest accepted estimated relative error of corrected results
+    k_pk : array, optional
+        Wavenumbers (1/Mpc) at which P(k,z) is returned (none if not set)
+    z_pk : array, optional
+        Redshifts at which P(k,z) is returned
+    nonlinear : bool, optional
+        Whether the returned P(k,z) is the nonlinear one
+    """
+
+    def __init__(self, low_precision, high_precision, scales=None, drift=0.05,
+                 tolerance=1.e-3, k_pk=None, z_pk=[0.], nonlinear=False):
+        if isinstance(low_precision, str):
+            low_precision = read_precision_file(low_precision)
+        if isinstance(high_precision, str):
+            high_precision = read_precision_file(high_precision)
+        self.low_precision = dict(low_precision)
+        self.high_precision = dict(high_precision)
+        self.scales = dict(scales) if scales is not None else {}
+        self.drift = drift
+        self.tolerance = tolerance
+        self.k_pk = None if k_pk is None else np.asarray(k_pk, dtype=np.double)
+        self.z_pk = np.atleast_1d(np.asarray(z_pk, dtype=np.double))
+        self.nonlinear = nonlinear
+        self.cosmo = Class()
+        # reference points: list of (params, correction), most recent last
+        self.references = []
+        self.high_precision_runs = 0
+        self.low_precision_runs = 0
+
+    def _run(self, params, precision):
+        self.cosmo.struct_cleanup()
+        self.cosmo.empty()
+        self.cosmo.set(params)
+        self.cosmo.set(precision)
+        self.cosmo.compute()
+        out = {}
+        if 'Cl' in str(params.get('output', '')):
+            if 'y' in str(params.get('lensing', 'no')).lower():
+                out['cl'] = self.cosmo.lensed_cl()
+            else:
+                out['cl'] = self.cosmo.raw_cl()
+        if self.k_pk is not None:
+            out['pk'] = np.array([[self.cosmo.pk(k, z) if self.nonlinear else self.cosmo.pk_lin(k, z)
+                                   for z in self.z_pk] for k in self.k_pk])
+        return out
+
+    @staticmethod
+    def _is_auto(name):
+        return len(name) == 2 and name[0] == name[1]
+
+    def _correction(self, high, low):
+        correction = {}
+        if 'cl' in low:
+            correction['cl'] = {}
+            for name, value in low['cl'].items():
+                if name == 'ell':
+                    continue
+                l_size = min(len(value), len(high['cl'][name]))
+                if self._is_auto(name):
+                    ratio = np.ones(len(value))
+                    nonzero = value[:l_size] != 0.
+                    ratio[:l_size][nonzero] = high['cl'][name][:l_size][nonzero]/value[:l_size][nonzero]
+                    correction['cl'][name] = ratio
+                else:
+                    difference = np.zeros(len(value))
+                    difference[:l_size] = high['cl'][name][:l_size]-value[:l_size]
+                    correction['cl'][name] = difference
+        if 'pk' in low:
+            correction['pk'] = high['pk']/low['pk']
+        return correction
+
+    def _apply(self, low, correction):
+        out = {}
+        if 'cl' in low:
+            out['cl'] = {'ell': low['cl']['ell']}
+            for name, value in low['cl'].items():
+                if name == 'ell':
+                    continue
+                if self._is_auto(name):
+                    out['cl'][name] = value*correction['cl'][name]
+                else:
+                    out['cl'][name] = value+correction['cl'][name]
+        if 'pk' in low:
+            out['pk'] = low['pk']*correction['pk']
+        return out
+
+    def _distance(self, params, reference):
+        distance = 0.
+        for name, value in params.items():
+            try:
+                value = float(value)
+                value_ref = float(reference.get(name, value))
+            except (TypeError, ValueError):
+                if reference.get(name) != value:
+                    return np.inf
+                continue
+            scale = np.abs(value_ref)
+            if scale == 0.:
+                scale = 1.
+            scale = self.scales.get(name, scale)
+            distance = max(distance, np.abs(value-value_ref)/scale)
+        for name in reference:
+            if name not in params:
+                return np.inf
+        return distance
+
+    def _relative_change(self, correction1, correction2, reference):
+        """maximum relative change between two corrections, measured on the
+        corrected result of the most recent reference"""
+        change = 0.
+        if 'cl' in correction1:
+            for name, value in correction1['cl'].items():
+                cl = reference['cl'][name]
+                if self._is_auto(name):
+                    change = max(change, np.max(np.abs(value/correction2['cl'][name]-1.)))
+                else:
+                    scale = np.max(np.abs(cl)) if np.any(cl != 0.) else 1.
+                    change = max(change, np.max(np.abs(value-correction2['cl'][name]))/scale)
+        if 'pk' in correction1:
+            change = max(change, np.max(np.abs(correction1['pk']/correction2['pk']-1.)))
+        return change
+
+    def error_estimate(self, params):
+        """
+        Estimated relative error of the corrected result at this point, or
+        infinity if it cannot be estimated (less than two reference points)
+        """
+        if len(self.references) < 2:
+            return np.inf
+        (params1, correction1, high1), (params2, correction2, high2) = self.references[-2:]
+        distance12 = self._distance(params2, params1)
+        if distance12 == 0. or not np.isfinite(distance12):
+            return np.inf
+        return self._relative_change(correction2, correction1, high2)*self._distance(params, params2)/distance12
+
+    def compute(self, params):
+        """
+        compute(params)
+
+        Return the corrected outputs at this point, as a dictionary with 'cl'
+        (like lensed_cl(), or raw_cl() without lensing), 'pk' (array
+        pk[index_k, index_z], if k_pk was set), 'high_precision' (whether
+        a reference run was done at this point) and 'error_estimate'
+        """
+        params = dict(params)
+        need_reference = True
+        error = np.inf
+        if self.references and self._distance(params, self.references[-1][0]) == 0.:
+            # same point as the last reference: return its high-precision result
+            out = dict(self.references[-1][2])
+            out['high_precision'] = False
+            out['error_estimate'] = 0.
+            return out
+        if len(self.references) >= 2:
+            distance = self._distance(params, self.references[-1][0])
+            error = self.error_estimate(params)
+            if distance <= self.drift and error <= self.tolerance:
+                need_reference = False
+
+        if need_reference:
+            high = self._run(params, self.high_precision)
+            low = self._run(params, self.low_precision)
+            self.high_precision_runs += 1
+            self.low_precision_runs += 1
+            self.references = self.references[-1:]+[(params, self._correction(high, low), high)]
+            out = high
+            error = 0.
+        else:
+            low = self._run(params, self.low_precision)
+            self.low_precision_runs += 1
+            out = self._apply(low, self.references[-1][1])
+
+        out['high_precision'] = need_reference
+        out['error_estimate'] = error
+        return out
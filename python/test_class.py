@@ -83,6 +83,7 @@ import unittest
 
 from classy import Class
 from classy import CosmoSevereError
+from classy import MultiFidelityClass
 from math import log10
 from matplotlib.offsetbox import AnchoredText
 from nose.plugins.attrib import attr
@@ -598,6 +599,103 @@ class TestClass(unittest.TestCase):
         # Store parameters (contained in self.scenario) to text file
         self.store_ini_file(path)
 
+class TestMultiFidelityClass(unittest.TestCase):
+    """
+    Testing MultiFidelityClass: refresh of the reference point when the
+    drift or the estimated error are too large, and accuracy of the
+    corrected results against a direct high-precision run
+
+    To run it, do
+    ~] nosetests test_class.py -a test_multifidelity
+    """
+
+    def setUp(self):
+        self.params = {
+            'output': 'tCl,pCl,lCl,mPk',
+            'lensing': 'yes',
+            'l_max_scalars': 1500,
+            'P_k_max_1/Mpc': 1.0,
+            'omega_b': 0.0224}
+        self.low_precision = {
+            'tol_perturbations_integration': 1.e-3,
+            'l_logstep': 1.3,
+            'l_linstep': 60,
+            'k_step_sub': 0.08}
+        self.high_precision = {}
+        self.k_pk = np.logspace(-3, 0, 10)
+
+    def point(self, omega_b):
+        params = dict(self.params)
+        params['omega_b'] = omega_b
+        return params
+
+    @attr('test_multifidelity')
+    def test_drift_refresh(self):
+        """A new reference is computed beyond the drift only"""
+        mf = MultiFidelityClass(self.low_precision, self.high_precision,
+                                drift=5.e-3, tolerance=1.)
+        # the first two points are references (no error control before)
+        self.assertTrue(mf.compute(self.point(0.0224))['high_precision'])
+        result = mf.compute(self.point(0.0226))
+        self.assertTrue(result['high_precision'])
+        self.assertEqual(result['error_estimate'], 0.)
+        # within the drift of the last reference
+        result = mf.compute(self.point(0.02261))
+        self.assertFalse(result['high_precision'])
+        self.assertTrue(np.isfinite(result['error_estimate']))
+        # beyond
+        self.assertTrue(mf.compute(self.point(0.0230))['high_precision'])
+        self.assertEqual(mf.high_precision_runs, 3)
+        self.assertEqual(mf.low_precision_runs, 4)
+
+    @attr('test_multifidelity')
+    def test_tolerance_trigger(self):
+        """A new reference is computed when the estimated error exceeds the tolerance"""
+        mf = MultiFidelityClass(self.low_precision, self.high_precision,
+                                drift=1., tolerance=1.e-8)
+        mf.compute(self.point(0.0224))
+        mf.compute(self.point(0.0226))
+        self.assertGreater(mf.error_estimate(self.point(0.0225)), mf.tolerance)
+        self.assertTrue(mf.compute(self.point(0.0225))['high_precision'])
+        mf.tolerance = 1.
+        self.assertFalse(mf.compute(self.point(0.02255))['high_precision'])
+        self.assertEqual(mf.high_precision_runs, 3)
+
+    @attr('test_multifidelity')
+    def test_corrected_result(self):
+        """Corrected Cl and P(k) are closer to a direct high-precision run than low-precision ones"""
+        mf = MultiFidelityClass(self.low_precision, self.high_precision,
+                                drift=0.05, tolerance=1.e-2, k_pk=self.k_pk)
+        mf.compute(self.point(0.0224))
+        mf.compute(self.point(0.0226))
+        params = self.point(0.02245)
+        result = mf.compute(params)
+        self.assertFalse(result['high_precision'])
+
+        cosmo = Class()
+        direct = {}
+        for name, precision in [('high', self.high_precision), ('low', self.low_precision)]:
+            cosmo.set(params)
+            cosmo.set(precision)
+            cosmo.compute()
+            direct[name] = {
+                'cl': cosmo.lensed_cl(),
+                'pk': np.array([[cosmo.pk_lin(k, 0.)] for k in self.k_pk])}
+            cosmo.struct_cleanup()
+            cosmo.empty()
+
+        high = direct['high']
+        for name in ['tt', 'ee', 'te']:
+            scale = np.max(np.abs(high['cl'][name][2:]))
+            error = np.max(np.abs(result['cl'][name][2:]-high['cl'][name][2:]))/scale
+            error_low = np.max(np.abs(direct['low']['cl'][name][2:]-high['cl'][name][2:]))/scale
+            self.assertLess(error, 1.e-4)
+            self.assertLess(error, error_low)
+        error = np.max(np.abs(result['pk']/high['pk']-1.))
+        error_low = np.max(np.abs(direct['low']['pk']/high['pk']-1.))
+        self.assertLess(error, result['error_estimate'])
+        self.assertLess(error, error_low)
+
 def has_tensor(input_dict):
     if 'modes' in list(input_dict.keys()):
         if input_dict['modes'].find('t') != -1:
@@ -113,6 +113,42 @@
  */
 
 #include "background.h"
+#include <sys/stat.h>
+
+/* nanoseconds of the modification time of a file, where the system
+   provides them (glibc defines st_mtime as st_mtim.tv_sec in that
+   case) */
+#if defined(__APPLE__)
+#define _MTIME_NSEC_(file_status) ((file_status).st_mtimespec.tv_nsec)
+#elif defined(st_mtime)
+#define _MTIME_NSEC_(file_status) ((file_status).st_mtim.tv_nsec)
+#else
+#define _MTIME_NSEC_(file_status) 0
+#endif
+
+/**
+ * Phase-space distribution tabulated in one of the files
+ * ncdm_psd_filenames, with its spline. The tables are kept for the
+ * lifetime of the process: background_ncdm_init() is called at each
+ * reading of the input (shooting method, wrappers running CLASS in a
+ * loop) and each file is then parsed only once. A file is read again
+ * if its size or modification time (to the nanosecond, where
+ * available) changed.
+ */
+
+struct background_ncdm_psd_table {
+  char filename[_ARGUMENT_LENGTH_MAX_];
+  time_t mtime;
+  long mtime_nsec;
+  off_t size;
+  int tablesize;
+  double *q;
+  double *f0;
+  double *d2f0;
+  struct background_ncdm_psd_table * next;
+};
+
+static struct background_ncdm_psd_table * background_ncdm_psd_tables = NULL;
 
 /**
  * Background quantities at given redshift z.
@@ -1352,10 +1388,106 @@ int background_ncdm_test_function(
   return _SUCCESS_;
 }
 
+/**
+ * Get the tabulated phase-space distribution of one ncdm species
+ * from a file, reading and splining the file only if it is not yet in
+ * the tables kept by the process.
+ *
+ * Not thread-safe: must be called inside the critical section
+ * background_ncdm_psd_tables.
+ *
+ * @param pba      Input: background structure (for error messages)
+ * @param filename Input: name of the file
+ * @param pbadist  Output: tablesize, q, f0 and d2f0 point to the table (not to be freed)
+ * @return the error status
+ */
+
+int background_ncdm_psd_file(
+                             struct background * pba,
+                             char * filename,
+                             struct background_parameters_for_distributions * pbadist
+                             ) {
+
+  struct background_ncdm_psd_table * table;
+  struct stat file_status;
+  FILE *psdfile;
+  int row,status;
+  double tmp1,tmp2;
+
+  class_test(stat(filename,&file_status) != 0,
+             pba->error_message,
+             "Could not open file %s!",filename);
+
+  /** - look for the file among the tables already read */
+  for (table=background_ncdm_psd_tables; table!=NULL; table=table->next) {
+    if ((strcmp(table->filename,filename) == 0) &&
+        (table->mtime == file_status.st_mtime) &&
+        (table->mtime_nsec == _MTIME_NSEC_(file_status)) &&
+        (table->size == file_status.st_size))
+      break;
+  }
+
+  /** - otherwise read it and add it to the tables. A previous version
+      of the file stays in the list, since another run may still use
+      it */
+  if (table == NULL) {
+
+    psdfile = fopen(filename,"r");
+    class_test(psdfile == NULL,pba->error_message,
+               "Could not open file %s!",filename);
+
+    class_alloc(table,sizeof(struct background_ncdm_psd_table),pba->error_message);
+    strncpy(table->filename,filename,_ARGUMENT_LENGTH_MAX_-1);
+    table->filename[_ARGUMENT_LENGTH_MAX_-1] = '\0';
+    table->mtime = file_status.st_mtime;
+    table->mtime_nsec = _MTIME_NSEC_(file_status);
+    table->size = file_status.st_size;
+
+    // Find size of table:
+    for (row=0,status=2; status==2; row++) {
+      status = fscanf(psdfile,"%lf %lf",&tmp1,&tmp2);
+    }
+    rewind(psdfile);
+    table->tablesize = row-1;
+
+    /*Allocate room for interpolation table: */
+    class_alloc(table->q,sizeof(double)*table->tablesize,pba->error_message);
+    class_alloc(table->f0,sizeof(double)*table->tablesize,pba->error_message);
+    class_alloc(table->d2f0,sizeof(double)*table->tablesize,pba->error_message);
+    for (row=0; row<table->tablesize; row++) {
+      status = fscanf(psdfile,"%lf %lf",
+                      &table->q[row],&table->f0[row]);
+    }
+    fclose(psdfile);
+    /* Call spline interpolation: */
+    class_call(array_spline_table_lines(table->q,
+                                        table->tablesize,
+                                        table->f0,
+                                        1,
+                                        table->d2f0,
+                                        _SPLINE_EST_DERIV_,
+                                        pba->error_message),
+               pba->error_message,
+               pba->error_message);
+
+    table->next = background_ncdm_psd_tables;
+    background_ncdm_psd_tables = table;
+  }
+
+  pbadist->tablesize = table->tablesize;
+  pbadist->q = table->q;
+  pbadist->f0 = table->f0;
+  pbadist->d2f0 = table->d2f0;
+
+  return _SUCCESS_;
+}
+
 /**
  * This function finds optimal quadrature weights for each ncdm
  * species
  *
+ * The species are independent and are sampled in parallel.
+ *
  * @param ppr Input: precision structure
  * @param pba Input/Output: background structure
  */
@@ -1365,12 +1497,10 @@ int background_ncdm_init(
                          struct background *pba
                          ) {
 
-  int index_q, k,tolexp,row,status,filenum;
-  double f0m2,f0m1,f0,f0p1,f0p2,dq,q,df0dq,tmp1,tmp2;
-  struct background_parameters_for_distributions pbadist;
-  FILE *psdfile;
-
-  pbadist.pba = pba;
+  int k,filenum,number_of_threads;
+  struct background_parameters_for_distributions * pbadist;
+  /* error flag, also used in the critical section and parallel loop below */
+  int abort = _FALSE_;
 
   /* Allocate pointer arrays: */
   class_alloc(pba->q_ncdm, sizeof(double*)*pba->N_ncdm,pba->error_message);
@@ -1384,192 +1514,235 @@ int background_ncdm_init(
   class_alloc(pba->q_size_ncdm_bg,sizeof(int)*pba->N_ncdm,pba->error_message);
   class_alloc(pba->factor_ncdm,sizeof(double)*pba->N_ncdm,pba->error_message);
 
+  /* One set of parameters of the distribution per species: */
+  class_alloc(pbadist,sizeof(struct background_parameters_for_distributions)*pba->N_ncdm,pba->error_message);
+
+  /** - get the tabulated distributions of the species read from files */
   for (k=0, filenum=0; k<pba->N_ncdm; k++) {
-    pbadist.n_ncdm = k;
-    pbadist.q = NULL;
-    pbadist.tablesize = 0;
+    pbadist[k].pba = pba;
+    pbadist[k].n_ncdm = k;
+    pbadist[k].q = NULL;
+    pbadist[k].f0 = NULL;
+    pbadist[k].d2f0 = NULL;
+    pbadist[k].tablesize = 0;
     /*Do we need to read in a file to interpolate the distribution function? */
     if ((pba->got_files!=NULL)&&(pba->got_files[k]==_TRUE_)) {
-      psdfile = fopen(pba->ncdm_psd_files+filenum*_ARGUMENT_LENGTH_MAX_,"r");
-      class_test(psdfile == NULL,pba->error_message,
-                 "Could not open file %s!",pba->ncdm_psd_files+filenum*_ARGUMENT_LENGTH_MAX_);
-      // Find size of table:
-      for (row=0,status=2; status==2; row++) {
-        status = fscanf(psdfile,"%lf %lf",&tmp1,&tmp2);
+#pragma omp critical (background_ncdm_psd_tables)
+      class_call_parallel(background_ncdm_psd_file(pba,
+                                                   pba->ncdm_psd_files+filenum*_ARGUMENT_LENGTH_MAX_,
+                                                   &(pbadist[k])),
+                          pba->error_message,
+                          pba->error_message);
+      if (abort == _TRUE_) {
+        free(pbadist);
+        return _FAILURE_;
       }
-      rewind(psdfile);
-      pbadist.tablesize = row-1;
-
-      /*Allocate room for interpolation table: */
-      class_alloc(pbadist.q,sizeof(double)*pbadist.tablesize,pba->error_message);
-      class_alloc(pbadist.f0,sizeof(double)*pbadist.tablesize,pba->error_message);
-      class_alloc(pbadist.d2f0,sizeof(double)*pbadist.tablesize,pba->error_message);
-      for (row=0; row<pbadist.tablesize; row++) {
-        status = fscanf(psdfile,"%lf %lf",
-                        &pbadist.q[row],&pbadist.f0[row]);
-        //        printf("(q,f0) = (%g,%g)\n",pbadist.q[row],pbadist.f0[row]);
-      }
-      fclose(psdfile);
-      /* Call spline interpolation: */
-      class_call(array_spline_table_lines(pbadist.q,
-                                          pbadist.tablesize,
-                                          pbadist.f0,
-                                          1,
-                                          pbadist.d2f0,
-                                          _SPLINE_EST_DERIV_,
-                                          pba->error_message),
-                 pba->error_message,
-                 pba->error_message);
       filenum++;
     }
+  }
 
-    /* Handle perturbation qsampling: */
-    if (pba->ncdm_quadrature_strategy[k]==qm_auto) {
-      /** Automatic q-sampling for this species */
-      class_alloc(pba->q_ncdm[k],_QUADRATURE_MAX_*sizeof(double),pba->error_message);
-      class_alloc(pba->w_ncdm[k],_QUADRATURE_MAX_*sizeof(double),pba->error_message);
-
-      class_call(get_qsampling(pba->q_ncdm[k],
-                               pba->w_ncdm[k],
-                               &(pba->q_size_ncdm[k]),
-                               _QUADRATURE_MAX_,
-                               ppr->tol_ncdm,
-                               pbadist.q,
-                               pbadist.tablesize,
-                               background_ncdm_test_function,
-                               background_ncdm_distribution,
-                               &pbadist,
-                               pba->error_message),
-                 pba->error_message,
-                 pba->error_message);
-      pba->q_ncdm[k]=realloc(pba->q_ncdm[k],pba->q_size_ncdm[k]*sizeof(double));
-      pba->w_ncdm[k]=realloc(pba->w_ncdm[k],pba->q_size_ncdm[k]*sizeof(double));
+  /** - sample each species */
+  number_of_threads = class_number_of_threads(pba->N_ncdm,
+                                              _NCDM_SAMPLING_COST_,
+                                              ppr->thread_overhead,
+                                              0);
 
+#pragma omp parallel for                        \
+  shared(ppr,pba,pbadist,abort)                 \
+  private(k)                                    \
+  schedule(dynamic)                             \
+  num_threads(number_of_threads)
 
-      if (pba->background_verbose > 0) {
-        printf("ncdm species i=%d sampled with %d points for purpose of perturbation integration\n",
-               k+1,
-               pba->q_size_ncdm[k]);
-      }
+  for (k=0; k<pba->N_ncdm; k++) {
 
-      /* Handle background q_sampling: */
-      class_alloc(pba->q_ncdm_bg[k],_QUADRATURE_MAX_BG_*sizeof(double),pba->error_message);
-      class_alloc(pba->w_ncdm_bg[k],_QUADRATURE_MAX_BG_*sizeof(double),pba->error_message);
-
-      class_call(get_qsampling(pba->q_ncdm_bg[k],
-                               pba->w_ncdm_bg[k],
-                               &(pba->q_size_ncdm_bg[k]),
-                               _QUADRATURE_MAX_BG_,
-                               ppr->tol_ncdm_bg,
-                               pbadist.q,
-                               pbadist.tablesize,
-                               background_ncdm_test_function,
-                               background_ncdm_distribution,
-                               &pbadist,
-                               pba->error_message),
-                 pba->error_message,
-                 pba->error_message);
+#pragma omp flush(abort)
+
+    class_call_parallel(background_ncdm_sampling(ppr,pba,&(pbadist[k])),
+                        pba->error_message,
+                        pba->error_message);
+  }
 
-      pba->q_ncdm_bg[k]=realloc(pba->q_ncdm_bg[k],pba->q_size_ncdm_bg[k]*sizeof(double));
-      pba->w_ncdm_bg[k]=realloc(pba->w_ncdm_bg[k],pba->q_size_ncdm_bg[k]*sizeof(double));
+  free(pbadist);
 
-      /** - in verbose mode, inform user of number of sampled momenta
-          for background quantities */
-      if (pba->background_verbose > 0) {
+  if (abort == _TRUE_) return _FAILURE_;
+
+  /** - in verbose mode, inform user of number of sampled momenta */
+  if (pba->background_verbose > 0) {
+    for (k=0; k<pba->N_ncdm; k++) {
+      if (pba->ncdm_quadrature_strategy[k]==qm_auto) {
+        printf("ncdm species i=%d sampled with %d points for purpose of perturbation integration\n",
+               k+1,
+               pba->q_size_ncdm[k]);
         printf("ncdm species i=%d sampled with %d points for purpose of background integration\n",
                k+1,
                pba->q_size_ncdm_bg[k]);
       }
-    }
-    else{
-      /** Manual q-sampling for this species. Same sampling used for both perturbation and background sampling, since this will usually be a high precision setting anyway */
-      pba->q_size_ncdm_bg[k] = pba->ncdm_input_q_size[k];
-      pba->q_size_ncdm[k] = pba->ncdm_input_q_size[k];
-      class_alloc(pba->q_ncdm_bg[k],pba->q_size_ncdm_bg[k]*sizeof(double),pba->error_message);
-      class_alloc(pba->w_ncdm_bg[k],pba->q_size_ncdm_bg[k]*sizeof(double),pba->error_message);
-      class_alloc(pba->q_ncdm[k],pba->q_size_ncdm[k]*sizeof(double),pba->error_message);
-      class_alloc(pba->w_ncdm[k],pba->q_size_ncdm[k]*sizeof(double),pba->error_message);
-      class_call(get_qsampling_manual(pba->q_ncdm[k],
-                                      pba->w_ncdm[k],
-                                      pba->q_size_ncdm[k],
-                                      pba->ncdm_qmax[k],
-                                      pba->ncdm_quadrature_strategy[k],
-                                      pbadist.q,
-                                      pbadist.tablesize,
-                                      background_ncdm_distribution,
-                                      &pbadist,
-                                      pba->error_message),
-                 pba->error_message,
-                 pba->error_message);
-      for (index_q=0; index_q<pba->q_size_ncdm[k]; index_q++) {
-        pba->q_ncdm_bg[k][index_q] = pba->q_ncdm[k][index_q];
-        pba->w_ncdm_bg[k][index_q] = pba->w_ncdm[k][index_q];
-      }
-      /** - in verbose mode, inform user of number of sampled momenta
-          for background quantities */
-      if (pba->background_verbose > 0) {
+      else {
         printf("ncdm species i=%d sampled with %d points for purpose of background andperturbation integration using the manual method\n",
                k+1,
                pba->q_size_ncdm[k]);
       }
     }
+  }
 
-    class_alloc(pba->dlnf0_dlnq_ncdm[k],
-                pba->q_size_ncdm[k]*sizeof(double),
-                pba->error_message);
+  return _SUCCESS_;
+}
 
+/**
+ * This function finds optimal quadrature weights for one ncdm
+ * species, and the logarithmic derivative of its distribution at each
+ * momentum. It only writes in the arrays of this species.
+ *
+ * @param ppr     Input: precision structure
+ * @param pba     Input/Output: background structure
+ * @param pbadist Input: parameters of the distribution of this species
+ */
 
+int background_ncdm_sampling(
+                             struct precision *ppr,
+                             struct background *pba,
+                             struct background_parameters_for_distributions * pbadist
+                             ) {
+
+  int index_q, k,tolexp;
+  double f0m2,f0m1,f0,f0p1,f0p2,dq,q,df0dq;
+  qss_trees trees;
+
+  k = pbadist->n_ncdm;
+
+  /* Handle perturbation qsampling: */
+  if (pba->ncdm_quadrature_strategy[k]==qm_auto) {
+    /** Automatic q-sampling for this species. The adaptive trees
+        are built once, for the smaller of the two tolerances, and
+        shared by the perturbation and background samplings */
+    class_call(get_qsampling_trees(&trees,
+                                   MIN(ppr->tol_ncdm,ppr->tol_ncdm_bg),
+                                   pbadist->q,
+                                   pbadist->tablesize,
+                                   background_ncdm_test_function,
+                                   background_ncdm_distribution,
+                                   pbadist,
+                                   pba->error_message),
+               pba->error_message,
+               pba->error_message);
+
+    class_alloc(pba->q_ncdm[k],_QUADRATURE_MAX_*sizeof(double),pba->error_message);
+    class_alloc(pba->w_ncdm[k],_QUADRATURE_MAX_*sizeof(double),pba->error_message);
+
+    class_call(get_qsampling_from_trees(pba->q_ncdm[k],
+                                        pba->w_ncdm[k],
+                                        &(pba->q_size_ncdm[k]),
+                                        _QUADRATURE_MAX_,
+                                        ppr->tol_ncdm,
+                                        pbadist->q,
+                                        pbadist->tablesize,
+                                        background_ncdm_test_function,
+                                        background_ncdm_distribution,
+                                        pbadist,
+                                        &trees,
+                                        pba->error_message),
+               pba->error_message,
+               pba->error_message);
+    pba->q_ncdm[k]=realloc(pba->q_ncdm[k],pba->q_size_ncdm[k]*sizeof(double));
+    pba->w_ncdm[k]=realloc(pba->w_ncdm[k],pba->q_size_ncdm[k]*sizeof(double));
+
+    /* Handle background q_sampling: */
+    class_alloc(pba->q_ncdm_bg[k],_QUADRATURE_MAX_BG_*sizeof(double),pba->error_message);
+    class_alloc(pba->w_ncdm_bg[k],_QUADRATURE_MAX_BG_*sizeof(double),pba->error_message);
+
+    class_call(get_qsampling_from_trees(pba->q_ncdm_bg[k],
+                                        pba->w_ncdm_bg[k],
+                                        &(pba->q_size_ncdm_bg[k]),
+                                        _QUADRATURE_MAX_BG_,
+                                        ppr->tol_ncdm_bg,
+                                        pbadist->q,
+                                        pbadist->tablesize,
+                                        background_ncdm_test_function,
+                                        background_ncdm_distribution,
+                                        pbadist,
+                                        &trees,
+                                        pba->error_message),
+               pba->error_message,
+               pba->error_message);
+
+    pba->q_ncdm_bg[k]=realloc(pba->q_ncdm_bg[k],pba->q_size_ncdm_bg[k]*sizeof(double));
+    pba->w_ncdm_bg[k]=realloc(pba->w_ncdm_bg[k],pba->q_size_ncdm_bg[k]*sizeof(double));
+
+    free_qsampling_trees(&trees);
+  }
+  else{
+    /** Manual q-sampling for this species. Same sampling used for both perturbation and background sampling, since this will usually be a high precision setting anyway */
+    pba->q_size_ncdm_bg[k] = pba->ncdm_input_q_size[k];
+    pba->q_size_ncdm[k] = pba->ncdm_input_q_size[k];
+    class_alloc(pba->q_ncdm_bg[k],pba->q_size_ncdm_bg[k]*sizeof(double),pba->error_message);
+    class_alloc(pba->w_ncdm_bg[k],pba->q_size_ncdm_bg[k]*sizeof(double),pba->error_message);
+    class_alloc(pba->q_ncdm[k],pba->q_size_ncdm[k]*sizeof(double),pba->error_message);
+    class_alloc(pba->w_ncdm[k],pba->q_size_ncdm[k]*sizeof(double),pba->error_message);
+    class_call(get_qsampling_manual(pba->q_ncdm[k],
+                                    pba->w_ncdm[k],
+                                    pba->q_size_ncdm[k],
+                                    pba->ncdm_qmax[k],
+                                    pba->ncdm_quadrature_strategy[k],
+                                    pbadist->q,
+                                    pbadist->tablesize,
+                                    background_ncdm_distribution,
+                                    pbadist,
+                                    pba->error_message),
+               pba->error_message,
+               pba->error_message);
     for (index_q=0; index_q<pba->q_size_ncdm[k]; index_q++) {
-      q = pba->q_ncdm[k][index_q];
-      class_call(background_ncdm_distribution(&pbadist,q,&f0),
-                 pba->error_message,pba->error_message);
+      pba->q_ncdm_bg[k][index_q] = pba->q_ncdm[k][index_q];
+      pba->w_ncdm_bg[k][index_q] = pba->w_ncdm[k][index_q];
+    }
+  }
 
-      //Loop to find appropriate dq:
-      for (tolexp=_PSD_DERIVATIVE_EXP_MIN_; tolexp<_PSD_DERIVATIVE_EXP_MAX_; tolexp++) {
+  class_alloc(pba->dlnf0_dlnq_ncdm[k],
+              pba->q_size_ncdm[k]*sizeof(double),
+              pba->error_message);
 
-        if (index_q == 0) {
-          dq = MIN((0.5-ppr->smallest_allowed_variation)*q,2*exp(tolexp)*(pba->q_ncdm[k][index_q+1]-q));
-        }
-        else if (index_q == pba->q_size_ncdm[k]-1) {
-          dq = exp(tolexp)*2.0*(pba->q_ncdm[k][index_q]-pba->q_ncdm[k][index_q-1]);
-        }
-        else{
-          dq = exp(tolexp)*(pba->q_ncdm[k][index_q+1]-pba->q_ncdm[k][index_q-1]);
-        }
 
-        class_call(background_ncdm_distribution(&pbadist,q-2*dq,&f0m2),
-                   pba->error_message,pba->error_message);
-        class_call(background_ncdm_distribution(&pbadist,q+2*dq,&f0p2),
-                   pba->error_message,pba->error_message);
+  for (index_q=0; index_q<pba->q_size_ncdm[k]; index_q++) {
+    q = pba->q_ncdm[k][index_q];
+    class_call(background_ncdm_distribution(pbadist,q,&f0),
+               pba->error_message,pba->error_message);
+
+    //Loop to find appropriate dq:
+    for (tolexp=_PSD_DERIVATIVE_EXP_MIN_; tolexp<_PSD_DERIVATIVE_EXP_MAX_; tolexp++) {
 
-        if (fabs((f0p2-f0m2)/f0)>sqrt(ppr->smallest_allowed_variation)) break;
+      if (index_q == 0) {
+        dq = MIN((0.5-ppr->smallest_allowed_variation)*q,2*exp(tolexp)*(pba->q_ncdm[k][index_q+1]-q));
+      }
+      else if (index_q == pba->q_size_ncdm[k]-1) {
+        dq = exp(tolexp)*2.0*(pba->q_ncdm[k][index_q]-pba->q_ncdm[k][index_q-1]);
+      }
+      else{
+        dq = exp(tolexp)*(pba->q_ncdm[k][index_q+1]-pba->q_ncdm[k][index_q-1]);
       }
 
-      class_call(background_ncdm_distribution(&pbadist,q-dq,&f0m1),
+      class_call(background_ncdm_distribution(pbadist,q-2*dq,&f0m2),
                  pba->error_message,pba->error_message);
-      class_call(background_ncdm_distribution(&pbadist,q+dq,&f0p1),
+      class_call(background_ncdm_distribution(pbadist,q+2*dq,&f0p2),
                  pba->error_message,pba->error_message);
-      //5 point estimate of the derivative:
-      df0dq = (+f0m2-8*f0m1+8*f0p1-f0p2)/12.0/dq;
-      //printf("df0dq[%g] = %g. dlf=%g ?= %g. f0 =%g.\n",q,df0dq,q/f0*df0dq,
-      //Avoid underflow in extreme tail:
-      if (fabs(f0)==0.)
-        pba->dlnf0_dlnq_ncdm[k][index_q] = -q; /* valid for whatever f0 with exponential tail in exp(-q) */
-      else
-        pba->dlnf0_dlnq_ncdm[k][index_q] = q/f0*df0dq;
-    }
-
-    pba->factor_ncdm[k]=pba->deg_ncdm[k]*4*_PI_*pow(pba->T_cmb*pba->T_ncdm[k]*_k_B_,4)*8*_PI_*_G_
-      /3./pow(_h_P_/2./_PI_,3)/pow(_c_,7)*_Mpc_over_m_*_Mpc_over_m_;
 
-    /* If allocated, deallocate interpolation table:  */
-    if ((pba->got_files!=NULL)&&(pba->got_files[k]==_TRUE_)) {
-      free(pbadist.q);
-      free(pbadist.f0);
-      free(pbadist.d2f0);
+      if (fabs((f0p2-f0m2)/f0)>sqrt(ppr->smallest_allowed_variation)) break;
     }
+
+    class_call(background_ncdm_distribution(pbadist,q-dq,&f0m1),
+               pba->error_message,pba->error_message);
+    class_call(background_ncdm_distribution(pbadist,q+dq,&f0p1),
+               pba->error_message,pba->error_message);
+    //5 point estimate of the derivative:
+    df0dq = (+f0m2-8*f0m1+8*f0p1-f0p2)/12.0/dq;
+    //printf("df0dq[%g] = %g. dlf=%g ?= %g. f0 =%g.\n",q,df0dq,q/f0*df0dq,
+    //Avoid underflow in extreme tail:
+    if (fabs(f0)==0.)
+      pba->dlnf0_dlnq_ncdm[k][index_q] = -q; /* valid for whatever f0 with exponential tail in exp(-q) */
+    else
+      pba->dlnf0_dlnq_ncdm[k][index_q] = q/f0*df0dq;
   }
 
+  pba->factor_ncdm[k]=pba->deg_ncdm[k]*4*_PI_*pow(pba->T_cmb*pba->T_ncdm[k]*_k_B_,4)*8*_PI_*_G_
+    /3./pow(_h_P_/2./_PI_,3)/pow(_c_,7)*_Mpc_over_m_*_Mpc_over_m_;
 
   return _SUCCESS_;
 }
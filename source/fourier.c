@@ -1176,6 +1176,135 @@ int fourier_k_nl_at_z(
   return _SUCCESS_;
 }
 
+/**
+ * Re-evaluate the HMcode nonlinear power spectrum and the nonlinear
+ * corrections for new baryonic feedback parameters, without
+ * recomputing the linear spectra, the sigma tables and the nonlinear
+ * scale. Only possible if fourier_init() ran with
+ * hmcode_fast_feedback set to true. The arrays nl_corr_density,
+ * ln_pk_nl and ddln_pk_nl are overwritten; modules using
+ * nl_corr_density (transfer and beyond) must be re-run afterwards.
+ *
+ * @param pba      Input: pointer to background structure
+ * @param pfo      Input/Output: pointer to fourier structure
+ * @param feedback Input: baryonic feedback model
+ * @param c_min    Input: minimum concentration (used only if feedback = nl_user_defined)
+ * @param eta_0    Input: halo bloating parameter (used only if feedback = nl_user_defined)
+ * @return the error status
+ */
+
+int fourier_hmcode_update_feedback(
+                                   struct background *pba,
+                                   struct fourier *pfo,
+                                   enum hmcode_baryonic_feedback_model feedback,
+                                   double c_min,
+                                   double eta_0
+                                   ) {
+
+  int index_pk, index_tau, index_tau_late, index_k, index_mass;
+  int offset;
+  double * conc;
+  double * pk_nl;
+  int abort;
+
+  class_test((pfo->method != nl_HMcode) || (pfo->hmcode_fast_feedback == _FALSE_),
+             pfo->error_message,
+             "fast update of the baryonic feedback requires non_linear = hmcode and hmcode_fast_feedback = yes");
+
+  pfo->feedback = feedback;
+  pfo->c_min = c_min;
+  pfo->eta_0 = eta_0;
+
+  class_call(fourier_hmcode_baryonic_feedback(pfo),
+             pfo->error_message,
+             pfo->error_message);
+
+  for (index_pk=0; index_pk<pfo->pk_size; index_pk++) {
+
+    /* initialize error management flag */
+    abort = _FALSE_;
+
+    /* beginning of parallel region */
+
+#pragma omp parallel                            \
+  shared(pba,pfo,index_pk,abort)                \
+  private(index_tau,index_tau_late,index_k,index_mass,offset,conc,pk_nl)
+
+    {
+
+      class_alloc_parallel(conc,pfo->hm_mass_size*sizeof(double),pfo->error_message);
+      class_alloc_parallel(pk_nl,pfo->k_size*sizeof(double),pfo->error_message);
+
+#pragma omp for schedule (dynamic)
+
+      for (index_tau=0; index_tau<pfo->tau_size; index_tau++) {
+
+#pragma omp flush(abort)
+
+        /* times where P_NL could not be computed keep R_NL=1 */
+        if (pfo->hm_computable[index_pk][index_tau] == _FALSE_)
+          continue;
+
+        offset = index_tau*pfo->hm_mass_size;
+
+        for (index_mass=0; index_mass<pfo->hm_mass_size; index_mass++) {
+          conc[index_mass] = pfo->c_min*pfo->hm_conc1[index_pk][offset+index_mass];
+        }
+
+        class_call_parallel(fourier_hmcode_pk_nl(pfo,
+                                                 pfo->hm_ln_pk_l[index_pk]+index_tau*pfo->k_size,
+                                                 pfo->hm_mass,
+                                                 pfo->hm_nu[index_pk]+offset,
+                                                 pfo->hm_r_virial[index_pk]+offset,
+                                                 conc,
+                                                 pfo->hm_index_cut[index_pk][index_tau],
+                                                 pfo->eta_0 - 0.3*pfo->hm_sigma8[index_pk][index_tau],
+                                                 0.584/pfo->hm_sigma_disp[index_pk][index_tau],
+                                                 pfo->hm_sigma_disp[index_pk][index_tau],
+                                                 pfo->hm_fdamp[index_pk][index_tau],
+                                                 pfo->hm_alpha[index_pk][index_tau],
+                                                 pfo->hm_rho_m[index_pk],
+                                                 pk_nl),
+                            pfo->error_message,
+                            pfo->error_message);
+
+        for (index_k=0; index_k<pfo->k_size; index_k++) {
+          pfo->nl_corr_density[index_pk][index_tau * pfo->k_size + index_k] = sqrt(pk_nl[index_k]/exp(pfo->hm_ln_pk_l[index_pk][index_tau*pfo->k_size+index_k]));
+        }
+
+        if (index_tau >= pfo->tau_size - pfo->ln_tau_size) {
+
+          index_tau_late = index_tau - (pfo->tau_size - pfo->ln_tau_size);
+
+          for (index_k=0; index_k<pfo->k_size; index_k++) {
+            pfo->ln_pk_nl[index_pk][index_tau_late * pfo->k_size + index_k] = pfo->ln_pk_l[index_pk][index_tau_late * pfo->k_size + index_k] + 2.*log(pfo->nl_corr_density[index_pk][index_tau * pfo->k_size + index_k]);
+          }
+        }
+      }
+
+      free(conc);
+      free(pk_nl);
+
+    } /* end of parallel region */
+
+    if (abort == _TRUE_) return _FAILURE_;
+
+    if (pfo->ln_tau_size > 1) {
+      class_call(array_spline_table_lines(pfo->ln_tau,
+                                          pfo->ln_tau_size,
+                                          pfo->ln_pk_nl[index_pk],
+                                          pfo->k_size,
+                                          pfo->ddln_pk_nl[index_pk],
+                                          _SPLINE_EST_DERIV_,
+                                          pfo->error_message),
+                 pfo->error_message,
+                 pfo->error_message);
+    }
+  }
+
+  return _SUCCESS_;
+}
+
 /**
  * Initialize the fourier structure, and in particular the
  * nl_corr_density and k_nl interpolation tables.
@@ -1424,6 +1553,12 @@ int fourier_init(
       class_call(fourier_hmcode_baryonic_feedback(pfo),
                  pfo->error_message,
                  pfo->error_message);
+
+      if (pfo->hmcode_fast_feedback == _TRUE_) {
+        class_call(fourier_hmcode_tables_init(ppr,pba,pfo),
+                   pfo->error_message,
+                   pfo->error_message);
+      }
     }
 
     /** --> Loop over decreasing time/growing redhsift. For each
@@ -1681,6 +1816,9 @@ int fourier_free(
     }
 
     free(pfo->is_non_zero);
+
+    if (pfo->tail_cb_fraction != NULL)
+      free(pfo->tail_cb_fraction);
   }
 
   if (pfo->method > nl_none) {
@@ -1698,6 +1836,12 @@ int fourier_free(
     free(pfo->ln_pk_nl);
     if (pfo->ln_tau_size > 1)
       free(pfo->ddln_pk_nl);
+
+    if ((pfo->method == nl_HMcode) && (pfo->hmcode_fast_feedback == _TRUE_)) {
+      class_call(fourier_hmcode_tables_free(pfo),
+                 pfo->error_message,
+                 pfo->error_message);
+    }
   }
 
   if (pfo->has_pk_eq == _TRUE_) {
@@ -1782,6 +1926,12 @@ int fourier_indices(
              pfo->error_message,
              pfo->error_message);
 
+  /** - get quantities needed by the analytic tail of P(k), if any */
+
+  class_call(fourier_tail_init(pba,ppt,pfo),
+             pfo->error_message,
+             pfo->error_message);
+
   /** - given previous indices, we can allocate the array of linear power spectrum values */
 
   class_alloc(pfo->ln_pk_ic_l,pfo->pk_size*sizeof(double*),pfo->error_message);
@@ -1842,8 +1992,10 @@ int fourier_indices(
 
 /**
  * Copy list of k from perturbation module, and extended it if
- * necessary to larger k for extrapolation (currently this
- * extrapolation is required only by HMcode)
+ * necessary to larger k for extrapolation (required by HMcode, and
+ * when the perturbations were only integrated up to
+ * ppt->k_max_for_pk_solved, in which case P(k,z) is extended by an
+ * analytic tail up to ppt->k_max_pk_tail)
  *
  * @param ppr Input: pointer to precision structure
  * @param ppt Input: pointer to perturbation structure
@@ -1861,13 +2013,42 @@ int fourier_get_k_list(
   double k_max,exponent;
   int index_k;
 
-  pfo->k_size = ppt->k_size[pfo->index_md_scalars];
+  pfo->k_size_solved = ppt->k_size[pfo->index_md_scalars];
+  pfo->k_size = pfo->k_size_solved;
   pfo->k_size_pk = ppt->k_size_pk;
-  k_max = ppt->k[pfo->index_md_scalars][pfo->k_size-1];
+  pfo->tail_fit_size = 0;
+  k_max = ppt->k[pfo->index_md_scalars][pfo->k_size_solved-1];
+
+  /** - if the perturbations stopped before the k needed for P(k),
+      compute the number of values in the analytic tail, which then
+      become part of the stored P(k,z) */
+  if (ppt->k_max_pk_tail > k_max) {
+    index_k=0;
+    k = k_max;
+    while(k < ppt->k_max_pk_tail && index_k < _MAX_NUM_EXTRAPOLATION_){
+      index_k++;
+      k = k_max * pow(10,(double)index_k/ppr->k_per_decade_for_pk);
+    }
+    class_test(index_k == _MAX_NUM_EXTRAPOLATION_,
+               pfo->error_message,
+               "could not reach extrapolated value k = %.10e starting from k = %.10e with k_per_decade of %.10e in _MAX_NUM_INTERPOLATION_=%i steps",
+               ppt->k_max_pk_tail,k_max,ppr->k_per_decade_for_pk,_MAX_NUM_EXTRAPOLATION_
+               );
+    pfo->k_size = pfo->k_size_solved+index_k;
+    pfo->k_size_pk = pfo->k_size;
+
+    /* number of integrated values over which the slope of the tail is fitted */
+    pfo->tail_fit_size = 1;
+    while ((pfo->tail_fit_size < pfo->k_size_solved) &&
+           (ppt->k[pfo->index_md_scalars][pfo->k_size_solved-1-pfo->tail_fit_size] >= k_max*pow(10.,-ppr->pk_tail_fit_decades)))
+      pfo->tail_fit_size++;
+    pfo->tail_fit_size = MIN(MAX(pfo->tail_fit_size,2),pfo->k_size_solved);
+  }
 
   /** - if k extrapolation necessary, compute number of required extra values */
   if (pfo->method == nl_HMcode){
     index_k=0;
+    k=0;
     while(k < ppr->hmcode_max_k_extra && index_k < _MAX_NUM_EXTRAPOLATION_){
       index_k++;
       k = k_max * pow(10,(double)index_k/ppr->k_per_decade_for_pk);
@@ -1877,7 +2058,7 @@ int fourier_get_k_list(
                "could not reach extrapolated value k = %.10e starting from k = %.10e with k_per_decade of %.10e in _MAX_NUM_INTERPOLATION_=%i steps",
                ppr->hmcode_max_k_extra,k_max,ppr->k_per_decade_for_pk,_MAX_NUM_EXTRAPOLATION_
                );
-    pfo->k_size_extra = pfo->k_size+index_k;
+    pfo->k_size_extra = MAX(pfo->k_size_solved+index_k,pfo->k_size);
   }
   /** - otherwise, same number of values as in perturbation module */
   else {
@@ -1889,15 +2070,15 @@ int fourier_get_k_list(
   class_alloc(pfo->ln_k,pfo->k_size_extra*sizeof(double),pfo->error_message);
 
   /** - fill array of k (not extrapolated) */
-  for (index_k=0; index_k<pfo->k_size; index_k++) {
+  for (index_k=0; index_k<pfo->k_size_solved; index_k++) {
     k = ppt->k[pfo->index_md_scalars][index_k];
     pfo->k[index_k] = k;
     pfo->ln_k[index_k] = log(k);
   }
 
   /** - fill additional values of k (extrapolated) */
-  for (index_k=pfo->k_size; index_k<pfo->k_size_extra; index_k++) {
-    exponent = (double)(index_k-(pfo->k_size-1))/ppr->k_per_decade_for_pk;
+  for (index_k=pfo->k_size_solved; index_k<pfo->k_size_extra; index_k++) {
+    exponent = (double)(index_k-(pfo->k_size_solved-1))/ppr->k_per_decade_for_pk;
     pfo->k[index_k] = k * pow(10,exponent);
     pfo->ln_k[index_k] = log(k) + exponent*log(10.);
   }
@@ -1947,6 +2128,69 @@ int fourier_get_tau_list(
   return _SUCCESS_;
 }
 
+/**
+ * Compute the quantities needed by the analytic tail of P(k) that
+ * depend only on time: with massive neutrinos, the asymptotic ratio
+ * delta_m/delta_cb = rho_cb/rho_m at each time of the source table
+ *
+ * @param pba Input: pointer to background structure
+ * @param ppt Input: pointer to perturbation structure
+ * @param pfo Input/Output: pointer to fourier structure
+ * @return the error status
+ */
+
+int fourier_tail_init(
+                      struct background * pba,
+                      struct perturbations * ppt,
+                      struct fourier * pfo
+                      ) {
+
+  int index_tau;
+  int n_ncdm;
+  int last_index=0;
+  double * pvecback;
+  double rho_cb,rho_m;
+
+  pfo->tail_cb_fraction = NULL;
+
+  if ((pfo->tail_fit_size == 0) || (pfo->has_pk_cb == _FALSE_))
+    return _SUCCESS_;
+
+  class_alloc(pfo->tail_cb_fraction,ppt->tau_size*sizeof(double),pfo->error_message);
+  class_alloc(pvecback,pba->bg_size*sizeof(double),pfo->error_message);
+
+  for (index_tau=0; index_tau<ppt->tau_size; index_tau++) {
+
+    class_call(background_at_tau(pba,
+                                 ppt->tau_sampling[index_tau],
+                                 normal_info,
+                                 inter_closeby,
+                                 &last_index,
+                                 pvecback),
+               pba->error_message,
+               pfo->error_message);
+
+    /* same species as in the definition of delta_cb and delta_m in the perturbation module */
+    rho_cb = pvecback[pba->index_bg_rho_b];
+    if (pba->has_cdm == _TRUE_)
+      rho_cb += pvecback[pba->index_bg_rho_cdm];
+    if (pba->has_idm == _TRUE_)
+      rho_cb += pvecback[pba->index_bg_rho_idm];
+    if (pba->has_dcdm == _TRUE_)
+      rho_cb += pvecback[pba->index_bg_rho_dcdm];
+
+    rho_m = rho_cb;
+    for (n_ncdm=0; n_ncdm < pba->N_ncdm; n_ncdm++)
+      rho_m += pvecback[pba->index_bg_rho_ncdm1+n_ncdm];
+
+    pfo->tail_cb_fraction[index_tau] = rho_cb/rho_m;
+  }
+
+  free(pvecback);
+
+  return _SUCCESS_;
+}
+
 /**
  * Get sources for a given wavenumber (and for a given time, type, ic,
  * mode...) either directly from precomputed valkues (computed ain
@@ -1981,8 +2225,14 @@ int fourier_get_source(
   double scaled_factor,log_scaled_factor;
 
   /** - use precomputed values */
-  if (index_k < pfo->k_size) {
-    *source = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][index_tau * pfo->k_size + index_k];
+  if (index_k < pfo->k_size_solved) {
+    *source = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][index_tau * pfo->k_size_solved + index_k];
+  }
+  /** - with an analytic tail, all larger wavenumbers use the calibrated tail **/
+  else if (pfo->tail_fit_size > 0) {
+    class_call(fourier_get_source_tail(ppt,pfo,index_k,index_ic,index_tp,index_tau,sources,source),
+               pfo->error_message,
+               pfo->error_message);
   }
   /** - extrapolate **/
   else {
@@ -1992,14 +2242,14 @@ int fourier_get_source(
     /**
      * --> Get last source and k, which are used in (almost) all methods
      */
-    k_max = pfo->k[pfo->k_size-1];
-    source_max = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][index_tau * pfo->k_size + pfo->k_size - 1];
+    k_max = pfo->k[pfo->k_size_solved-1];
+    source_max = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][index_tau * pfo->k_size_solved + pfo->k_size_solved - 1];
 
     /**
      * --> Get previous source and k, which are used in best methods
      */
-    k_previous = pfo->k[pfo->k_size-2];
-    source_previous = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][index_tau * pfo->k_size + pfo->k_size - 2];
+    k_previous = pfo->k[pfo->k_size_solved-2];
+    source_previous = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][index_tau * pfo->k_size_solved + pfo->k_size_solved - 2];
 
     switch(pfo->extrapolation_method){
       /**
@@ -2066,6 +2316,88 @@ int fourier_get_source(
   return _SUCCESS_;
 }
 
+/**
+ * Get sources beyond the last integrated wavenumber from the
+ * calibrated analytic tail used when the perturbations were only
+ * integrated up to ppt->k_max_for_pk_solved.
+ *
+ * At large k, the density sources of baryons and CDM grow like
+ * ln(k) (the usual k^2 T(k) behaviour). The tail of delta_cb (or of
+ * delta_m without massive neutrinos) is thus S(k) = S(k_max) + s
+ * ln(k/k_max), matched in amplitude at the last integrated value
+ * k_max, with a slope s fitted by least squares over the last
+ * pfo->tail_fit_size integrated values (spanning pk_tail_fit_decades
+ * decades in k). With massive neutrinos, the free-streaming of
+ * neutrinos makes delta_m/delta_cb decay towards its asymptotic value
+ * rho_cb/rho_m like (k_fs/k)^2: the tail of delta_m is the tail of
+ * delta_cb multiplied by this ratio, matched at k_max.
+ *
+ * @param ppt             Input: pointer to perturbation structure
+ * @param pfo             Input: pointer to fourier structure
+ * @param index_k         Input: index of required k value (beyond pfo->k_size_solved)
+ * @param index_ic        Input: index of required ic value
+ * @param index_tp        Input: index of required tp value
+ * @param index_tau       Input: index of required tau value
+ * @param sources         Input: array containing the original sources
+ * @param source          Output: desired value of source
+ * @return the error status
+ */
+
+int fourier_get_source_tail(
+                            struct perturbations * ppt,
+                            struct fourier * pfo,
+                            int index_k,
+                            int index_ic,
+                            int index_tp,
+                            int index_tau,
+                            double ** sources,
+                            double * source
+                            ) {
+
+  int index_tp_fit;
+  int index_k_fit;
+  int k_size = pfo->k_size_solved;
+  double * source_fit;
+  double ln_k_mean=0.,source_mean=0.,covariance=0.,variance=0.;
+  double slope,source_fit_max,ratio_max,ratio_inf;
+  double dln_k = pfo->ln_k[index_k]-pfo->ln_k[k_size-1];
+
+  /** - with massive neutrinos, the tail of delta_m is built on that of delta_cb */
+  if ((pfo->tail_cb_fraction != NULL) && (index_tp == ppt->index_tp_delta_m))
+    index_tp_fit = ppt->index_tp_delta_cb;
+  else
+    index_tp_fit = index_tp;
+
+  source_fit = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp_fit] + index_tau * k_size;
+
+  /** - least-square slope of the source with respect to ln(k) over the fitting range */
+  for (index_k_fit=k_size-pfo->tail_fit_size; index_k_fit<k_size; index_k_fit++) {
+    ln_k_mean += pfo->ln_k[index_k_fit];
+    source_mean += source_fit[index_k_fit];
+  }
+  ln_k_mean /= pfo->tail_fit_size;
+  source_mean /= pfo->tail_fit_size;
+
+  for (index_k_fit=k_size-pfo->tail_fit_size; index_k_fit<k_size; index_k_fit++) {
+    covariance += (pfo->ln_k[index_k_fit]-ln_k_mean)*(source_fit[index_k_fit]-source_mean);
+    variance += (pfo->ln_k[index_k_fit]-ln_k_mean)*(pfo->ln_k[index_k_fit]-ln_k_mean);
+  }
+  slope = covariance/variance;
+
+  /** - tail matched in amplitude at the last integrated value */
+  source_fit_max = source_fit[k_size-1];
+  *source = source_fit_max + slope*dln_k;
+
+  /** - neutrino suppression of delta_m: ratio to delta_cb relaxing to rho_cb/rho_m */
+  if (index_tp_fit != index_tp) {
+    ratio_max = sources[index_ic * ppt->tp_size[pfo->index_md_scalars] + index_tp][index_tau * k_size + k_size-1]/source_fit_max;
+    ratio_inf = pfo->tail_cb_fraction[index_tau];
+    *source *= ratio_inf + (ratio_max-ratio_inf)*exp(-2.*dln_k);
+  }
+
+  return _SUCCESS_;
+}
+
 /**
  * This routine computes all the components of the matter power
  * spectrum P(k), given the source functions and the primordial
@@ -3115,22 +3447,19 @@ int fourier_hmcode(
                    ) {
 
   /* integers */
-  int index_mass, i, ng, nsig;
-  int index_k, index_ncol;
+  int index_mass, ng, nsig;
+  int index_k;
   int last_index=0;
   int index_pk_cb;
   int counter, index_nl;
 
-  int index_nu, index_cut;
-  int index_y;
-  int index_ddy;
+  int index_cut;
 
   /* Background parameters */
   double Omega_m,fnu,Omega0_m;
   double z_at_tau;
   double rho_crit_today_in_msun_mpc3;
   double growth;
-  double anorm;
 
   /* temporary numbers */
   double m, r, nu, sig, sigf;
@@ -3152,10 +3481,8 @@ int fourier_hmcode(
   double z_form, g_form;
 
   double eta;
-  double gst, window_nfw;
   double nu_cut;
-  double fac, k_star, fdamp;
-  double pk_lin, pk_2h, pk_1h;
+  double k_star, fdamp;
 
   /* data fields */
   double * pvecback;
@@ -3167,8 +3494,6 @@ int fourier_hmcode(
   double * r_real;
   double * nu_arr;
 
-  double * p1h_integrand;
-
 
   /** include precision parameters that control the number of entries in the growth and sigma tables */
   ng = ppr->n_hmcode_tables;
@@ -3185,8 +3510,6 @@ int fourier_hmcode(
     Omega0_m = Omega0_m - pba->Omega0_ncdm_tot;
   }
 
-  anorm    = 1./(2*pow(_PI_,2));
-
   /** Call all the relevant background parameters at this tau */
   class_alloc(pvecback,pba->bg_size*sizeof(double),pfo->error_message);
 
@@ -3446,6 +3769,14 @@ int fourier_hmcode(
     } else {
       conc[index_mass] = pfo->c_min*(1.+z_form)/(1.+z_at_tau)*pnw->dark_energy_correction;
     }
+
+    if (pfo->hmcode_fast_feedback == _TRUE_) {
+      if (z_form < z_at_tau){
+        pfo->hm_conc1[index_pk][index_tau*pfo->hm_mass_size+index_mass] = 1.;
+      } else {
+        pfo->hm_conc1[index_pk][index_tau*pfo->hm_mass_size+index_mass] = (1.+z_form)/(1.+z_at_tau)*pnw->dark_energy_correction;
+      }
+    }
   }
 
 
@@ -3467,6 +3798,130 @@ int fourier_hmcode(
     index_cut = ppr->nsteps_for_p1h_integral;
   }
 
+  class_call(fourier_hmcode_pk_nl(pfo,
+                                  lnpk_l[index_pk],
+                                  mass,
+                                  nu_arr,
+                                  r_virial,
+                                  conc,
+                                  index_cut,
+                                  eta,
+                                  k_star,
+                                  sigma_disp,
+                                  fdamp,
+                                  alpha,
+                                  rho_crit_today_in_msun_mpc3*Omega0_m,
+                                  pk_nl),
+             pfo->error_message,
+             pfo->error_message);
+
+  /** Store the quantities needed by fourier_hmcode_update_feedback() */
+  if (pfo->hmcode_fast_feedback == _TRUE_) {
+    pfo->hm_computable[index_pk][index_tau] = _TRUE_;
+    pfo->hm_index_cut[index_pk][index_tau] = index_cut;
+    pfo->hm_sigma8[index_pk][index_tau] = sigma8;
+    pfo->hm_sigma_disp[index_pk][index_tau] = sigma_disp;
+    pfo->hm_fdamp[index_pk][index_tau] = fdamp;
+    pfo->hm_alpha[index_pk][index_tau] = alpha;
+    pfo->hm_rho_m[index_pk] = rho_crit_today_in_msun_mpc3*Omega0_m;
+    for (index_mass=0; index_mass<pfo->hm_mass_size; index_mass++) {
+      pfo->hm_nu[index_pk][index_tau*pfo->hm_mass_size+index_mass] = nu_arr[index_mass];
+      pfo->hm_r_virial[index_pk][index_tau*pfo->hm_mass_size+index_mass] = r_virial[index_mass];
+    }
+    for (index_k=0; index_k<pfo->k_size; index_k++) {
+      pfo->hm_ln_pk_l[index_pk][index_tau*pfo->k_size+index_k] = lnpk_l[index_pk][index_k];
+    }
+  }
+
+  // print parameter values
+  if ((pfo->fourier_verbose > 1 && tau==pba->conformal_age) || pfo->fourier_verbose > 3){
+    fprintf(stdout, " -> Parameters at redshift z = %e:\n", z_at_tau);
+    fprintf(stdout, "    fnu:		%e\n", fnu);
+    fprintf(stdout, "    sigd [Mpc/h]:	%e\n", sigma_disp*pba->h);
+    fprintf(stdout, "    sigd100 [Mpc/h]:    %e\n", sigma_disp100*pba->h);
+    fprintf(stdout, "    sigma8:		%e\n", sigma8);
+    fprintf(stdout, "    nu min:		%e\n", nu_arr[0]);
+    fprintf(stdout, "    nu max:		%e\n", nu_arr[ppr->nsteps_for_p1h_integral-1]);
+    fprintf(stdout, "    r_v min [Mpc/h]:    %e\n", r_virial[0]*pba->h);
+    fprintf(stdout, "    r_v max [Mpc/h]:    %e\n", r_virial[ppr->nsteps_for_p1h_integral-1]*pba->h);
+    fprintf(stdout, "    r_nl [Mpc/h]:	%e\n", r_nl*pba->h);
+    fprintf(stdout, "    k_nl [h/Mpc]:	%e\n", *k_nl/pba->h);
+    fprintf(stdout, "    sigma_nl:		%e\n", sigma_nl/delta_c);
+    fprintf(stdout, "    neff:		%e\n", n_eff);
+    fprintf(stdout, "    c min:		%e\n", conc[ppr->nsteps_for_p1h_integral-1]);
+    fprintf(stdout, "    c max:		%e\n", conc[0]);
+    fprintf(stdout, "    Dv:			%e\n", Delta_v);
+    fprintf(stdout, "    dc:			%e\n", delta_c);
+    fprintf(stdout, "    eta:		%e\n", eta);
+    fprintf(stdout, "    k*:			%e\n", k_star/pba->h);
+    fprintf(stdout, "    Abary:		%e\n", pfo->c_min);
+    fprintf(stdout, "    fdamp:		%e\n", fdamp);
+    fprintf(stdout, "    alpha:		%e\n", alpha);
+    fprintf(stdout, "    ksize, kmin, kmax:   %d, %e, %e\n", pfo->k_size, pfo->k[0]/pba->h, pfo->k[pfo->k_size-1]/pba->h);
+
+  }
+
+  free(conc);
+  free(mass);
+  free(r_real);
+  free(r_virial);
+  free(sigma_r);
+  free(sigmaf_r);
+  free(nu_arr);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Computes the HMcode nonlinear power spectrum at one time, given the
+ * tables of halo properties in the 1-halo integral and the parameters
+ * of the 2-halo term. This is the only step of fourier_hmcode() that
+ * depends on the baryonic feedback parameters, through conc (proportional
+ * to c_min) and eta (containing eta_0).
+ *
+ * @param pfo         Input: pointer to fourier structure
+ * @param lnpk_l      Input: logarithm of the linear power spectrum
+ * @param mass        Input: table of halo masses
+ * @param nu_arr      Input: table of nu=delta_c/sigma(M)
+ * @param r_virial    Input: table of virial radii
+ * @param conc        Input: table of halo concentrations
+ * @param index_cut   Input: number of masses kept in the 1-halo integral
+ * @param eta         Input: halo bloating parameter
+ * @param k_star      Input: damping wavenumber of the 1-halo term
+ * @param sigma_disp  Input: displacement variance
+ * @param fdamp       Input: damping factor of the 2-halo term
+ * @param alpha       Input: smoothing parameter of the 1-halo to 2-halo transition
+ * @param rho_m_today Input: matter density today in M_sun/Mpc^3
+ * @param pk_nl       Output: nonlinear power spectrum
+ * @return the error status
+ */
+
+int fourier_hmcode_pk_nl(
+                         struct fourier *pfo,
+                         double *lnpk_l,
+                         double *mass,
+                         double *nu_arr,
+                         double *r_virial,
+                         double *conc,
+                         int index_cut,
+                         double eta,
+                         double k_star,
+                         double sigma_disp,
+                         double fdamp,
+                         double alpha,
+                         double rho_m_today,
+                         double *pk_nl
+                         ) {
+
+  int index_mass, index_k, i;
+  int index_nu, index_y, index_ddy, index_ncol;
+  double anorm;
+  double gst, window_nfw;
+  double fac, pk_lin, pk_2h, pk_1h;
+  double * p1h_integrand;
+
+  anorm    = 1./(2*pow(_PI_,2));
+
   i=0;
   index_nu=i;
   i++;
@@ -3480,7 +3935,7 @@ int fourier_hmcode(
 
     class_alloc(p1h_integrand,index_cut*index_ncol*sizeof(double),pfo->error_message);
 
-    pk_lin = exp(lnpk_l[index_pk][index_k])*pow(pfo->k[index_k],3)*anorm; //convert P_k to Delta_k^2
+    pk_lin = exp(lnpk_l[index_k])*pow(pfo->k[index_k],3)*anorm; //convert P_k to Delta_k^2
 
     for (index_mass=0; index_mass<index_cut; index_mass++){ //Calculates the integrand for the ph1 integral at all nu values
       //get the nu^eta-value of the window
@@ -3536,7 +3991,7 @@ int fourier_hmcode(
       fac=exp(-pow((pfo->k[index_k]/k_star), 2.));
     }
 
-    pk_1h = pk_1h*anorm*pow(pfo->k[index_k],3)*(1.-fac)/(rho_crit_today_in_msun_mpc3*Omega0_m);  // dimensionless power
+    pk_1h = pk_1h*anorm*pow(pfo->k[index_k],3)*(1.-fac)/rho_m_today;  // dimensionless power
 
     if (fdamp==0){
       pk_2h=pk_lin;
@@ -3549,41 +4004,105 @@ int fourier_hmcode(
     free(p1h_integrand);
   }
 
-  // print parameter values
-  if ((pfo->fourier_verbose > 1 && tau==pba->conformal_age) || pfo->fourier_verbose > 3){
-    fprintf(stdout, " -> Parameters at redshift z = %e:\n", z_at_tau);
-    fprintf(stdout, "    fnu:		%e\n", fnu);
-    fprintf(stdout, "    sigd [Mpc/h]:	%e\n", sigma_disp*pba->h);
-    fprintf(stdout, "    sigd100 [Mpc/h]:    %e\n", sigma_disp100*pba->h);
-    fprintf(stdout, "    sigma8:		%e\n", sigma8);
-    fprintf(stdout, "    nu min:		%e\n", nu_arr[0]);
-    fprintf(stdout, "    nu max:		%e\n", nu_arr[ppr->nsteps_for_p1h_integral-1]);
-    fprintf(stdout, "    r_v min [Mpc/h]:    %e\n", r_virial[0]*pba->h);
-    fprintf(stdout, "    r_v max [Mpc/h]:    %e\n", r_virial[ppr->nsteps_for_p1h_integral-1]*pba->h);
-    fprintf(stdout, "    r_nl [Mpc/h]:	%e\n", r_nl*pba->h);
-    fprintf(stdout, "    k_nl [h/Mpc]:	%e\n", *k_nl/pba->h);
-    fprintf(stdout, "    sigma_nl:		%e\n", sigma_nl/delta_c);
-    fprintf(stdout, "    neff:		%e\n", n_eff);
-    fprintf(stdout, "    c min:		%e\n", conc[ppr->nsteps_for_p1h_integral-1]);
-    fprintf(stdout, "    c max:		%e\n", conc[0]);
-    fprintf(stdout, "    Dv:			%e\n", Delta_v);
-    fprintf(stdout, "    dc:			%e\n", delta_c);
-    fprintf(stdout, "    eta:		%e\n", eta);
-    fprintf(stdout, "    k*:			%e\n", k_star/pba->h);
-    fprintf(stdout, "    Abary:		%e\n", pfo->c_min);
-    fprintf(stdout, "    fdamp:		%e\n", fdamp);
-    fprintf(stdout, "    alpha:		%e\n", alpha);
-    fprintf(stdout, "    ksize, kmin, kmax:   %d, %e, %e\n", pfo->k_size, pfo->k[0]/pba->h, pfo->k[pfo->k_size-1]/pba->h);
+  return _SUCCESS_;
+}
 
+/**
+ * Allocate the tables in which fourier_hmcode() stores the quantities
+ * needed by fourier_hmcode_update_feedback(), and fill the mass table
+ *
+ * @param ppr         Input: pointer to precision structure
+ * @param pba         Input: pointer to background structure
+ * @param pfo         Input/Output: pointer to fourier structure
+ * @return the error status
+ */
+
+int fourier_hmcode_tables_init(
+                               struct precision *ppr,
+                               struct background *pba,
+                               struct fourier *pfo
+                               ) {
+
+  int index_pk, index_mass;
+  double mmin, mmax;
+
+  pfo->hm_mass_size = ppr->nsteps_for_p1h_integral;
+
+  /* same mass sampling as in fourier_hmcode() */
+  mmin=ppr->mmin_for_p1h_integral/pba->h;
+  mmax=ppr->mmax_for_p1h_integral/pba->h;
+
+  class_alloc(pfo->hm_mass,pfo->hm_mass_size*sizeof(double),pfo->error_message);
+  for (index_mass=0; index_mass<pfo->hm_mass_size; index_mass++) {
+    pfo->hm_mass[index_mass] = exp(log(mmin)+log(mmax/mmin)*(index_mass)/(pfo->hm_mass_size-1));
   }
 
-  free(conc);
-  free(mass);
-  free(r_real);
-  free(r_virial);
-  free(sigma_r);
-  free(sigmaf_r);
-  free(nu_arr);
+  class_alloc(pfo->hm_computable,pfo->pk_size*sizeof(short*),pfo->error_message);
+  class_alloc(pfo->hm_index_cut,pfo->pk_size*sizeof(int*),pfo->error_message);
+  class_alloc(pfo->hm_sigma8,pfo->pk_size*sizeof(double*),pfo->error_message);
+  class_alloc(pfo->hm_sigma_disp,pfo->pk_size*sizeof(double*),pfo->error_message);
+  class_alloc(pfo->hm_fdamp,pfo->pk_size*sizeof(double*),pfo->error_message);
+  class_alloc(pfo->hm_alpha,pfo->pk_size*sizeof(double*),pfo->error_message);
+  class_alloc(pfo->hm_rho_m,pfo->pk_size*sizeof(double),pfo->error_message);
+  class_alloc(pfo->hm_nu,pfo->pk_size*sizeof(double*),pfo->error_message);
+  class_alloc(pfo->hm_r_virial,pfo->pk_size*sizeof(double*),pfo->error_message);
+  class_alloc(pfo->hm_conc1,pfo->pk_size*sizeof(double*),pfo->error_message);
+  class_alloc(pfo->hm_ln_pk_l,pfo->pk_size*sizeof(double*),pfo->error_message);
+
+  for (index_pk=0; index_pk<pfo->pk_size; index_pk++) {
+    class_calloc(pfo->hm_computable[index_pk],pfo->tau_size,sizeof(short),pfo->error_message);
+    class_alloc(pfo->hm_index_cut[index_pk],pfo->tau_size*sizeof(int),pfo->error_message);
+    class_alloc(pfo->hm_sigma8[index_pk],pfo->tau_size*sizeof(double),pfo->error_message);
+    class_alloc(pfo->hm_sigma_disp[index_pk],pfo->tau_size*sizeof(double),pfo->error_message);
+    class_alloc(pfo->hm_fdamp[index_pk],pfo->tau_size*sizeof(double),pfo->error_message);
+    class_alloc(pfo->hm_alpha[index_pk],pfo->tau_size*sizeof(double),pfo->error_message);
+    class_alloc(pfo->hm_nu[index_pk],pfo->tau_size*pfo->hm_mass_size*sizeof(double),pfo->error_message);
+    class_alloc(pfo->hm_r_virial[index_pk],pfo->tau_size*pfo->hm_mass_size*sizeof(double),pfo->error_message);
+    class_alloc(pfo->hm_conc1[index_pk],pfo->tau_size*pfo->hm_mass_size*sizeof(double),pfo->error_message);
+    class_alloc(pfo->hm_ln_pk_l[index_pk],pfo->tau_size*pfo->k_size*sizeof(double),pfo->error_message);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Free the tables allocated by fourier_hmcode_tables_init()
+ *
+ * @param pfo         Input: pointer to fourier structure
+ * @return the error status
+ */
+
+int fourier_hmcode_tables_free(
+                               struct fourier *pfo
+                               ) {
+
+  int index_pk;
+
+  for (index_pk=0; index_pk<pfo->pk_size; index_pk++) {
+    free(pfo->hm_computable[index_pk]);
+    free(pfo->hm_index_cut[index_pk]);
+    free(pfo->hm_sigma8[index_pk]);
+    free(pfo->hm_sigma_disp[index_pk]);
+    free(pfo->hm_fdamp[index_pk]);
+    free(pfo->hm_alpha[index_pk]);
+    free(pfo->hm_nu[index_pk]);
+    free(pfo->hm_r_virial[index_pk]);
+    free(pfo->hm_conc1[index_pk]);
+    free(pfo->hm_ln_pk_l[index_pk]);
+  }
+
+  free(pfo->hm_mass);
+  free(pfo->hm_computable);
+  free(pfo->hm_index_cut);
+  free(pfo->hm_sigma8);
+  free(pfo->hm_sigma_disp);
+  free(pfo->hm_fdamp);
+  free(pfo->hm_alpha);
+  free(pfo->hm_rho_m);
+  free(pfo->hm_nu);
+  free(pfo->hm_r_virial);
+  free(pfo->hm_conc1);
+  free(pfo->hm_ln_pk_l);
 
   return _SUCCESS_;
 }
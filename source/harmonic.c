@@ -9,6 +9,7 @@
  *
  * -# harmonic_init() at the beginning (but after transfer_init())
  * -# harmonic_cl_at_l() at any time for computing individual \f$ C_l \f$'s at any l
+ * -# harmonic_cl_covariance() at any time for computing their Gaussian covariance
  * -# harmonic_free() at the end
  */
 
@@ -245,6 +246,429 @@ int harmonic_cl_at_l(
 
 }
 
+/**
+ * Rebuild the number count spectra (dd, Td, pd, dl) for new values of
+ * the light-to-mass bias and magnification bias of each bin, as a
+ * linear combination of the component spectra stored when the input
+ * flag 'number_count_components' is set. No transfer function or q
+ * integral is recomputed. The tables used by harmonic_cl_at_l() are
+ * updated in place (but not those of the lensing module, which must
+ * be re-run if lensed number count spectra are needed).
+ *
+ * @param phr                          Input/Output: pointer to harmonic structure
+ * @param selection_bias               Input: light-to-mass bias of each bin (d_size values)
+ * @param selection_magnification_bias Input: magnification bias of each bin (d_size values)
+ * @return the error status
+ */
+
+int harmonic_cl_number_count_recombine(
+                                       struct harmonic * phr,
+                                       double * selection_bias,
+                                       double * selection_magnification_bias
+                                       ) {
+
+  int index_md;
+  int index_l;
+  int index_ic1_ic2;
+  int index_d1,index_d2;
+  int index_ncc,index_ncc1,index_ncc2;
+  int index_ct;
+  double * coef_ncc; /* coefficients of the components, coef_ncc[index_d1*phr->ncc_size+index_ncc] */
+  double * cl;
+  double * cl_nc;
+  double clvalue;
+
+  class_test(phr->has_nc_components == _FALSE_,
+             phr->error_message,
+             "number count components were not stored: set 'number_count_components' to yes");
+
+  index_md = phr->index_md_scalars;
+
+  class_alloc(coef_ncc,phr->d_size*phr->ncc_size*sizeof(double),phr->error_message);
+
+  for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+    if (phr->has_ncc_density == _TRUE_)
+      coef_ncc[index_d1*phr->ncc_size+phr->index_ncc_density] = selection_bias[index_d1];
+    if (phr->has_ncc_unbiased == _TRUE_) {
+      coef_ncc[index_d1*phr->ncc_size+phr->index_ncc_unbiased] = 1.;
+      coef_ncc[index_d1*phr->ncc_size+phr->index_ncc_magnification] = selection_magnification_bias[index_d1];
+    }
+  }
+
+  for (index_l=0; index_l<phr->l_size[index_md]; index_l++) {
+    for (index_ic1_ic2=0; index_ic1_ic2<phr->ic_ic_size[index_md]; index_ic1_ic2++) {
+
+      cl = phr->cl[index_md] + (index_l * phr->ic_ic_size[index_md] + index_ic1_ic2) * phr->ct_size;
+      cl_nc = phr->cl_nc + (index_l * phr->ic_ic_size[index_md] + index_ic1_ic2) * phr->ncct_size;
+
+      if (phr->has_dd == _TRUE_) {
+        index_ct=0;
+        for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+          for (index_d2=index_d1; index_d2<=MIN(index_d1+phr->non_diag,phr->d_size-1); index_d2++) {
+            clvalue = 0.;
+            for (index_ncc1=0; index_ncc1<phr->ncc_size; index_ncc1++)
+              for (index_ncc2=0; index_ncc2<phr->ncc_size; index_ncc2++)
+                clvalue += coef_ncc[index_d1*phr->ncc_size+index_ncc1]
+                  * coef_ncc[index_d2*phr->ncc_size+index_ncc2]
+                  * cl_nc[phr->index_ncct_dd+(index_ct*phr->ncc_size+index_ncc1)*phr->ncc_size+index_ncc2];
+            cl[phr->index_ct_dd+index_ct] = clvalue;
+            index_ct++;
+          }
+        }
+      }
+
+      if (phr->has_td == _TRUE_) {
+        for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+          clvalue = 0.;
+          for (index_ncc=0; index_ncc<phr->ncc_size; index_ncc++)
+            clvalue += coef_ncc[index_d1*phr->ncc_size+index_ncc]
+              * cl_nc[phr->index_ncct_td+index_d1*phr->ncc_size+index_ncc];
+          cl[phr->index_ct_td+index_d1] = clvalue;
+        }
+      }
+
+      if (phr->has_pd == _TRUE_) {
+        for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+          clvalue = 0.;
+          for (index_ncc=0; index_ncc<phr->ncc_size; index_ncc++)
+            clvalue += coef_ncc[index_d1*phr->ncc_size+index_ncc]
+              * cl_nc[phr->index_ncct_pd+index_d1*phr->ncc_size+index_ncc];
+          cl[phr->index_ct_pd+index_d1] = clvalue;
+        }
+      }
+
+      if (phr->has_dl == _TRUE_) {
+        index_ct=0;
+        for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+          for (index_d2=MAX(index_d1-phr->non_diag,0); index_d2<=MIN(index_d1+phr->non_diag,phr->d_size-1); index_d2++) {
+            clvalue = 0.;
+            for (index_ncc=0; index_ncc<phr->ncc_size; index_ncc++)
+              clvalue += coef_ncc[index_d1*phr->ncc_size+index_ncc]
+                * cl_nc[phr->index_ncct_dl+index_ct*phr->ncc_size+index_ncc];
+            cl[phr->index_ct_dl+index_ct] = clvalue;
+            index_ct++;
+          }
+        }
+      }
+    }
+  }
+
+  free(coef_ncc);
+
+  /** - update second derivatives for spline interpolation */
+
+  class_call(array_spline_table_lines(phr->l,
+                                      phr->l_size[index_md],
+                                      phr->cl[index_md],
+                                      phr->ic_ic_size[index_md]*phr->ct_size,
+                                      phr->ddcl[index_md],
+                                      _SPLINE_EST_DERIV_,
+                                      phr->error_message),
+             phr->error_message,
+             phr->error_message);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Gaussian (Knox) covariance of all the \f$ C_l \f$ types (TT, TE,
+ * ..., dd, ll, ...) on a partial sky, optionally binned in l, with
+ * optional noise on the auto-spectra (e.g. instrumental noise for the
+ * CMB, shot noise 1/n for each number count bin).
+ *
+ * The covariance is block-diagonal in l: for each band of multipoles b
+ * (with \f$ C_b = \sum_{l \in b} (2l+1) C_l / \sum_{l \in b} (2l+1) \f$),
+ * \f$ Cov[C_b^{ab}, C_b^{cd}] = \sum_{l \in b} (2l+1) [\tilde{C}_l^{ac}
+ * \tilde{C}_l^{bd} + \tilde{C}_l^{ad} \tilde{C}_l^{bc}] / (f_{sky}
+ * [\sum_{l \in b}(2l+1)]^2) \f$, where \f$ \tilde{C}_l \f$ includes the
+ * noise. Only these diagonal blocks are returned. The total (unlensed)
+ * spectra of harmonic_cl_at_l() are used, and the cross-spectra that
+ * CLASS does not compute (TB, EB, Ed, dd beyond non_diag, ...) are
+ * assumed to vanish. The bands are computed in parallel.
+ *
+ * @param phr        Input: pointer to harmonic structure
+ * @param l_min      Input: first multipole
+ * @param l_max      Input: last multipole
+ * @param delta_l    Input: width of the bands (1 for no binning); the last band stops at l_max
+ * @param fsky       Input: observed fraction of the sky
+ * @param noise      Input: noise[(l-l_min)*phr->ct_size+index_ct] for l_min <= l <= l_max, only read for auto-spectra, or NULL for no noise
+ * @param covariance Output: covariance[(index_lb*phr->ct_size+index_ct1)*phr->ct_size+index_ct2], for the (l_max-l_min)/delta_l+1 bands (must be already allocated)
+ * @return the error status
+ */
+
+int harmonic_cl_covariance(
+                           struct harmonic * phr,
+                           int l_min,
+                           int l_max,
+                           int delta_l,
+                           double fsky,
+                           double * noise,
+                           double * covariance
+                           ) {
+
+  int field_size;
+  int * ct_field1;
+  int * ct_field2;
+  int lb_size;
+  int index_lb;
+  int index_md;
+  int index_ct1,index_ct2;
+  int a1,b1,a2,b2;
+  int l;
+  double * cl_tot;
+  double ** cl_md;
+  double ** cl_md_ic;
+  double * cl_field;
+  double * cov;
+  double weight,sum_weight;
+  int abort;
+
+  class_test((l_min < 2) || (l_max < l_min) || (delta_l < 1),
+             phr->error_message,
+             "wrong multipole range l_min=%d, l_max=%d, delta_l=%d",l_min,l_max,delta_l);
+
+  class_test(l_max > phr->l_max_tot,
+             phr->error_message,
+             "spectra only computed up to l=%d, cannot compute their covariance up to l=%d",phr->l_max_tot,l_max);
+
+  class_test((fsky <= 0.) || (fsky > 1.),
+             phr->error_message,
+             "fsky=%e should be in ]0,1]",fsky);
+
+  /** - find the pair of fields (T, E, B, phi, each d bin, each l bin) of each type */
+
+  class_alloc(ct_field1,phr->ct_size*sizeof(int),phr->error_message);
+  class_alloc(ct_field2,phr->ct_size*sizeof(int),phr->error_message);
+
+  class_call_except(harmonic_cl_covariance_fields(phr,&field_size,ct_field1,ct_field2),
+                    phr->error_message,
+                    phr->error_message,
+                    free(ct_field1);free(ct_field2));
+
+  lb_size = (l_max-l_min)/delta_l+1;
+
+  abort = _FALSE_;
+
+#pragma omp parallel                                                    \
+  shared(phr,l_min,l_max,delta_l,fsky,noise,covariance,field_size,ct_field1,ct_field2,lb_size,abort) \
+  private(index_lb,index_md,index_ct1,index_ct2,a1,b1,a2,b2,l,cl_tot,cl_md,cl_md_ic,cl_field,cov,weight,sum_weight)
+  {
+
+    /** - allocate the spectra at one l, and the symmetric matrix of
+        spectra between fields (including noise) */
+
+    class_alloc_parallel(cl_tot,phr->ct_size*sizeof(double),phr->error_message);
+    class_alloc_parallel(cl_md,phr->md_size*sizeof(double*),phr->error_message);
+    class_alloc_parallel(cl_md_ic,phr->md_size*sizeof(double*),phr->error_message);
+    for (index_md=0; index_md<phr->md_size; index_md++) {
+      class_alloc_parallel(cl_md[index_md],phr->ct_size*sizeof(double),phr->error_message);
+      class_alloc_parallel(cl_md_ic[index_md],phr->ic_ic_size[index_md]*phr->ct_size*sizeof(double),phr->error_message);
+    }
+    class_alloc_parallel(cl_field,field_size*field_size*sizeof(double),phr->error_message);
+    for (a1=0; a1<field_size*field_size; a1++)
+      cl_field[a1] = 0.;
+
+#pragma omp for schedule (dynamic)
+
+    for (index_lb=0; index_lb<lb_size; index_lb++) {
+
+      cov = covariance + index_lb*phr->ct_size*phr->ct_size;
+
+      for (index_ct1=0; index_ct1<phr->ct_size*phr->ct_size; index_ct1++)
+        cov[index_ct1] = 0.;
+
+      sum_weight = 0.;
+
+      /** - sum the contribution of each l in the band to the upper triangle */
+
+      for (l=l_min+index_lb*delta_l; l<=MIN(l_min+(index_lb+1)*delta_l-1,l_max); l++) {
+
+        class_call_parallel(harmonic_cl_at_l(phr,(double)l,cl_tot,cl_md,cl_md_ic),
+                            phr->error_message,
+                            phr->error_message);
+
+        for (index_ct1=0; index_ct1<phr->ct_size; index_ct1++) {
+          a1 = ct_field1[index_ct1];
+          b1 = ct_field2[index_ct1];
+          cl_field[a1*field_size+b1] = cl_tot[index_ct1];
+          if ((a1 == b1) && (noise != NULL))
+            cl_field[a1*field_size+b1] += noise[(l-l_min)*phr->ct_size+index_ct1];
+          cl_field[b1*field_size+a1] = cl_field[a1*field_size+b1];
+        }
+
+        weight = 2.*l+1.;
+        sum_weight += weight;
+
+        for (index_ct1=0; index_ct1<phr->ct_size; index_ct1++) {
+          a1 = ct_field1[index_ct1];
+          b1 = ct_field2[index_ct1];
+          for (index_ct2=index_ct1; index_ct2<phr->ct_size; index_ct2++) {
+            a2 = ct_field1[index_ct2];
+            b2 = ct_field2[index_ct2];
+            cov[index_ct1*phr->ct_size+index_ct2] += weight *
+              (cl_field[a1*field_size+a2]*cl_field[b1*field_size+b2]
+               + cl_field[a1*field_size+b2]*cl_field[b1*field_size+a2]);
+          }
+        }
+      }
+
+      /** - normalize, and fill the lower triangle */
+
+      for (index_ct1=0; index_ct1<phr->ct_size; index_ct1++) {
+        for (index_ct2=index_ct1; index_ct2<phr->ct_size; index_ct2++) {
+          cov[index_ct1*phr->ct_size+index_ct2] /= fsky*sum_weight*sum_weight;
+          cov[index_ct2*phr->ct_size+index_ct1] = cov[index_ct1*phr->ct_size+index_ct2];
+        }
+      }
+
+#pragma omp flush(abort)
+
+    }
+
+    for (index_md=0; index_md<phr->md_size; index_md++) {
+      free(cl_md[index_md]);
+      free(cl_md_ic[index_md]);
+    }
+    free(cl_md);
+    free(cl_md_ic);
+    free(cl_tot);
+    free(cl_field);
+
+  }
+
+  free(ct_field1);
+  free(ct_field2);
+
+  if (abort == _TRUE_) return _FAILURE_;
+
+  return _SUCCESS_;
+}
+
+/**
+ * Identify each type of \f$ C_l \f$ with a pair of fields, numbered in
+ * the order T, E, B, \f$ \phi \f$, number count bins, lensing bins (only
+ * the fields appearing in at least one type are counted).
+ *
+ * @param phr        Input: pointer to harmonic structure
+ * @param field_size Output: number of fields
+ * @param ct_field1  Output: ct_field1[index_ct] is the first field of the type index_ct (must be already allocated)
+ * @param ct_field2  Output: ct_field2[index_ct] is the second field of the type index_ct (must be already allocated)
+ * @return the error status
+ */
+
+int harmonic_cl_covariance_fields(
+                                  struct harmonic * phr,
+                                  int * field_size,
+                                  int * ct_field1,
+                                  int * ct_field2
+                                  ) {
+
+  int index_field=0;
+  int field_t=0,field_e=0,field_b=0,field_p=0,field_d=0,field_l=0;
+  int index_d1,index_d2;
+  int index_ct;
+
+  if ((phr->has_tt == _TRUE_) || (phr->has_te == _TRUE_) || (phr->has_tp == _TRUE_) || (phr->has_td == _TRUE_) || (phr->has_tl == _TRUE_))
+    field_t = index_field++;
+  if ((phr->has_ee == _TRUE_) || (phr->has_te == _TRUE_) || (phr->has_ep == _TRUE_))
+    field_e = index_field++;
+  if (phr->has_bb == _TRUE_)
+    field_b = index_field++;
+  if ((phr->has_pp == _TRUE_) || (phr->has_tp == _TRUE_) || (phr->has_ep == _TRUE_) || (phr->has_pd == _TRUE_))
+    field_p = index_field++;
+  if ((phr->has_dd == _TRUE_) || (phr->has_td == _TRUE_) || (phr->has_pd == _TRUE_) || (phr->has_dl == _TRUE_)) {
+    field_d = index_field;
+    index_field += phr->d_size;
+  }
+  if ((phr->has_ll == _TRUE_) || (phr->has_tl == _TRUE_) || (phr->has_dl == _TRUE_)) {
+    field_l = index_field;
+    index_field += phr->d_size;
+  }
+  *field_size = index_field;
+
+  if (phr->has_tt == _TRUE_) {
+    ct_field1[phr->index_ct_tt] = field_t;
+    ct_field2[phr->index_ct_tt] = field_t;
+  }
+  if (phr->has_ee == _TRUE_) {
+    ct_field1[phr->index_ct_ee] = field_e;
+    ct_field2[phr->index_ct_ee] = field_e;
+  }
+  if (phr->has_te == _TRUE_) {
+    ct_field1[phr->index_ct_te] = field_t;
+    ct_field2[phr->index_ct_te] = field_e;
+  }
+  if (phr->has_bb == _TRUE_) {
+    ct_field1[phr->index_ct_bb] = field_b;
+    ct_field2[phr->index_ct_bb] = field_b;
+  }
+  if (phr->has_pp == _TRUE_) {
+    ct_field1[phr->index_ct_pp] = field_p;
+    ct_field2[phr->index_ct_pp] = field_p;
+  }
+  if (phr->has_tp == _TRUE_) {
+    ct_field1[phr->index_ct_tp] = field_t;
+    ct_field2[phr->index_ct_tp] = field_p;
+  }
+  if (phr->has_ep == _TRUE_) {
+    ct_field1[phr->index_ct_ep] = field_e;
+    ct_field2[phr->index_ct_ep] = field_p;
+  }
+
+  /* pairs of bins are ordered like in harmonic_cl_number_count_recombine() */
+
+  if (phr->has_dd == _TRUE_) {
+    index_ct=0;
+    for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+      for (index_d2=index_d1; index_d2<=MIN(index_d1+phr->non_diag,phr->d_size-1); index_d2++) {
+        ct_field1[phr->index_ct_dd+index_ct] = field_d+index_d1;
+        ct_field2[phr->index_ct_dd+index_ct] = field_d+index_d2;
+        index_ct++;
+      }
+    }
+  }
+  if (phr->has_td == _TRUE_) {
+    for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+      ct_field1[phr->index_ct_td+index_d1] = field_t;
+      ct_field2[phr->index_ct_td+index_d1] = field_d+index_d1;
+    }
+  }
+  if (phr->has_pd == _TRUE_) {
+    for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+      ct_field1[phr->index_ct_pd+index_d1] = field_p;
+      ct_field2[phr->index_ct_pd+index_d1] = field_d+index_d1;
+    }
+  }
+  if (phr->has_ll == _TRUE_) {
+    index_ct=0;
+    for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+      for (index_d2=index_d1; index_d2<=MIN(index_d1+phr->non_diag,phr->d_size-1); index_d2++) {
+        ct_field1[phr->index_ct_ll+index_ct] = field_l+index_d1;
+        ct_field2[phr->index_ct_ll+index_ct] = field_l+index_d2;
+        index_ct++;
+      }
+    }
+  }
+  if (phr->has_tl == _TRUE_) {
+    for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+      ct_field1[phr->index_ct_tl+index_d1] = field_t;
+      ct_field2[phr->index_ct_tl+index_d1] = field_l+index_d1;
+    }
+  }
+  if (phr->has_dl == _TRUE_) {
+    index_ct=0;
+    for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+      for (index_d2=MAX(index_d1-phr->non_diag,0); index_d2<=MIN(index_d1+phr->non_diag,phr->d_size-1); index_d2++) {
+        ct_field1[phr->index_ct_dl+index_ct] = field_d+index_d1;
+        ct_field2[phr->index_ct_dl+index_ct] = field_l+index_d2;
+        index_ct++;
+      }
+    }
+  }
+
+  return _SUCCESS_;
+}
+
 /**
  * This routine initializes the harmonic structure (in particular,
  * computes table of anisotropy and Fourier spectra \f$ C_l^{X}, P(k), ... \f$)
@@ -295,10 +719,19 @@ int harmonic_init(
 
   if (ppt->has_cls == _TRUE_) {
 
-    class_call(harmonic_cls(pba,ppt,ptr,ppm,phr),
+    class_call(harmonic_cls(ppr,pba,ppt,ptr,ppm,phr),
                phr->error_message,
                phr->error_message);
 
+    /** - the transfer functions are not needed by any other module:
+        release them if requested */
+
+    if (ptr->release_transfer == _TRUE_) {
+      class_call(transfer_release_tables(ppt,ptr),
+                 ptr->error_message,
+                 phr->error_message);
+    }
+
   }
   else {
     phr->ct_size=0;
@@ -347,6 +780,9 @@ int harmonic_free(
       free(phr->l_max);
       free(phr->cl);
       free(phr->ddcl);
+
+      if (phr->has_nc_components == _TRUE_)
+        free(phr->cl_nc);
     }
 
     for (index_md=0; index_md < phr->md_size; index_md++)
@@ -384,6 +820,8 @@ int harmonic_indices(
   int index_ct;
   int index_md;
   int index_ic1_ic2;
+  int index_ncc;
+  int index_ncct;
 
   phr->md_size = ppt->md_size;
   if (ppt->has_scalars == _TRUE_)
@@ -563,6 +1001,38 @@ int harmonic_indices(
 
     phr->ct_size = index_ct;
 
+    /* components of the number count spectra: the transfer module
+       has computed all number count terms for b=1 and s=0, plus the
+       coefficients of s, so each bin is the sum b*density + unbiased
+       + s*magnification */
+
+    phr->has_nc_components = _FALSE_;
+
+    if ((ptr->has_nc_components == _TRUE_) && (phr->has_dd == _TRUE_)) {
+
+      phr->has_nc_components = _TRUE_;
+
+      phr->has_ncc_density = ppt->has_nc_density;
+      phr->has_ncc_unbiased = _FALSE_;
+      if ((ppt->has_nc_rsd == _TRUE_) || (ppt->has_nc_lens == _TRUE_) || (ppt->has_nc_gr == _TRUE_))
+        phr->has_ncc_unbiased = _TRUE_;
+
+      index_ncc = 0;
+      class_define_index(phr->index_ncc_density,      phr->has_ncc_density, index_ncc,1);
+      class_define_index(phr->index_ncc_unbiased,     phr->has_ncc_unbiased,index_ncc,1);
+      class_define_index(phr->index_ncc_magnification,phr->has_ncc_unbiased,index_ncc,1);
+      phr->ncc_size = index_ncc;
+
+      index_ncct = 0;
+      class_define_index(phr->index_ncct_dd,phr->has_dd,index_ncct,
+                         (phr->d_size*(phr->d_size+1)-(phr->d_size-phr->non_diag)*(phr->d_size-1-phr->non_diag))/2*phr->ncc_size*phr->ncc_size);
+      class_define_index(phr->index_ncct_td,phr->has_td,index_ncct,phr->d_size*phr->ncc_size);
+      class_define_index(phr->index_ncct_pd,phr->has_pd,index_ncct,phr->d_size*phr->ncc_size);
+      class_define_index(phr->index_ncct_dl,phr->has_dl,index_ncct,
+                         (phr->d_size*phr->d_size - (phr->d_size-phr->non_diag)*(phr->d_size-1-phr->non_diag))*phr->ncc_size);
+      phr->ncct_size = index_ncct;
+    }
+
     /* infer from input quantities the l_max for each mode and type,
        l_max_ct[index_md][index_type].  Maximize it over index_ct, and
        then over index_md. */
@@ -651,6 +1121,7 @@ int harmonic_indices(
  * This routine computes a table of values for all harmonic spectra \f$ C_l \f$'s,
  * given the transfer functions and primordial spectra.
  *
+ * @param ppr Input: pointer to precision structure
  * @param pba Input: pointer to background structure
  * @param ppt Input: pointer to perturbation structure
  * @param ptr Input: pointer to transfer structure
@@ -660,6 +1131,7 @@ int harmonic_indices(
  */
 
 int harmonic_cls(
+                 struct precision * ppr,
                  struct background * pba,
                  struct perturbations * ppt,
                  struct transfer * ptr,
@@ -689,6 +1161,9 @@ int harmonic_cls(
      parallel region. */
   int abort;
 
+  /* number of threads (always one if no openmp) */
+  int number_of_threads;
+
 #ifdef _OPENMP
   /* instrumentation times */
   double tstart, tstop;
@@ -722,6 +1197,17 @@ int harmonic_cls(
     class_alloc(phr->ddcl[index_md],sizeof(double)*phr->l_size[index_md]*phr->ct_size*phr->ic_ic_size[index_md],phr->error_message);
     cl_integrand_num_columns = 1+phr->ct_size*2; /* one for k, ct_size for each type, ct_size for each second derivative of each type */
 
+    if ((phr->has_nc_components == _TRUE_) && _scalars_) {
+      class_alloc(phr->cl_nc,sizeof(double)*phr->l_size[index_md]*phr->ncct_size*phr->ic_ic_size[index_md],phr->error_message);
+      cl_integrand_num_columns += phr->ncct_size*2; /* same for each component spectrum, after the previous columns */
+    }
+
+    /* number of threads adapted to the amount of work (one integral over q per l and per column) */
+    number_of_threads = class_number_of_threads(ptr->l_size[index_md],
+                                                (double)ptr->q_size*cl_integrand_num_columns*_HARMONIC_COST_,
+                                                ppr->thread_overhead,
+                                                ppr->threads_harmonic);
+
     /** - --> (c) loop over initial conditions */
 
     for (index_ic1 = 0; index_ic1 < phr->ic_size[index_md]; index_ic1++) {
@@ -738,7 +1224,8 @@ int harmonic_cls(
 
 #pragma omp parallel                                                    \
   shared(ptr,ppm,index_md,phr,ppt,cl_integrand_num_columns,index_ic1,index_ic2,abort) \
-  private(tstart,cl_integrand,primordial_pk,transfer_ic1,transfer_ic2,index_l,tstop)
+  private(tstart,cl_integrand,primordial_pk,transfer_ic1,transfer_ic2,index_l,tstop) \
+  num_threads(number_of_threads)
 
           {
 
@@ -821,6 +1308,11 @@ int harmonic_cls(
                 [(index_l * phr->ic_ic_size[index_md] + index_ic1_ic2) * phr->ct_size + index_ct]
                 = 0.;
             }
+            if ((phr->has_nc_components == _TRUE_) && _scalars_) {
+              for (index_ct=0; index_ct<phr->ncct_size; index_ct++) {
+                phr->cl_nc[(index_l * phr->ic_ic_size[index_md] + index_ic1_ic2) * phr->ncct_size + index_ct] = 0.;
+              }
+            }
           }
         }
       }
@@ -895,14 +1387,36 @@ int harmonic_compute_cl(
   double transfer_ic2_temp=0.;
   double * transfer_ic1_nc=NULL;
   double * transfer_ic2_nc=NULL;
+  double * transfer_ic1_ncc=NULL; /* components of transfer_ic1_nc, transfer_ic1_ncc[index_d1*phr->ncc_size+index_ncc] */
+  double * transfer_ic2_ncc=NULL; /* idem */
+  double * coef_ncc=NULL;         /* coefficients of these components, coef_ncc[index_d1*phr->ncc_size+index_ncc] */
+  short has_nc_components=_FALSE_;
+  int index_ncc,index_ncc1,index_ncc2;
+  int index_col_nc=0;
   double factor;
-  int index_q_spline=0;
 
   index_ic1_ic2 = index_symmetric_matrix(index_ic1,index_ic2,phr->ic_size[index_md]);
 
   if (ppt->has_cl_number_count == _TRUE_ && _scalars_) {
     class_alloc(transfer_ic1_nc,phr->d_size*sizeof(double),phr->error_message);
     class_alloc(transfer_ic2_nc,phr->d_size*sizeof(double),phr->error_message);
+
+    if (phr->has_nc_components == _TRUE_) {
+      has_nc_components = _TRUE_;
+      /* component spectra are stored after the ct_size spectra and their second derivatives */
+      index_col_nc = 1+2*phr->ct_size;
+      class_alloc(transfer_ic1_ncc,phr->d_size*phr->ncc_size*sizeof(double),phr->error_message);
+      class_alloc(transfer_ic2_ncc,phr->d_size*phr->ncc_size*sizeof(double),phr->error_message);
+      class_alloc(coef_ncc,phr->d_size*phr->ncc_size*sizeof(double),phr->error_message);
+      for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+        if (phr->has_ncc_density == _TRUE_)
+          coef_ncc[index_d1*phr->ncc_size+phr->index_ncc_density] = ptr->selection_bias[index_d1];
+        if (phr->has_ncc_unbiased == _TRUE_) {
+          coef_ncc[index_d1*phr->ncc_size+phr->index_ncc_unbiased] = 1.;
+          coef_ncc[index_d1*phr->ncc_size+phr->index_ncc_magnification] = ptr->selection_magnification_bias[index_d1];
+        }
+      }
+    }
   }
 
   for (index_q=0; index_q < ptr->q_size; index_q++) {
@@ -963,7 +1477,7 @@ int harmonic_compute_cl(
       }
     }
 
-    if (ppt->has_cl_number_count == _TRUE_ && _scalars_) {
+    if (ppt->has_cl_number_count == _TRUE_ && _scalars_ && has_nc_components == _FALSE_) {
 
       for (index_d1=0; index_d1<phr->d_size; index_d1++) {
 
@@ -1011,6 +1525,84 @@ int harmonic_compute_cl(
       }
     }
 
+    /* with nuisance-separable number counts, the transfer functions
+       were computed for b=1 and s=0; the terms in nc_lens and G4 are
+       proportional to (2-5s), the other terms in s have their own
+       types */
+
+    if (has_nc_components == _TRUE_) {
+
+      for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+
+        for (index_ncc=0; index_ncc<phr->ncc_size; index_ncc++) {
+          transfer_ic1_ncc[index_d1*phr->ncc_size+index_ncc] = 0.;
+          transfer_ic2_ncc[index_d1*phr->ncc_size+index_ncc] = 0.;
+        }
+
+        if (ppt->has_nc_density == _TRUE_) {
+          transfer_ic1_ncc[index_d1*phr->ncc_size+phr->index_ncc_density] = transfer_ic1[ptr->index_tt_density+index_d1];
+          transfer_ic2_ncc[index_d1*phr->ncc_size+phr->index_ncc_density] = transfer_ic2[ptr->index_tt_density+index_d1];
+        }
+
+        if (ppt->has_nc_rsd     == _TRUE_) {
+          transfer_ic1_ncc[index_d1*phr->ncc_size+phr->index_ncc_unbiased]
+            += transfer_ic1[ptr->index_tt_rsd+index_d1]
+            + transfer_ic1[ptr->index_tt_d0+index_d1]
+            + transfer_ic1[ptr->index_tt_d1+index_d1];
+          transfer_ic2_ncc[index_d1*phr->ncc_size+phr->index_ncc_unbiased]
+            += transfer_ic2[ptr->index_tt_rsd+index_d1]
+            + transfer_ic2[ptr->index_tt_d0+index_d1]
+            + transfer_ic2[ptr->index_tt_d1+index_d1];
+          transfer_ic1_ncc[index_d1*phr->ncc_size+phr->index_ncc_magnification]
+            += transfer_ic1[ptr->index_tt_d1_mag+index_d1];
+          transfer_ic2_ncc[index_d1*phr->ncc_size+phr->index_ncc_magnification]
+            += transfer_ic2[ptr->index_tt_d1_mag+index_d1];
+        }
+
+        if (ppt->has_nc_lens == _TRUE_) {
+          transfer_ic1_ncc[index_d1*phr->ncc_size+phr->index_ncc_unbiased] +=
+            phr->l[index_l]*(phr->l[index_l]+1.)*transfer_ic1[ptr->index_tt_nc_lens+index_d1];
+          transfer_ic2_ncc[index_d1*phr->ncc_size+phr->index_ncc_unbiased] +=
+            phr->l[index_l]*(phr->l[index_l]+1.)*transfer_ic2[ptr->index_tt_nc_lens+index_d1];
+          transfer_ic1_ncc[index_d1*phr->ncc_size+phr->index_ncc_magnification] -=
+            2.5*phr->l[index_l]*(phr->l[index_l]+1.)*transfer_ic1[ptr->index_tt_nc_lens+index_d1];
+          transfer_ic2_ncc[index_d1*phr->ncc_size+phr->index_ncc_magnification] -=
+            2.5*phr->l[index_l]*(phr->l[index_l]+1.)*transfer_ic2[ptr->index_tt_nc_lens+index_d1];
+        }
+
+        if (ppt->has_nc_gr == _TRUE_) {
+          transfer_ic1_ncc[index_d1*phr->ncc_size+phr->index_ncc_unbiased]
+            += transfer_ic1[ptr->index_tt_nc_g1+index_d1]
+            + transfer_ic1[ptr->index_tt_nc_g2+index_d1]
+            + transfer_ic1[ptr->index_tt_nc_g3+index_d1]
+            + transfer_ic1[ptr->index_tt_nc_g4+index_d1]
+            + transfer_ic1[ptr->index_tt_nc_g5+index_d1];
+          transfer_ic2_ncc[index_d1*phr->ncc_size+phr->index_ncc_unbiased]
+            += transfer_ic2[ptr->index_tt_nc_g1+index_d1]
+            + transfer_ic2[ptr->index_tt_nc_g2+index_d1]
+            + transfer_ic2[ptr->index_tt_nc_g3+index_d1]
+            + transfer_ic2[ptr->index_tt_nc_g4+index_d1]
+            + transfer_ic2[ptr->index_tt_nc_g5+index_d1];
+          transfer_ic1_ncc[index_d1*phr->ncc_size+phr->index_ncc_magnification]
+            += transfer_ic1[ptr->index_tt_nc_g2_mag+index_d1]
+            - 2.5*transfer_ic1[ptr->index_tt_nc_g4+index_d1]
+            + transfer_ic1[ptr->index_tt_nc_g5_mag+index_d1];
+          transfer_ic2_ncc[index_d1*phr->ncc_size+phr->index_ncc_magnification]
+            += transfer_ic2[ptr->index_tt_nc_g2_mag+index_d1]
+            - 2.5*transfer_ic2[ptr->index_tt_nc_g4+index_d1]
+            + transfer_ic2[ptr->index_tt_nc_g5_mag+index_d1];
+        }
+
+        /* total for the input values of b and s */
+        transfer_ic1_nc[index_d1] = 0.;
+        transfer_ic2_nc[index_d1] = 0.;
+        for (index_ncc=0; index_ncc<phr->ncc_size; index_ncc++) {
+          transfer_ic1_nc[index_d1] += coef_ncc[index_d1*phr->ncc_size+index_ncc]*transfer_ic1_ncc[index_d1*phr->ncc_size+index_ncc];
+          transfer_ic2_nc[index_d1] += coef_ncc[index_d1*phr->ncc_size+index_ncc]*transfer_ic2_ncc[index_d1*phr->ncc_size+index_ncc];
+        }
+      }
+    }
+
     /* integrand of Cl's */
 
     /* note: we must integrate
@@ -1175,6 +1767,68 @@ int harmonic_compute_cl(
         }
       }
     }
+
+    /* integrand of component spectra, for each pair of components */
+
+    if (has_nc_components == _TRUE_) {
+
+      if (phr->has_dd == _TRUE_) {
+        index_ct=0;
+        for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+          for (index_d2=index_d1; index_d2<=MIN(index_d1+phr->non_diag,phr->d_size-1); index_d2++) {
+            for (index_ncc1=0; index_ncc1<phr->ncc_size; index_ncc1++) {
+              for (index_ncc2=0; index_ncc2<phr->ncc_size; index_ncc2++) {
+                cl_integrand[index_q*cl_integrand_num_columns+index_col_nc+phr->index_ncct_dd+(index_ct*phr->ncc_size+index_ncc1)*phr->ncc_size+index_ncc2]=
+                  primordial_pk[index_ic1_ic2]
+                  * transfer_ic1_ncc[index_d1*phr->ncc_size+index_ncc1]
+                  * transfer_ic2_ncc[index_d2*phr->ncc_size+index_ncc2]
+                  * factor;
+              }
+            }
+            index_ct++;
+          }
+        }
+      }
+
+      if (phr->has_td == _TRUE_) {
+        for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+          for (index_ncc=0; index_ncc<phr->ncc_size; index_ncc++) {
+            cl_integrand[index_q*cl_integrand_num_columns+index_col_nc+phr->index_ncct_td+index_d1*phr->ncc_size+index_ncc]=
+              primordial_pk[index_ic1_ic2]
+              * 0.5*(transfer_ic1_temp * transfer_ic2_ncc[index_d1*phr->ncc_size+index_ncc] +
+                     transfer_ic1_ncc[index_d1*phr->ncc_size+index_ncc] * transfer_ic2_temp)
+              * factor;
+          }
+        }
+      }
+
+      if (phr->has_pd == _TRUE_) {
+        for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+          for (index_ncc=0; index_ncc<phr->ncc_size; index_ncc++) {
+            cl_integrand[index_q*cl_integrand_num_columns+index_col_nc+phr->index_ncct_pd+index_d1*phr->ncc_size+index_ncc]=
+              primordial_pk[index_ic1_ic2]
+              * 0.5*(transfer_ic1[ptr->index_tt_lcmb] * transfer_ic2_ncc[index_d1*phr->ncc_size+index_ncc] +
+                     transfer_ic1_ncc[index_d1*phr->ncc_size+index_ncc] * transfer_ic2[ptr->index_tt_lcmb])
+              * factor;
+          }
+        }
+      }
+
+      if (phr->has_dl == _TRUE_) {
+        index_ct=0;
+        for (index_d1=0; index_d1<phr->d_size; index_d1++) {
+          for (index_d2=MAX(index_d1-phr->non_diag,0); index_d2<=MIN(index_d1+phr->non_diag,phr->d_size-1); index_d2++) {
+            for (index_ncc=0; index_ncc<phr->ncc_size; index_ncc++) {
+              cl_integrand[index_q*cl_integrand_num_columns+index_col_nc+phr->index_ncct_dl+index_ct*phr->ncc_size+index_ncc]=
+                primordial_pk[index_ic1_ic2]
+                * transfer_ic1_ncc[index_d1*phr->ncc_size+index_ncc] * transfer_ic2[ptr->index_tt_lensing+index_d2]
+                * factor;
+            }
+            index_ct++;
+          }
+        }
+      }
+    }
   }
 
   for (index_ct=0; index_ct<phr->ct_size; index_ct++) {
@@ -1200,64 +1854,17 @@ int harmonic_compute_cl(
     /* for non-zero spectra, integrate over q */
     else {
 
-      /* spline the integrand over the whole range of k's */
-
-      class_call(array_spline(cl_integrand,
-                              cl_integrand_num_columns,
-                              ptr->q_size,
-                              0,
-                              1+index_ct,
-                              1+phr->ct_size+index_ct,
-                              _SPLINE_EST_DERIV_,
-                              phr->error_message),
-                 phr->error_message,
-                 phr->error_message);
-
-      /* Technical point: we will now do a spline integral over the
-         whole range of k's, excepted in the closed (K>0) case. In
-         that case, it is a bad idea to spline over the values of k
-         corresponding to nu<nu_flat_approximation. In this region, nu
-         values are integer values, so the steps dq and dk have some
-         discrete jumps. This makes the spline routine less accurate
-         than a trapezoidal integral with finer sampling. So, in the
-         closed case, we set index_q_spline to
-         ptr->index_q_flat_approximation, to tell the integration
-         routine that below this index, it should treat the integral
-         as a trapezoidal one. For testing, one is free to set
-         index_q_spline to 0, to enforce spline integration
-         everywhere, or to (ptr->q_size-1), to enforce trapezoidal
-         integration everywhere. */
-
-      if (pba->sgnK == 1) {
-        index_q_spline = ptr->index_q_flat_approximation;
-      }
-
-      class_call(array_integrate_all_trapzd_or_spline(cl_integrand,
-                                                      cl_integrand_num_columns,
-                                                      ptr->q_size,
-                                                      index_q_spline,
-                                                      0,
-                                                      1+index_ct,
-                                                      1+phr->ct_size+index_ct,
-                                                      &clvalue,
-                                                      phr->error_message),
+      class_call(harmonic_integrate_cl(pba,
+                                       ptr,
+                                       phr,
+                                       cl_integrand_num_columns,
+                                       cl_integrand,
+                                       1+index_ct,
+                                       1+phr->ct_size+index_ct,
+                                       &clvalue),
                  phr->error_message,
                  phr->error_message);
 
-      /* in the closed case, instead of an integral, we have a
-         discrete sum. In practice, this does not matter: the previous
-         routine does give a correct approximation of the discrete
-         sum, both in the trapezoidal and spline regions. The only
-         error comes from the first point: the previous routine
-         assumes a weight for the first point which is too small
-         compared to what it would be in the an actual discrete
-         sum. The line below correct this problem in an exact way.
-      */
-
-      if (pba->sgnK == 1) {
-        clvalue += cl_integrand[1+index_ct] * ptr->q[0]/ptr->k[0][0]*sqrt(pba->K)/2.;
-      }
-
       /* we have the correct C_l now. We can store it in the transfer structure. */
 
       phr->cl[index_md]
@@ -1267,6 +1874,31 @@ int harmonic_compute_cl(
     }
   }
 
+  /* same integral for the component spectra */
+
+  if (has_nc_components == _TRUE_) {
+
+    for (index_ct=0; index_ct<phr->ncct_size; index_ct++) {
+
+      class_call(harmonic_integrate_cl(pba,
+                                       ptr,
+                                       phr,
+                                       cl_integrand_num_columns,
+                                       cl_integrand,
+                                       index_col_nc+index_ct,
+                                       index_col_nc+phr->ncct_size+index_ct,
+                                       &clvalue),
+                 phr->error_message,
+                 phr->error_message);
+
+      phr->cl_nc[(index_l * phr->ic_ic_size[index_md] + index_ic1_ic2) * phr->ncct_size + index_ct] = clvalue;
+    }
+
+    free(transfer_ic1_ncc);
+    free(transfer_ic2_ncc);
+    free(coef_ncc);
+  }
+
   if (ppt->has_cl_number_count == _TRUE_ && _scalars_) {
     free(transfer_ic1_nc);
     free(transfer_ic2_nc);
@@ -1276,6 +1908,95 @@ int harmonic_compute_cl(
 
 }
 
+/**
+ * This routine integrates over q one column of the \f$ C_l\f$ integrand
+ * prepared by harmonic_compute_cl().
+ *
+ * @param pba                      Input: pointer to background structure
+ * @param ptr                      Input: pointer to transfer structure
+ * @param phr                      Input: pointer to harmonic structure (for error message)
+ * @param cl_integrand_num_columns Input: number of columns in cl_integrand
+ * @param cl_integrand             Input/Output: integrand (the second derivative column is filled here)
+ * @param index_column             Input: column of the integrand
+ * @param index_ddcolumn           Input: column where its second derivative can be stored
+ * @param clvalue                  Output: the integral
+ * @return the error status
+ */
+
+int harmonic_integrate_cl(
+                          struct background * pba,
+                          struct transfer * ptr,
+                          struct harmonic * phr,
+                          int cl_integrand_num_columns,
+                          double * cl_integrand,
+                          int index_column,
+                          int index_ddcolumn,
+                          double * clvalue
+                          ) {
+
+  int index_q_spline=0;
+
+  /* spline the integrand over the whole range of k's */
+
+  class_call(array_spline(cl_integrand,
+                          cl_integrand_num_columns,
+                          ptr->q_size,
+                          0,
+                          index_column,
+                          index_ddcolumn,
+                          _SPLINE_EST_DERIV_,
+                          phr->error_message),
+             phr->error_message,
+             phr->error_message);
+
+  /* Technical point: we will now do a spline integral over the
+     whole range of k's, excepted in the closed (K>0) case. In
+     that case, it is a bad idea to spline over the values of k
+     corresponding to nu<nu_flat_approximation. In this region, nu
+     values are integer values, so the steps dq and dk have some
+     discrete jumps. This makes the spline routine less accurate
+     than a trapezoidal integral with finer sampling. So, in the
+     closed case, we set index_q_spline to
+     ptr->index_q_flat_approximation, to tell the integration
+     routine that below this index, it should treat the integral
+     as a trapezoidal one. For testing, one is free to set
+     index_q_spline to 0, to enforce spline integration
+     everywhere, or to (ptr->q_size-1), to enforce trapezoidal
+     integration everywhere. */
+
+  if (pba->sgnK == 1) {
+    index_q_spline = ptr->index_q_flat_approximation;
+  }
+
+  class_call(array_integrate_all_trapzd_or_spline(cl_integrand,
+                                                  cl_integrand_num_columns,
+                                                  ptr->q_size,
+                                                  index_q_spline,
+                                                  0,
+                                                  index_column,
+                                                  index_ddcolumn,
+                                                  clvalue,
+                                                  phr->error_message),
+             phr->error_message,
+             phr->error_message);
+
+  /* in the closed case, instead of an integral, we have a
+     discrete sum. In practice, this does not matter: the previous
+     routine does give a correct approximation of the discrete
+     sum, both in the trapezoidal and spline regions. The only
+     error comes from the first point: the previous routine
+     assumes a weight for the first point which is too small
+     compared to what it would be in the an actual discrete
+     sum. The line below correct this problem in an exact way.
+  */
+
+  if (pba->sgnK == 1) {
+    *clvalue += cl_integrand[index_column] * ptr->q[0]/ptr->k[0][0]*sqrt(pba->K)/2.;
+  }
+
+  return _SUCCESS_;
+}
+
 /* deprecated functions (since v2.8) */
 
 /**
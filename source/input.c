@@ -25,6 +25,25 @@
 #include "distortions.h"
 #include "output.h"
 
+/**
+ * Jacobian of the last multidimensional shooting for a given input,
+ * kept until input_free_shooting_jacobians() is called (only with
+ * shooting_jacobian_reuse). A new shooting starts from it instead of
+ * finite differences (see fzero_Newton()) only when all input names
+ * and values, including the targets, and the unknown names are the
+ * same, so that the result never depends on previous runs with other
+ * parameters.
+ */
+
+struct input_shooting_jacobian {
+  char * key;       /**< input names and values, then unknown names, as null-terminated strings */
+  int key_size;     /**< size of key in bytes */
+  double jacobian[_NUM_TARGETS_*_NUM_TARGETS_];
+  struct input_shooting_jacobian * next;
+};
+
+static struct input_shooting_jacobian * input_shooting_jacobians = NULL;
+
 /**
  * Initialize input parameters from external file.
  *
@@ -454,6 +473,239 @@ int input_read_from_file(struct file_content * pfc,
 }
 
 
+/**
+ * Run CLASS from the input module up to a given module, for the
+ * parameters passed in packed form, in a single call. This is the
+ * whole computation of the python wrapper at each compute(): setting
+ * the parameters, running the modules in the order of main/class.c,
+ * and cleaning up after a failure.
+ *
+ * The modules already allocated in the structures (bit mask *modules)
+ * are freed first. On success, *modules contains all modules from
+ * input to last_module. On failure, all modules are freed, *modules is
+ * zero and *failed_module is the module that failed; an input
+ * parameter that was not read counts as a failure of the input module.
+ *
+ * @param pfc           Input/Output: parameters (set from names and values if values is not NULL)
+ * @param size          Input: number of parameters in names and values
+ * @param names         Input: packed names (size null-terminated strings), or NULL to keep those of pfc
+ * @param values        Input: packed values, or NULL to use pfc as it is
+ * @param last_module   Input: last module to run
+ * @param modules       Input/Output: bit mask of the allocated modules
+ * @param failed_module Output: module that failed, if any
+ * @param ppr           Input: pointer to precision structure
+ * @param pba           Input: pointer to background structure
+ * @param pth           Input: pointer to thermodynamics structure
+ * @param ppt           Input: pointer to perturbation structure
+ * @param ptr           Input: pointer to transfer structure
+ * @param ppm           Input: pointer to primordial structure
+ * @param phr           Input: pointer to harmonic structure
+ * @param pfo           Input: pointer to fourier structure
+ * @param ple           Input: pointer to lensing structure
+ * @param psd           Input: pointer to distorsion structure
+ * @param pop           Input: pointer to output structure
+ * @param errmsg        Input/Output: Error message
+ * @return the error status
+ */
+
+int input_compute_modules(struct file_content * pfc,
+                          int size,
+                          char * names,
+                          char * values,
+                          enum input_module last_module,
+                          int * modules,
+                          enum input_module * failed_module,
+                          struct precision * ppr,
+                          struct background *pba,
+                          struct thermodynamics *pth,
+                          struct perturbations *ppt,
+                          struct transfer *ptr,
+                          struct primordial *ppm,
+                          struct harmonic *phr,
+                          struct fourier *pfo,
+                          struct lensing *ple,
+                          struct distortions *psd,
+                          struct output *pop,
+                          ErrorMsg errmsg){
+
+  int index_module,i;
+  ErrorMsg unread;
+
+  /** - free the modules of the previous run */
+  *failed_module = im_input;
+  class_call(input_free_modules(modules,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,errmsg),
+             errmsg,
+             errmsg);
+
+  /** - set and read the parameters */
+  if (values != NULL) {
+    class_call(parser_set_packed(pfc,size,names,values,errmsg),
+               errmsg,
+               errmsg);
+  }
+  else {
+    for (i=0; i<pfc->size; i++) {
+      pfc->read[i] = _FALSE_;
+    }
+  }
+
+  class_call(input_read_from_file(pfc,ppr,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,pop,errmsg),
+             errmsg,
+             errmsg);
+  *modules = (1 << im_input);
+
+  /** - check that all parameters were understood */
+  unread[0] = '\0';
+  for (i=0; i<pfc->size; i++) {
+    if ((pfc->read[i] == _FALSE_) && (strlen(unread)+strlen(pfc->name[i])+3 < _ERRORMSGSIZE_/2)) {
+      if (unread[0] != '\0')
+        strcat(unread,", ");
+      strcat(unread,pfc->name[i]);
+    }
+  }
+  if (unread[0] != '\0') {
+    class_call(input_free_modules(modules,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,errmsg),
+               errmsg,
+               errmsg);
+    class_stop(errmsg,
+               "Class did not read input parameter(s): %s",unread);
+  }
+
+  /** - run the modules */
+  for (index_module=im_background; index_module<=last_module; index_module++) {
+
+    *failed_module = index_module;
+
+    switch (index_module) {
+    case im_background:
+      class_call_except(background_init(ppr,pba),
+                        pba->error_message,errmsg,
+                        input_free_modules(modules,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,pba->error_message));
+      break;
+    case im_thermodynamics:
+      class_call_except(thermodynamics_init(ppr,pba,pth),
+                        pth->error_message,errmsg,
+                        input_free_modules(modules,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,pth->error_message));
+      break;
+    case im_perturbations:
+      class_call_except(perturbations_init(ppr,pba,pth,ppt),
+                        ppt->error_message,errmsg,
+                        input_free_modules(modules,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,ppt->error_message));
+      break;
+    case im_primordial:
+      class_call_except(primordial_init(ppr,ppt,ppm),
+                        ppm->error_message,errmsg,
+                        input_free_modules(modules,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,ppm->error_message));
+      break;
+    case im_fourier:
+      class_call_except(fourier_init(ppr,pba,pth,ppt,ppm,pfo),
+                        pfo->error_message,errmsg,
+                        input_free_modules(modules,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,pfo->error_message));
+      break;
+    case im_transfer:
+      class_call_except(transfer_init(ppr,pba,pth,ppt,pfo,ptr),
+                        ptr->error_message,errmsg,
+                        input_free_modules(modules,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,ptr->error_message));
+      break;
+    case im_harmonic:
+      class_call_except(harmonic_init(ppr,pba,ppt,ppm,pfo,ptr,phr),
+                        phr->error_message,errmsg,
+                        input_free_modules(modules,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,phr->error_message));
+      break;
+    case im_lensing:
+      class_call_except(lensing_init(ppr,ppt,phr,pfo,ple),
+                        ple->error_message,errmsg,
+                        input_free_modules(modules,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,ple->error_message));
+      break;
+    case im_distortions:
+      class_call_except(distortions_init(ppr,pba,pth,ppt,ppm,psd),
+                        psd->error_message,errmsg,
+                        input_free_modules(modules,pba,pth,ppt,ptr,ppm,phr,pfo,ple,psd,psd->error_message));
+      break;
+    }
+
+    *modules |= (1 << index_module);
+  }
+
+  return _SUCCESS_;
+
+}
+
+/**
+ * Free the modules recorded in a bit mask (see input_compute_modules()),
+ * in the reverse order of their computation, and clear the mask. If
+ * only the input module ran for the background or perturbations
+ * structure, the pointers allocated by the input module are freed.
+ *
+ * @param modules Input/Output: bit mask of the allocated modules, zero on output
+ * @param pba     Input: pointer to background structure
+ * @param pth     Input: pointer to thermodynamics structure
+ * @param ppt     Input: pointer to perturbation structure
+ * @param ptr     Input: pointer to transfer structure
+ * @param ppm     Input: pointer to primordial structure
+ * @param phr     Input: pointer to harmonic structure
+ * @param pfo     Input: pointer to fourier structure
+ * @param ple     Input: pointer to lensing structure
+ * @param psd     Input: pointer to distorsion structure
+ * @param errmsg  Input/Output: Error message
+ * @return the error status
+ */
+
+int input_free_modules(int * modules,
+                       struct background *pba,
+                       struct thermodynamics *pth,
+                       struct perturbations *ppt,
+                       struct transfer *ptr,
+                       struct primordial *ppm,
+                       struct harmonic *phr,
+                       struct fourier *pfo,
+                       struct lensing *ple,
+                       struct distortions *psd,
+                       ErrorMsg errmsg){
+
+  int allocated = *modules;
+
+  *modules = 0;
+
+  if (allocated & (1 << im_distortions)) {
+    class_call(distortions_free(psd), psd->error_message, errmsg);
+  }
+  if (allocated & (1 << im_lensing)) {
+    class_call(lensing_free(ple), ple->error_message, errmsg);
+  }
+  if (allocated & (1 << im_harmonic)) {
+    class_call(harmonic_free(phr), phr->error_message, errmsg);
+  }
+  if (allocated & (1 << im_transfer)) {
+    class_call(transfer_free(ptr), ptr->error_message, errmsg);
+  }
+  if (allocated & (1 << im_fourier)) {
+    class_call(fourier_free(pfo), pfo->error_message, errmsg);
+  }
+  if (allocated & (1 << im_primordial)) {
+    class_call(primordial_free(ppm), ppm->error_message, errmsg);
+  }
+  if (allocated & (1 << im_perturbations)) {
+    class_call(perturbations_free(ppt), ppt->error_message, errmsg);
+  }
+  else if (allocated & (1 << im_input)) {
+    perturbations_free_input(ppt);
+  }
+  if (allocated & (1 << im_thermodynamics)) {
+    class_call(thermodynamics_free(pth), pth->error_message, errmsg);
+  }
+  if (allocated & (1 << im_background)) {
+    class_call(background_free(pba), pba->error_message, errmsg);
+  }
+  else if (allocated & (1 << im_input)) {
+    background_free_input(pba);
+  }
+
+  return _SUCCESS_;
+
+}
+
+
 /**
  * In CLASS, we call 'shooting' the process of doing preliminary runs
  * of parts of the code in order to find numerically the value of an
@@ -515,7 +767,11 @@ int input_shooting(struct file_content * pfc,
   int counter, index_target, i;
   int fevals=0;
   double xzero;
-  double *dxdF, *x_inout;
+  double *dxdF, *x_inout, *jacobian;
+  int has_jacobian;
+  struct input_shooting_jacobian * pjac;
+  char * jacobian_key;
+  int jacobian_key_size;
   int target_indices[_NUM_TARGETS_];
   int needs_shooting;
   int shooting_failed=_FALSE_;
@@ -678,13 +934,35 @@ int input_shooting(struct file_content * pfc,
       class_alloc(dxdF,
                   sizeof(double)*unknown_parameters_size,
                   errmsg);
+      class_alloc(jacobian,
+                  sizeof(double)*unknown_parameters_size*unknown_parameters_size,
+                  errmsg);
 
       /* Get the guess for the initial variables */
       class_call(input_get_guess(x_inout, dxdF, &fzw, errmsg),
                  errmsg,
                  errmsg);
 
-      /* Use multi-dimensional Newton method */
+      /* Start from the jacobian of a previous shooting with the same input, if any */
+      has_jacobian = _FALSE_;
+      if (ppr->shooting_jacobian_reuse == _TRUE_) {
+        class_call(input_shooting_jacobian_key(pfc,&fzw,&jacobian_key,&jacobian_key_size,errmsg),
+                   errmsg,
+                   errmsg);
+#pragma omp critical (input_shooting_jacobians)
+        {
+          for (pjac=input_shooting_jacobians; pjac!=NULL; pjac=pjac->next) {
+            if ((pjac->key_size == jacobian_key_size) &&
+                (memcmp(pjac->key,jacobian_key,jacobian_key_size) == 0)) {
+              memcpy(jacobian,pjac->jacobian,unknown_parameters_size*unknown_parameters_size*sizeof(double));
+              has_jacobian = _TRUE_;
+              break;
+            }
+          }
+        }
+      }
+
+      /* Use multi-dimensional quasi-Newton method */
       class_call_try(fzero_Newton(input_try_unknown_parameters,
                                   x_inout,
                                   dxdF,
@@ -692,12 +970,42 @@ int input_shooting(struct file_content * pfc,
                                   ppr->tol_shooting_deltax,
                                   ppr->tol_shooting_deltaF,
                                   &fzw,
+                                  jacobian,
+                                  &has_jacobian,
                                   &fevals,
                                   errmsg),
                      errmsg,
                      pba->shooting_error,
                      shooting_failed=_TRUE_);
 
+      /* Keep the last jacobian for the next shooting with the same
+         input (the list then owns jacobian_key) */
+      if (ppr->shooting_jacobian_reuse == _TRUE_) {
+        if ((shooting_failed == _FALSE_) && (has_jacobian == _TRUE_)) {
+#pragma omp critical (input_shooting_jacobians)
+          {
+            for (pjac=input_shooting_jacobians; pjac!=NULL; pjac=pjac->next) {
+              if ((pjac->key_size == jacobian_key_size) &&
+                  (memcmp(pjac->key,jacobian_key,jacobian_key_size) == 0))
+                break;
+            }
+            if (pjac == NULL) {
+              pjac = malloc(sizeof(struct input_shooting_jacobian));
+              if (pjac != NULL) {
+                pjac->key = jacobian_key;
+                pjac->key_size = jacobian_key_size;
+                jacobian_key = NULL;
+                pjac->next = input_shooting_jacobians;
+                input_shooting_jacobians = pjac;
+              }
+            }
+            if (pjac != NULL)
+              memcpy(pjac->jacobian,jacobian,unknown_parameters_size*unknown_parameters_size*sizeof(double));
+          }
+        }
+        free(jacobian_key);
+      }
+
       /* Store xzero */
       // This needs to be done with enough accuracy. A standard double has a relative
       // precision of around 1e-16, so 1e-20 should be good enough for the shooting
@@ -714,6 +1022,7 @@ int input_shooting(struct file_content * pfc,
       /* Free local variables */
       free(x_inout);
       free(dxdF);
+      free(jacobian);
     }
 
     if (input_verbose > 1) {
@@ -851,6 +1160,84 @@ int input_shooting(struct file_content * pfc,
 }
 
 
+/**
+ * Related to 'shooting': build the key under which the jacobian of a
+ * multidimensional shooting is stored, made of all input names and
+ * values (hence also the targets) followed by the names of the unknown
+ * parameters, as null-terminated strings
+ *
+ * @param pfc             Input: pointer to the input file content
+ * @param pfzw            Input: pointer to the shooting workspace
+ * @param key             Output: allocated key, to be freed by the caller
+ * @param key_size        Output: size of the key in bytes
+ * @param errmsg          Input/Output: Error message
+ * @return the error status
+ */
+
+int input_shooting_jacobian_key(struct file_content * pfc,
+                                struct fzerofun_workspace * pfzw,
+                                char ** key,
+                                int * key_size,
+                                ErrorMsg errmsg){
+
+  int i, counter;
+  char * pkey;
+
+  *key_size = 0;
+  for (i=0; i < pfc->size; i++) {
+    *key_size += strlen(pfc->name[i])+1+strlen(pfc->value[i])+1;
+  }
+  for (counter=0; counter < pfzw->target_size; counter++) {
+    *key_size += strlen(pfzw->fc.name[pfzw->unknown_parameters_index[counter]])+1;
+  }
+
+  class_alloc(*key,
+              *key_size*sizeof(char),
+              errmsg);
+
+  pkey = *key;
+  for (i=0; i < pfc->size; i++) {
+    strcpy(pkey,pfc->name[i]);
+    pkey += strlen(pfc->name[i])+1;
+    strcpy(pkey,pfc->value[i]);
+    pkey += strlen(pfc->value[i])+1;
+  }
+  for (counter=0; counter < pfzw->target_size; counter++) {
+    strcpy(pkey,pfzw->fc.name[pfzw->unknown_parameters_index[counter]]);
+    pkey += strlen(pfzw->fc.name[pfzw->unknown_parameters_index[counter]])+1;
+  }
+
+  return _SUCCESS_;
+
+}
+
+/**
+ * Related to 'shooting': free the jacobians kept by previous
+ * multidimensional shootings with shooting_jacobian_reuse. Wrappers
+ * call it when they clean up their structures.
+ *
+ * @return the error status
+ */
+
+int input_free_shooting_jacobians(void){
+
+  struct input_shooting_jacobian * pjac;
+
+#pragma omp critical (input_shooting_jacobians)
+  {
+    while (input_shooting_jacobians != NULL) {
+      pjac = input_shooting_jacobians;
+      input_shooting_jacobians = pjac->next;
+      free(pjac->key);
+      free(pjac);
+    }
+  }
+
+  return _SUCCESS_;
+
+}
+
+
 /**
  * Related to 'shooting': for each target, check whether it is
  * sufficient to stick to the default value of the unkown parameter
@@ -3729,6 +4116,9 @@ int input_read_parameters_nonlinear(struct file_content * pfc,
       }
 
       class_read_double("z_infinity", pfo->z_infinity);
+
+      /* Read whether HMcode should keep the tables needed to update the feedback parameters */
+      class_read_flag("hmcode_fast_feedback", pfo->hmcode_fast_feedback);
     }
     else if (strstr(string1,"no")!=NULL){
       pfo->method=nl_none;
@@ -4608,6 +4998,7 @@ int input_read_parameters_spectra(struct file_content * pfc,
   int i;
   double z_max=0.;
   int bin;
+  short free_as_you_go = _FALSE_;
 
   /** 1) Maximum l for CLs */
   /* Read */
@@ -4762,6 +5153,11 @@ int input_read_parameters_spectra(struct file_content * pfc,
                    phr->non_diag,ppt->selection_num-1);
     }
 
+    /* Read */
+    if (ppt->has_cl_number_count == _TRUE_) {
+      class_read_flag("number_count_components",ptr->has_nc_components);
+    }
+
     /** 2.b) Selection function */
     /* Read */
     class_call(parser_read_string(pfc,"dNdz_selection",&string1,&flag1,errmsg),
@@ -4841,6 +5237,29 @@ int input_read_parameters_spectra(struct file_content * pfc,
       ppm->has_k_max_for_primordial_pk = _TRUE_;
     }
 
+    /** 3.a.2) Maximum k up to which perturbations are integrated for P(k) */
+    /* Read */
+    class_call(parser_read_double(pfc,"P_k_max_solved_h/Mpc",&param1,&flag1,errmsg),
+               errmsg,
+               errmsg);
+    class_call(parser_read_double(pfc,"P_k_max_solved_1/Mpc",&param2,&flag2,errmsg),
+               errmsg,
+               errmsg);
+    /* Test */
+    class_test((flag1 == _TRUE_) && (flag2 == _TRUE_),
+               errmsg,
+               "You can only enter one of 'P_k_max_solved_h/Mpc' or 'P_k_max_solved_1/Mpc'.");
+    /* Complete set of parameters */
+    if (flag1 == _TRUE_){
+      ppt->k_max_for_pk_solved = param1*pba->h;
+    }
+    if (flag2 == _TRUE_){
+      ppt->k_max_for_pk_solved = param2;
+    }
+    class_test(ppt->k_max_for_pk_solved < 0.,
+               errmsg,
+               "'P_k_max_solved' must be positive, you entered %e 1/Mpc",ppt->k_max_for_pk_solved);
+
     /** 3.b) Redshift values */
     /* Read */
     class_call(parser_read_list_of_doubles(pfc,"z_pk",&int1,&pointer1,&flag1,errmsg),
@@ -4906,6 +5325,41 @@ int input_read_parameters_spectra(struct file_content * pfc,
     }
   }
 
+  /** 4) Redshift at which the perturbations of each wavenumber are checkpointed */
+  /* Read */
+  class_read_double("perturbations_checkpoint_z",ppt->checkpoint_z);
+
+  /** 5) Redshift separating early and late contributions to the line-of-sight integrals */
+  /* Read */
+  class_read_double("transfer_split_z",ptr->split_z);
+
+  /** 6) Free-as-you-go lifecycle: intermediate tables are released as
+      soon as the modules reading them are done, unless the query
+      functions using them are listed in 'queries' */
+  /* Read */
+  class_read_flag("free_as_you_go",free_as_you_go);
+  /* Complete set of parameters */
+  if (free_as_you_go == _TRUE_) {
+    ppt->release_sources = _TRUE_;
+    ptr->release_transfer = _TRUE_;
+    class_call(parser_read_string(pfc,"queries",&string1,&flag1,errmsg),
+               errmsg,
+               errmsg);
+    if (flag1 == _TRUE_) {
+      if (strstr(string1,"sources") != NULL) {
+        ppt->release_sources = _FALSE_;
+      }
+      if (strstr(string1,"transfer") != NULL) {
+        ptr->release_transfer = _FALSE_;
+      }
+    }
+    /* the sources are also read by the output module (for the Fourier
+       transfer functions) and by runs restarting from a checkpoint */
+    if ((ppt->has_density_transfers == _TRUE_) || (ppt->has_velocity_transfers == _TRUE_) || (ppt->checkpoint_z > 0.)) {
+      ppt->release_sources = _FALSE_;
+    }
+  }
+
   return _SUCCESS_;
 
 }
@@ -5643,6 +6097,7 @@ int input_default_params(struct background *pba,
   pth->reionization_width=0.5;
   pth->helium_fullreio_redshift=3.5;
   pth->helium_fullreio_width=0.5;
+  pth->recombination_from = NULL;
 
   /** 8.b) 'reio_bins_tanh' case */
   pth->binned_reio_num=0;
@@ -5858,6 +6313,7 @@ int input_default_params(struct background *pba,
   pfo->extrapolation_method = extrap_max_scaled;
   pfo->feedback = nl_emu_dmonly;
   pfo->z_infinity = 10.;
+  pfo->hmcode_fast_feedback = _FALSE_;
 
   /**
    * Default to input_read_parameters_primordial
@@ -5981,6 +6437,7 @@ int input_default_params(struct background *pba,
   ptr->selection_bias[0]=1.;
   ptr->selection_magnification_bias[0]=0.;
   phr->non_diag=0;
+  ptr->has_nc_components = _FALSE_;
   /** 2.b) Selection function */
   ptr->has_nz_analytic = _FALSE_;
   ptr->has_nz_file = _FALSE_;
@@ -5993,11 +6450,22 @@ int input_default_params(struct background *pba,
   ppt->k_max_for_pk=1.;
   /** 3.a) Maximum k in P(k) primordial */
   ppm->has_k_max_for_primordial_pk = _FALSE_;
+  /** 3.a) Maximum k in P(k) integrated by the perturbations (none: no analytic tail) */
+  ppt->k_max_for_pk_solved = 0.;
   /** 3.b) Redshift values */
   pop->z_pk_num = 1;
   pop->z_pk[0] = 0.;
   /** 3.c) Maximum redshift */
   ppt->z_max_pk=0.;
+  /** 4) Checkpoint of perturbations */
+  ppt->checkpoint_z = -1.;
+  ppt->checkpoint_from = NULL;
+  /** 5) Early and late contributions to the line-of-sight integrals */
+  ptr->split_z = -1.;
+  ptr->early_from = NULL;
+  /** 6) Free-as-you-go lifecycle */
+  ppt->release_sources = _FALSE_;
+  ptr->release_transfer = _FALSE_;
 
   /**
    * Default to input_read_parameters_lensing
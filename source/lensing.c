@@ -196,6 +196,16 @@ int lensing_init(
     /* Integrate correlation function difference on [0,pi/16] */
     num_mu = (ple->l_unlensed_max * 2 )/16;
   }
+
+  /** - choose the number of threads of all loops over angles from the amount of work */
+
+  ple->number_of_threads = class_number_of_threads(num_mu,
+                                                   ple->l_unlensed_max*_LENSING_COST_,
+                                                   ppr->thread_overhead,
+                                                   ppr->threads_lensing);
+
+  if (ple->lensing_verbose > 1)
+    printf(" -> using %d thread(s) for %d angles\n",ple->number_of_threads,num_mu);
   /** - allocate array of \f$ \mu \f$ values, as well as quadrature weights */
 
   class_alloc(mu,
@@ -342,19 +352,19 @@ int lensing_init(
   icount += ple->l_unlensed_max+1;
 
   //debut = omp_get_wtime();
-  class_call(lensing_d00(mu,num_mu,ple->l_unlensed_max,d00),
+  class_call(lensing_d00(mu,num_mu,ple->l_unlensed_max,d00,ple->number_of_threads),
              ple->error_message,
              ple->error_message);
 
-  class_call(lensing_d11(mu,num_mu,ple->l_unlensed_max,d11),
+  class_call(lensing_d11(mu,num_mu,ple->l_unlensed_max,d11,ple->number_of_threads),
              ple->error_message,
              ple->error_message);
 
-  class_call(lensing_d1m1(mu,num_mu,ple->l_unlensed_max,d1m1),
+  class_call(lensing_d1m1(mu,num_mu,ple->l_unlensed_max,d1m1,ple->number_of_threads),
              ple->error_message,
              ple->error_message);
 
-  class_call(lensing_d2m2(mu,num_mu,ple->l_unlensed_max,d2m2),
+  class_call(lensing_d2m2(mu,num_mu,ple->l_unlensed_max,d2m2,ple->number_of_threads),
              ple->error_message,
              ple->error_message);
   //fin = omp_get_wtime();
@@ -364,15 +374,15 @@ int lensing_init(
 
   if (ple->has_te==_TRUE_) {
 
-    class_call(lensing_d20(mu,num_mu,ple->l_unlensed_max,d20),
+    class_call(lensing_d20(mu,num_mu,ple->l_unlensed_max,d20,ple->number_of_threads),
                ple->error_message,
                ple->error_message);
 
-    class_call(lensing_d3m1(mu,num_mu,ple->l_unlensed_max,d3m1),
+    class_call(lensing_d3m1(mu,num_mu,ple->l_unlensed_max,d3m1,ple->number_of_threads),
                ple->error_message,
                ple->error_message);
 
-    class_call(lensing_d4m2(mu,num_mu,ple->l_unlensed_max,d4m2),
+    class_call(lensing_d4m2(mu,num_mu,ple->l_unlensed_max,d4m2,ple->number_of_threads),
                ple->error_message,
                ple->error_message);
 
@@ -380,23 +390,23 @@ int lensing_init(
 
   if (ple->has_ee==_TRUE_ || ple->has_bb==_TRUE_) {
 
-    class_call(lensing_d22(mu,num_mu,ple->l_unlensed_max,d22),
+    class_call(lensing_d22(mu,num_mu,ple->l_unlensed_max,d22,ple->number_of_threads),
                ple->error_message,
                ple->error_message);
 
-    class_call(lensing_d31(mu,num_mu,ple->l_unlensed_max,d31),
+    class_call(lensing_d31(mu,num_mu,ple->l_unlensed_max,d31,ple->number_of_threads),
                ple->error_message,
                ple->error_message);
 
-    class_call(lensing_d3m3(mu,num_mu,ple->l_unlensed_max,d3m3),
+    class_call(lensing_d3m3(mu,num_mu,ple->l_unlensed_max,d3m3,ple->number_of_threads),
                ple->error_message,
                ple->error_message);
 
-    class_call(lensing_d40(mu,num_mu,ple->l_unlensed_max,d40),
+    class_call(lensing_d40(mu,num_mu,ple->l_unlensed_max,d40,ple->number_of_threads),
                ple->error_message,
                ple->error_message);
 
-    class_call(lensing_d4m4(mu,num_mu,ple->l_unlensed_max,d4m4),
+    class_call(lensing_d4m4(mu,num_mu,ple->l_unlensed_max,d4m4,ple->number_of_threads),
                ple->error_message,
                ple->error_message);
   }
@@ -498,7 +508,8 @@ int lensing_init(
   //debut = omp_get_wtime();
 #pragma omp parallel for                        \
   private (index_mu,l)                          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(ple->number_of_threads)
   for (index_mu=0; index_mu<num_mu; index_mu++) {
 
     Cgl[index_mu]=0;
@@ -577,7 +588,8 @@ int lensing_init(
 #pragma omp parallel for                                                \
   private (index_mu,l,ll,res,resX,resp,resm,lens,lensp,lensm,           \
            fac,fac1,X_000,X_p000,X_220,X_022,X_p022,X_121,X_132,X_242)	\
-  schedule (static)
+  schedule (static)                                                    \
+  num_threads(ple->number_of_threads)
 
   for (index_mu=0;index_mu<num_mu-1;index_mu++) {
 
@@ -1058,7 +1070,8 @@ int lensing_lensed_cl_tt(
   /** Integration by Gauss-Legendre quadrature. **/
 #pragma omp parallel for                        \
   private (imu,index_l,cle)                     \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(ple->number_of_threads)
 
   for (index_l=0; index_l<ple->l_size; index_l++){
     cle=0;
@@ -1121,7 +1134,8 @@ int lensing_lensed_cl_te(
   /** Integration by Gauss-Legendre quadrature. **/
 #pragma omp parallel for                        \
   private (imu,index_l,clte)                    \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(ple->number_of_threads)
 
   for (index_l=0; index_l < ple->l_size; index_l++){
     clte=0;
@@ -1188,7 +1202,8 @@ int lensing_lensed_cl_ee_bb(
   /** Integration by Gauss-Legendre quadrature. **/
 #pragma omp parallel for                        \
   private (imu,index_l,clp,clm)                 \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(ple->number_of_threads)
 
   for (index_l=0; index_l < ple->l_size; index_l++){
     clp=0; clm=0;
@@ -1237,6 +1252,7 @@ int lensing_addback_cl_ee_bb(
  * @param num_mu Input: Number of cos(beta) values
  * @param lmax   Input: maximum multipole
  * @param d00    Input/output: Result is stored here
+ * @param number_of_threads Input: number of threads of the loop over angles
  *
  * Wigner d-functions, computed by recurrence
  * actual recurrence on \f$ \sqrt{(2l+1)/2} d^l_{mm'} \f$ for stability
@@ -1247,7 +1263,8 @@ int lensing_d00(
                 double * mu,
                 int num_mu,
                 int lmax,
-                double ** d00
+                double ** d00,
+                int number_of_threads
                 ) {
   double ll, dlm1, dl, dlp1;
   int index_mu, l;
@@ -1266,7 +1283,8 @@ int lensing_d00(
 
 #pragma omp parallel for                        \
   private (index_mu,dlm1,dl,dlp1,l,ll)          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(number_of_threads)
 
   for (index_mu=0;index_mu<num_mu;index_mu++) {
     dlm1=1.0/sqrt(2.); /* l=0 */
@@ -1294,6 +1312,7 @@ int lensing_d00(
  * @param num_mu Input: Number of cos(beta) values
  * @param lmax   Input: maximum multipole
  * @param d11    Input/output: Result is stored here
+ * @param number_of_threads Input: number of threads of the loop over angles
  *
  * Wigner d-functions, computed by recurrence
  * actual recurrence on \f$ \sqrt{(2l+1)/2} d^l_{mm'} \f$ for stability
@@ -1304,7 +1323,8 @@ int lensing_d11(
                 double * mu,
                 int num_mu,
                 int lmax,
-                double ** d11
+                double ** d11,
+                int number_of_threads
                 ) {
   double ll, dlm1, dl, dlp1;
   int index_mu, l;
@@ -1323,7 +1343,8 @@ int lensing_d11(
   }
 #pragma omp parallel for                        \
   private (index_mu,dlm1,dl,dlp1,l,ll)          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(number_of_threads)
 
   for (index_mu=0;index_mu<num_mu;index_mu++) {
     d11[index_mu][0]=0;
@@ -1351,6 +1372,7 @@ int lensing_d11(
  * @param num_mu Input: Number of cos(beta) values
  * @param lmax   Input: maximum multipole
  * @param d1m1    Input/output: Result is stored here
+ * @param number_of_threads Input: number of threads of the loop over angles
  *
  * Wigner d-functions, computed by recurrence
  * actual recurrence on \f$ \sqrt{(2l+1)/2} d^l_{mm'} \f$ for stability
@@ -1361,7 +1383,8 @@ int lensing_d1m1(
                  double * mu,
                  int num_mu,
                  int lmax,
-                 double ** d1m1
+                 double ** d1m1,
+                 int number_of_threads
                  ) {
   double ll, dlm1, dl, dlp1;
   int index_mu, l;
@@ -1380,7 +1403,8 @@ int lensing_d1m1(
   }
 #pragma omp parallel for                        \
   private (index_mu,dlm1,dl,dlp1,l,ll)          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(number_of_threads)
 
   for (index_mu=0;index_mu<num_mu;index_mu++) {
     d1m1[index_mu][0]=0;
@@ -1408,6 +1432,7 @@ int lensing_d1m1(
  * @param num_mu Input: Number of cos(beta) values
  * @param lmax   Input: maximum multipole
  * @param d2m2   Input/output: Result is stored here
+ * @param number_of_threads Input: number of threads of the loop over angles
  *
  * Wigner d-functions, computed by recurrence
  * actual recurrence on \f$ \sqrt{(2l+1)/2} d^l_{mm'} \f$ for stability
@@ -1418,7 +1443,8 @@ int lensing_d2m2(
                  double * mu,
                  int num_mu,
                  int lmax,
-                 double ** d2m2
+                 double ** d2m2,
+                 int number_of_threads
                  ) {
   double ll, dlm1, dl, dlp1;
   int index_mu, l;
@@ -1437,7 +1463,8 @@ int lensing_d2m2(
   }
 #pragma omp parallel for                        \
   private (index_mu,dlm1,dl,dlp1,l,ll)          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(number_of_threads)
 
   for (index_mu=0;index_mu<num_mu;index_mu++) {
     d2m2[index_mu][0]=0;
@@ -1465,6 +1492,7 @@ int lensing_d2m2(
  * @param num_mu Input: Number of cos(beta) values
  * @param lmax   Input: maximum multipole
  * @param d22    Input/output: Result is stored here
+ * @param number_of_threads Input: number of threads of the loop over angles
  *
  * Wigner d-functions, computed by recurrence
  * actual recurrence on \f$ \sqrt{(2l+1)/2} d^l_{mm'} \f$ for stability
@@ -1475,7 +1503,8 @@ int lensing_d22(
                 double * mu,
                 int num_mu,
                 int lmax,
-                double ** d22
+                double ** d22,
+                int number_of_threads
                 ) {
   double ll, dlm1, dl, dlp1;
   int index_mu, l;
@@ -1494,7 +1523,8 @@ int lensing_d22(
   }
 #pragma omp parallel for                        \
   private (index_mu,dlm1,dl,dlp1,l,ll)          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(number_of_threads)
 
   for (index_mu=0;index_mu<num_mu;index_mu++) {
     d22[index_mu][0]=0;
@@ -1522,6 +1552,7 @@ int lensing_d22(
  * @param num_mu Input: Number of cos(beta) values
  * @param lmax   Input: maximum multipole
  * @param d20    Input/output: Result is stored here
+ * @param number_of_threads Input: number of threads of the loop over angles
  *
  * Wigner d-functions, computed by recurrence
  * actual recurrence on \f$ \sqrt{(2l+1)/2} d^l_{mm'} \f$ for stability
@@ -1532,7 +1563,8 @@ int lensing_d20(
                 double * mu,
                 int num_mu,
                 int lmax,
-                double ** d20
+                double ** d20,
+                int number_of_threads
                 ) {
   double ll, dlm1, dl, dlp1;
   int index_mu, l;
@@ -1549,7 +1581,8 @@ int lensing_d20(
   }
 #pragma omp parallel for                        \
   private (index_mu,dlm1,dl,dlp1,l,ll)          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(number_of_threads)
 
   for (index_mu=0;index_mu<num_mu;index_mu++) {
     d20[index_mu][0]=0;
@@ -1577,6 +1610,7 @@ int lensing_d20(
  * @param num_mu Input: Number of cos(beta) values
  * @param lmax   Input: maximum multipole
  * @param d31    Input/output: Result is stored here
+ * @param number_of_threads Input: number of threads of the loop over angles
  *
  * Wigner d-functions, computed by recurrence
  * actual recurrence on \f$ \sqrt{(2l+1)/2} d^l_{mm'} \f$ for stability
@@ -1587,7 +1621,8 @@ int lensing_d31(
                 double * mu,
                 int num_mu,
                 int lmax,
-                double ** d31
+                double ** d31,
+                int number_of_threads
                 ) {
   double ll, dlm1, dl, dlp1;
   int index_mu, l;
@@ -1606,7 +1641,8 @@ int lensing_d31(
   }
 #pragma omp parallel for                        \
   private (index_mu,dlm1,dl,dlp1,l,ll)          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(number_of_threads)
 
   for (index_mu=0;index_mu<num_mu;index_mu++) {
     d31[index_mu][0]=0;
@@ -1635,6 +1671,7 @@ int lensing_d31(
  * @param num_mu Input: Number of cos(beta) values
  * @param lmax   Input: maximum multipole
  * @param d3m1   Input/output: Result is stored here
+ * @param number_of_threads Input: number of threads of the loop over angles
  *
  * Wigner d-functions, computed by recurrence
  * actual recurrence on \f$ \sqrt{(2l+1)/2} d^l_{mm'} \f$ for stability
@@ -1645,7 +1682,8 @@ int lensing_d3m1(
                  double * mu,
                  int num_mu,
                  int lmax,
-                 double ** d3m1
+                 double ** d3m1,
+                 int number_of_threads
                  ) {
   double ll, dlm1, dl, dlp1;
   int index_mu, l;
@@ -1664,7 +1702,8 @@ int lensing_d3m1(
   }
 #pragma omp parallel for                        \
   private (index_mu,dlm1,dl,dlp1,l,ll)          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(number_of_threads)
 
   for (index_mu=0;index_mu<num_mu;index_mu++) {
     d3m1[index_mu][0]=0;
@@ -1693,6 +1732,7 @@ int lensing_d3m1(
  * @param num_mu Input: Number of cos(beta) values
  * @param lmax   Input: maximum multipole
  * @param d3m3   Input/output: Result is stored here
+ * @param number_of_threads Input: number of threads of the loop over angles
  *
  * Wigner d-functions, computed by recurrence
  * actual recurrence on \f$ \sqrt{(2l+1)/2} d^l_{mm'} \f$ for stability
@@ -1703,7 +1743,8 @@ int lensing_d3m3(
                  double * mu,
                  int num_mu,
                  int lmax,
-                 double ** d3m3
+                 double ** d3m3,
+                 int number_of_threads
                  ) {
   double ll, dlm1, dl, dlp1;
   int index_mu, l;
@@ -1722,7 +1763,8 @@ int lensing_d3m3(
   }
 #pragma omp parallel for                        \
   private (index_mu,dlm1,dl,dlp1,l,ll)          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(number_of_threads)
 
   for (index_mu=0;index_mu<num_mu;index_mu++) {
     d3m3[index_mu][0]=0;
@@ -1751,6 +1793,7 @@ int lensing_d3m3(
  * @param num_mu Input: Number of cos(beta) values
  * @param lmax   Input: maximum multipole
  * @param d40    Input/output: Result is stored here
+ * @param number_of_threads Input: number of threads of the loop over angles
  *
  * Wigner d-functions, computed by recurrence
  * actual recurrence on \f$ \sqrt{(2l+1)/2} d^l_{mm'} \f$ for stability
@@ -1761,7 +1804,8 @@ int lensing_d40(
                 double * mu,
                 int num_mu,
                 int lmax,
-                double ** d40
+                double ** d40,
+                int number_of_threads
                 ) {
   double ll, dlm1, dl, dlp1;
   int index_mu, l;
@@ -1778,7 +1822,8 @@ int lensing_d40(
   }
 #pragma omp parallel for                        \
   private (index_mu,dlm1,dl,dlp1,l,ll)          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(number_of_threads)
 
   for (index_mu=0;index_mu<num_mu;index_mu++) {
     d40[index_mu][0]=0;
@@ -1808,6 +1853,7 @@ int lensing_d40(
  * @param num_mu Input: Number of cos(beta) values
  * @param lmax   Input: maximum multipole
  * @param d4m2   Input/output: Result is stored here
+ * @param number_of_threads Input: number of threads of the loop over angles
  *
  * Wigner d-functions, computed by recurrence
  * actual recurrence on \f$ \sqrt{(2l+1)/2} d^l_{mm'} \f$ for stability
@@ -1818,7 +1864,8 @@ int lensing_d4m2(
                  double * mu,
                  int num_mu,
                  int lmax,
-                 double ** d4m2
+                 double ** d4m2,
+                 int number_of_threads
                  ) {
   double ll, dlm1, dl, dlp1;
   int index_mu, l;
@@ -1837,7 +1884,8 @@ int lensing_d4m2(
   }
 #pragma omp parallel for                        \
   private (index_mu,dlm1,dl,dlp1,l,ll)          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(number_of_threads)
 
   for (index_mu=0;index_mu<num_mu;index_mu++) {
     d4m2[index_mu][0]=0;
@@ -1867,6 +1915,7 @@ int lensing_d4m2(
  * @param num_mu Input: Number of cos(beta) values
  * @param lmax   Input: maximum multipole
  * @param d4m4   Input/output: Result is stored here
+ * @param number_of_threads Input: number of threads of the loop over angles
  *
  * Wigner d-functions, computed by recurrence
  * actual recurrence on \f$ \sqrt{(2l+1)/2} d^l_{mm'} \f$ for stability
@@ -1877,7 +1926,8 @@ int lensing_d4m4(
                  double * mu,
                  int num_mu,
                  int lmax,
-                 double ** d4m4
+                 double ** d4m4,
+                 int number_of_threads
                  ) {
   double ll, dlm1, dl, dlp1;
   int index_mu, l;
@@ -1896,7 +1946,8 @@ int lensing_d4m4(
   }
 #pragma omp parallel for                        \
   private (index_mu,dlm1,dl,dlp1,l,ll)          \
-  schedule (static)
+  schedule (static)                             \
+  num_threads(number_of_threads)
 
   for (index_mu=0;index_mu<num_mu;index_mu++) {
     d4m4[index_mu][0]=0;
@@ -60,6 +60,10 @@ int perturbations_sources_at_tau(
 
   short do_spline = _FALSE_;
 
+  class_test(ppt->sources_released == _TRUE_,
+             ppt->error_message,
+             "source tables have already been released; add 'sources' to the input parameter 'queries' to keep them");
+
   logtau = log(tau);
 
   /** - If we have defined a z_max_pk > 0, then we have already an
@@ -228,6 +232,225 @@ int perturbations_sources_at_k_and_z(
   return _SUCCESS_;
 }
 
+/**
+ * Source functions \f$ S^{X} (k, \tau) \f$ of several types at a list
+ * of redshifts, in a single sweep through the source table.
+ *
+ * For each redshift, the conformal time and the interpolation
+ * coefficients in the time direction are computed only once, and then
+ * applied to all requested types and to all wavenumbers (the loop
+ * over wavenumbers is parallelized). The interpolation is the same
+ * as in perturbations_sources_at_tau(): spline within the table of
+ * late sources (z < z_max_pk), linear elsewhere, and exact reading of
+ * the last time for z=0.
+ *
+ * @param pba        Input: pointer to background structure
+ * @param ppt        Input: pointer to perturbation structure containing interpolation tables
+ * @param index_md   Input: index of requested mode (for scalars, just pass ppt->index_md_scalars)
+ * @param index_ic   Input: index of requested initial condition (for adiabatic, just pass ppt->index_ic_ad)
+ * @param tp_num     Input: number of requested source function types
+ * @param index_tp   Input: list of requested types, index_tp[index_tp_list] (if NULL, all ppt->tp_size[index_md] types in their natural order)
+ * @param z_size     Input: number of redshifts
+ * @param z          Input: list of redshifts (in any order)
+ * @param psources   Output: array (already allocated) of source functions, psources[(index_tp_list * z_size + index_z) * ppt->k_size[index_md] + index_k]
+ * @return the error status
+ */
+
+int perturbations_sources_at_z_list(
+                                    struct background * pba,
+                                    struct perturbations * ppt,
+                                    int index_md,
+                                    int index_ic,
+                                    int tp_num,
+                                    int * index_tp,
+                                    int z_size,
+                                    double * z,
+                                    double * psources
+                                    ) {
+
+  /** Summary: */
+
+  /** - define local variables */
+
+  int k_size;
+  int index_z, index_tp_list, tp, index_k, index_k_block, k_block_size, index_k_max;
+  int inf, sup, mid;
+  double tau, logtau, weight;
+  double * source_inf, * source_sup, * ddsource_inf, * ddsource_sup;
+  double * result;
+  int number_of_threads;
+
+  /* for each redshift: interpolation scheme (0: last time, 1: linear, 2: spline), lower index in the relevant table, and coefficients */
+  short * scheme;
+  int * index_inf;
+  double * a, * b, * h;
+
+  class_test(ppt->sources_released == _TRUE_,
+             ppt->error_message,
+             "source tables have already been released; add 'sources' to the input parameter 'queries' to keep them");
+
+  class_test((index_md < 0) || (index_md >= ppt->md_size) || (index_ic < 0) || (index_ic >= ppt->ic_size[index_md]),
+             ppt->error_message,
+             "mode or initial condition index out of range");
+
+  if (index_tp == NULL) {
+    class_test(tp_num != ppt->tp_size[index_md],
+               ppt->error_message,
+               "when no list of types is passed, tp_num=%d should be equal to the number of types %d",
+               tp_num,ppt->tp_size[index_md]);
+  }
+  else {
+    for (index_tp_list=0; index_tp_list<tp_num; index_tp_list++) {
+      class_test((index_tp[index_tp_list] < 0) || (index_tp[index_tp_list] >= ppt->tp_size[index_md]),
+                 ppt->error_message,
+                 "source type index %d out of range",
+                 index_tp[index_tp_list]);
+    }
+  }
+
+  if ((tp_num == 0) || (z_size == 0))
+    return _SUCCESS_;
+
+  k_size = ppt->k_size[index_md];
+
+  class_alloc(scheme,z_size*sizeof(short),ppt->error_message);
+  class_alloc(index_inf,z_size*sizeof(int),ppt->error_message);
+  class_alloc(a,z_size*sizeof(double),ppt->error_message);
+  class_alloc(b,z_size*sizeof(double),ppt->error_message);
+  class_alloc(h,z_size*sizeof(double),ppt->error_message);
+
+  /** - for each redshift, find the position in the table of times and the interpolation coefficients */
+
+  for (index_z=0; index_z<z_size; index_z++) {
+
+    class_test_except(z[index_z] < 0.,
+                      ppt->error_message,
+                      free(scheme);free(index_inf);free(a);free(b);free(h),
+                      "negative redshift z=%e",z[index_z]);
+
+    if (z[index_z] == 0.) {
+      scheme[index_z] = 0;
+      index_inf[index_z] = ppt->tau_size-1;
+      continue;
+    }
+
+    class_call_except(background_tau_of_z(pba,
+                                          z[index_z],
+                                          &tau),
+                      pba->error_message,
+                      ppt->error_message,
+                      free(scheme);free(index_inf);free(a);free(b);free(h));
+
+    logtau = log(tau);
+
+    if ((ppt->ln_tau_size > 1) && (logtau >= ppt->ln_tau[0])) {
+
+      class_test_except(logtau > ppt->ln_tau[ppt->ln_tau_size-1],
+                        ppt->error_message,
+                        free(scheme);free(index_inf);free(a);free(b);free(h),
+                        "z=%e outside of the table of sources",z[index_z]);
+
+      inf = 0;
+      sup = ppt->ln_tau_size-1;
+      while (sup-inf > 1) {
+        mid = (int)(0.5*(inf+sup));
+        if (logtau < ppt->ln_tau[mid]) {sup=mid;}
+        else {inf=mid;}
+      }
+
+      scheme[index_z] = 2;
+      index_inf[index_z] = inf;
+      h[index_z] = ppt->ln_tau[sup]-ppt->ln_tau[inf];
+      b[index_z] = (logtau-ppt->ln_tau[inf])/h[index_z];
+      a[index_z] = 1.-b[index_z];
+    }
+    else {
+
+      class_test_except((tau < ppt->tau_sampling[0]) || (tau > ppt->tau_sampling[ppt->tau_size-1]),
+                        ppt->error_message,
+                        free(scheme);free(index_inf);free(a);free(b);free(h),
+                        "z=%e outside of the table of sources",z[index_z]);
+
+      inf = 0;
+      sup = ppt->tau_size-1;
+      while (sup-inf > 1) {
+        mid = (int)(0.5*(inf+sup));
+        if (tau < ppt->tau_sampling[mid]) {sup=mid;}
+        else {inf=mid;}
+      }
+
+      weight = (tau-ppt->tau_sampling[inf])/(ppt->tau_sampling[sup]-ppt->tau_sampling[inf]);
+
+      scheme[index_z] = 1;
+      index_inf[index_z] = inf;
+      a[index_z] = 1.-weight;
+      b[index_z] = weight;
+    }
+  }
+
+  /** - interpolate all types at all redshifts, by blocks of consecutive wavenumbers */
+
+  k_block_size = _SOURCES_K_BLOCK_;
+
+  number_of_threads = class_number_of_threads((k_size+k_block_size-1)/k_block_size,
+                                              (double)k_block_size*tp_num*z_size*_SOURCES_AT_Z_COST_,
+                                              _THREAD_OVERHEAD_,
+                                              0);
+
+#pragma omp parallel for                                                \
+  private(index_k_block,index_k_max,index_z,index_tp_list,tp,index_k,inf,source_inf,source_sup,ddsource_inf,ddsource_sup,result) \
+  schedule(static)                                                      \
+  num_threads(number_of_threads)
+
+  for (index_k_block=0; index_k_block<k_size; index_k_block+=k_block_size) {
+
+    index_k_max = MIN(index_k_block+k_block_size,k_size);
+
+    for (index_tp_list=0; index_tp_list<tp_num; index_tp_list++) {
+
+      tp = (index_tp == NULL) ? index_tp_list : index_tp[index_tp_list];
+
+      for (index_z=0; index_z<z_size; index_z++) {
+
+        inf = index_inf[index_z];
+        result = psources+(index_tp_list*z_size+index_z)*k_size;
+
+        if (scheme[index_z] == 0) {
+          source_inf = ppt->sources[index_md][index_ic*ppt->tp_size[index_md]+tp]+inf*k_size;
+          for (index_k=index_k_block; index_k<index_k_max; index_k++)
+            result[index_k] = source_inf[index_k];
+        }
+        else if (scheme[index_z] == 1) {
+          source_inf = ppt->sources[index_md][index_ic*ppt->tp_size[index_md]+tp]+inf*k_size;
+          source_sup = source_inf+k_size;
+          for (index_k=index_k_block; index_k<index_k_max; index_k++)
+            result[index_k] = source_inf[index_k]*a[index_z] + b[index_z]*source_sup[index_k];
+        }
+        else {
+          source_inf = ppt->late_sources[index_md][index_ic*ppt->tp_size[index_md]+tp]+inf*k_size;
+          source_sup = source_inf+k_size;
+          ddsource_inf = ppt->ddlate_sources[index_md][index_ic*ppt->tp_size[index_md]+tp]+inf*k_size;
+          ddsource_sup = ddsource_inf+k_size;
+          for (index_k=index_k_block; index_k<index_k_max; index_k++)
+            result[index_k] =
+              a[index_z]*source_inf[index_k] +
+              b[index_z]*source_sup[index_k] +
+              ((a[index_z]*a[index_z]*a[index_z]-a[index_z])*ddsource_inf[index_k] +
+               (b[index_z]*b[index_z]*b[index_z]-b[index_z])*ddsource_sup[index_k])*h[index_z]*h[index_z]/6.;
+        }
+      }
+    }
+  }
+
+  free(scheme);
+  free(index_inf);
+  free(a);
+  free(b);
+  free(h);
+
+  return _SUCCESS_;
+}
+
 /**
  * Function called by the output module or the wrappers, which returns
  * the source functions \f$ S^{X} (k, \tau) \f$ corresponding to
@@ -252,9 +475,41 @@ int perturbations_output_data_at_z(
                                    double *data
                                    ) {
 
+  class_call(perturbations_output_data_at_z_list(pba,ppt,output_format,1,&z,number_of_titles,data),
+             ppt->error_message,
+             ppt->error_message);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Same as perturbations_output_data_at_z(), but for a list of
+ * redshifts. All sources are interpolated at all redshifts in a
+ * single call to perturbations_sources_at_z_list().
+ *
+ * @param pba              Input: pointer to background structure
+ * @param ppt              Input: pointer to perturbation structure
+ * @param output_format    Input: choice of ordering and normalisation for the output quantities
+ * @param z_size           Input: number of redshifts
+ * @param z                Input: list of redshifts
+ * @param number_of_titles Input: number of requested source functions (found in perturbations_output_titles)
+ * @param data             Output: vector of all source functions for all redshifts, k values and initial conditions (previously allocated with the right size), data[((index_z * ppt->ic_size[index_md] + index_ic) * ppt->k_size[index_md] + index_k) * number_of_titles + index_title]
+ * @return the error status
+ */
+
+int perturbations_output_data_at_z_list(
+                                        struct background * pba,
+                                        struct perturbations * ppt,
+                                        enum file_format output_format,
+                                        int z_size,
+                                        double * z,
+                                        int number_of_titles,
+                                        double *data
+                                        ) {
+
   double * tkfull=NULL;  /* array with argument tkfull[(index_k * ppt->ic_size[index_md] + index_ic) * ppt->tp_size[index_md] + index_tp] */
 
-  double * pvecsources;
+  double * sources_at_z=NULL; /* array with argument sources_at_z[((index_ic * ppt->tp_size[index_md] + index_tp) * z_size + index_z) * ppt->k_size[index_md] + index_k] */
 
   double tau;
 
@@ -262,82 +517,86 @@ int perturbations_output_data_at_z(
   int index_ic;
   int index_k;
   int index_tp;
+  int index_z;
+  int k_size = ppt->k_size[index_md];
+  int ic_size = ppt->ic_size[index_md];
+  int tp_size = ppt->tp_size[index_md];
 
-  /** - allocate tkfull */
-
-  if (ppt->k_size[index_md]*ppt->ic_size[index_md]*ppt->tp_size[index_md] > 0) {
-    class_alloc(tkfull,
-                ppt->k_size[index_md]*ppt->ic_size[index_md]*ppt->tp_size[index_md]*sizeof(double),
-                ppt->error_message);
-  }
-
-  /** - compute \f$T_i(k)\f$ for each k (if several ic's, compute it
-        for each ic; if z_pk = 0, this is done by directly reading
-        inside the pre-computed table; if not, this is done by
-        interpolating the table at the correct value of tau. */
+  class_test(ppt->sources_released == _TRUE_,
+             ppt->error_message,
+             "source tables have already been released; add 'sources' to the input parameter 'queries' to keep them");
 
-  /* if z_pk = 0, no interpolation needed */
+  /** - check that all redshifts are within the table of late sources (or equal to zero) */
 
-  if (z == 0.) {
+  for (index_z=0; index_z<z_size; index_z++) {
+    if (z[index_z] != 0.) {
+      class_call(background_tau_of_z(pba,
+                                     z[index_z],
+                                     &tau),
+                 pba->error_message,
+                 ppt->error_message);
 
-    for (index_k=0; index_k<ppt->k_size[index_md]; index_k++) {
-      for (index_tp=0; index_tp<ppt->tp_size[index_md]; index_tp++) {
-        for (index_ic=0; index_ic<ppt->ic_size[index_md]; index_ic++) {
-          tkfull[(index_k * ppt->ic_size[index_md] + index_ic) * ppt->tp_size[index_md] + index_tp]
-            = ppt->sources[index_md][index_ic * ppt->tp_size[index_md] + index_tp][(ppt->tau_size-1) * ppt->k_size[index_md] + index_k];
-        }
-      }
+      class_test(log(tau) < ppt->ln_tau[0],
+                 ppt->error_message,
+                 "Asking sources at z=%e bigger than z_max_pk, something probably went wrong",
+                 z[index_z]);
     }
   }
 
-  /* if 0 <= z_pk <= z_max_pk, interpolation needed, */
-  else {
+  /** - compute \f$T_i(k)\f$ for each k, each ic and each z in one sweep
+      (if z = 0, this is done by directly reading inside the
+      pre-computed table; if not, this is done by interpolating the
+      table at the correct value of tau) */
 
-    /* check the time corresponding to the highest redshift requested in output plus one */
-    class_call(background_tau_of_z(pba,
-                                   z,
-                                   &tau),
-               pba->error_message,
-               ppt->error_message);
+  if (k_size*ic_size*tp_size > 0) {
+    class_alloc(tkfull,
+                k_size*ic_size*tp_size*sizeof(double),
+                ppt->error_message);
+    class_alloc(sources_at_z,
+                (size_t)ic_size*tp_size*z_size*k_size*sizeof(double),
+                ppt->error_message);
 
-    class_test(log(tau) < ppt->ln_tau[0],
-               "Asking sources at a z bigger than z_max_pk, something probably went wrong",
-               ppt->error_message);
+    for (index_ic=0; index_ic<ic_size; index_ic++) {
+      class_call(perturbations_sources_at_z_list(pba,
+                                                 ppt,
+                                                 index_md,
+                                                 index_ic,
+                                                 tp_size,
+                                                 NULL,
+                                                 z_size,
+                                                 z,
+                                                 sources_at_z+(size_t)index_ic*tp_size*z_size*k_size),
+                 ppt->error_message,
+                 ppt->error_message);
+    }
+  }
 
-    class_alloc(pvecsources,
-                ppt->k_size[index_md]*sizeof(double),
-                ppt->error_message);
+  /** - for each z, reorder and store data */
 
-    for (index_k=0; index_k<ppt->k_size[index_md]; index_k++) {
-      for (index_tp=0; index_tp<ppt->tp_size[index_md]; index_tp++) {
-        for (index_ic=0; index_ic<ppt->ic_size[index_md]; index_ic++) {
-          class_call(perturbations_sources_at_tau(ppt,
-                                                  index_md,
-                                                  index_ic,
-                                                  index_tp,
-                                                  tau,
-                                                  pvecsources),
-                     ppt->error_message,
-                     ppt->error_message);
+  for (index_z=0; index_z<z_size; index_z++) {
 
-          tkfull[(index_k * ppt->ic_size[index_md] + index_ic) * ppt->tp_size[index_md] + index_tp] =
-            pvecsources[index_k];
+    if (tkfull != NULL) {
+      for (index_k=0; index_k<k_size; index_k++) {
+        for (index_tp=0; index_tp<tp_size; index_tp++) {
+          for (index_ic=0; index_ic<ic_size; index_ic++) {
+            tkfull[(index_k * ic_size + index_ic) * tp_size + index_tp]
+              = sources_at_z[((size_t)(index_ic * tp_size + index_tp) * z_size + index_z) * k_size + index_k];
+          }
         }
       }
     }
-    free(pvecsources);
-  }
-
-  /** - store data */
 
-  class_call(perturbations_output_data(pba,ppt,output_format,tkfull,number_of_titles,data),
-             ppt->error_message,
-             ppt->error_message);
+    class_call(perturbations_output_data(pba,ppt,output_format,tkfull,number_of_titles,data+(size_t)index_z*ic_size*k_size*number_of_titles),
+               ppt->error_message,
+               ppt->error_message);
+  }
 
   /** - free tkfull */
   // condition necessary because the size could be zero (if ppt->tp_size is zero)
-  if (tkfull != NULL)
+  if (tkfull != NULL) {
     free(tkfull);
+    free(sources_at_z);
+  }
 
   return _SUCCESS_;
 }
@@ -377,6 +636,10 @@ int perturbations_output_data_at_index_tau(
              "index_tau outside of array range",
              ppt->error_message);
 
+  class_test(ppt->sources_released == _TRUE_,
+             ppt->error_message,
+             "source tables have already been released; add 'sources' to the input parameter 'queries' to keep them");
+
   /** - allocate and fill tkfull */
 
   if (ppt->k_size[index_md]*ppt->ic_size[index_md]*ppt->tp_size[index_md] > 0) {
@@ -714,6 +977,8 @@ int perturbations_init(
   int number_of_threads=1;
   /* index of the thread (always 0 if no openmp) */
   int thread=0;
+  /* largest number of wavenumbers among modes */
+  int k_size_max;
 
   /* This code can be optionally compiled with the openmp option for parallel computation.
      Inside parallel regions, the use of the command "return" is forbidden.
@@ -732,6 +997,8 @@ int perturbations_init(
 
   /** - perform preliminary checks */
 
+  ppt->sources_released = _FALSE_;
+
   if (ppt->has_perturbations == _FALSE_) {
     if (ppt->perturbations_verbose > 0)
       printf("No sources requested. Perturbation module skipped.\n");
@@ -827,6 +1094,16 @@ int perturbations_init(
     printf("Warning: the niv initial conditions in CLASS (and also in CAMB) should still be double-checked: if you want to do it and send feedback, you are welcome!\n");
   }
 
+#ifdef _PRECISION_PROFILE_
+  if (ppt->perturbations_verbose > 1) {
+    if ((ppr->l_max_g == _PROFILE_L_MAX_G_) && (ppr->l_max_pol_g == _PROFILE_L_MAX_POL_G_) &&
+        (ppr->l_max_ur == _PROFILE_L_MAX_UR_) && (ppr->l_max_ncdm == _PROFILE_L_MAX_NCDM_))
+      printf(" -> using hierarchy loops compiled for precision profile %s\n",_PROFILE_NAME_);
+    else
+      printf(" -> precision differs from compiled profile %s, using generic hierarchy loops where it disagrees\n",_PROFILE_NAME_);
+  }
+#endif
+
   if (ppt->has_tensors == _TRUE_) {
 
     ppt->evolve_tensor_ur = _FALSE_;
@@ -905,20 +1182,33 @@ int perturbations_init(
              ppt->error_message,
              ppt->error_message);
 
+  /** - if states must be checkpointed at checkpoint_z, prepare it, and check whether a previous checkpoint can be used */
+  class_call(perturbations_checkpoint_init(ppr,
+                                           pba,
+                                           pth,
+                                           ppt),
+             ppt->error_message,
+             ppt->error_message);
+
   /** - if we want to store perturbations for given k values, write titles and allocate storage */
   class_call(perturbations_prepare_k_output(pba,ppt),
              ppt->error_message,
              ppt->error_message);
 
-  /** - create an array of workspaces in multi-thread case */
+  /** - choose the number of threads from the number of wavenumbers,
+      and create an array of workspaces in multi-thread case */
 
-#ifdef _OPENMP
+  k_size_max = 0;
+  for (index_md = 0; index_md < ppt->md_size; index_md++)
+    k_size_max = MAX(k_size_max,ppt->k_size[index_md]);
 
-#pragma omp parallel
-  {
-    number_of_threads = omp_get_num_threads();
-  }
-#endif
+  number_of_threads = class_number_of_threads(k_size_max,
+                                              _PERTURBATIONS_COST_PER_K_,
+                                              ppr->thread_overhead,
+                                              ppr->threads_perturbations);
+
+  if (ppt->perturbations_verbose > 1)
+    printf(" -> using %d thread(s) for %d wavenumbers\n",number_of_threads,k_size_max);
 
   class_alloc(pppw,number_of_threads * sizeof(struct perturbations_workspace *),ppt->error_message);
 
@@ -963,6 +1253,12 @@ int perturbations_init(
 
     if (abort == _TRUE_) return _FAILURE_;
 
+    if (ppt->has_checkpoint == _TRUE_) {
+      class_call(perturbations_checkpoint_alloc(ppt,index_md,pppw[0]),
+                 ppt->error_message,
+                 ppt->error_message);
+    }
+
     /** - --> (c) loop over initial conditions and wavenumbers; for each of them, evolve perturbations and compute source functions with perturbations_solve() */
 
     for (index_ic = 0; index_ic < ppt->ic_size[index_md]; index_ic++) {
@@ -1168,6 +1464,9 @@ int perturbations_free(
 
     }
 
+    if (ppt->has_checkpoint == _TRUE_)
+      perturbations_checkpoint_free(ppt);
+
     free(ppt->tau_sampling);
     if (ppt->ln_tau_size > 1)
       free(ppt->ln_tau);
@@ -1209,6 +1508,55 @@ int perturbations_free(
 
 }
 
+/**
+ * Free the source tables as soon as no module needs them anymore.
+ *
+ * Called at the end of fourier_init() or transfer_init() (whichever
+ * is the last module reading the sources) when ppt->release_sources
+ * is set. The rest of the perturbations structure is kept until
+ * perturbations_free(), which then skips the released tables.
+ *
+ * @param ppt Input/Output: perturbation structure
+ * @return the error status
+ */
+
+int perturbations_release_sources(
+                                  struct perturbations * ppt
+                                  ) {
+
+  int index_md,index_ic,index_tp;
+  double size=0.;
+
+  if ((ppt->has_perturbations == _FALSE_) || (ppt->sources_released == _TRUE_))
+    return _SUCCESS_;
+
+  for (index_md = 0; index_md < ppt->md_size; index_md++) {
+    for (index_ic = 0; index_ic < ppt->ic_size[index_md]; index_ic++) {
+      for (index_tp = 0; index_tp < ppt->tp_size[index_md]; index_tp++) {
+
+        free(ppt->sources[index_md][index_ic*ppt->tp_size[index_md]+index_tp]);
+        ppt->sources[index_md][index_ic*ppt->tp_size[index_md]+index_tp] = NULL;
+        ppt->late_sources[index_md][index_ic*ppt->tp_size[index_md]+index_tp] = NULL;
+        size += ppt->tau_size*ppt->k_size[index_md];
+
+        if (ppt->ln_tau_size > 1) {
+          free(ppt->ddlate_sources[index_md][index_ic*ppt->tp_size[index_md]+index_tp]);
+          ppt->ddlate_sources[index_md][index_ic*ppt->tp_size[index_md]+index_tp] = NULL;
+          size += ppt->ln_tau_size*ppt->k_size[index_md];
+        }
+      }
+    }
+  }
+
+  ppt->sources_released = _TRUE_;
+
+  if (ppt->perturbations_verbose > 0)
+    printf(" -> released source tables (%.1f MB)\n",size*sizeof(double)/1024./1024.);
+
+  return _SUCCESS_;
+
+}
+
 /**
  * Initialize all indices and allocate most arrays in perturbations structure.
  *
@@ -2116,9 +2464,12 @@ int perturbations_get_k_list(
   double * k_max_cmb;
   double * k_max_cl;
   double k_max=0.;
+  double k_max_pk=0.;
   double scale2;
   double *tmp_k_list;
   int newk_size, index_newk, add_k_output_value;
+  struct perturbations * ppt_old;
+  short adopt_k_list;
 
   /** Summary: */
 
@@ -2130,6 +2481,8 @@ int perturbations_get_k_list(
              ppt->error_message,
              "stop to avoid division by zero");
 
+  ppt->k_max_pk_tail = 0.;
+
   /** - allocate arrays related to k list for each mode */
 
   class_alloc(ppt->k_size_cmb,
@@ -2225,10 +2578,23 @@ int perturbations_get_k_list(
     /* find k_max: */
 
     if ((ppt->has_pk_matter == _TRUE_) || (ppt->has_density_transfers == _TRUE_) || (ppt->has_velocity_transfers == _TRUE_))
-      k_max = MAX(k_max,ppt->k_max_for_pk);
+      k_max_pk = MAX(k_max_pk,ppt->k_max_for_pk);
 
     if (ppt->has_nl_corrections_based_on_delta_m == _TRUE_)
-      k_max = MAX(k_max,ppr->nonlinear_min_k_max);
+      k_max_pk = MAX(k_max_pk,ppr->nonlinear_min_k_max);
+
+    /* if the user asked to integrate the perturbations only up to a
+       moderate k_max_for_pk_solved, the largest wavenumbers needed
+       for P(k,z) will be obtained by the fourier module from an
+       analytic tail: then we stop the list at k_max_for_pk_solved,
+       unless the C_l's require larger k values anyway */
+
+    if ((ppt->k_max_for_pk_solved > 0.) && (k_max_pk > MAX(k_max,ppt->k_max_for_pk_solved))) {
+      ppt->k_max_pk_tail = k_max_pk;
+      k_max_pk = ppt->k_max_for_pk_solved;
+    }
+
+    k_max = MAX(k_max,k_max_pk);
 
     /** - --> test that result for k_min, k_max make sense */
 
@@ -2363,6 +2729,10 @@ int perturbations_get_k_list(
 
     ppt->k_size[ppt->index_md_scalars] = index_k;
 
+    /* with an analytic tail, all computed values are used for P(k,z) and T(k,z) */
+    if (ppt->k_max_pk_tail > 0.)
+      ppt->k_size_pk = index_k;
+
     class_realloc(ppt->k[ppt->index_md_scalars],
                   ppt->k[ppt->index_md_scalars],
                   ppt->k_size[ppt->index_md_scalars]*sizeof(double),
@@ -2729,6 +3099,51 @@ int perturbations_get_k_list(
     ppt->k_max = MAX(ppt->k_max,ppt->k[ppt->index_md_tensors][ppt->k_size[ppt->index_md_tensors]-1]); /* last value, inferred from perturbations structure */
   }
 
+  /** - if the perturbations may be restarted from the checkpoint of a
+      previous run, keep the k list of that run, provided that it
+      differs from the current one by less than one step at each end:
+      the k list depends slightly on late-time quantities (through the
+      conformal age), and all wavenumbers can only be restarted if
+      they are identical */
+
+  ppt_old = ppt->checkpoint_from;
+
+  if ((ppt->checkpoint_z > 0.) &&
+      (ppt_old != NULL) &&
+      (ppt_old->has_checkpoint == _TRUE_) &&
+      (ppt_old->md_size == ppt->md_size) &&
+      (ppt_old->k_output_values_num == ppt->k_output_values_num)) {
+
+    adopt_k_list = _TRUE_;
+
+    for (index_mode=0; (index_mode<ppt->md_size) && (adopt_k_list == _TRUE_); index_mode++) {
+      index_k = ppt->k_size[index_mode]-1;
+      if ((ppt->k_size[index_mode] < 2) ||
+          (fabs(ppt_old->k[index_mode][0]-ppt->k[index_mode][0]) > ppt->k[index_mode][1]-ppt->k[index_mode][0]) ||
+          (fabs(ppt_old->k[index_mode][ppt_old->k_size[index_mode]-1]-ppt->k[index_mode][index_k]) > ppt->k[index_mode][index_k]-ppt->k[index_mode][index_k-1]))
+        adopt_k_list = _FALSE_;
+    }
+
+    if (adopt_k_list == _TRUE_) {
+      for (index_mode=0; index_mode<ppt->md_size; index_mode++) {
+        ppt->k_size[index_mode] = ppt_old->k_size[index_mode];
+        ppt->k_size_cmb[index_mode] = ppt_old->k_size_cmb[index_mode];
+        ppt->k_size_cl[index_mode] = ppt_old->k_size_cl[index_mode];
+        class_realloc(ppt->k[index_mode],
+                      ppt->k[index_mode],
+                      ppt->k_size[index_mode]*sizeof(double),
+                      ppt->error_message);
+        memcpy(ppt->k[index_mode],ppt_old->k[index_mode],ppt->k_size[index_mode]*sizeof(double));
+        for (index_k_output=0; index_k_output<ppt->k_output_values_num; index_k_output++) {
+          ppt->index_k_output_values[index_mode*ppt->k_output_values_num+index_k_output] =
+            ppt_old->index_k_output_values[index_mode*ppt->k_output_values_num+index_k_output];
+        }
+      }
+      ppt->k_min = ppt_old->k_min;
+      ppt->k_max = ppt_old->k_max;
+    }
+  }
+
   free(k_max_cmb);
   free(k_max_cl);
 
@@ -2738,8 +3153,9 @@ int perturbations_get_k_list(
 
 /**
  * Initialize a perturbations_workspace structure. All fields are allocated
- * here, with the exception of the perturbations_vector '-->pv' field, which
- * is allocated separately in perturbations_vector_init. We allocate one
+ * here, including two buffers of maximum size for the perturbations_vector
+ * '-->pv' field, which is defined separately in perturbations_vector_init
+ * for each approximation scheme. We allocate one
  * such perturbations_workspace structure per thread and per mode
  * (scalar/../tensor). Then, for each thread, all initial conditions
  * and wavenumbers will use the same workspace.
@@ -2769,6 +3185,7 @@ int perturbations_workspace_init(
   int index_mt=0;
   int index_ap;
   int l;
+  int * approx_full;
 
   /** - Compute maximum l_max for any multipole */;
   if (_scalars_) {
@@ -2866,6 +3283,8 @@ int perturbations_workspace_init(
     class_define_index(ppw->index_ap_ncdmfa,pba->has_ncdm,index_ap,1);
     class_define_index(ppw->index_ap_tca_idm_dr,pba->has_idr,index_ap,1);
     class_define_index(ppw->index_ap_rsa_idr,pba->has_idr,index_ap,1);
+    class_define_index(ppw->index_ap_tca_idm_b,pth->has_idm_b,index_ap,1);
+    class_define_index(ppw->index_ap_tca_idm_g,pth->has_idm_g,index_ap,1);
   }
 
   ppw->ap_size=index_ap;
@@ -2888,6 +3307,10 @@ int perturbations_workspace_init(
       ppw->approx[ppw->index_ap_tca_idm_dr]=(int)tca_idm_dr_off;
     if (pth->has_idm_dr == _TRUE_)
       ppw->approx[ppw->index_ap_tca_idm_dr]=(int)tca_idm_dr_on;
+    if (pth->has_idm_b == _TRUE_)
+      ppw->approx[ppw->index_ap_tca_idm_b]=(int)tca_idm_b_on;
+    if (pth->has_idm_g == _TRUE_)
+      ppw->approx[ppw->index_ap_tca_idm_g]=(int)tca_idm_g_on;
 
     if (pba->has_ur == _TRUE_) {
       ppw->approx[ppw->index_ap_ufa]=(int)ufa_off;
@@ -2903,6 +3326,54 @@ int perturbations_workspace_init(
     ppw->approx[ppw->index_ap_rsa]=(int)rsa_off;
   }
 
+  /** - define the layout of the largest vector of integrated
+      perturbations, with all approximations turned off, and allocate
+      once and for all two buffers of that size. They will be recycled
+      by perturbations_vector_init() for each wavenumber and each
+      approximation switch */
+
+  class_alloc(approx_full,MAX(ppw->ap_size,1)*sizeof(int),ppt->error_message);
+
+  approx_full[ppw->index_ap_tca]=(int)tca_off;
+  approx_full[ppw->index_ap_rsa]=(int)rsa_off;
+
+  if (_scalars_) {
+    if (pba->has_ur == _TRUE_)
+      approx_full[ppw->index_ap_ufa]=(int)ufa_off;
+    if (pba->has_ncdm == _TRUE_)
+      approx_full[ppw->index_ap_ncdmfa]=(int)ncdmfa_off;
+    if (pba->has_idr == _TRUE_) {
+      approx_full[ppw->index_ap_tca_idm_dr]=(int)tca_idm_dr_off;
+      approx_full[ppw->index_ap_rsa_idr]=(int)rsa_idr_off;
+    }
+    if (pth->has_idm_b == _TRUE_)
+      approx_full[ppw->index_ap_tca_idm_b]=(int)tca_idm_b_off;
+    if (pth->has_idm_g == _TRUE_)
+      approx_full[ppw->index_ap_tca_idm_g]=(int)tca_idm_g_off;
+  }
+
+  class_call(perturbations_vector_alloc(pba,ppt,0,&(ppw->pv_full)),
+             ppt->error_message,
+             ppt->error_message);
+
+  class_call(perturbations_vector_indices(ppr,pba,ppt,index_md,ppw,approx_full,ppw->pv_full),
+             ppt->error_message,
+             ppt->error_message);
+
+  free(approx_full);
+
+  class_call(perturbations_vector_alloc(pba,ppt,ppw->pv_full->pt_size,&(ppw->pv_buffer[0])),
+             ppt->error_message,
+             ppt->error_message);
+
+  class_call(perturbations_vector_alloc(pba,ppt,ppw->pv_full->pt_size,&(ppw->pv_buffer[1])),
+             ppt->error_message,
+             ppt->error_message);
+
+  class_alloc(ppw->jacvec_full,ppw->pv_full->pt_size*sizeof(double),ppt->error_message);
+
+  ppw->pv = ppw->pv_buffer[0];
+
   /** - allocate fields where some of the perturbations are stored */
 
   if (_scalars_) {
@@ -2921,9 +3392,8 @@ int perturbations_workspace_init(
 }
 
 /**
- * Free the perturbations_workspace structure (with the exception of the
- * perturbations_vector '-->pv' field, which is freed separately in
- * perturbations_vector_free).
+ * Free the perturbations_workspace structure, including the buffers
+ * used for the perturbations_vector '-->pv' field.
  *
  * @param ppt        Input: pointer to the perturbation structure
  * @param index_md Input: index of mode under consideration (scalar/.../tensor)
@@ -2944,6 +3414,11 @@ int perturbations_workspace_free (
   if (ppw->ap_size > 0)
     free(ppw->approx);
 
+  perturbations_vector_free(ppw->pv_buffer[0]);
+  perturbations_vector_free(ppw->pv_buffer[1]);
+  perturbations_vector_free(ppw->pv_full);
+  free(ppw->jacvec_full);
+
   if (_scalars_) {
 
     if ((ppt->has_density_transfers == _TRUE_) || (ppt->has_velocity_transfers == _TRUE_) || (ppt->has_source_delta_m == _TRUE_)) {
@@ -3039,14 +3514,18 @@ int perturbations_solve(
   /* approximation scheme within previous interval: previous_approx[index_ap] */
   int * previous_approx;
 
+  /* interval starting at checkpoint_tau (-1 if no checkpoint for this wavenumber), and first interval to integrate */
+  int index_interval_checkpoint;
+  int index_interval_start;
+
+  /* was the state of this wavenumber restored from a previous run? */
+  short restored;
+
   int n_ncdm,is_early_enough;
 
-  /* function pointer to ODE evolver and names of possible evolvers */
+  /* Runge-Kutta evolver (the stiff evolver is declared in evolver_ndf15.h) */
 
   extern int evolver_rk();
-  extern int evolver_ndf15();
-  int (*generic_evolver)();
-
 
   /* Related to the perturbation output */
   int (*perhaps_print_variables)();
@@ -3211,11 +3690,13 @@ int perturbations_solve(
              ppt->error_message,
              ppt->error_message);
 
-  class_alloc(interval_limit,(interval_number+1)*sizeof(double),ppt->error_message);
+  /* (one more interval is allocated, in case it should be split at checkpoint_tau) */
 
-  class_alloc(interval_approx,interval_number*sizeof(int*),ppt->error_message);
+  class_alloc(interval_limit,(interval_number+2)*sizeof(double),ppt->error_message);
 
-  for (index_interval=0; index_interval<interval_number; index_interval++)
+  class_alloc(interval_approx,(interval_number+1)*sizeof(int*),ppt->error_message);
+
+  for (index_interval=0; index_interval<interval_number+1; index_interval++)
     class_alloc(interval_approx[index_interval],ppw->ap_size*sizeof(int),ppt->error_message);
 
   class_call(perturbations_find_approximation_switches(ppr,
@@ -3237,6 +3718,38 @@ int perturbations_solve(
 
   free(interval_number_of);
 
+  /** - if states are checkpointed, split the interval containing
+      checkpoint_tau in two intervals with the same approximation
+      scheme, so that the state at checkpoint_tau is available at the
+      beginning of an interval */
+
+  index_interval_checkpoint = -1;
+
+  if ((ppt->has_checkpoint == _TRUE_) &&
+      (tau < ppt->checkpoint_tau) &&
+      (ppt->checkpoint_tau < ppt->tau_sampling[tau_actual_size-1])) {
+
+    for (index_interval=0; interval_limit[index_interval+1] < ppt->checkpoint_tau; index_interval++);
+
+    /* (if checkpoint_tau happens to be exactly a switching time, there is no checkpoint for this wavenumber) */
+    if (interval_limit[index_interval+1] > ppt->checkpoint_tau) {
+
+      index_interval_checkpoint = index_interval+1;
+
+      for (index_interval=interval_number; index_interval>index_interval_checkpoint; index_interval--) {
+        interval_limit[index_interval+1] = interval_limit[index_interval];
+        for (index_ap=0; index_ap<ppw->ap_size; index_ap++)
+          interval_approx[index_interval][index_ap] = interval_approx[index_interval-1][index_ap];
+      }
+      interval_limit[index_interval_checkpoint+1] = interval_limit[index_interval_checkpoint];
+      interval_limit[index_interval_checkpoint] = ppt->checkpoint_tau;
+      for (index_ap=0; index_ap<ppw->ap_size; index_ap++)
+        interval_approx[index_interval_checkpoint][index_ap] = interval_approx[index_interval_checkpoint-1][index_ap];
+
+      interval_number++;
+    }
+  }
+
   /** - fill the structure containing all fixed parameters, indices
       and workspaces needed by perturbations_derivs */
 
@@ -3264,9 +3777,34 @@ int perturbations_solve(
     }
   }
 
+  /** - if possible, restore the state at checkpoint_tau from a
+      previous run, and start integrating from there */
+
+  index_interval_start = 0;
+
+  if ((index_interval_checkpoint > 0) &&
+      (ppt->checkpoint_restart == _TRUE_) &&
+      (perhaps_print_variables == NULL)) {
+
+    class_call(perturbations_checkpoint_restore(ppr,
+                                                pba,
+                                                ppt,
+                                                index_md,
+                                                index_ic,
+                                                index_k,
+                                                interval_approx[index_interval_checkpoint],
+                                                ppw,
+                                                &restored),
+               ppt->error_message,
+               ppt->error_message);
+
+    if (restored == _TRUE_)
+      index_interval_start = index_interval_checkpoint;
+  }
+
   /** - loop over intervals over which approximation scheme is uniform. For each interval: */
 
-  for (index_interval=0; index_interval<interval_number; index_interval++) {
+  for (index_interval=index_interval_start; index_interval<interval_number; index_interval++) {
 
     /** - --> (a) fix the approximation scheme */
 
@@ -3291,48 +3829,83 @@ int perturbations_solve(
         tau_ini, fill the vector with initial conditions for each
         mode. If it starts from an approximation switching point,
         redistribute correctly the perturbations from the previous to
-        the new vector of perturbations. */
-
-    class_call(perturbations_vector_init(ppr,
-                                         pba,
-                                         pth,
-                                         ppt,
-                                         index_md,
-                                         index_ic,
-                                         k,
-                                         interval_limit[index_interval],
-                                         ppw,
-                                         previous_approx),
-               ppt->error_message,
-               ppt->error_message);
+        the new vector of perturbations. At checkpoint_tau, the
+        approximation scheme does not change and the vector is kept
+        (or it has just been restored); it is then stored. */
+
+    if (index_interval != index_interval_checkpoint) {
+
+      class_call(perturbations_vector_init(ppr,
+                                           pba,
+                                           pth,
+                                           ppt,
+                                           index_md,
+                                           index_ic,
+                                           k,
+                                           interval_limit[index_interval],
+                                           ppw,
+                                           previous_approx),
+                 ppt->error_message,
+                 ppt->error_message);
+    }
+    else {
 
-    /** - --> (d) integrate the perturbations over the current interval. */
+      class_call(perturbations_checkpoint_store(ppt,
+                                                index_md,
+                                                index_ic,
+                                                index_k,
+                                                ppw),
+                 ppt->error_message,
+                 ppt->error_message);
+    }
+
+    /** - --> (d) integrate the perturbations over the current
+        interval. With ndf15, the experience on Jacobian increments
+        gathered in previous intervals is passed to the evolver. */
 
     if (ppr->evolver == rk){
-      generic_evolver = evolver_rk;
+
+      class_call(evolver_rk(perturbations_derivs,
+                            interval_limit[index_interval],
+                            interval_limit[index_interval+1],
+                            ppw->pv->y,
+                            ppw->pv->used_in_sources,
+                            ppw->pv->pt_size,
+                            &ppaw,
+                            ppr->tol_perturbations_integration,
+                            ppr->smallest_allowed_variation,
+                            perturbations_timescale,
+                            ppr->perturbations_integration_stepsize,
+                            ppt->tau_sampling,
+                            tau_actual_size,
+                            perturbations_sources,
+                            perhaps_print_variables,
+                            ppt->error_message),
+                 ppt->error_message,
+                 ppt->error_message);
     }
     else {
-      generic_evolver = evolver_ndf15;
-    }
-
-    class_call(generic_evolver(perturbations_derivs,
-                               interval_limit[index_interval],
-                               interval_limit[index_interval+1],
-                               ppw->pv->y,
-                               ppw->pv->used_in_sources,
-                               ppw->pv->pt_size,
-                               &ppaw,
-                               ppr->tol_perturbations_integration,
-                               ppr->smallest_allowed_variation,
-                               perturbations_timescale,
-                               ppr->perturbations_integration_stepsize,
-                               ppt->tau_sampling,
-                               tau_actual_size,
-                               perturbations_sources,
-                               perhaps_print_variables,
-                               ppt->error_message),
-               ppt->error_message,
-               ppt->error_message);
+
+      class_call(evolver_ndf15_with_experience(perturbations_derivs,
+                                               interval_limit[index_interval],
+                                               interval_limit[index_interval+1],
+                                               ppw->pv->y,
+                                               ppw->pv->used_in_sources,
+                                               ppw->pv->pt_size,
+                                               &ppaw,
+                                               ppr->tol_perturbations_integration,
+                                               ppr->smallest_allowed_variation,
+                                               perturbations_timescale,
+                                               ppr->perturbations_integration_stepsize,
+                                               ppt->tau_sampling,
+                                               tau_actual_size,
+                                               perturbations_sources,
+                                               perhaps_print_variables,
+                                               ppw->pv->jacvec,
+                                               ppt->error_message),
+                 ppt->error_message,
+                 ppt->error_message);
+    }
 
   }
 
@@ -3352,11 +3925,12 @@ int perturbations_solve(
     }
   }
 
-  /** - free quantities allocated at the beginning of the routine */
+  /** - free quantities allocated at the beginning of the routine
+      (the vector ppw-->pv belongs to the workspace and is recycled) */
 
-  class_call(perturbations_vector_free(ppw->pv),
-             ppt->error_message,
-             ppt->error_message);
+  /* (if the interval was not split at checkpoint_tau, one more array was allocated) */
+  if (index_interval_checkpoint == -1)
+    interval_number++;
 
   for (index_interval=0; index_interval<interval_number; index_interval++)
     free(interval_approx[index_interval]);
@@ -3368,6 +3942,688 @@ int perturbations_solve(
   return _SUCCESS_;
 }
 
+/**
+ * Build the list of all inputs that affect the evolution of
+ * perturbations and their sources up to a late time tau (checkpoint_z
+ * or split_z), apart from the precision parameters which are compared
+ * separately: modes, initial conditions and types of sources, gauge
+ * and switches, the physical densities and parameters of all species
+ * present at early times (with their perturbation-only parameters
+ * such as ceff2_ur, cs2_fld or the idm/idr couplings), helium
+ * fraction, recombination code, energy injection and varying
+ * constants. The late-time cosmology (cosmological constant, and the
+ * background of the fluid when its density fraction at tau is below
+ * tol_perturbations_checkpoint) and reionisation are left out: their
+ * effect before tau is checked through the background and
+ * thermodynamical quantities at tau. Two runs are compatible at tau
+ * only if their keys are equal; entries set to NaN (energy injection
+ * read from files) never compare equal.
+ *
+ * @param ppr      Input: pointer to precision structure
+ * @param pba      Input: pointer to background structure
+ * @param pth      Input: pointer to thermodynamics structure
+ * @param ppt      Input: pointer to perturbation structure
+ * @param pvecback Input: background quantities at tau
+ * @param key      Output: pointer to the allocated key
+ * @param key_size Output: size of the key
+ * @return the error status
+ */
+
+int perturbations_early_key(
+                            struct precision * ppr,
+                            struct background * pba,
+                            struct thermodynamics * pth,
+                            struct perturbations * ppt,
+                            double * pvecback,
+                            double ** key,
+                            int * key_size
+                            ) {
+
+  double h2 = pba->h*pba->h;
+  int n_ncdm, index_q, index;
+
+#define class_key_add(VALUE) {                                                 \
+    class_realloc(*key,*key,(*key_size+1)*sizeof(double),ppt->error_message); \
+    (*key)[(*key_size)++] = (double)(VALUE);                                  \
+  }
+
+  *key = NULL;
+  *key_size = 0;
+
+  /** - modes, initial conditions, types of sources, gauge and switches */
+
+  class_key_add(ppt->has_scalars);
+  class_key_add(ppt->has_vectors);
+  class_key_add(ppt->has_tensors);
+  class_key_add(ppt->has_ad);
+  class_key_add(ppt->has_bi);
+  class_key_add(ppt->has_cdi);
+  class_key_add(ppt->has_nid);
+  class_key_add(ppt->has_niv);
+  class_key_add(ppt->has_perturbed_recombination);
+  class_key_add(ppt->tensor_method);
+  class_key_add(ppt->evolve_tensor_ur);
+  class_key_add(ppt->evolve_tensor_ncdm);
+  class_key_add(ppt->has_cl_cmb_temperature);
+  class_key_add(ppt->has_cl_cmb_polarization);
+  class_key_add(ppt->has_cl_cmb_lensing_potential);
+  class_key_add(ppt->has_cl_lensing_potential);
+  class_key_add(ppt->has_cl_number_count);
+  class_key_add(ppt->has_pk_matter);
+  class_key_add(ppt->has_density_transfers);
+  class_key_add(ppt->has_velocity_transfers);
+  class_key_add(ppt->has_metricpotential_transfers);
+  class_key_add(ppt->has_Nbody_gauge_transfers);
+  class_key_add(ppt->has_nc_density);
+  class_key_add(ppt->has_nc_rsd);
+  class_key_add(ppt->has_nc_lens);
+  class_key_add(ppt->has_nc_gr);
+  class_key_add(ppt->has_source_t);
+  class_key_add(ppt->has_source_p);
+  class_key_add(ppt->has_source_delta_m);
+  class_key_add(ppt->has_source_delta_cb);
+  class_key_add(ppt->has_source_delta_tot);
+  class_key_add(ppt->has_source_delta_g);
+  class_key_add(ppt->has_source_delta_b);
+  class_key_add(ppt->has_source_delta_cdm);
+  class_key_add(ppt->has_source_delta_idm);
+  class_key_add(ppt->has_source_delta_idr);
+  class_key_add(ppt->has_source_delta_dcdm);
+  class_key_add(ppt->has_source_delta_fld);
+  class_key_add(ppt->has_source_delta_scf);
+  class_key_add(ppt->has_source_delta_dr);
+  class_key_add(ppt->has_source_delta_ur);
+  class_key_add(ppt->has_source_delta_ncdm);
+  class_key_add(ppt->has_source_theta_m);
+  class_key_add(ppt->has_source_theta_cb);
+  class_key_add(ppt->has_source_theta_tot);
+  class_key_add(ppt->has_source_theta_g);
+  class_key_add(ppt->has_source_theta_b);
+  class_key_add(ppt->has_source_theta_cdm);
+  class_key_add(ppt->has_source_theta_idm);
+  class_key_add(ppt->has_source_theta_idr);
+  class_key_add(ppt->has_source_theta_dcdm);
+  class_key_add(ppt->has_source_theta_fld);
+  class_key_add(ppt->has_source_theta_scf);
+  class_key_add(ppt->has_source_theta_dr);
+  class_key_add(ppt->has_source_theta_ur);
+  class_key_add(ppt->has_source_theta_ncdm);
+  class_key_add(ppt->has_source_phi);
+  class_key_add(ppt->has_source_phi_prime);
+  class_key_add(ppt->has_source_phi_plus_psi);
+  class_key_add(ppt->has_source_psi);
+  class_key_add(ppt->has_source_h);
+  class_key_add(ppt->has_source_h_prime);
+  class_key_add(ppt->has_source_eta);
+  class_key_add(ppt->has_source_eta_prime);
+  class_key_add(ppt->has_source_H_T_Nb_prime);
+  class_key_add(ppt->has_source_k2gamma_Nb);
+  class_key_add(ppt->gauge);
+  class_key_add(ppt->switch_sw);
+  class_key_add(ppt->switch_eisw);
+  class_key_add(ppt->switch_lisw);
+  class_key_add(ppt->switch_dop);
+  class_key_add(ppt->switch_pol);
+  class_key_add(ppt->eisw_lisw_split_z);
+
+  /** - species present at early times, with their perturbation parameters */
+
+  class_key_add(pba->T_cmb);
+  class_key_add(pba->Omega0_b*h2);
+  class_key_add(pba->Omega0_cdm*h2);
+  class_key_add(pba->Omega0_ur*h2);
+  class_key_add(ppt->three_ceff2_ur);
+  class_key_add(ppt->three_cvis2_ur);
+  class_key_add(pba->K);
+
+  class_key_add(pba->has_idm);
+  if (pba->has_idm == _TRUE_) {
+    class_key_add(pba->Omega0_idm*h2);
+    class_key_add(pth->m_idm);
+  }
+
+  class_key_add(pba->has_idr);
+  if (pba->has_idr == _TRUE_) {
+    class_key_add(pba->Omega0_idr*h2);
+    class_key_add(pba->T_idr);
+    class_key_add(ppt->idr_nature);
+  }
+
+  class_key_add(pth->has_idm_dr);
+  if (pth->has_idm_dr == _TRUE_) {
+    class_key_add(pth->a_idm_dr);
+    class_key_add(pth->b_idr);
+    class_key_add(pth->n_index_idm_dr);
+    for (index = 0; index < ppr->l_max_idr-1; index++) {
+      class_key_add(ppt->alpha_idm_dr[index]);
+      class_key_add(ppt->beta_idr[index]);
+    }
+  }
+
+  class_key_add(pth->has_idm_b);
+  if (pth->has_idm_b == _TRUE_) {
+    class_key_add(pth->cross_idm_b);
+    class_key_add(pth->n_index_idm_b);
+  }
+
+  class_key_add(pth->has_idm_g);
+  if (pth->has_idm_g == _TRUE_) {
+    class_key_add(pth->cross_idm_g);
+    class_key_add(pth->u_idm_g);
+    class_key_add(pth->n_index_idm_g);
+  }
+
+  class_key_add(pba->has_dcdm);
+  class_key_add(pba->has_dr);
+  if ((pba->has_dcdm == _TRUE_) || (pba->has_dr == _TRUE_)) {
+    class_key_add(pba->Omega_ini_dcdm);
+    class_key_add(pba->Omega0_dcdmdr*h2);
+    class_key_add(pba->Gamma_dcdm);
+  }
+
+  class_key_add(pba->N_ncdm);
+  for (n_ncdm = 0; n_ncdm < pba->N_ncdm; n_ncdm++) {
+    class_key_add(pba->M_ncdm[n_ncdm]);
+    class_key_add(pba->T_ncdm[n_ncdm]);
+    class_key_add(pba->ksi_ncdm[n_ncdm]);
+    class_key_add(pba->deg_ncdm[n_ncdm]);
+    class_key_add(pba->q_size_ncdm[n_ncdm]);
+    for (index_q = 0; index_q < pba->q_size_ncdm[n_ncdm]; index_q++) {
+      class_key_add(pba->q_ncdm[n_ncdm][index_q]);
+      class_key_add(pba->w_ncdm[n_ncdm][index_q]);
+      class_key_add(pba->dlnf0_dlnq_ncdm[n_ncdm][index_q]);
+    }
+  }
+
+  class_key_add(pba->has_scf);
+  if (pba->has_scf == _TRUE_) {
+    class_key_add(pba->Omega0_scf*h2);
+    class_key_add(pba->attractor_ic_scf);
+    class_key_add(pba->phi_ini_scf);
+    class_key_add(pba->phi_prime_ini_scf);
+    class_key_add(pba->scf_parameters_size);
+    for (index = 0; index < pba->scf_parameters_size; index++)
+      class_key_add(pba->scf_parameters[index]);
+  }
+
+  /** - fluid: perturbation parameters always, background parameters
+      only if its density fraction at tau is not negligible */
+
+  class_key_add(pba->has_fld);
+  if (pba->has_fld == _TRUE_) {
+    class_key_add(pba->use_ppf);
+    class_key_add(pba->c_gamma_over_c_fld);
+    class_key_add(pba->cs2_fld);
+    if (pvecback[pba->index_bg_rho_fld]/pvecback[pba->index_bg_rho_tot] > ppr->tol_perturbations_checkpoint) {
+      class_key_add(pba->fluid_equation_of_state);
+      class_key_add(pba->Omega0_fld*h2);
+      class_key_add(pba->w0_fld);
+      class_key_add(pba->wa_fld);
+      class_key_add(pba->Omega_EDE);
+    }
+  }
+
+  /** - helium, recombination, energy injection and varying constants */
+
+  class_key_add(pth->YHe);
+  class_key_add(pth->recombination);
+  class_key_add(pth->recfast_photoion_mode);
+
+  class_key_add(pth->has_exotic_injection);
+  if (pth->has_exotic_injection == _TRUE_) {
+    class_key_add(pth->in.DM_annihilation_efficiency);
+    class_key_add(pth->in.DM_annihilation_cross_section);
+    class_key_add(pth->in.DM_annihilation_mass);
+    class_key_add(pth->in.DM_annihilation_fraction);
+    class_key_add(pth->in.DM_annihilation_variation);
+    class_key_add(pth->in.DM_annihilation_z);
+    class_key_add(pth->in.DM_annihilation_zmax);
+    class_key_add(pth->in.DM_annihilation_zmin);
+    class_key_add(pth->in.DM_annihilation_f_halo);
+    class_key_add(pth->in.DM_annihilation_z_halo);
+    class_key_add(pth->in.DM_decay_fraction);
+    class_key_add(pth->in.DM_decay_Gamma);
+    class_key_add(pth->in.PBH_evaporation_fraction);
+    class_key_add(pth->in.PBH_evaporation_mass);
+    class_key_add(pth->in.PBH_accretion_fraction);
+    class_key_add(pth->in.PBH_accretion_mass);
+    class_key_add(pth->in.PBH_accretion_recipe);
+    class_key_add(pth->in.PBH_accretion_relative_velocities);
+    class_key_add(pth->in.PBH_accretion_ADAF_delta);
+    class_key_add(pth->in.PBH_accretion_eigenvalue);
+    class_key_add(pth->in.f_eff_type);
+    class_key_add(pth->in.chi_type);
+    /* the content of input files is not part of the key */
+    if ((pth->in.f_eff_type == f_eff_from_file) ||
+        (pth->in.chi_type == chi_from_x_file) ||
+        (pth->in.chi_type == chi_from_z_file)) {
+      class_key_add(NAN);
+    }
+  }
+
+  class_key_add(pba->varconst_dep);
+  if (pba->varconst_dep != varconst_none) {
+    class_key_add(pba->varconst_alpha);
+    class_key_add(pba->varconst_me);
+    class_key_add(pba->varconst_transition_redshift);
+  }
+
+#undef class_key_add
+
+  return _SUCCESS_;
+}
+
+/**
+ * Prepare the checkpoint of perturbations at checkpoint_z: find the
+ * corresponding conformal time and the background and thermodynamical
+ * quantities there, and allocate the arrays indexed by modes. If a
+ * previous run is passed in checkpoint_from, decide whether its
+ * checkpoint can be used: this requires the same precision
+ * parameters, the same key of early-time inputs (see
+ * perturbations_early_key()), the same modes, initial conditions,
+ * types and number of wavenumbers, and the same time sampling of
+ * sources, time of checkpoint and background and thermodynamics at
+ * checkpoint_z, up to the precision parameter
+ * tol_perturbations_checkpoint. Parameters affecting only lower
+ * redshifts (e.g. the dark energy equation of state, if dark energy
+ * is negligible at checkpoint_z, or the reionisation history) pass
+ * this test, as long as they do not change the wavenumbers; parameters
+ * changing the early universe do not, and the run then starts from the
+ * initial time for all wavenumbers. The optical depth is not compared:
+ * if checkpoint_z is above reionisation, it only multiplies the CMB
+ * sources before checkpoint_z by a constant factor, and these are
+ * rescaled by the ratio of \f$ e^{-\kappa} \f$ at checkpoint_z in
+ * perturbations_checkpoint_restore().
+ *
+ * @param ppr Input: pointer to precision structure
+ * @param pba Input: pointer to background structure
+ * @param pth Input: pointer to thermodynamics structure
+ * @param ppt Input/Output: pointer to perturbation structure
+ * @return the error status
+ */
+
+int perturbations_checkpoint_init(
+                                  struct precision * ppr,
+                                  struct background * pba,
+                                  struct thermodynamics * pth,
+                                  struct perturbations * ppt
+                                  ) {
+
+  struct perturbations * ppt_old = ppt->checkpoint_from;
+  double * pvecback;
+  double * pvecthermo;
+  int last_index=0;
+  int index_md, index_k, index_tau, index_key;
+  short compatible;
+
+  ppt->has_checkpoint = _FALSE_;
+  ppt->checkpoint_restart = _FALSE_;
+
+  if (ppt->checkpoint_z <= 0.)
+    return _SUCCESS_;
+
+  /** - find conformal time and background/thermodynamical quantities at checkpoint_z */
+
+  class_call(background_tau_of_z(pba,ppt->checkpoint_z,&(ppt->checkpoint_tau)),
+             pba->error_message,
+             ppt->error_message);
+
+  class_alloc(pvecback,pba->bg_size*sizeof(double),ppt->error_message);
+  class_alloc(pvecthermo,pth->th_size*sizeof(double),ppt->error_message);
+
+  class_call(background_at_tau(pba,
+                               ppt->checkpoint_tau,
+                               normal_info,
+                               inter_normal,
+                               &last_index,
+                               pvecback),
+             pba->error_message,
+             ppt->error_message);
+
+  class_call(thermodynamics_at_z(pba,
+                                 pth,
+                                 ppt->checkpoint_z,
+                                 inter_normal,
+                                 &last_index,
+                                 pvecback,
+                                 pvecthermo),
+             pth->error_message,
+             ppt->error_message);
+
+  ppt->checkpoint_a = pvecback[pba->index_bg_a];
+  ppt->checkpoint_H = pvecback[pba->index_bg_H];
+  ppt->checkpoint_dkappa = pvecthermo[pth->index_th_dkappa];
+  ppt->checkpoint_exp_m_kappa = pvecthermo[pth->index_th_exp_m_kappa];
+
+  class_call(perturbations_early_key(ppr,
+                                     pba,
+                                     pth,
+                                     ppt,
+                                     pvecback,
+                                     &(ppt->checkpoint_key),
+                                     &(ppt->checkpoint_key_size)),
+             ppt->error_message,
+             ppt->error_message);
+
+  free(pvecback);
+  free(pvecthermo);
+
+  class_alloc(ppt->checkpoint_precision,sizeof(struct precision),ppt->error_message);
+  *(ppt->checkpoint_precision) = *ppr;
+
+  for (index_tau=0; (index_tau < ppt->tau_size) && (ppt->tau_sampling[index_tau] < ppt->checkpoint_tau); index_tau++);
+  ppt->checkpoint_index_tau = index_tau;
+
+  /** - allocate arrays indexed by modes (the rest is allocated in perturbations_checkpoint_alloc()) */
+
+  class_alloc(ppt->checkpoint_ap_size,ppt->md_size*sizeof(int),ppt->error_message);
+  class_alloc(ppt->checkpoint_pt_size_max,ppt->md_size*sizeof(int),ppt->error_message);
+  class_alloc(ppt->checkpoint_stored,ppt->md_size*sizeof(short*),ppt->error_message);
+  class_alloc(ppt->checkpoint_approx,ppt->md_size*sizeof(int*),ppt->error_message);
+  class_alloc(ppt->checkpoint_pt_size,ppt->md_size*sizeof(int*),ppt->error_message);
+  class_alloc(ppt->checkpoint_y,ppt->md_size*sizeof(double*),ppt->error_message);
+  class_alloc(ppt->checkpoint_jacvec,ppt->md_size*sizeof(double*),ppt->error_message);
+  class_alloc(ppt->checkpoint_used_in_sources,ppt->md_size*sizeof(int*),ppt->error_message);
+
+  ppt->has_checkpoint = _TRUE_;
+
+  /** - check whether the checkpoint of a previous run can be used */
+
+  if (ppt_old == NULL)
+    return _SUCCESS_;
+
+  compatible = _TRUE_;
+
+  if ((ppt_old->has_perturbations == _FALSE_) ||
+      (ppt_old->has_checkpoint == _FALSE_) ||
+      (ppt_old->md_size != ppt->md_size) ||
+      (ppt_old->checkpoint_index_tau != ppt->checkpoint_index_tau) ||
+      (ppt_old->checkpoint_key_size != ppt->checkpoint_key_size) ||
+      (class_precision_equal(ppt_old->checkpoint_precision,ppt->checkpoint_precision) == _FALSE_)) {
+    compatible = _FALSE_;
+  }
+
+  /* written such that NaN entries never match */
+  for (index_key = 0; (index_key < ppt->checkpoint_key_size) && (compatible == _TRUE_); index_key++) {
+    if (!(fabs(ppt_old->checkpoint_key[index_key]-ppt->checkpoint_key[index_key])
+          <= _TOLVAR_*ppr->smallest_allowed_variation*fabs(ppt->checkpoint_key[index_key])))
+      compatible = _FALSE_;
+  }
+
+  for (index_md = 0; (index_md < ppt->md_size) && (compatible == _TRUE_); index_md++) {
+    if ((ppt_old->ic_size[index_md] != ppt->ic_size[index_md]) ||
+        (ppt_old->tp_size[index_md] != ppt->tp_size[index_md]) ||
+        (ppt_old->k_size[index_md] != ppt->k_size[index_md]) ||
+        (ppt_old->k_size_cmb[index_md] != ppt->k_size_cmb[index_md]) ||
+        (ppt_old->k_size_cl[index_md] != ppt->k_size_cl[index_md])) {
+      compatible = _FALSE_;
+    }
+    for (index_k = 0; (index_k < ppt->k_size[index_md]) && (compatible == _TRUE_); index_k++) {
+      if (ppt_old->k[index_md][index_k] != ppt->k[index_md][index_k])
+        compatible = _FALSE_;
+    }
+  }
+
+  for (index_tau = 0; (index_tau < ppt->checkpoint_index_tau) && (compatible == _TRUE_); index_tau++) {
+    if (fabs(ppt_old->tau_sampling[index_tau]/ppt->tau_sampling[index_tau]-1.) > ppr->tol_perturbations_checkpoint)
+      compatible = _FALSE_;
+  }
+
+  if ((compatible == _TRUE_) &&
+      ((fabs(ppt_old->checkpoint_tau/ppt->checkpoint_tau-1.) > ppr->tol_perturbations_checkpoint) ||
+       (fabs(ppt_old->checkpoint_a/ppt->checkpoint_a-1.) > ppr->tol_perturbations_checkpoint) ||
+       (fabs(ppt_old->checkpoint_H/ppt->checkpoint_H-1.) > ppr->tol_perturbations_checkpoint) ||
+       (fabs(ppt_old->checkpoint_dkappa/ppt->checkpoint_dkappa-1.) > ppr->tol_perturbations_checkpoint))) {
+    compatible = _FALSE_;
+  }
+
+  ppt->checkpoint_restart = compatible;
+
+  if (ppt->perturbations_verbose > 0) {
+    if (compatible == _TRUE_)
+      printf(" -> restarting wavenumbers from the checkpoint of a previous run at z=%g\n",ppt->checkpoint_z);
+    else
+      printf(" -> the checkpoint of the previous run cannot be used (different early-time inputs, precision or wavenumbers), integrating from initial time\n");
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Allocate the arrays storing the state of all wavenumbers at
+ * checkpoint_tau for a given mode, once the maximum size of the
+ * vector of perturbations is known.
+ *
+ * @param ppt      Input/Output: pointer to perturbation structure
+ * @param index_md Input: index of mode under consideration
+ * @param ppw      Input: pointer to a workspace initialized for this mode
+ * @return the error status
+ */
+
+int perturbations_checkpoint_alloc(
+                                   struct perturbations * ppt,
+                                   int index_md,
+                                   struct perturbations_workspace * ppw
+                                   ) {
+
+  int ick_size = ppt->ic_size[index_md]*ppt->k_size[index_md];
+
+  ppt->checkpoint_ap_size[index_md] = ppw->ap_size;
+  ppt->checkpoint_pt_size_max[index_md] = ppw->pv_full->pt_size;
+
+  class_calloc(ppt->checkpoint_stored[index_md],ick_size,sizeof(short),ppt->error_message);
+  class_alloc(ppt->checkpoint_approx[index_md],ick_size*ppw->ap_size*sizeof(int),ppt->error_message);
+  class_alloc(ppt->checkpoint_pt_size[index_md],ick_size*sizeof(int),ppt->error_message);
+  class_alloc(ppt->checkpoint_y[index_md],ick_size*ppw->pv_full->pt_size*sizeof(double),ppt->error_message);
+  class_alloc(ppt->checkpoint_jacvec[index_md],ick_size*ppw->pv_full->pt_size*sizeof(double),ppt->error_message);
+  class_alloc(ppt->checkpoint_used_in_sources[index_md],ick_size*ppw->pv_full->pt_size*sizeof(int),ppt->error_message);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Store the state of one wavenumber at checkpoint_tau: approximation
+ * scheme, vector of perturbations and Jacobian experience of ndf15.
+ *
+ * @param ppt      Input/Output: pointer to perturbation structure
+ * @param index_md Input: index of mode under consideration
+ * @param index_ic Input: index of initial condition under consideration
+ * @param index_k  Input: index of wavenumber
+ * @param ppw      Input: workspace containing the current vector ppw-->pv
+ * @return the error status
+ */
+
+int perturbations_checkpoint_store(
+                                   struct perturbations * ppt,
+                                   int index_md,
+                                   int index_ic,
+                                   int index_k,
+                                   struct perturbations_workspace * ppw
+                                   ) {
+
+  int index_ick = index_ic*ppt->k_size[index_md]+index_k;
+  int offset = index_ick*ppt->checkpoint_pt_size_max[index_md];
+  int index_ap, index_pt;
+
+  for (index_ap=0; index_ap<ppw->ap_size; index_ap++)
+    ppt->checkpoint_approx[index_md][index_ick*ppw->ap_size+index_ap] = ppw->approx[index_ap];
+
+  ppt->checkpoint_pt_size[index_md][index_ick] = ppw->pv->pt_size;
+
+  for (index_pt=0; index_pt<ppw->pv->pt_size; index_pt++) {
+    ppt->checkpoint_y[index_md][offset+index_pt] = ppw->pv->y[index_pt];
+    ppt->checkpoint_jacvec[index_md][offset+index_pt] = ppw->pv->jacvec[index_pt];
+    ppt->checkpoint_used_in_sources[index_md][offset+index_pt] = ppw->pv->used_in_sources[index_pt];
+  }
+
+  ppt->checkpoint_stored[index_md][index_ick] = _TRUE_;
+
+  return _SUCCESS_;
+}
+
+/**
+ * Restore the state of one wavenumber at checkpoint_tau from the run
+ * ppt-->checkpoint_from, together with its source functions at
+ * earlier times. Nothing is done if this wavenumber was not stored,
+ * or if its approximation scheme at checkpoint_tau has changed.
+ *
+ * @param ppr      Input: pointer to precision structure
+ * @param pba      Input: pointer to background structure
+ * @param ppt      Input/Output: pointer to perturbation structure
+ * @param index_md Input: index of mode under consideration
+ * @param index_ic Input: index of initial condition under consideration
+ * @param index_k  Input: index of wavenumber
+ * @param approx   Input: approximation scheme just after checkpoint_tau in this run
+ * @param ppw      Input/Output: workspace in which ppw-->pv is restored
+ * @param restored Output: was the state restored?
+ * @return the error status
+ */
+
+int perturbations_checkpoint_restore(
+                                     struct precision * ppr,
+                                     struct background * pba,
+                                     struct perturbations * ppt,
+                                     int index_md,
+                                     int index_ic,
+                                     int index_k,
+                                     int * approx,
+                                     struct perturbations_workspace * ppw,
+                                     short * restored
+                                     ) {
+
+  struct perturbations * ppt_old = ppt->checkpoint_from;
+  struct perturbations_vector * ppv;
+  int index_ick = index_ic*ppt->k_size[index_md]+index_k;
+  int offset;
+  int index_ap, index_pt, index_tau, index_tp;
+  short is_cmb;
+  double ratio;
+
+  *restored = _FALSE_;
+
+  if ((ppt_old->checkpoint_stored[index_md][index_ick] == _FALSE_) ||
+      (ppt_old->checkpoint_ap_size[index_md] != ppw->ap_size) ||
+      (ppt_old->checkpoint_pt_size_max[index_md] != ppw->pv_full->pt_size))
+    return _SUCCESS_;
+
+  for (index_ap=0; index_ap<ppw->ap_size; index_ap++) {
+    if (ppt_old->checkpoint_approx[index_md][index_ick*ppw->ap_size+index_ap] != approx[index_ap])
+      return _SUCCESS_;
+  }
+
+  /** - define the indices of the vector for this approximation scheme */
+
+  for (index_ap=0; index_ap<ppw->ap_size; index_ap++)
+    ppw->approx[index_ap] = approx[index_ap];
+
+  ppv = ppw->pv_buffer[0];
+
+  class_call(perturbations_vector_indices(ppr,
+                                          pba,
+                                          ppt,
+                                          index_md,
+                                          ppw,
+                                          ppw->approx,
+                                          ppv),
+             ppt->error_message,
+             ppt->error_message);
+
+  class_call(perturbations_vector_index_full(pba,
+                                             ppt,
+                                             index_md,
+                                             ppw,
+                                             ppv),
+             ppt->error_message,
+             ppt->error_message);
+
+  if (ppv->pt_size != ppt_old->checkpoint_pt_size[index_md][index_ick])
+    return _SUCCESS_;
+
+  /** - copy the stored state */
+
+  offset = index_ick*ppw->pv_full->pt_size;
+
+  for (index_pt=0; index_pt<ppv->pt_size; index_pt++) {
+    ppv->y[index_pt] = ppt_old->checkpoint_y[index_md][offset+index_pt];
+    ppv->jacvec[index_pt] = ppt_old->checkpoint_jacvec[index_md][offset+index_pt];
+    ppv->used_in_sources[index_pt] = ppt_old->checkpoint_used_in_sources[index_md][offset+index_pt];
+  }
+
+  ppw->pv = ppv;
+
+  /** - copy the source functions sampled before checkpoint_tau,
+      rescaling the CMB temperature and polarisation types by the
+      ratio of \f$ e^{-\kappa} \f$ at checkpoint_z (different
+      optical depths to reionisation) */
+
+  ratio = ppt->checkpoint_exp_m_kappa/ppt_old->checkpoint_exp_m_kappa;
+
+  for (index_tp = 0; index_tp < ppt->tp_size[index_md]; index_tp++) {
+
+    is_cmb = (((ppt->has_source_t == _TRUE_) &&
+               ((index_tp == ppt->index_tp_t2) ||
+                ((_scalars_ || _vectors_) && (index_tp == ppt->index_tp_t1)) ||
+                (_scalars_ && (index_tp == ppt->index_tp_t0)))) ||
+              ((ppt->has_source_p == _TRUE_) && (index_tp == ppt->index_tp_p)));
+
+    for (index_tau = 0; index_tau < ppt->checkpoint_index_tau; index_tau++) {
+      ppt->sources[index_md]
+        [index_ic * ppt->tp_size[index_md] + index_tp]
+        [index_tau * ppt->k_size[index_md] + index_k] =
+        ppt_old->sources[index_md]
+        [index_ic * ppt->tp_size[index_md] + index_tp]
+        [index_tau * ppt->k_size[index_md] + index_k];
+      if (is_cmb == _TRUE_)
+        ppt->sources[index_md]
+          [index_ic * ppt->tp_size[index_md] + index_tp]
+          [index_tau * ppt->k_size[index_md] + index_k] *= ratio;
+    }
+  }
+
+  *restored = _TRUE_;
+
+  return _SUCCESS_;
+}
+
+/**
+ * Free the arrays allocated by perturbations_checkpoint_init() and
+ * perturbations_checkpoint_alloc().
+ *
+ * @param ppt Input: pointer to perturbation structure
+ * @return the error status
+ */
+
+int perturbations_checkpoint_free(
+                                  struct perturbations * ppt
+                                  ) {
+
+  int index_md;
+
+  for (index_md = 0; index_md < ppt->md_size; index_md++) {
+    free(ppt->checkpoint_stored[index_md]);
+    free(ppt->checkpoint_approx[index_md]);
+    free(ppt->checkpoint_pt_size[index_md]);
+    free(ppt->checkpoint_y[index_md]);
+    free(ppt->checkpoint_jacvec[index_md]);
+    free(ppt->checkpoint_used_in_sources[index_md]);
+  }
+
+  free(ppt->checkpoint_ap_size);
+  free(ppt->checkpoint_pt_size_max);
+  free(ppt->checkpoint_stored);
+  free(ppt->checkpoint_approx);
+  free(ppt->checkpoint_pt_size);
+  free(ppt->checkpoint_y);
+  free(ppt->checkpoint_jacvec);
+  free(ppt->checkpoint_used_in_sources);
+  free(ppt->checkpoint_key);
+  free(ppt->checkpoint_precision);
+
+  ppt->has_checkpoint = _FALSE_;
+
+  return _SUCCESS_;
+}
+
 /**
  * Fill array of strings with the name of the 'k_output_values'
  * functions (transfer functions as a function of time, for fixed
@@ -3817,6 +5073,18 @@ int perturbations_find_approximation_switches(
               fprintf(stdout,"Mode k=%e: will switch off dark tight-coupling approximation at tau=%e\n",k,interval_limit[index_switch]);
           }
 
+          if (pth->has_idm_b == _TRUE_){
+            if ((interval_approx[index_switch-1][ppw->index_ap_tca_idm_b]==(int)tca_idm_b_on) &&
+                (interval_approx[index_switch][ppw->index_ap_tca_idm_b]==(int)tca_idm_b_off))
+              fprintf(stdout,"Mode k=%e: will switch off idm-baryon tight-coupling approximation at tau=%e\n",k,interval_limit[index_switch]);
+          }
+
+          if (pth->has_idm_g == _TRUE_){
+            if ((interval_approx[index_switch-1][ppw->index_ap_tca_idm_g]==(int)tca_idm_g_on) &&
+                (interval_approx[index_switch][ppw->index_ap_tca_idm_g]==(int)tca_idm_g_off))
+              fprintf(stdout,"Mode k=%e: will switch off idm-photon tight-coupling approximation at tau=%e\n",k,interval_limit[index_switch]);
+          }
+
           if (pba->has_ur == _TRUE_) {
             if ((interval_approx[index_switch-1][ppw->index_ap_ufa]==(int)ufa_off) &&
                 (interval_approx[index_switch][ppw->index_ap_ufa]==(int)ufa_on)) {
@@ -3853,92 +5121,44 @@ int perturbations_find_approximation_switches(
                                             ppt,
                                             index_md,
                                             k,
-                                            tau_end,
-                                            ppw),
-
-               ppt->error_message,
-               ppt->error_message);
-  }
-
-  return _SUCCESS_;
-}
-
-/**
- * Initialize the field '-->pv' of a perturbations_workspace structure, which
- * is a perturbations_vector structure. This structure contains indices and
- * values of all quantities which need to be integrated with respect
- * to time (and only them: quantities fixed analytically or obeying
- * constraint equations are NOT included in this vector). This routine
- * distinguishes between two cases:
- *
- * --> the input pa_old is set to the NULL pointer:
- *
- * This happens when we start integrating over a new wavenumber and we
- * want to set initial conditions for the perturbations. Then, it is
- * assumed that ppw-->pv is not yet allocated. This routine allocates
- * it, defines all indices, and then fills the vector ppw-->pv-->y with
- * the initial conditions defined in perturbations_initial_conditions.
- *
- * --> the input pa_old is not set to the NULL pointer and describes
- * some set of approximations:
- *
- * This happens when we need to change approximation scheme while
- * integrating over a given wavenumber. The new approximation
- * described by ppw-->pa is then different from pa_old. Then, this
- * routine allocates a new vector with a new size and new index
- * values; it fills this vector with initial conditions taken from the
- * previous vector passed as an input in ppw-->pv, and eventually with
- * some analytic approximations for the new variables appearing at
- * this time; then the new vector comes in replacement of the old one,
- * which is freed.
- *
- * @param ppr        Input: pointer to precision structure
- * @param pba        Input: pointer to background structure
- * @param pth        Input: pointer to the thermodynamics structure
- * @param ppt        Input: pointer to the perturbation structure
- * @param index_md Input: index of mode under consideration (scalar/.../tensor)
- * @param index_ic   Input: index of initial condition under consideration (ad, iso...)
- * @param k          Input: wavenumber
- * @param tau        Input: conformal time
- * @param ppw        Input/Output: workspace containing in input the approximation scheme, the background/thermodynamics/metric quantities, and eventually the previous vector y; and in output the new vector y.
- * @param pa_old     Input: NULL is we need to set y to initial conditions for a new wavenumber; points towards a perturbations_approximations if we want to switch of approximation.
- * @return the error status
- */
-
-int perturbations_vector_init(
-                              struct precision * ppr,
-                              struct background * pba,
-                              struct thermodynamics * pth,
-                              struct perturbations * ppt,
-                              int index_md,
-                              int index_ic,
-                              double k,
-                              double tau,
-                              struct perturbations_workspace * ppw, /* ppw->pv unallocated if pa_old = NULL, allocated and filled otherwise */
-                              int * pa_old
-                              ) {
-
-  /** Summary: */
-
-  /** - define local variables */
-
-  struct perturbations_vector * ppv;
+                                            tau_end,
+                                            ppw),
 
-  int index_pt;
-  int l;
-  int n_ncdm,index_q,ncdm_l_size;
-  double rho_plus_p_ncdm,q,q2,epsilon,a,factor;
+               ppt->error_message,
+               ppt->error_message);
+  }
 
-  /** - allocate a new perturbations_vector structure to which ppw-->pv will point at the end of the routine */
+  return _SUCCESS_;
+}
 
-  class_alloc(ppv,sizeof(struct perturbations_vector),ppt->error_message);
+/**
+ * Define all indices of a perturbations_vector structure for a given
+ * approximation scheme. The vector must have been allocated with
+ * perturbations_vector_alloc(), so that its ncdm arrays exist; only
+ * indices and sizes are written here.
+ *
+ * @param ppr        Input: pointer to precision structure
+ * @param pba        Input: pointer to background structure
+ * @param ppt        Input: pointer to the perturbation structure
+ * @param index_md   Input: index of mode under consideration (scalar/.../tensor)
+ * @param ppw        Input: workspace containing the approximation indices
+ * @param approx     Input: array of approximation flags approx[index_ap]
+ * @param ppv        Output: vector whose indices are defined here
+ * @return the error status
+ */
 
-  /** - initialize pointers to NULL (they will be allocated later if
-      needed), relevant for perturbations_vector_free() */
-  ppv->l_max_ncdm = NULL;
-  ppv->q_size_ncdm = NULL;
+int perturbations_vector_indices(
+                                 struct precision * ppr,
+                                 struct background * pba,
+                                 struct perturbations * ppt,
+                                 int index_md,
+                                 struct perturbations_workspace * ppw,
+                                 int * approx,
+                                 struct perturbations_vector * ppv
+                                 ) {
 
-  /** - define all indices in this new vector (depends on approximation scheme, described by the input structure ppw-->pa) */
+  int index_pt;
+  int n_ncdm;
 
   index_pt = 0;
 
@@ -3976,7 +5196,7 @@ int perturbations_vector_init(
 
     /* photons */
 
-    if (ppw->approx[ppw->index_ap_rsa] == (int)rsa_off) { /* if radiation streaming approximation is off */
+    if (approx[ppw->index_ap_rsa] == (int)rsa_off) { /* if radiation streaming approximation is off */
 
       /* temperature */
 
@@ -3985,7 +5205,7 @@ int perturbations_vector_init(
       class_define_index(ppv->index_pt_delta_g,_TRUE_,index_pt,1); /* photon density */
       class_define_index(ppv->index_pt_theta_g,_TRUE_,index_pt,1); /* photon velocity */
 
-      if (ppw->approx[ppw->index_ap_tca] == (int)tca_off) {
+      if (approx[ppw->index_ap_tca] == (int)tca_off) {
 
         class_define_index(ppv->index_pt_shear_g,_TRUE_,index_pt,1); /* photon shear */
         class_define_index(ppv->index_pt_l3_g,_TRUE_,index_pt,ppv->l_max_g-2); /* higher momenta */
@@ -4042,20 +5262,20 @@ int perturbations_vector_init(
     class_define_index(ppv->index_pt_phi_prime_scf,pba->has_scf,index_pt,1); /* scalar field velocity */
 
     /* perturbed recombination: the indices are defined once tca is off. */
-    if ( (ppt->has_perturbed_recombination == _TRUE_) && (ppw->approx[ppw->index_ap_tca] == (int)tca_off) ){
+    if ( (ppt->has_perturbed_recombination == _TRUE_) && (approx[ppw->index_ap_tca] == (int)tca_off) ){
       class_define_index(ppv->index_pt_perturbed_recombination_delta_temp,_TRUE_,index_pt,1);
       class_define_index(ppv->index_pt_perturbed_recombination_delta_chi,_TRUE_,index_pt,1);
     }
 
     /* ultra relativistic neutrinos */
 
-    if (pba->has_ur && (ppw->approx[ppw->index_ap_rsa] == (int)rsa_off)) {
+    if (pba->has_ur && (approx[ppw->index_ap_rsa] == (int)rsa_off)) {
 
       class_define_index(ppv->index_pt_delta_ur,_TRUE_,index_pt,1); /* density of ultra-relativistic neutrinos/relics */
       class_define_index(ppv->index_pt_theta_ur,_TRUE_,index_pt,1); /* velocity of ultra-relativistic neutrinos/relics */
       class_define_index(ppv->index_pt_shear_ur,_TRUE_,index_pt,1); /* shear of ultra-relativistic neutrinos/relics */
 
-      if (ppw->approx[ppw->index_ap_ufa] == (int)ufa_off) {
+      if (approx[ppw->index_ap_ufa] == (int)ufa_off) {
         ppv->l_max_ur = ppr->l_max_ur;
         class_define_index(ppv->index_pt_l3_ur,_TRUE_,index_pt,ppv->l_max_ur-2); /* additional momenta in Boltzmann hierarchy (beyond l=0,1,2,3) */
       }
@@ -4064,11 +5284,11 @@ int perturbations_vector_init(
     /* interacting dark radiation */
 
     if (pba->has_idr == _TRUE_){
-      if (ppw->approx[ppw->index_ap_rsa_idr]==(int)rsa_idr_off) {
+      if (approx[ppw->index_ap_rsa_idr]==(int)rsa_idr_off) {
         class_define_index(ppv->index_pt_delta_idr,_TRUE_,index_pt,1); /* density of interacting dark radiation */
         class_define_index(ppv->index_pt_theta_idr,_TRUE_,index_pt,1); /* velocity of interacting dark radiation */
         if (ppt->idr_nature == idr_free_streaming){
-          if (ppw->approx[ppw->index_ap_tca_idm_dr] == (int)tca_idm_dr_off){
+          if (approx[ppw->index_ap_tca_idm_dr] == (int)tca_idm_dr_off){
             class_define_index(ppv->index_pt_shear_idr,_TRUE_,index_pt,1); /* shear of interacting dark radiation */
             ppv->l_max_idr = ppr->l_max_idr;
             class_define_index(ppv->index_pt_l3_idr,_TRUE_,index_pt,ppv->l_max_idr-2); /* additional momenta in Boltzmann hierarchy (beyond l=0,1,2,3) */
@@ -4083,12 +5303,10 @@ int perturbations_vector_init(
     if (pba->has_ncdm == _TRUE_) {
       ppv->index_pt_psi0_ncdm1 = index_pt; /* density of ultra-relativistic neutrinos/relics */
       ppv->N_ncdm = pba->N_ncdm;
-      class_alloc(ppv->l_max_ncdm,ppv->N_ncdm*sizeof(double),ppt->error_message);
-      class_alloc(ppv->q_size_ncdm,ppv->N_ncdm*sizeof(double),ppt->error_message);
 
       for (n_ncdm = 0; n_ncdm < pba->N_ncdm; n_ncdm++){
         // Set value of ppv->l_max_ncdm:
-        if (ppw->approx[ppw->index_ap_ncdmfa] == (int)ncdmfa_off){
+        if (approx[ppw->index_ap_ncdmfa] == (int)ncdmfa_off){
           /* reject inconsistent values of the number of mutipoles in ultra relativistic neutrino hierarchy */
           class_test(ppr->l_max_ncdm < 4,
                      ppt->error_message,
@@ -4126,8 +5344,8 @@ int perturbations_vector_init(
 
     /* eventually reject inconsistent values of the number of mutipoles in photon temperature hierarchy and polarization*/
 
-    if (ppw->approx[ppw->index_ap_rsa] == (int)rsa_off) { /* if radiation streaming approximation is off */
-      if (ppw->approx[ppw->index_ap_tca] == (int)tca_off) { /* if tight-coupling approximation is off */
+    if (approx[ppw->index_ap_rsa] == (int)rsa_off) { /* if radiation streaming approximation is off */
+      if (approx[ppw->index_ap_tca] == (int)tca_off) { /* if tight-coupling approximation is off */
 
         ppv->l_max_g = ppr->l_max_g_ten;
 
@@ -4167,8 +5385,8 @@ int perturbations_vector_init(
                ppt->error_message,
                "ppr->l_max_pol_g_ten should be at least 4");
 
-    if (ppw->approx[ppw->index_ap_rsa] == (int)rsa_off) { /* if radiation streaming approximation is off */
-      if (ppw->approx[ppw->index_ap_tca] == (int)tca_off) { /* if tight-coupling approximation is off */
+    if (approx[ppw->index_ap_rsa] == (int)rsa_off) { /* if radiation streaming approximation is off */
+      if (approx[ppw->index_ap_tca] == (int)tca_off) { /* if tight-coupling approximation is off */
 
         ppv->l_max_g = ppr->l_max_g_ten;
 
@@ -4197,8 +5415,6 @@ int perturbations_vector_init(
     if (ppt->evolve_tensor_ncdm == _TRUE_) {
       ppv->index_pt_psi0_ncdm1 = index_pt;
       ppv->N_ncdm = pba->N_ncdm;
-      class_alloc(ppv->l_max_ncdm,ppv->N_ncdm*sizeof(double),ppt->error_message);
-      class_alloc(ppv->q_size_ncdm,ppv->N_ncdm*sizeof(double),ppt->error_message);
 
       for (n_ncdm = 0; n_ncdm < pba->N_ncdm; n_ncdm++){
         // Set value of ppv->l_max_ncdm:
@@ -4224,12 +5440,325 @@ int perturbations_vector_init(
 
   ppv->pt_size = index_pt;
 
-  /** - allocate vectors for storing the values of all these
-      quantities and their time-derivatives at a given time */
+  return _SUCCESS_;
+}
+
+/**
+ * Fill the array ppv-->index_full, giving for each integrated
+ * variable its position in the layout ppw-->pv_full obtained when all
+ * approximations are turned off. Variables existing only within an
+ * approximation (e.g. the ncdm fluid variables) get the value -1.
+ * This allows to carry information from one approximation scheme to
+ * the next for all variables which survive the switch.
+ *
+ * @param pba        Input: pointer to background structure
+ * @param ppt        Input: pointer to the perturbation structure
+ * @param index_md   Input: index of mode under consideration (scalar/.../tensor)
+ * @param ppw        Input: workspace containing the current approximation scheme and the full layout
+ * @param ppv        Input/Output: vector with indices already defined
+ * @return the error status
+ */
+
+int perturbations_vector_index_full(
+                                    struct background * pba,
+                                    struct perturbations * ppt,
+                                    int index_md,
+                                    struct perturbations_workspace * ppw,
+                                    struct perturbations_vector * ppv
+                                    ) {
+
+  struct perturbations_vector * pvf = ppw->pv_full;
+  int index_pt;
+  int n_ncdm,ncdm_size;
+
+  for (index_pt=0; index_pt<ppv->pt_size; index_pt++)
+    ppv->index_full[index_pt] = -1;
+
+  if (_scalars_) {
+
+    if (ppw->approx[ppw->index_ap_rsa] == (int)rsa_off) {
+      if (ppw->approx[ppw->index_ap_tca] == (int)tca_off) {
+        perturbations_vector_map_block(ppv,ppv->index_pt_delta_g,pvf->index_pt_delta_g,ppv->l_max_g+1);
+        perturbations_vector_map_block(ppv,ppv->index_pt_pol0_g,pvf->index_pt_pol0_g,ppv->l_max_pol_g+1);
+      }
+      else {
+        perturbations_vector_map_block(ppv,ppv->index_pt_delta_g,pvf->index_pt_delta_g,2);
+      }
+    }
+
+    perturbations_vector_map_block(ppv,ppv->index_pt_delta_b,pvf->index_pt_delta_b,2);
+
+    if (pba->has_cdm == _TRUE_) {
+      perturbations_vector_map_block(ppv,ppv->index_pt_delta_cdm,pvf->index_pt_delta_cdm,1);
+      if (ppt->gauge == newtonian)
+        perturbations_vector_map_block(ppv,ppv->index_pt_theta_cdm,pvf->index_pt_theta_cdm,1);
+    }
+
+    if (pba->has_idm == _TRUE_)
+      perturbations_vector_map_block(ppv,ppv->index_pt_delta_idm,pvf->index_pt_delta_idm,2);
+
+    if (pba->has_dcdm == _TRUE_)
+      perturbations_vector_map_block(ppv,ppv->index_pt_delta_dcdm,pvf->index_pt_delta_dcdm,2);
+
+    if (pba->has_dr == _TRUE_)
+      perturbations_vector_map_block(ppv,ppv->index_pt_F0_dr,pvf->index_pt_F0_dr,ppv->l_max_dr+1);
+
+    if (pba->has_fld == _TRUE_) {
+      if (pba->use_ppf == _FALSE_)
+        perturbations_vector_map_block(ppv,ppv->index_pt_delta_fld,pvf->index_pt_delta_fld,2);
+      else
+        perturbations_vector_map_block(ppv,ppv->index_pt_Gamma_fld,pvf->index_pt_Gamma_fld,1);
+    }
+
+    if (pba->has_scf == _TRUE_)
+      perturbations_vector_map_block(ppv,ppv->index_pt_phi_scf,pvf->index_pt_phi_scf,2);
+
+    if ((ppt->has_perturbed_recombination == _TRUE_) && (ppw->approx[ppw->index_ap_tca] == (int)tca_off))
+      perturbations_vector_map_block(ppv,
+                                     ppv->index_pt_perturbed_recombination_delta_temp,
+                                     pvf->index_pt_perturbed_recombination_delta_temp,
+                                     2);
+
+    if ((pba->has_ur == _TRUE_) && (ppw->approx[ppw->index_ap_rsa] == (int)rsa_off)) {
+      if (ppw->approx[ppw->index_ap_ufa] == (int)ufa_off)
+        perturbations_vector_map_block(ppv,ppv->index_pt_delta_ur,pvf->index_pt_delta_ur,ppv->l_max_ur+1);
+      else
+        perturbations_vector_map_block(ppv,ppv->index_pt_delta_ur,pvf->index_pt_delta_ur,3);
+    }
+
+    if ((pba->has_idr == _TRUE_) && (ppw->approx[ppw->index_ap_rsa_idr] == (int)rsa_idr_off)) {
+      if ((ppt->idr_nature == idr_free_streaming) && (ppw->approx[ppw->index_ap_tca_idm_dr] == (int)tca_idm_dr_off))
+        perturbations_vector_map_block(ppv,ppv->index_pt_delta_idr,pvf->index_pt_delta_idr,ppv->l_max_idr+1);
+      else
+        perturbations_vector_map_block(ppv,ppv->index_pt_delta_idr,pvf->index_pt_delta_idr,2);
+    }
+
+    if ((pba->has_ncdm == _TRUE_) && (ppw->approx[ppw->index_ap_ncdmfa] == (int)ncdmfa_off)) {
+      ncdm_size = 0;
+      for (n_ncdm=0; n_ncdm < ppv->N_ncdm; n_ncdm++)
+        ncdm_size += (ppv->l_max_ncdm[n_ncdm]+1)*ppv->q_size_ncdm[n_ncdm];
+      perturbations_vector_map_block(ppv,ppv->index_pt_psi0_ncdm1,pvf->index_pt_psi0_ncdm1,ncdm_size);
+    }
+
+    if (ppt->gauge == synchronous)
+      perturbations_vector_map_block(ppv,ppv->index_pt_eta,pvf->index_pt_eta,1);
+    if (ppt->gauge == newtonian)
+      perturbations_vector_map_block(ppv,ppv->index_pt_phi,pvf->index_pt_phi,1);
+  }
+
+  if (_vectors_) {
+
+    perturbations_vector_map_block(ppv,ppv->index_pt_theta_b,pvf->index_pt_theta_b,1);
+
+    if ((ppw->approx[ppw->index_ap_rsa] == (int)rsa_off) && (ppw->approx[ppw->index_ap_tca] == (int)tca_off)) {
+      perturbations_vector_map_block(ppv,ppv->index_pt_delta_g,pvf->index_pt_delta_g,ppv->l_max_g+1);
+      perturbations_vector_map_block(ppv,ppv->index_pt_pol0_g,pvf->index_pt_pol0_g,ppv->l_max_pol_g+1);
+    }
+
+    if (ppt->gauge == synchronous)
+      perturbations_vector_map_block(ppv,ppv->index_pt_hv_prime,pvf->index_pt_hv_prime,1);
+    if (ppt->gauge == newtonian)
+      perturbations_vector_map_block(ppv,ppv->index_pt_V,pvf->index_pt_V,1);
+  }
+
+  if (_tensors_) {
+
+    if ((ppw->approx[ppw->index_ap_rsa] == (int)rsa_off) && (ppw->approx[ppw->index_ap_tca] == (int)tca_off)) {
+      perturbations_vector_map_block(ppv,ppv->index_pt_delta_g,pvf->index_pt_delta_g,ppv->l_max_g+1);
+      perturbations_vector_map_block(ppv,ppv->index_pt_pol0_g,pvf->index_pt_pol0_g,ppv->l_max_pol_g+1);
+    }
+
+    if (ppt->evolve_tensor_ur == _TRUE_)
+      perturbations_vector_map_block(ppv,ppv->index_pt_delta_ur,pvf->index_pt_delta_ur,ppv->l_max_ur+1);
+
+    if (ppt->evolve_tensor_ncdm == _TRUE_) {
+      ncdm_size = 0;
+      for (n_ncdm=0; n_ncdm < ppv->N_ncdm; n_ncdm++)
+        ncdm_size += (ppv->l_max_ncdm[n_ncdm]+1)*ppv->q_size_ncdm[n_ncdm];
+      perturbations_vector_map_block(ppv,ppv->index_pt_psi0_ncdm1,pvf->index_pt_psi0_ncdm1,ncdm_size);
+    }
+
+    perturbations_vector_map_block(ppv,ppv->index_pt_gw,pvf->index_pt_gw,2);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Map a block of consecutive variables of ppv onto the corresponding
+ * block of the full layout.
+ *
+ * @param ppv        Input/Output: vector whose index_full array is filled
+ * @param index_pt   Input: first index of the block in ppv
+ * @param index_full Input: first index of the block in the full layout
+ * @param size       Input: number of variables in the block
+ * @return the error status
+ */
+
+int perturbations_vector_map_block(
+                                   struct perturbations_vector * ppv,
+                                   int index_pt,
+                                   int index_full,
+                                   int size
+                                   ) {
+  int i;
+
+  for (i=0; i<size; i++)
+    ppv->index_full[index_pt+i] = index_full+i;
+
+  return _SUCCESS_;
+}
+
+/**
+ * Allocate a perturbations_vector structure able to hold the largest
+ * vector of integrated perturbations for a given mode (the one in
+ * which all approximations are turned off). Such buffers are
+ * allocated once per workspace and recycled for every wavenumber
+ * and every approximation scheme.
+ *
+ * @param pba        Input: pointer to background structure
+ * @param ppt        Input: pointer to the perturbation structure
+ * @param pt_size_max Input: maximum size of the vector (0 if only indices are needed)
+ * @param pv         Output: pointer to the allocated structure
+ * @return the error status
+ */
+
+int perturbations_vector_alloc(
+                               struct background * pba,
+                               struct perturbations * ppt,
+                               int pt_size_max,
+                               struct perturbations_vector ** pv
+                               ) {
+
+  class_alloc(*pv,sizeof(struct perturbations_vector),ppt->error_message);
+
+  (*pv)->l_max_ncdm = NULL;
+  (*pv)->q_size_ncdm = NULL;
+  (*pv)->y = NULL;
+  (*pv)->dy = NULL;
+  (*pv)->used_in_sources = NULL;
+  (*pv)->index_full = NULL;
+  (*pv)->jacvec = NULL;
+
+  if (pba->has_ncdm == _TRUE_) {
+    class_alloc((*pv)->l_max_ncdm,pba->N_ncdm*sizeof(int),ppt->error_message);
+    class_alloc((*pv)->q_size_ncdm,pba->N_ncdm*sizeof(int),ppt->error_message);
+  }
+
+  if (pt_size_max > 0) {
+    class_calloc((*pv)->y,pt_size_max,sizeof(double),ppt->error_message);
+    class_alloc((*pv)->dy,pt_size_max*sizeof(double),ppt->error_message);
+    class_alloc((*pv)->used_in_sources,pt_size_max*sizeof(int),ppt->error_message);
+    class_alloc((*pv)->index_full,pt_size_max*sizeof(int),ppt->error_message);
+    class_calloc((*pv)->jacvec,pt_size_max,sizeof(double),ppt->error_message);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Initialize the field '-->pv' of a perturbations_workspace structure, which
+ * is a perturbations_vector structure. This structure contains indices and
+ * values of all quantities which need to be integrated with respect
+ * to time (and only them: quantities fixed analytically or obeying
+ * constraint equations are NOT included in this vector). This routine
+ * distinguishes between two cases:
+ *
+ * --> the input pa_old is set to the NULL pointer:
+ *
+ * This happens when we start integrating over a new wavenumber and we
+ * want to set initial conditions for the perturbations. This routine
+ * takes one of the buffers preallocated in the workspace, defines all
+ * indices, and then fills the vector ppw-->pv-->y with the initial
+ * conditions defined in perturbations_initial_conditions.
+ *
+ * --> the input pa_old is not set to the NULL pointer and describes
+ * some set of approximations:
+ *
+ * This happens when we need to change approximation scheme while
+ * integrating over a given wavenumber. The new approximation
+ * described by ppw-->pa is then different from pa_old. Then, this
+ * routine defines new index values in the other workspace buffer (no
+ * memory is allocated, since both buffers have the maximum size); it
+ * fills this vector with initial conditions taken from the previous
+ * vector passed as an input in ppw-->pv, and eventually with some
+ * analytic approximations for the new variables appearing at this
+ * time; then the new vector comes in replacement of the old one. The
+ * Jacobian experience of ndf15 (see evolver_ndf15_with_experience) is
+ * carried over for all variables common to both schemes.
+ *
+ * @param ppr        Input: pointer to precision structure
+ * @param pba        Input: pointer to background structure
+ * @param pth        Input: pointer to the thermodynamics structure
+ * @param ppt        Input: pointer to the perturbation structure
+ * @param index_md Input: index of mode under consideration (scalar/.../tensor)
+ * @param index_ic   Input: index of initial condition under consideration (ad, iso...)
+ * @param k          Input: wavenumber
+ * @param tau        Input: conformal time
+ * @param ppw        Input/Output: workspace containing in input the approximation scheme, the background/thermodynamics/metric quantities, and eventually the previous vector y; and in output the new vector y.
+ * @param pa_old     Input: NULL is we need to set y to initial conditions for a new wavenumber; points towards a perturbations_approximations if we want to switch of approximation.
+ * @return the error status
+ */
+
+int perturbations_vector_init(
+                              struct precision * ppr,
+                              struct background * pba,
+                              struct thermodynamics * pth,
+                              struct perturbations * ppt,
+                              int index_md,
+                              int index_ic,
+                              double k,
+                              double tau,
+                              struct perturbations_workspace * ppw, /* ppw->pv undefined if pa_old = NULL, filled otherwise */
+                              int * pa_old
+                              ) {
+
+  /** Summary: */
+
+  /** - define local variables */
+
+  struct perturbations_vector * ppv;
+
+  int index_pt;
+  int l;
+  int n_ncdm,index_q,ncdm_l_size;
+  double rho_plus_p_ncdm,q,q2,epsilon,a,factor;
+
+  /** - pick the workspace buffer not currently holding ppw-->pv (the
+      previous vector is still needed below to redistribute the
+      perturbations across an approximation switch) */
+
+  if ((pa_old != NULL) && (ppw->pv == ppw->pv_buffer[0]))
+    ppv = ppw->pv_buffer[1];
+  else
+    ppv = ppw->pv_buffer[0];
+
+  /** - define all indices in this new vector (depends on approximation scheme, described by the input structure ppw-->pa) */
+
+  class_call(perturbations_vector_indices(ppr,
+                                          pba,
+                                          ppt,
+                                          index_md,
+                                          ppw,
+                                          ppw->approx,
+                                          ppv),
+             ppt->error_message,
+             ppt->error_message);
+
+  class_call(perturbations_vector_index_full(pba,
+                                             ppt,
+                                             index_md,
+                                             ppw,
+                                             ppv),
+             ppt->error_message,
+             ppt->error_message);
 
-  class_calloc(ppv->y,ppv->pt_size,sizeof(double),ppt->error_message);
-  class_alloc(ppv->dy,ppv->pt_size*sizeof(double),ppt->error_message);
-  class_alloc(ppv->used_in_sources,ppv->pt_size*sizeof(int),ppt->error_message);
+  /** - reset the values of all these quantities (the buffers have
+      been allocated once and for all with the maximum size in
+      perturbations_workspace_init) */
+
+  for (index_pt=0; index_pt<ppv->pt_size; index_pt++)
+    ppv->y[index_pt] = 0.;
 
   /** - specify which perturbations are needed in the evaluation of source terms */
 
@@ -4402,7 +5931,10 @@ int perturbations_vector_init(
     }
 
     /** - --> (b) let ppw-->pv points towards the perturbations_vector structure
-        that we just created */
+        that we just defined, with no experience on Jacobian increments yet */
+
+    for (index_pt=0; index_pt<ppv->pt_size; index_pt++)
+      ppv->jacvec[index_pt] = 0.;
 
     ppw->pv = ppv;
 
@@ -4444,6 +5976,18 @@ int perturbations_vector_init(
                    "at tau=%g: the dark tight-coupling approximation can be switched off, not on",tau);
       }
 
+      if (pth->has_idm_b == _TRUE_){
+        class_test((pa_old[ppw->index_ap_tca_idm_b] == (int)tca_idm_b_off) && (ppw->approx[ppw->index_ap_tca_idm_b] == (int)tca_idm_b_on),
+                   ppt->error_message,
+                   "at tau=%g: the idm-baryon tight-coupling approximation can be switched off, not on",tau);
+      }
+
+      if (pth->has_idm_g == _TRUE_){
+        class_test((pa_old[ppw->index_ap_tca_idm_g] == (int)tca_idm_g_off) && (ppw->approx[ppw->index_ap_tca_idm_g] == (int)tca_idm_g_on),
+                   ppt->error_message,
+                   "at tau=%g: the idm-photon tight-coupling approximation can be switched off, not on",tau);
+      }
+
       /** - ---> (a.2.) some variables (b, cdm, fld, ...) are not affected by
           any approximation. They need to be reconducted whatever
           the approximation switching is. We treat them here. Below
@@ -5002,6 +6546,23 @@ int perturbations_vector_init(
         }
       }
 
+      /* -- case of switching off the idm-baryon or idm-photon
+         tight-coupling approximation. It only changes the way the idm
+         momentum exchange rate is computed, not the layout of the
+         vector: all variables are carried over */
+
+      if (((pth->has_idm_b == _TRUE_) &&
+           (pa_old[ppw->index_ap_tca_idm_b] == (int)tca_idm_b_on) && (ppw->approx[ppw->index_ap_tca_idm_b] == (int)tca_idm_b_off)) ||
+          ((pth->has_idm_g == _TRUE_) &&
+           (pa_old[ppw->index_ap_tca_idm_g] == (int)tca_idm_g_on) && (ppw->approx[ppw->index_ap_tca_idm_g] == (int)tca_idm_g_off))) {
+
+        if (ppt->perturbations_verbose>2)
+          fprintf(stdout,"Mode k=%e: switch off idm tight-coupling approximation at tau=%e\n",k,tau);
+
+        for (index_pt=0; index_pt<ppv->pt_size; index_pt++)
+          ppv->y[index_pt] = ppw->pv->y[index_pt];
+      }
+
       /* -- case of switching on ncdm fluid
          approximation. Provide correct initial conditions to new set
          of variables */
@@ -5301,14 +6862,22 @@ int perturbations_vector_init(
       }
     }
 
-    /** - --> (d) free the previous vector of perturbations */
+    /** - --> (d) carry over the experience gained by ndf15 on the
+        Jacobian increments for all variables surviving the switch
+        (the previous buffer will be recycled at the next switch) */
 
-    class_call(perturbations_vector_free(ppw->pv),
-               ppt->error_message,
-               ppt->error_message);
+    for (index_pt=0; index_pt<ppw->pv_full->pt_size; index_pt++)
+      ppw->jacvec_full[index_pt] = 0.;
+
+    for (index_pt=0; index_pt<ppw->pv->pt_size; index_pt++)
+      if (ppw->pv->index_full[index_pt] >= 0)
+        ppw->jacvec_full[ppw->pv->index_full[index_pt]] = ppw->pv->jacvec[index_pt];
+
+    for (index_pt=0; index_pt<ppv->pt_size; index_pt++)
+      ppv->jacvec[index_pt] = (ppv->index_full[index_pt] >= 0) ? ppw->jacvec_full[ppv->index_full[index_pt]] : 0.;
 
     /** - --> (e) let ppw-->pv points towards the perturbations_vector structure
-        that we just created */
+        that we just filled */
 
     ppw->pv = ppv;
 
@@ -5330,9 +6899,11 @@ int perturbations_vector_free(
 
   if (pv->l_max_ncdm != NULL) free(pv->l_max_ncdm);
   if (pv->q_size_ncdm != NULL) free(pv->q_size_ncdm);
-  free(pv->y);
-  free(pv->dy);
-  free(pv->used_in_sources);
+  if (pv->y != NULL) free(pv->y);
+  if (pv->dy != NULL) free(pv->dy);
+  if (pv->used_in_sources != NULL) free(pv->used_in_sources);
+  if (pv->index_full != NULL) free(pv->index_full);
+  if (pv->jacvec != NULL) free(pv->jacvec);
   free(pv);
 
   return _SUCCESS_;
@@ -6126,6 +7697,8 @@ int perturbations_approximations(
   double tau_dmu_idm_g = 0., tau_dmu_idm_dr = 0.;
   /* in case of idm_b there is a fourth condition */
   double tau_R_idm_b;
+  /* relaxation time of the idm velocity towards the photon one, \f$ 1/(S_{idm\_g} \dot{\mu}_{idm\_g}) \f$ */
+  double tau_S_dmu_idm_g;
   /** - compute Fourier mode time scale = \f$ \tau_k = 1/k \f$ */
 
 
@@ -6252,6 +7825,34 @@ int perturbations_approximations(
       }
     }
 
+    /* idm-baryon and idm-photon tight-coupling approximations: the
+       idm velocity follows that of its partner as long as the idm
+       relaxation time is short compared to the Hubble and Fourier time
+       scales. They are only coded for a single idm interaction. */
+    if (pth->has_idm_b == _TRUE_) {
+      tau_R_idm_b = 1./ppw->pvecthermo[pth->index_th_R_idm_b];
+      if ((pth->has_idm_g == _FALSE_) && (pth->has_idm_dr == _FALSE_) &&
+          (tau_R_idm_b/tau_h < ppr->idm_b_tight_coupling_trigger_tau_c_over_tau_h) &&
+          (tau_R_idm_b/tau_k < ppr->idm_b_tight_coupling_trigger_tau_c_over_tau_k)) {
+        ppw->approx[ppw->index_ap_tca_idm_b] = (int)tca_idm_b_on;
+      }
+      else {
+        ppw->approx[ppw->index_ap_tca_idm_b] = (int)tca_idm_b_off;
+      }
+    }
+
+    if (pth->has_idm_g == _TRUE_) {
+      tau_S_dmu_idm_g = tau_dmu_idm_g * 3./4.*ppw->pvecback[pba->index_bg_rho_idm]/ppw->pvecback[pba->index_bg_rho_g];
+      if ((pth->has_idm_b == _FALSE_) && (pth->has_idm_dr == _FALSE_) &&
+          (tau_S_dmu_idm_g/tau_h < ppr->idm_g_tight_coupling_trigger_tau_c_over_tau_h) &&
+          (tau_S_dmu_idm_g/tau_k < ppr->idm_g_tight_coupling_trigger_tau_c_over_tau_k)) {
+        ppw->approx[ppw->index_ap_tca_idm_g] = (int)tca_idm_g_on;
+      }
+      else {
+        ppw->approx[ppw->index_ap_tca_idm_g] = (int)tca_idm_g_off;
+      }
+    }
+
     /** - --> (c) free-streaming approximations */
 
     if ((tau/tau_k > ppr->radiation_streaming_trigger_tau_over_tau_k) &&
@@ -7532,15 +9133,20 @@ int perturbations_sources(
   a_prime_over_a = pvecback[pba->index_bg_a] * pvecback[pba->index_bg_H]; /* (a'/a)=aH */
   a_prime_over_a_prime = pvecback[pba->index_bg_H_prime] * pvecback[pba->index_bg_a] + pow(pvecback[pba->index_bg_H] * pvecback[pba->index_bg_a],2); /* (a'/a)' = aH'+(aH)^2 */
 
-  theta_b = y[ppw->pv->index_pt_theta_b];
-  theta_b_prime = dy[ppw->pv->index_pt_theta_b];
+  /* baryon (and idm) velocities only exist in the scalar vector of perturbations */
+  theta_b = 0.;
+  theta_b_prime = 0.;
+  if (_scalars_) {
+    theta_b = y[ppw->pv->index_pt_theta_b];
+    theta_b_prime = dy[ppw->pv->index_pt_theta_b];
+  }
   dkappa = pvecthermo[pth->index_th_dkappa];
   ddkappa = pvecthermo[pth->index_th_ddkappa];
   exp_m_kappa = pvecthermo[pth->index_th_exp_m_kappa];
   g = pvecthermo[pth->index_th_g];
   g_prime = pvecthermo[pth->index_th_dg];
 
-  if (pba->has_idm == _TRUE_) {
+  if ((_scalars_) && (pba->has_idm == _TRUE_)) {
     theta_idm= y[ppw->pv->index_pt_theta_idm];
     theta_idm_prime = dy[ppw->pv->index_pt_theta_idm];
   }
@@ -8775,6 +10381,7 @@ int perturbations_derivs(double tau,
   double dmu_idm_g = 0., photon_scattering_rate;
   double S_idm_dr=0., dmu_idm_dr=0., dmu_idr=0., tca_slip_idm_dr=0.;
   double R_idm_b = 0., dR_idm_b = 0., S_idm_b = 0.; /* these are just going to be used as a short hand notation */
+  double drag_idm_b = 0., drag_idm_g = 0., F_idm, F_tca = 0.;
 
   /* for use with non-cold dark matter (ncdm): */
   int index_q,n_ncdm,idx;
@@ -9008,6 +10615,46 @@ int perturbations_derivs(double tau,
 
     /** - --> (e) BEGINNING OF ACTUAL SYSTEM OF EQUATIONS OF EVOLUTION */
 
+    /* idm momentum exchange with baryons or photons. When the
+       corresponding idm tight-coupling approximation is on, the
+       exchange rate is not computed from the (stiff) velocity
+       difference, but from the condition that the idm velocity
+       evolves like that of its partner (theta_idm' = theta_b' or
+       theta_g'), to zeroth order in the idm relaxation time. F_idm
+       and F_tca are the idm and tightly-coupled photon-baryon
+       accelerations in absence of idm interactions. */
+    if ((pth->has_idm_b == _TRUE_) || (pth->has_idm_g == _TRUE_)) {
+
+      if (pth->has_idm_b == _TRUE_)
+        drag_idm_b = R_idm_b*(theta_idm-theta_b);
+      if (pth->has_idm_g == _TRUE_)
+        drag_idm_g = dmu_idm_g*(theta_idm-theta_g);
+
+      F_idm = -a_prime_over_a*theta_idm + metric_euler + k2*c2_idm*delta_idm;
+      if (ppw->approx[ppw->index_ap_tca] == (int)tca_on)
+        F_tca = (-a_prime_over_a*theta_b + k2*(delta_p_b_over_rho_b+R*delta_g/4.))/(1.+R) + metric_euler;
+
+      if ((pth->has_idm_b == _TRUE_) && (ppw->approx[ppw->index_ap_tca_idm_b] == (int)tca_idm_b_on)) {
+        if (ppw->approx[ppw->index_ap_tca] == (int)tca_off)
+          drag_idm_b = (F_idm - (-a_prime_over_a*theta_b + metric_euler + k2*delta_p_b_over_rho_b
+                                 + R*pvecthermo[pth->index_th_dkappa]*(theta_g-theta_b)))/(1.+S_idm_b);
+        else
+          drag_idm_b = (F_idm - F_tca)/(1.+S_idm_b/(1.+R));
+      }
+
+      if ((pth->has_idm_g == _TRUE_) && (ppw->approx[ppw->index_ap_tca_idm_g] == (int)tca_idm_g_on) &&
+          (ppw->approx[ppw->index_ap_rsa] == (int)rsa_off)) {
+        if (ppw->approx[ppw->index_ap_tca] == (int)tca_off)
+          drag_idm_g = (F_idm - (k2*(delta_g/4.-s2_squared*y[pv->index_pt_shear_g]) + metric_euler
+                                 + pvecthermo[pth->index_th_dkappa]*(theta_b-theta_g)))/(S_idm_g+1.);
+        else
+          drag_idm_g = (F_idm - F_tca)/(S_idm_g+R/(1.+R));
+      }
+
+      ppw->drag_idm_b = drag_idm_b;
+      ppw->drag_idm_g = drag_idm_g;
+    }
+
     /* start with idm as it might be needed during (normal) tca  */
     if (pba->has_idm == _TRUE_){
       dy[pv->index_pt_delta_idm] = -(theta_idm+metric_continuity); /* idm density */
@@ -9017,10 +10664,10 @@ int perturbations_derivs(double tau,
         + k2*c2_idm*delta_idm; /* idm velocity */
 
       if (pth->has_idm_g == _TRUE_) {
-        dy[pv->index_pt_theta_idm] += -S_idm_g*dmu_idm_g*(theta_idm-theta_g); /* correction to idm velocity due to idm_g */
+        dy[pv->index_pt_theta_idm] += -S_idm_g*drag_idm_g; /* correction to idm velocity due to idm_g */
       }
       if (pth->has_idm_b == _TRUE_){
-        dy[pv->index_pt_theta_idm] += -R_idm_b*(theta_idm-theta_b); /* correction to idm velocity due to idm_b */
+        dy[pv->index_pt_theta_idm] += -drag_idm_b; /* correction to idm velocity due to idm_b */
       }
       if (pth->has_idm_dr == _TRUE_) {
         if (ppw->approx[ppw->index_ap_tca_idm_dr] == (int)tca_idm_dr_off) {
@@ -9082,7 +10729,7 @@ int perturbations_derivs(double tau,
         + R*pvecthermo[pth->index_th_dkappa]*(theta_g-theta_b);
 
       if (pth->has_idm_b == _TRUE_) {
-        dy[pv->index_pt_theta_b] += S_idm_b*R_idm_b*(theta_idm-theta_b);
+        dy[pv->index_pt_theta_b] += S_idm_b*drag_idm_b;
       }
     }
 
@@ -9101,11 +10748,10 @@ int perturbations_derivs(double tau,
         +metric_euler;
 
       if (pth->has_idm_g == _TRUE_) {
-        dy[pv->index_pt_theta_b] +=
-          -dmu_idm_g * R/(1.+R) * (theta_g - theta_idm);
+        dy[pv->index_pt_theta_b] += R/(1.+R) * drag_idm_g;
       }
       if (pth->has_idm_b == _TRUE_) {
-        dy[pv->index_pt_theta_b] += (S_idm_b * R_idm_b * (theta_idm - theta_b))/(1.+R);
+        dy[pv->index_pt_theta_b] += S_idm_b * drag_idm_b/(1.+R);
       }
     }
 
@@ -9127,7 +10773,7 @@ int perturbations_derivs(double tau,
           + pvecthermo[pth->index_th_dkappa]*(theta_b-theta_g);
 
         if (pth->has_idm_g == _TRUE_) {
-          dy[pv->index_pt_theta_g] += dmu_idm_g * (theta_idm - theta_g);
+          dy[pv->index_pt_theta_g] += drag_idm_g;
         }
 
         /** - -----> photon temperature shear */
@@ -9144,12 +10790,8 @@ int perturbations_derivs(double tau,
           - photon_scattering_rate*y[pv->index_pt_l3_g];
 
         /** - -----> photon temperature l>3 */
-        for (l = 4; l < pv->l_max_g; l++) {
-
-          dy[pv->index_pt_delta_g+l] = k/(2.0*l+1.0)*
-            (l*s_l[l]*y[pv->index_pt_delta_g+l-1]-(l+1)*s_l[l+1]*y[pv->index_pt_delta_g+l+1])
-            - photon_scattering_rate*y[pv->index_pt_delta_g+l];
-        }
+        class_hierarchy(dy+pv->index_pt_delta_g,y+pv->index_pt_delta_g,s_l,k,photon_scattering_rate,
+                        4,pv->l_max_g,_PROFILE_L_MAX_G_);
 
         /** - -----> photon temperature lmax */
         l = pv->l_max_g; /* l=lmax */
@@ -9177,10 +10819,8 @@ int perturbations_derivs(double tau,
 
         /** - -----> photon polarization l>2 */
 
-        for (l=3; l < pv->l_max_pol_g; l++)
-          dy[pv->index_pt_pol0_g+l] = k/(2.*l+1)*
-            (l*s_l[l]*y[pv->index_pt_pol0_g+l-1]-(l+1.)*s_l[l+1]*y[pv->index_pt_pol0_g+l+1])
-            -photon_scattering_rate*y[pv->index_pt_pol0_g+l];
+        class_hierarchy(dy+pv->index_pt_pol0_g,y+pv->index_pt_pol0_g,s_l,k,photon_scattering_rate,
+                        3,pv->l_max_pol_g,_PROFILE_L_MAX_POL_G_);
 
         /** - -----> photon polarization lmax_pol */
 
@@ -9203,11 +10843,10 @@ int perturbations_derivs(double tau,
           +k2*(0.25*delta_g-s2_squared*ppw->tca_shear_g)+(1.+R)/R*metric_euler;
 
         if (pth->has_idm_g == _TRUE_) {
-          dy[pv->index_pt_theta_g] +=
-            -dmu_idm_g * (theta_g - theta_idm);
+          dy[pv->index_pt_theta_g] += drag_idm_g;
         }
         if (pth->has_idm_b == _TRUE_) {
-          dy[pv->index_pt_theta_g] += S_idm_b * R_idm_b * (theta_idm - theta_b) / R;
+          dy[pv->index_pt_theta_g] += S_idm_b * drag_idm_b / R;
         }
       }
 
@@ -9441,10 +11080,8 @@ int perturbations_derivs(double tau,
             (l*2.*s_l[l]*s_l[2]*y[pv->index_pt_shear_ur]-(l+1.)*s_l[l+1]*y[pv->index_pt_l3_ur+1]);
 
           /** - -----> exact ur l>3 */
-          for (l = 4; l < pv->l_max_ur; l++) {
-            dy[pv->index_pt_delta_ur+l] = k/(2.*l+1)*
-              (l*s_l[l]*y[pv->index_pt_delta_ur+l-1]-(l+1.)*s_l[l+1]*y[pv->index_pt_delta_ur+l+1]);
-          }
+          class_hierarchy(dy+pv->index_pt_delta_ur,y+pv->index_pt_delta_ur,s_l,k,0.,
+                          4,pv->l_max_ur,_PROFILE_L_MAX_UR_);
 
           /** - -----> exact ur lmax_ur */
           l = pv->l_max_ur;
@@ -9604,13 +11241,13 @@ int perturbations_derivs(double tau,
 
             /** - -----> ncdm l>3 for given momentum bin */
 
-            for (l=3; l<pv->l_max_ncdm[n_ncdm]; l++){
-              dy[idx+l] = qk_div_epsilon/(2.*l+1.0)*(l*s_l[l]*y[idx+(l-1)]-(l+1.)*s_l[l+1]*y[idx+(l+1)]);
-            }
+            class_hierarchy(dy+idx,y+idx,s_l,qk_div_epsilon,0.,
+                            3,pv->l_max_ncdm[n_ncdm],_PROFILE_L_MAX_NCDM_);
 
             /** - -----> ncdm lmax for given momentum bin (truncation as in Ma and Bertschinger)
                 but with curvature taken into account a la arXiv:1305.3261 */
 
+            l = pv->l_max_ncdm[n_ncdm];
             dy[idx+l] = qk_div_epsilon*y[idx+l-1]-(1.+l)*k*cotKgen*y[idx+l];
 
             /** - -----> jump to next momentum bin or species */
@@ -10135,7 +11772,7 @@ int perturbations_tca_slip_and_shear(double * y,
 
   /** - ---> standard photon velocity derivative without tca (neglecting shear) - only needed for idm_g_dr behavior */
   if (pth->has_idm_g == _TRUE_) {
-	theta_prime += -R/(1.+R) * dmu_idm_g * (theta_g - theta_idm);
+	theta_prime += R/(1.+R) * ppw->drag_idm_g;
   }
 
   /** - ---> like Ma & Bertschinger */
@@ -10175,15 +11812,21 @@ int perturbations_tca_slip_and_shear(double * y,
 
 
   if (pth->has_idm_g == _TRUE_ && (ppr->tight_coupling_approximation == (int)first_order_CLASS || ppr->tight_coupling_approximation == (int)second_order_CLASS ||  ppr->tight_coupling_approximation == (int)compromise_CLASS )) {
-    slip += -F*dmu_idm_g * ( k2*delta_g/4. + metric_euler + pvecthermo[pth->index_th_dkappa]*(theta_b-theta_g) + dmu_idm_g * (theta_idm - theta_g)
+    slip += -F*dmu_idm_g * ( k2*delta_g/4. + metric_euler + pvecthermo[pth->index_th_dkappa]*(theta_b-theta_g) + ppw->drag_idm_g
                              - theta_idm_prime);
   }
 
   if (pth->has_idm_b == _TRUE_) {
-    slip -= S_idm_b * tau_c/tau_idm_b / (1.+R)
-      * ( (a_prime_over_a - dtau_idm_b/tau_idm_b) * (theta_idm - theta_b)
-          + theta_idm_prime
-          - (-a_prime_over_a*theta_b + metric_euler + cb2*k2*delta_b + R/tau_c*(theta_g - theta_b) + S_idm_b*R_idm_b*(theta_idm - theta_b)) );
+    if (ppw->approx[ppw->index_ap_tca_idm_b] == (int)tca_idm_b_off) {
+      slip -= S_idm_b * tau_c/tau_idm_b / (1.+R)
+        * ( (a_prime_over_a - dtau_idm_b/tau_idm_b) * (theta_idm - theta_b)
+            + theta_idm_prime
+            - (-a_prime_over_a*theta_b + metric_euler + cb2*k2*delta_b + R/tau_c*(theta_g - theta_b) + S_idm_b*R_idm_b*(theta_idm - theta_b)) );
+    }
+    else {
+      /* idm and baryons move together: only the time dependence of the algebraic exchange rate contributes */
+      slip -= S_idm_b * tau_c / (1.+R) * (a_prime_over_a - dtau_idm_b/tau_idm_b) * ppw->drag_idm_b;
+    }
   }
 
   /** - ---> intermediate quantities for 2nd order tca: shear_g at first order in tight-coupling */
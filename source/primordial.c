@@ -221,7 +221,7 @@ int primordial_init(
     k_max = ppm->k_max_for_primordial_pk; /* last value, user-defined (i.e. if specified in .ini file) */
   }
   else{
-    k_max = ppt->k_max; /* last value, inferred from perturbations structure */
+    k_max = MAX(ppt->k_max,ppt->k_max_pk_tail); /* last value, inferred from perturbations structure (including the range of the analytic tail of P(k)) */
   }
 
   class_test(k_min <= 0.,
@@ -1616,13 +1616,11 @@ int primordial_inflation_spectra(
   double tstart, tstop, tspent;
 #endif
 
-#ifdef _OPENMP
-
-#pragma omp parallel
-  {
-    number_of_threads = omp_get_num_threads();
-  }
-#endif
+  /* number of threads adapted to the amount of work */
+  number_of_threads = class_number_of_threads(ppm->lnk_size,
+                                              _PRIMORDIAL_COST_PER_K_,
+                                              ppr->thread_overhead,
+                                              ppr->threads_primordial);
 
   abort = _FALSE_;
 
@@ -69,7 +69,7 @@ int thermodynamics_at_z(
   /** - define local variables */
   double x0;
   /* Dark matter baryon scattering */
-  double Vrms_idm_b2, T_diff_idm_b, m_b, FHe;
+  double Vrms_idm_b2, T_diff_idm_b, m_b;
   /* Varying fundamental constants */
   double sigmaTrescale = 1., alpha = 1., me = 1.;
 
@@ -154,7 +154,7 @@ int thermodynamics_at_z(
       /* For DM-g calculate at early times the optical depth parameters */
       if (pth->has_idm_g == _TRUE_) {
         /* calculate dmu_idm_g and its derivatives */
-        pvecthermo[pth->index_th_dmu_idm_g] = 3./8./_PI_/_G_*pow(1.+z, 2+pth->n_index_idm_g)*pba->Omega0_idm*pba->H0*pba->H0*pth->u_idm_g*pow(_c_,4)*_sigma_/1.e11/_eV_/_Mpc_over_m_;
+        pvecthermo[pth->index_th_dmu_idm_g] = pth->dmu_idm_g_coeff*pow(1.+z, 2+pth->n_index_idm_g);
         pvecthermo[pth->index_th_ddmu_idm_g] = -(2.+pth->n_index_idm_g) * pvecback[pba->index_bg_H] * pvecback[pba->index_bg_a] * pvecthermo[pth->index_th_dmu_idm_g];
         pvecthermo[pth->index_th_dddmu_idm_g] = (2.+pth->n_index_idm_g)*pvecthermo[pth->index_th_dmu_idm_g]/(1.+z) *
           (pvecback[pba->index_bg_H]*pvecback[pba->index_bg_H]/(1.+z) * (1.+pth->n_index_idm_g) - pvecback[pba->index_bg_H_prime]);
@@ -171,15 +171,13 @@ int thermodynamics_at_z(
       if (pth->has_idm_b == _TRUE_){
 
         /* some constants used in the scattering rate and temperatures */
-        FHe = 1-pth->YHe;
         m_b = _m_p_*_c_*_c_/_eV_;
         Vrms_idm_b2 = 1.e-8; /* approximation for V_rms at early times */
         T_diff_idm_b = (pvecthermo[pth->index_th_Tb]*_k_B_/_eV_/m_b)+(pvecthermo[pth->index_th_T_idm]*_k_B_/_eV_/pth->m_idm)+(Vrms_idm_b2/3.0); /* T and m are all in eV */
 
         /* Now compute the coupling coefficients */
-        pvecthermo[pth->index_th_R_idm_b] = (pvecback[pba->index_bg_a]*pvecback[pba->index_bg_rho_b]*pth->cross_idm_b*pth->n_coeff_idm_b/(m_b+pth->m_idm))
-          *pow(T_diff_idm_b,(pth->n_index_idm_b+1.0)/2.0)*FHe
-          *(3.e-4*pow(_c_,4.)/(8.*_PI_*_Mpc_over_m_*_G_*_eV_)); /* conversion coefficient for the units */
+        pvecthermo[pth->index_th_R_idm_b] = pth->R_idm_b_coeff*pvecback[pba->index_bg_a]*pvecback[pba->index_bg_rho_b]
+          *pow(T_diff_idm_b,(pth->n_index_idm_b+1.0)/2.0);
         pvecthermo[pth->index_th_dR_idm_b] = pvecthermo[pth->index_th_R_idm_b] * pvecback[pba->index_bg_a] * pvecback[pba->index_bg_H]
           * ( -2. - (1.+z) * (pth->n_index_idm_b+1.0)/2.0 * (pba->T_cmb*_k_B_/_eV_/m_b + pba->T_cmb*_k_B_/_eV_/pth->m_idm)/T_diff_idm_b);
       }
@@ -187,7 +185,7 @@ int thermodynamics_at_z(
       /* For idm_dr calculate at early times the optical depth parameters */
       if (pth->has_idm_dr == _TRUE_){
         /* calculate dmu_idm_dr and its derivatives */
-        pvecthermo[pth->index_th_dmu_idm_dr] = pth->a_idm_dr*pow((1.+z)/1.e7,pth->n_index_idm_dr)*pba->Omega0_idm*pow(pba->h,2);
+        pvecthermo[pth->index_th_dmu_idm_dr] = pth->dmu_idm_dr_coeff*pow(1.+z,pth->n_index_idm_dr);
         pvecthermo[pth->index_th_ddmu_idm_dr] =  -pvecback[pba->index_bg_H] * pth->n_index_idm_dr / (1+z) * pvecthermo[pth->index_th_dmu_idm_dr];
         pvecthermo[pth->index_th_dddmu_idm_dr] = (pvecback[pba->index_bg_H]*pvecback[pba->index_bg_H]/ (1.+z) * (pth->n_index_idm_dr - 1.) - pvecback[pba->index_bg_H_prime])
           * pth->n_index_idm_dr / (1.+z) * pvecthermo[pth->index_th_dmu_idm_dr];
@@ -220,7 +218,7 @@ int thermodynamics_at_z(
       pvecthermo[pth->index_th_T_idr] = pba->T_idr* (1+z);
 
       /* calculate dmu_idr (self interaction) */
-      pvecthermo[pth->index_th_dmu_idr] = pth->b_idr*pow((1.+z)/1.e7,pth->n_index_idm_dr)*pba->Omega0_idr*pow(pba->h,2);
+      pvecthermo[pth->index_th_dmu_idr] = pth->dmu_idr_coeff*pow(1.+z,pth->n_index_idm_dr);
     }
   }
 
@@ -354,6 +352,20 @@ int thermodynamics_init(
   /** - infer number of hydrogen nuclei today in m**-3 */
   pth->n_e = 3.*pow(pba->H0 * _c_ / _Mpc_over_m_,2)*pba->Omega0_b/(8.*_PI_*_G_*_m_H_)*(1.-pth->YHe);
 
+  /** - compute once the redshift-independent prefactors of the idm
+      and idr interaction rates, so that each evaluation of a rate
+      during the integration reduces to a single power of (1+z) or
+      T_diff */
+  if (pba->has_idm == _TRUE_) {
+    pth->dmu_idm_g_coeff = 3./8./_PI_/_G_*pba->Omega0_idm*pba->H0*pba->H0*pth->u_idm_g*pow(_c_,4)*_sigma_/1.e11/_eV_/_Mpc_over_m_;
+    pth->R_idm_b_coeff = pth->cross_idm_b*pth->n_coeff_idm_b/(_m_p_*_c_*_c_/_eV_+pth->m_idm)*(1.-pth->YHe)
+      *(3.e-4*pow(_c_,4.)/(8.*_PI_*_Mpc_over_m_*_G_*_eV_)); /* conversion coefficient for the units */
+    pth->dmu_idm_dr_coeff = pth->a_idm_dr*pow(1.e7,-pth->n_index_idm_dr)*pba->Omega0_idm*pba->h*pba->h;
+  }
+  if (pba->has_idr == _TRUE_) {
+    pth->dmu_idr_coeff = pth->b_idr*pow(1.e7,-pth->n_index_idm_dr)*pba->Omega0_idr*pba->h*pba->h;
+  }
+
   /** - test whether all parameters are in the correct regime */
   class_call(thermodynamics_checks(ppr,pba,pth),
              pth->error_message,
@@ -452,6 +464,8 @@ int thermodynamics_free(
   free(pth->tau_table);
   free(pth->thermodynamics_table);
   free(pth->d2thermodynamics_dz2_table);
+  free(pth->reco_key_H);
+  free(pth->reco_precision);
 
   return _SUCCESS_;
 }
@@ -1134,6 +1148,16 @@ int thermodynamics_set_parameters_reionization(
   /** - allocate the vector of parameters defining the function \f$ X_e(z) \f$ */
   class_alloc(preio->reionization_parameters,preio->re_size*sizeof(double),pth->error_message);
 
+  /** - allocate the coefficients of the jumps, for the binned schemes */
+  preio->jump_center = NULL;
+  preio->jump_coefficient = NULL;
+  if ((pth->reio_parametrization == reio_bins_tanh) ||
+      (pth->reio_parametrization == reio_many_tanh) ||
+      (pth->reio_parametrization == reio_inter)) {
+    class_alloc(preio->jump_center,preio->re_z_size*sizeof(double),pth->error_message);
+    class_alloc(preio->jump_coefficient,preio->re_z_size*sizeof(double),pth->error_message);
+  }
+
   class_test(ppr->reionization_sampling <= 0.0,
              pth->error_message,
              "stop to avoid division by zero. Reionization stepsize has to be larger than zero");
@@ -1459,6 +1483,11 @@ int thermodynamics_set_parameters_reionization(
     break;
   }
 
+  /** - derive the coefficients used to evaluate \f$ X_e(z) \f$ */
+  class_call(thermodynamics_reionization_prepare(pth,preio),
+             pth->error_message,
+             pth->error_message);
+
   return _SUCCESS_;
 
 }
@@ -1500,6 +1529,8 @@ int thermodynamics_solve(
   int index_interval;
   /* edge of intervals where approximation scheme is uniform: z_ini, z_switch_1, ..., z_end */
   double * interval_limit;
+  /* first interval to integrate */
+  int index_interval_start;
   /* other z sampling variables */
   int i;
   double * mz_output;
@@ -1551,10 +1582,21 @@ int thermodynamics_solve(
     interval_limit[index_ap+1] = -ptw->ptdw->ap_z_limits[index_ap];
   }
 
+  /** - if the history before reionization of a previous run can be
+      reused, start directly with the reionization approximation */
+
+  class_call(thermodynamics_recombination_reuse(ppr,pba,pth,ptw,interval_limit,pvecback),
+             pth->error_message,
+             pth->error_message);
+
+  index_interval_start = 0;
+  if (pth->has_recombination_reused == _TRUE_)
+    index_interval_start = ptw->ptdw->index_ap_reio;
+
   /** - loop over intervals over which approximation scheme is
       uniform. For each interval: */
 
-  for (index_interval=0; index_interval<interval_number; index_interval++) {
+  for (index_interval=index_interval_start; index_interval<interval_number; index_interval++) {
 
     /** - --> (a) fix current approximation scheme. */
 
@@ -1631,6 +1673,14 @@ int thermodynamics_solve(
                  pth->error_message);
     }
 
+    /** - --> (d) store the state at the beginning of the reionization approximation */
+    if (index_interval == ptw->ptdw->index_ap_reio-1) {
+      pth->reco_z_restart = -interval_limit[index_interval+1];
+      pth->reco_D_Tmat = ptw->ptdw->ptv->y[ptw->ptdw->ptv->index_ti_D_Tmat];
+      pth->reco_x_H = ptw->ptdw->ptv->y[ptw->ptdw->ptv->index_ti_x_H];
+      pth->reco_x_He = ptw->ptdw->ptv->y[ptw->ptdw->ptv->index_ti_x_He];
+    }
+
   }
 
   /** - Compute reionization optical depth, if not supplied as input parameter */
@@ -1661,6 +1711,163 @@ int thermodynamics_solve(
 
 }
 
+/**
+ * Identify the history before the reionization approximation by the
+ * Hubble rate on all redshifts of the table before reionization, the
+ * CMB temperature, the helium and electron abundances and the
+ * precision parameters (including the recombination fudge factors and
+ * switches, and the HyRec settings), and check
+ * whether that of a previous run passed in recombination_from is the
+ * same (up to the precision parameter tol_recombination_reuse). This
+ * is the case when only reionization parameters have changed, like
+ * tau_reio, z_reio or reionization_width. If so, copy its
+ * thermodynamics table above the starting redshift of reionization,
+ * and prepare the state from which the reionization approximation
+ * can be evolved.
+ *
+ * Models with exotic energy injection, interacting dark matter or
+ * varying fundamental constants are never reused.
+ *
+ * @param ppr            Input: pointer to precision structure
+ * @param pba            Input: pointer to background structure
+ * @param pth            Input/Output: pointer to thermodynamics structure
+ * @param ptw            Input/Output: pointer to thermodynamics workspace
+ * @param interval_limit Input: edges of the approximation intervals (in -z)
+ * @param pvecback       Input: pointer to some allocated pvecback
+ * @return the error status
+ */
+
+int thermodynamics_recombination_reuse(
+                                       struct precision * ppr,
+                                       struct background * pba,
+                                       struct thermodynamics * pth,
+                                       struct thermo_workspace * ptw,
+                                       double * interval_limit,
+                                       double * pvecback
+                                       ) {
+
+  struct thermodynamics * pth_old = pth->recombination_from;
+  struct thermo_diffeq_workspace * ptdw = ptw->ptdw;
+  struct thermo_vector * ptv;
+  int index_key, index_z, index_ti;
+  int last_index=0;
+  short compatible;
+
+  pth->has_recombination_reused = _FALSE_;
+
+  /** - compute the key of the history before reionization: Hubble
+      rate on all redshifts of the table above the starting redshift of
+      reionization, and precision parameters */
+
+  pth->reco_z_restart = -interval_limit[ptdw->index_ap_reio];
+
+  pth->reco_key_size = 0;
+  for (index_z=0; index_z < pth->tt_size; index_z++) {
+    if (pth->z_table[index_z] >= pth->reco_z_restart)
+      pth->reco_key_size++;
+  }
+
+  class_alloc(pth->reco_key_H,pth->reco_key_size*sizeof(double),pth->error_message);
+
+  for (index_key=0; index_key < pth->reco_key_size; index_key++) {
+    class_call(background_at_z(pba,
+                               pth->z_table[pth->tt_size-pth->reco_key_size+index_key],
+                               short_info,
+                               inter_normal,
+                               &last_index,
+                               pvecback),
+               pba->error_message,
+               pth->error_message);
+    pth->reco_key_H[index_key] = pvecback[pba->index_bg_H];
+  }
+
+  pth->reco_Tcmb = pba->T_cmb;
+
+  class_alloc(pth->reco_precision,sizeof(struct precision),pth->error_message);
+  *(pth->reco_precision) = *ppr;
+
+  /** - check whether the history of the previous run is the same */
+
+  if (pth_old == NULL)
+    return _SUCCESS_;
+
+  compatible = _TRUE_;
+
+  if ((pth->has_exotic_injection == _TRUE_) || (pba->has_idm == _TRUE_) || (pth->has_varconst == _TRUE_) ||
+      (pth_old->has_exotic_injection == _TRUE_) || (pth_old->has_varconst == _TRUE_) ||
+      (pth_old->recombination != pth->recombination) ||
+      (pth_old->recfast_photoion_mode != pth->recfast_photoion_mode) ||
+      (pth_old->th_size != pth->th_size) ||
+      (pth_old->tt_size != pth->tt_size) ||
+      (pth_old->reco_key_size != pth->reco_key_size) ||
+      (pth_old->reco_z_restart != pth->reco_z_restart) ||
+      (pth_old->reco_Tcmb != pth->reco_Tcmb) ||
+      (class_precision_equal(pth_old->reco_precision,pth->reco_precision) == _FALSE_) ||
+      (fabs(pth_old->fHe/pth->fHe-1.) > ppr->tol_recombination_reuse) ||
+      (fabs(pth_old->n_e/pth->n_e-1.) > ppr->tol_recombination_reuse)) {
+    compatible = _FALSE_;
+  }
+
+  for (index_key=0; (index_key < pth->reco_key_size) && (compatible == _TRUE_); index_key++) {
+    if (fabs(pth_old->reco_key_H[index_key]/pth->reco_key_H[index_key]-1.) > ppr->tol_recombination_reuse)
+      compatible = _FALSE_;
+  }
+
+  for (index_z=0; (index_z < pth->tt_size) && (compatible == _TRUE_); index_z++) {
+    if (pth_old->z_table[index_z] != pth->z_table[index_z])
+      compatible = _FALSE_;
+  }
+
+  if (pth->thermodynamics_verbose > 0) {
+    if (compatible == _TRUE_)
+      printf(" -> reusing the history of a previous run above z=%g, evolving only reionization\n",pth->reco_z_restart);
+    else
+      printf(" -> the history of the previous run before reionization cannot be used, evolving from z=%g\n",-interval_limit[0]);
+  }
+
+  if (compatible == _FALSE_)
+    return _SUCCESS_;
+
+  /** - copy the table above the starting redshift of reionization
+      (the row at this redshift is overwritten if the evolver outputs
+      it again, as it did in the previous run) */
+
+  for (index_z=pth->tt_size-1; (index_z >= 0) && (pth->z_table[index_z] >= pth->reco_z_restart); index_z--) {
+    memcpy(pth->thermodynamics_table+index_z*pth->th_size,
+           pth_old->thermodynamics_table+index_z*pth->th_size,
+           pth->th_size*sizeof(double));
+  }
+
+  /** - set the state at the end of the previous approximation, from
+      which thermodynamics_vector_init() starts the reionization one */
+
+  pth->reco_D_Tmat = pth_old->reco_D_Tmat;
+  pth->reco_x_H = pth_old->reco_x_H;
+  pth->reco_x_He = pth_old->reco_x_He;
+
+  class_alloc(ptv,sizeof(struct thermo_vector),pth->error_message);
+
+  index_ti = 0;
+  class_define_index(ptv->index_ti_D_Tmat,_TRUE_,index_ti,1);
+  class_define_index(ptv->index_ti_x_He,_TRUE_,index_ti,1);
+  class_define_index(ptv->index_ti_x_H,_TRUE_,index_ti,1);
+  ptv->ti_size = index_ti;
+
+  class_calloc(ptv->y,ptv->ti_size,sizeof(double),pth->error_message);
+  class_calloc(ptv->dy,ptv->ti_size,sizeof(double),pth->error_message);
+  class_calloc(ptv->used_in_output,ptv->ti_size,sizeof(int),pth->error_message);
+
+  ptv->y[ptv->index_ti_D_Tmat] = pth->reco_D_Tmat;
+  ptv->y[ptv->index_ti_x_He] = pth->reco_x_He;
+  ptv->y[ptv->index_ti_x_H] = pth->reco_x_H;
+
+  ptdw->ptv = ptv;
+
+  pth->has_recombination_reused = _TRUE_;
+
+  return _SUCCESS_;
+}
+
 /**
  * Calculate those thermodynamics quantities which are not inside of
  * the thermodynamics table already.
@@ -1843,6 +2050,8 @@ int thermodynamics_workspace_free(
   }
 
   free(ptw->ptrp->reionization_parameters);
+  free(ptw->ptrp->jump_center);
+  free(ptw->ptrp->jump_coefficient);
   free(ptw->ptdw);
   free(ptw->ptrp);
 
@@ -2232,6 +2441,10 @@ int thermodynamics_reionization_evolve_with_tau(
     break;
   }
 
+  class_call(thermodynamics_reionization_prepare(pth,ptw->ptrp),
+             pth->error_message,
+             pth->error_message);
+
   /* ptaw->ptw->last_index_back has been properly set according to the
      redshift z = -mz_inbi, we should keep memory of it */
   last_index_back_mz_ini = ptpaw->ptw->last_index_back;
@@ -2298,6 +2511,10 @@ int thermodynamics_reionization_evolve_with_tau(
     break;
   }
 
+  class_call(thermodynamics_reionization_prepare(pth,ptw->ptrp),
+             pth->error_message,
+             pth->error_message);
+
   /* reset ptaw->ptw->last_index_back to match the redshift z = -mz_inbi */
   ptpaw->ptw->last_index_back = last_index_back_mz_ini;
 
@@ -2372,6 +2589,10 @@ int thermodynamics_reionization_evolve_with_tau(
                pth->error_message,
                "starting redshift for reionization > reionization_z_start_max = %e",ppr->reionization_z_start_max);
 
+    class_call(thermodynamics_reionization_prepare(pth,ptw->ptrp),
+               pth->error_message,
+               pth->error_message);
+
     /* reset ptaw->ptw->last_index_back to match the redshift z = -mz_inbi */
     ptpaw->ptw->last_index_back = last_index_back_mz_ini;
 
@@ -4073,6 +4294,9 @@ int thermodynamics_ionization_fractions(
 /**
  * This subroutine contains the reionization function \f$ X_e(z) \f$ (one for each scheme) and gives x for a given z.
  *
+ * It is the one-point case of thermodynamics_reionization_function_list(),
+ * with the value of xe_before stored in the reionization parameters.
+ *
  * @param z     Input: redshift
  * @param pth   Input: pointer to thermodynamics structure, to know which scheme is used
  * @param preio Input: pointer to reionization parameters of the function \f$ X_e(z) \f$
@@ -4086,209 +4310,307 @@ int thermodynamics_reionization_function(
                                          double * x
                                          ) {
 
-  /** Summary: */
+  class_call(thermodynamics_reionization_function_list(&z,
+                                                       &(preio->reionization_parameters[preio->index_re_xe_before]),
+                                                       1,
+                                                       pth,
+                                                       preio,
+                                                       x),
+             pth->error_message,
+             pth->error_message);
 
-  /** - define local variables */
-  double argument;
+  return _SUCCESS_;
+}
+
+/**
+ * Derive from the reionization parameters the coefficients used by
+ * thermodynamics_reionization_function_list(): powers and inverse
+ * widths of the tanh profiles, centers and heights of the jumps,
+ * inverse widths of the interpolation intervals. To be called each
+ * time the parameters change, except xe_before, in which all
+ * functions \f$ X_e(z) \f$ are linear.
+ *
+ * @param pth   Input: pointer to thermodynamics structure, to know which scheme is used
+ * @param preio Input/Output: pointer to reionization parameters of the function \f$ X_e(z) \f$
+ * @return the error status
+ */
+
+int thermodynamics_reionization_prepare(
+                                        struct thermodynamics * pth,
+                                        struct thermo_reionization_parameters * preio
+                                        ) {
+
+  double * param = preio->reionization_parameters;
+  double * z_node;
+  double * xe_node;
+  double exponent;
   int i;
-  double z_jump;
 
-  int jump;
-  double center,before, after,width,one_jump;
-  double z_min, z_max;
+  preio->index_last_interval = 0;
+
+  switch (pth->reio_parametrization) {
+
+  case reio_none:
+    break;
+
+  case reio_camb:
+  case reio_half_tanh:
+    exponent = param[preio->index_re_reio_exponent];
+    preio->reio_redshift_pow = pow(1.+param[preio->index_re_reio_redshift],exponent);
+    preio->reio_inverse_width = 1./(exponent*pow(1.+param[preio->index_re_reio_redshift],exponent-1.)
+                                    *param[preio->index_re_reio_width]);
+    if (pth->reio_parametrization == reio_camb)
+      preio->helium_inverse_width = 1./param[preio->index_re_helium_fullreio_width];
+    break;
+
+  case reio_bins_tanh:
+    z_node = param + preio->index_re_first_z;
+    preio->inverse_sharpness = 1./param[preio->index_re_step_sharpness];
+    /* central redshift of the tanh jump in each interval */
+    for (i=0; i<preio->re_z_size-2; i++) {
+      preio->jump_center[i] = 0.5*(z_node[i+1]+z_node[i]);
+    }
+    preio->jump_center[preio->re_z_size-2] = z_node[preio->re_z_size-2] + 0.5*(z_node[preio->re_z_size-2]-z_node[preio->re_z_size-3]);
+    break;
+
+  case reio_many_tanh:
+    z_node = param + preio->index_re_first_z;
+    xe_node = param + preio->index_re_first_xe;
+    preio->inverse_sharpness = 1./param[preio->index_re_step_sharpness];
+    /* the last jump goes from xe_node[re_z_size-2] to xe_before: only the first part is stored */
+    for (i=1; i<preio->re_z_size-1; i++) {
+      preio->jump_center[i] = z_node[i];
+      preio->jump_coefficient[i] = xe_node[i];
+      if (i < preio->re_z_size-2)
+        preio->jump_coefficient[i] -= xe_node[i+1];
+    }
+    break;
+
+  case reio_inter:
+    z_node = param + preio->index_re_first_z;
+    for (i=0; i<preio->re_z_size-1; i++) {
+      preio->jump_coefficient[i] = 1./(z_node[i+1]-z_node[i]);
+    }
+    break;
+
+  default:
+    class_stop(pth->error_message,
+               "value of reio_parametrization=%d unclear",pth->reio_parametrization);
+    break;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Reionization function \f$ X_e(z) \f$ at a list of redshifts, for
+ * given values of the ionization fraction without reionization
+ * xe_before at each of them. The coefficients computed by
+ * thermodynamics_reionization_prepare() make each scheme a
+ * branch-free loop over the list: no pow() for the CAMB-like
+ * profiles, and a sum over contiguous arrays of jumps for
+ * reio_many_tanh. For the binned schemes, the interval containing z
+ * is searched from the one of the previous point, which is fastest
+ * for ordered lists.
+ *
+ * @param z         Input: array of redshifts
+ * @param xe_before Input: array of ionization fractions without reionization at each z
+ * @param z_size    Input: size of the arrays
+ * @param pth       Input: pointer to thermodynamics structure, to know which scheme is used
+ * @param preio     Input: pointer to reionization parameters of the function \f$ X_e(z) \f$
+ * @param x         Output: array of \f$ X_e(z) \f$ (already allocated)
+ * @return the error status
+ */
+
+int thermodynamics_reionization_function_list(
+                                              double * z,
+                                              double * xe_before,
+                                              int z_size,
+                                              struct thermodynamics * pth,
+                                              struct thermo_reionization_parameters * preio,
+                                              double * x
+                                              ) {
+
+  /** Summary: */
+
+  /** - define local variables */
+  double * param = preio->reionization_parameters;
+  double * z_node;
+  double * xe_node;
+  double z_start,exponent,xe_after,helium_fraction,helium_redshift;
+  double argument,weight,sum,xe_next;
+  int index_z,index_jump,i,last;
 
   switch (pth->reio_parametrization) {
 
     /** - no reionization means nothing to be added to xe_before */
   case reio_none:
-    *x = preio->reionization_parameters[preio->index_re_xe_before];
+    for (index_z=0; index_z<z_size; index_z++) {
+      x[index_z] = xe_before[index_z];
+    }
     break;
 
     /** - implementation of ionization function similar to the one in CAMB */
   case reio_camb:
 
-    /** - --> case z > z_reio_start */
-    if (z > preio->reionization_parameters[preio->index_re_reio_start]) {
-      *x = preio->reionization_parameters[preio->index_re_xe_before];
-    }
-    else {
-      /** - --> case z < z_reio_start: hydrogen contribution (tanh of complicated argument) */
-      argument = (pow((1.+preio->reionization_parameters[preio->index_re_reio_redshift]),
-                      preio->reionization_parameters[preio->index_re_reio_exponent])
-                  -pow((1.+z),preio->reionization_parameters[preio->index_re_reio_exponent]))
-        /(preio->reionization_parameters[preio->index_re_reio_exponent]
-          *pow((1.+preio->reionization_parameters[preio->index_re_reio_redshift]),
-               (preio->reionization_parameters[preio->index_re_reio_exponent]-1.)))
-        /preio->reionization_parameters[preio->index_re_reio_width];
-
-      *x = (preio->reionization_parameters[preio->index_re_xe_after]
-            -preio->reionization_parameters[preio->index_re_xe_before])
-        *(tanh(argument)+1.)/2.
-        +preio->reionization_parameters[preio->index_re_xe_before];
-
-      /** - --> case z < z_reio_start: helium contribution (tanh of simpler argument) */
-      argument = (preio->reionization_parameters[preio->index_re_helium_fullreio_redshift] - z)
-        /preio->reionization_parameters[preio->index_re_helium_fullreio_width];
-
-      *x += preio->reionization_parameters[preio->index_re_helium_fullreio_fraction]
-        *(tanh(argument)+1.)/2.;
+    z_start = param[preio->index_re_reio_start];
+    exponent = param[preio->index_re_reio_exponent];
+    xe_after = param[preio->index_re_xe_after];
+    helium_fraction = param[preio->index_re_helium_fullreio_fraction];
+    helium_redshift = param[preio->index_re_helium_fullreio_redshift];
+
+    for (index_z=0; index_z<z_size; index_z++) {
+
+      /** - --> case z > z_reio_start */
+      if (z[index_z] > z_start) {
+        x[index_z] = xe_before[index_z];
+      }
+      else {
+        /** - --> case z < z_reio_start: hydrogen contribution (tanh of complicated argument) */
+        argument = (preio->reio_redshift_pow - pow(1.+z[index_z],exponent))*preio->reio_inverse_width;
+
+        x[index_z] = (xe_after-xe_before[index_z])*(tanh(argument)+1.)/2.+xe_before[index_z];
+
+        /** - --> case z < z_reio_start: helium contribution (tanh of simpler argument) */
+        argument = (helium_redshift - z[index_z])*preio->helium_inverse_width;
+
+        x[index_z] += helium_fraction*(tanh(argument)+1.)/2.;
+      }
     }
     break;
 
     /** - implementation of half-tangent like in 1209.0247 */
   case reio_half_tanh:
 
-    /** - --> case z > z_reio_start */
-    if (z > preio->reionization_parameters[preio->index_re_reio_start]) {
-      *x = preio->reionization_parameters[preio->index_re_xe_before];
-    }
-    else {
-      /** - --> case z < z_reio_start: hydrogen contribution (tanh of complicated argument) */
-      argument = (pow((1.+preio->reionization_parameters[preio->index_re_reio_redshift]),
-                      preio->reionization_parameters[preio->index_re_reio_exponent])
-                  -pow((1.+z),preio->reionization_parameters[preio->index_re_reio_exponent]))
-        /(preio->reionization_parameters[preio->index_re_reio_exponent]
-          *pow((1.+preio->reionization_parameters[preio->index_re_reio_redshift]),
-               (preio->reionization_parameters[preio->index_re_reio_exponent]-1.)))
-        /preio->reionization_parameters[preio->index_re_reio_width];
-
-      /* argument goes from 0 to infty, not from -infty to infty like
-         in reio_camb case. Thus tanh(argument) goes from 0 to 1, not
-         from -1 to 1.  */
-
-      *x = (preio->reionization_parameters[preio->index_re_xe_after]
-            -preio->reionization_parameters[preio->index_re_xe_before])
-        *tanh(argument)
-        +preio->reionization_parameters[preio->index_re_xe_before];
+    z_start = param[preio->index_re_reio_start];
+    exponent = param[preio->index_re_reio_exponent];
+    xe_after = param[preio->index_re_xe_after];
+
+    for (index_z=0; index_z<z_size; index_z++) {
+
+      /** - --> case z > z_reio_start */
+      if (z[index_z] > z_start) {
+        x[index_z] = xe_before[index_z];
+      }
+      else {
+        /** - --> case z < z_reio_start: hydrogen contribution (tanh of complicated argument) */
+        argument = (preio->reio_redshift_pow - pow(1.+z[index_z],exponent))*preio->reio_inverse_width;
+
+        /* argument goes from 0 to infty, not from -infty to infty like
+           in reio_camb case. Thus tanh(argument) goes from 0 to 1, not
+           from -1 to 1.  */
+
+        x[index_z] = (xe_after-xe_before[index_z])*tanh(argument)+xe_before[index_z];
+      }
     }
     break;
 
     /** - implementation of binned ionization function similar to astro-ph/0606552 */
   case reio_bins_tanh:
 
-    /** - --> case z > z_reio_start */
-    if (z > preio->reionization_parameters[preio->index_re_first_z+preio->re_z_size-1]) {
-      *x = preio->reionization_parameters[preio->index_re_xe_before];
-    }
-    else if (z < preio->reionization_parameters[preio->index_re_first_z]) {
-      *x = preio->reionization_parameters[preio->index_re_first_xe];
-    }
-    else {
-      i = 0;
-      while (preio->reionization_parameters[preio->index_re_first_z+i+1]<z) i++;
-
-      /* fix the final xe to xe_before*/
-      preio->reionization_parameters[preio->index_re_first_xe+preio->re_z_size-1] = preio->reionization_parameters[preio->index_re_xe_before];
-
-      /* This is the expression of the tanh-like jumps of the reio_bins_tanh scheme until the 10.06.2015. It appeared to be
-         not robust enough. It could lead to a kink in xe(z) near the maximum value of z at which reionisation is sampled. It has
-         been replaced by the simpler and more robust expression below.
-
-         *xe = preio->reionization_parameters[preio->index_re_first_xe+i]
-         +0.5*(tanh((2.*(z-preio->reionization_parameters[preio->index_re_first_z+i])
-         /(preio->reionization_parameters[preio->index_re_first_z+i+1]
-         -preio->reionization_parameters[preio->index_re_first_z+i])-1.)
-         /preio->reionization_parameters[preio->index_re_step_sharpness])
-         /tanh(1./preio->reionization_parameters[preio->index_re_step_sharpness])+1.)
-         *(preio->reionization_parameters[preio->index_re_first_xe+i+1]
-         -preio->reionization_parameters[preio->index_re_first_xe+i]);
-      */
-
-      /* compute the central redshift value of the tanh jump */
-      if (i == preio->re_z_size-2) {
-        z_jump = preio->reionization_parameters[preio->index_re_first_z+i]
-          + 0.5*(preio->reionization_parameters[preio->index_re_first_z+i]
-                 -preio->reionization_parameters[preio->index_re_first_z+i-1]);
+    z_node = param + preio->index_re_first_z;
+    xe_node = param + preio->index_re_first_xe;
+    last = preio->re_z_size-1;
+    i = preio->index_last_interval;
+
+    for (index_z=0; index_z<z_size; index_z++) {
+
+      /** - --> case z > z_reio_start */
+      if (z[index_z] > z_node[last]) {
+        x[index_z] = xe_before[index_z];
       }
-      else{
-        z_jump =  0.5*(preio->reionization_parameters[preio->index_re_first_z+i+1]
-                       + preio->reionization_parameters[preio->index_re_first_z+i]);
+      else if (z[index_z] < z_node[0]) {
+        x[index_z] = xe_node[0];
+      }
+      else {
+        /* interval such that z_i < z <= z_{i+1} (or z_0 <= z <= z_1) */
+        while ((i > 0) && (z[index_z] <= z_node[i])) i--;
+        while (z_node[i+1] < z[index_z]) i++;
+
+        /* the final xe is xe_before */
+        xe_next = (i+1 == last) ? xe_before[index_z] : xe_node[i+1];
+
+        /* implementation of the tanh jump, centered on jump_center[i]
+           (see thermodynamics_reionization_prepare()) */
+        x[index_z] = xe_node[i]
+          +0.5*(tanh((z[index_z]-preio->jump_center[i])*preio->inverse_sharpness)+1.)
+          *(xe_next-xe_node[i]);
       }
-
-      /* implementation of the tanh jump */
-      *x = preio->reionization_parameters[preio->index_re_first_xe+i]
-        +0.5*(tanh((z-z_jump)
-                   /preio->reionization_parameters[preio->index_re_step_sharpness])+1.)
-        *(preio->reionization_parameters[preio->index_re_first_xe+i+1]
-          -preio->reionization_parameters[preio->index_re_first_xe+i]);
     }
+    preio->index_last_interval = i;
     break;
 
     /** - implementation of many tanh jumps */
   case reio_many_tanh:
 
-    /** - --> case z > z_reio_start */
-    if (z > preio->reionization_parameters[preio->index_re_first_z+preio->re_z_size-1]) {
-      *x = preio->reionization_parameters[preio->index_re_xe_before];
-    }
-    else if (z > preio->reionization_parameters[preio->index_re_first_z]) {
-
-      *x = preio->reionization_parameters[preio->index_re_xe_before];
-
-      /* fix the final xe to xe_before*/
-      preio->reionization_parameters[preio->index_re_first_xe+preio->re_z_size-1] = preio->reionization_parameters[preio->index_re_xe_before];
-
-      for (jump=1; jump<preio->re_z_size-1; jump++) {
+    z_node = param + preio->index_re_first_z;
+    xe_node = param + preio->index_re_first_xe;
+    last = preio->re_z_size-1;
 
-        center = preio->reionization_parameters[preio->index_re_first_z+preio->re_z_size-1-jump];
+    for (index_z=0; index_z<z_size; index_z++) {
 
-        /* before and after are meant with respect to growing z, not growing time */
-        before = preio->reionization_parameters[preio->index_re_first_xe+preio->re_z_size-1-jump]
-          -preio->reionization_parameters[preio->index_re_first_xe+preio->re_z_size-jump];
-        after = 0.;
-        width = preio->reionization_parameters[preio->index_re_step_sharpness];
-
-        one_jump = before + (after-before)*(tanh((z-center)/width)+1.)/2.;
-
-        *x += one_jump;
+      /** - --> case z > z_reio_start */
+      if (z[index_z] > z_node[last]) {
+        x[index_z] = xe_before[index_z];
       }
+      else if (z[index_z] > z_node[0]) {
+
+        /* sum of the jumps, with weights going from 1 at low z to 0 at high z; the
+           last one (index re_z_size-2) also brings x from xe_before to xe_node[re_z_size-2] */
+        sum = 0.;
+        weight = 0.;
+        for (index_jump=1; index_jump<last; index_jump++) {
+          weight = (1.-tanh((z[index_z]-preio->jump_center[index_jump])*preio->inverse_sharpness))/2.;
+          sum += preio->jump_coefficient[index_jump]*weight;
+        }
 
-    }
-    else{
-      *x = preio->reionization_parameters[preio->index_re_first_xe];
+        x[index_z] = xe_before[index_z]*(1.-weight) + sum;
+      }
+      else{
+        x[index_z] = xe_node[0];
+      }
     }
     break;
 
     /** - implementation of reio_inter */
   case reio_inter:
 
-    /** - --> case z > z_reio_start */
-    if (z > preio->reionization_parameters[preio->index_re_first_z+preio->re_z_size-1]) {
-      *x = preio->reionization_parameters[preio->index_re_xe_before];
-    }
-    else{
-      i=0;
-      while (preio->reionization_parameters[preio->index_re_first_z+i+1] < z) i++;
+    z_node = param + preio->index_re_first_z;
+    xe_node = param + preio->index_re_first_xe;
+    last = preio->re_z_size-1;
+    i = preio->index_last_interval;
 
-      z_min = preio->reionization_parameters[preio->index_re_first_z+i];
-      z_max = preio->reionization_parameters[preio->index_re_first_z+i+1];
+    for (index_z=0; index_z<z_size; index_z++) {
 
-      /* fix the final xe to xe_before*/
-      preio->reionization_parameters[preio->index_re_first_xe+preio->re_z_size-1] = preio->reionization_parameters[preio->index_re_xe_before];
+      /** - --> case z > z_reio_start */
+      if (z[index_z] > z_node[last]) {
+        x[index_z] = xe_before[index_z];
+      }
+      else{
+        class_test(z[index_z] < z_node[0],
+                   pth->error_message,
+                   "z out of range for reionization interpolation");
 
-      class_test(z<z_min,
-                 pth->error_message,
-                 "z out of range for reionization interpolation");
+        /* interval such that z_i < z <= z_{i+1} (or z_0 <= z <= z_1) */
+        while ((i > 0) && (z[index_z] <= z_node[i])) i--;
+        while (z_node[i+1] < z[index_z]) i++;
 
-      class_test(z>z_max,
-                 pth->error_message,
-                 "z out of range for reionization interpolation");
+        /* the final xe is xe_before */
+        xe_next = (i+1 == last) ? xe_before[index_z] : xe_node[i+1];
 
-      argument =(z-preio->reionization_parameters[preio->index_re_first_z+i])
-        /(preio->reionization_parameters[preio->index_re_first_z+i+1]
-          -preio->reionization_parameters[preio->index_re_first_z+i]);
+        argument = (z[index_z]-z_node[i])*preio->jump_coefficient[i];
 
-      *x = preio->reionization_parameters[preio->index_re_first_xe+i]
-        + argument*(preio->reionization_parameters[preio->index_re_first_xe+i+1]
-                    -preio->reionization_parameters[preio->index_re_first_xe+i]);
+        x[index_z] = xe_node[i] + argument*(xe_next-xe_node[i]);
 
-      class_test(*x<0.,
-                 pth->error_message,
-                 "Interpolation gives negative ionization fraction\n",
-                 argument,
-                 preio->reionization_parameters[preio->index_re_first_xe+i],
-                 preio->reionization_parameters[preio->index_re_first_xe+i+1]);
+        class_test(x[index_z]<0.,
+                   pth->error_message,
+                   "Interpolation gives negative ionization fraction\n",
+                   argument,
+                   xe_node[i],
+                   xe_next);
+      }
     }
+    preio->index_last_interval = i;
     break;
 
   default:
@@ -4469,7 +4791,7 @@ int thermodynamics_idm_quantities(struct background * pba,
 
   /* Thermo quantities */
   double T_g, Tmat, T_idr = 0.;
-  double Vrms_idm_b2, m_b, T_diff_idm_b, FHe;
+  double Vrms_idm_b2, m_b, T_diff_idm_b;
 
   T_g = ptw->Tcmb * (1.+z);
   Tmat = y[ptv->index_ti_D_Tmat] + T_g;
@@ -4477,7 +4799,7 @@ int thermodynamics_idm_quantities(struct background * pba,
   /** - First deal with any required dark radiation */
   if (pba->has_idr == _TRUE_) {
     T_idr = pba->T_idr*(1.+z);
-    ptdw->dmu_idr = pth->b_idr*pow((1.+z)/1.e7,pth->n_index_idm_dr)*pba->Omega0_idr*pow(pba->h,2);
+    ptdw->dmu_idr = pth->dmu_idr_coeff*pow(1.+z,pth->n_index_idm_dr);
   }
 
   /** - Now deal with any required dark matter (and its interactions) */
@@ -4501,13 +4823,13 @@ int thermodynamics_idm_quantities(struct background * pba,
     /* Now add also coupling to photons*/
     if (pth->has_idm_g == _TRUE_) {
       /* - photon interaction rate with idm_g */
-      ptdw->dmu_idm_g = 3./8./_PI_/_G_*pow(1.+z, 2+pth->n_index_idm_g)*pba->Omega0_idm*pba->H0*pba->H0*pth->u_idm_g*pow(_c_,4)*_sigma_/1.e11/_eV_/_Mpc_over_m_;
+      ptdw->dmu_idm_g = pth->dmu_idm_g_coeff*pow(1.+z, 2+pth->n_index_idm_g);
       ptdw->T_idm_prime += - 2.*4./3. * pvecback[pba->index_bg_rho_g]/pvecback[pba->index_bg_rho_idm] * ptdw->dmu_idm_g * (ptdw->T_idm  - T_g) / pvecback[pba->index_bg_H];
     }
     /* Now add also coupling to dark radiation */
     if (pth->has_idm_dr == _TRUE_) {
       /* - idr interaction rate with idm_dr */
-      ptdw->dmu_idm_dr = pth->a_idm_dr*pow((1.+ z)/1.e7,pth->n_index_idm_dr)*pba->Omega0_idm*pow(pba->h,2);
+      ptdw->dmu_idm_dr = pth->dmu_idm_dr_coeff*pow(1.+z,pth->n_index_idm_dr);
       ptdw->Sinv_idm_dr  = 4./3.*pvecback[pba->index_bg_rho_idr]/pvecback[pba->index_bg_rho_idm];
       ptdw->T_idm_prime += - 2* ptdw->dmu_idm_dr * ptdw->Sinv_idm_dr * (ptdw->T_idm - T_idr) / pvecback[pba->index_bg_H];
     }
@@ -4519,14 +4841,12 @@ int thermodynamics_idm_quantities(struct background * pba,
       else
         Vrms_idm_b2 = 1.e-8*pow(((1.+z)/1.e3),2);
 
-      FHe = 1- ptw->YHe;
       m_b = _m_p_*_c_*_c_/_eV_; /* Note that for now we always assume scattering with protons. This will be adapted in future versions. */
 
       T_diff_idm_b = (Tmat*_k_B_/_eV_/m_b)+(ptdw->T_idm*_k_B_/_eV_/pth->m_idm)+(Vrms_idm_b2/3.0);
 
-      ptdw->R_idm_b = (pvecback[pba->index_bg_a]*pvecback[pba->index_bg_rho_b]*pth->cross_idm_b*pth->n_coeff_idm_b/(m_b+pth->m_idm))
-        *pow(T_diff_idm_b,(pth->n_index_idm_b+1.0)/2.0)*FHe
-        *(3.e-4*pow(_c_,4.)/(8.*_PI_*_Mpc_over_m_*_G_*_eV_));
+      ptdw->R_idm_b = pth->R_idm_b_coeff*pvecback[pba->index_bg_a]*pvecback[pba->index_bg_rho_b]
+        *pow(T_diff_idm_b,(pth->n_index_idm_b+1.0)/2.0);
 
       ptdw->T_idm_prime += -2.*pth->m_idm/(pth->m_idm + m_b)*ptdw->R_idm_b*(ptdw->T_idm-Tmat) / pvecback[pba->index_bg_H];
     }
@@ -4673,7 +4993,7 @@ int thermodynamics_idm_initial_temperature(
   double* pvecback;
   int last_index;
   /* idm-b special parameters */
-  double m_b, FHe, T_diff_idm_b;
+  double m_b, T_diff_idm_b;
   /* steady state factors ( = prefactors in temperature evolution equation) */
   double alpha=0.,beta=0.,epsilon=0.;
 
@@ -4691,23 +5011,21 @@ int thermodynamics_idm_initial_temperature(
   /* idm-idr steady state */
   if ((pth->has_idm_dr == _TRUE_) && (pth->n_index_idm_dr == 0)) {
     epsilon = 2*4./3.*pvecback[pba->index_bg_rho_idr]/pvecback[pba->index_bg_rho_idm]*
-      pth->a_idm_dr*pow((1.+ z_ini)/1.e7,pth->n_index_idm_dr)*pba->Omega0_idm*pow(pba->h,2) / pvecback[pba->index_bg_H]*(1.+z_ini);
+      pth->dmu_idm_dr_coeff*pow(1.+z_ini,pth->n_index_idm_dr) / pvecback[pba->index_bg_H]*(1.+z_ini);
   }
   /* idm_g steady state */
   else if (pth->has_idm_g == _TRUE_ && pth->n_index_idm_g == -2) {
-    ptdw->dmu_idm_dr = pth->a_idm_dr*pow((1.+ z_ini)/1.e7,pth->n_index_idm_dr)*pba->Omega0_idm*pow(pba->h,2);
+    ptdw->dmu_idm_dr = pth->dmu_idm_dr_coeff*pow(1.+z_ini,pth->n_index_idm_dr);
     ptdw->Sinv_idm_dr  = 4./3.*pvecback[pba->index_bg_rho_idr]/pvecback[pba->index_bg_rho_idm];
     alpha = 2.* ptdw->dmu_idm_dr * ptdw->Sinv_idm_dr;
   }
   /* idm_b steady state */
   else if (pth->has_idm_b == _TRUE_ && pth->n_index_idm_b == -3) {
-    FHe = 1-pth->YHe;
     m_b = _m_p_*_c_*_c_/_eV_;
     /* This is super-highly approximated, and will not usually be correct. However, the small error we incur should be corrected by the evolution equation */
     T_diff_idm_b = (pba->T_cmb*(1.+z_ini)*_k_B_/_eV_/m_b)+(pba->T_cmb*(1.+z_ini)*_k_B_/_eV_/pth->m_idm)+(1.e-8/3.0);
-    ptdw->R_idm_b = (pvecback[pba->index_bg_a]*pvecback[pba->index_bg_rho_b]*pth->cross_idm_b*pth->n_coeff_idm_b/(m_b+pth->m_idm))
-      *pow(T_diff_idm_b,(pth->n_index_idm_b+1.0)/2.0)*FHe
-      *(3.e-4*pow(_c_,4.)/(8.*_PI_*_Mpc_over_m_*_G_*_eV_));
+    ptdw->R_idm_b = pth->R_idm_b_coeff*pvecback[pba->index_bg_a]*pvecback[pba->index_bg_rho_b]
+      *pow(T_diff_idm_b,(pth->n_index_idm_b+1.0)/2.0);
     alpha = 2.*pth->m_idm/(pth->m_idm + m_b)*ptdw->R_idm_b;
   }
 
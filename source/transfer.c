@@ -69,6 +69,10 @@ int transfer_functions_at_q(
                             ) {
   /** Summary: */
 
+  class_test(ptr->transfer_released == _TRUE_,
+             ptr->error_message,
+             "transfer functions have already been released; add 'transfer' to the input parameter 'queries' to keep them");
+
   /** - interpolate in pre-computed table using array_interpolate_two() */
   class_call(array_interpolate_two(
                                    ptr->q,
@@ -138,6 +142,10 @@ int transfer_init(
   /* maximum number of sampling times for transfer sources */
   int tau_size_max;
 
+  /* maximum number of initial conditions over all modes */
+  int ic_size_max;
+  int index_md;
+
   /* array of sources S(k,tau), just taken from perturbation module,
      or transformed if non-linear corrections are needed
      sources[index_md][index_ic * ppt->tp_size[index_md] + index_tp][index_tau * ppt->k_size[index_md] + index_k]
@@ -172,6 +180,9 @@ int transfer_init(
      parallel region. */
   int abort;
 
+  /* number of threads (always one if no openmp) */
+  int number_of_threads;
+
 #ifdef _OPENMP
 
   /* instrumentation times */
@@ -181,10 +192,18 @@ int transfer_init(
 
   /** - check whether any spectrum in harmonic space (i.e., any \f$C_l\f$'s) is actually requested */
 
+  ptr->transfer_released = _FALSE_;
+
   if (ppt->has_cls == _FALSE_) {
     ptr->has_cls = _FALSE_;
     if (ptr->transfer_verbose > 0)
       printf("No harmonic space transfer functions to compute. Transfer module skipped.\n");
+    /* the sources were only needed by the fourier module */
+    if (ppt->release_sources == _TRUE_) {
+      class_call(perturbations_release_sources(ppt),
+                 ppt->error_message,
+                 ptr->error_message);
+    }
     return _SUCCESS_;
   }
   else
@@ -220,6 +239,14 @@ int transfer_init(
              ptr->error_message,
              ptr->error_message);
 
+  /** - if early and late contributions must be stored separately,
+      allocate the former, and eventually take them from a previous
+      run, using transfer_split_init() */
+
+  class_call(transfer_split_init(ppr,pba,pth,ppt,ptr),
+             ptr->error_message,
+             ptr->error_message);
+
   /** - copy sources to a local array sources (in fact, only the pointers are copied, not the data), and eventually apply non-linear corrections to the sources */
 
   class_alloc(sources,
@@ -258,7 +285,8 @@ int transfer_init(
              ptr->error_message,
              ptr->error_message);
 
-  /** - compute flat spherical bessel functions */
+  /** - compute flat spherical bessel functions (tabulated only below
+      hyper_l_flat_asymptotic, evaluated on the fly above) */
 
   xmax = ptr->q[ptr->q_size-1]*tau0;
   if (pba->sgnK == -1)
@@ -271,7 +299,7 @@ int transfer_init(
                                        ppr->hyper_x_min,
                                        xmax,
                                        ppr->hyper_sampling_flat,
-                                       ptr->l[ptr->l_size_max-1]+1,
+                                       MIN(ptr->l[ptr->l_size_max-1]+1,ppr->hyper_l_flat_asymptotic),
                                        ppr->hyper_phi_min_abs,
                                        &BIS,
                                        ptr->error_message),
@@ -309,13 +337,27 @@ int transfer_init(
   /* (a.3.) workspace, allocated in a parallel zone since in openmp
      version there is one workspace per thread */
 
+  ic_size_max = 0;
+  for (index_md = 0; index_md < ptr->md_size; index_md++)
+    ic_size_max = MAX(ic_size_max,ppt->ic_size[index_md]);
+
+  /* number of threads adapted to the amount of work (q_size line-of-sight integrals for each l and tau) */
+  number_of_threads = class_number_of_threads(ptr->q_size,
+                                              (double)ptr->l_size_max*ppt->tau_size*_TRANSFER_COST_,
+                                              ppr->thread_overhead,
+                                              ppr->threads_transfer);
+
+  if (ptr->transfer_verbose > 1)
+    printf(" -> using %d thread(s) for %zu wavenumbers\n",number_of_threads,ptr->q_size);
+
   /* initialize error management flag */
   abort = _FALSE_;
 
   /* beginning of parallel region */
 #pragma omp parallel                                                    \
-  shared(tau_size_max,ptr,ppr,pba,ppt,tp_of_tt,tau_rec,sources_spline,abort,BIS,tau0) \
-  private(ptw,index_q,tstart,tstop,tspent)
+  shared(tau_size_max,ic_size_max,ptr,ppr,pba,ppt,tp_of_tt,tau_rec,sources_spline,abort,BIS,tau0) \
+  private(ptw,index_q,tstart,tstop,tspent)                              \
+  num_threads(number_of_threads)
   {
 
 #ifdef _OPENMP
@@ -330,6 +372,7 @@ int transfer_init(
                                                 ppr,
                                                 &ptw,
                                                 ppt->tau_size,
+                                                ic_size_max,
                                                 tau_size_max,
                                                 pba->K,
                                                 pba->sgnK,
@@ -419,7 +462,54 @@ int transfer_init(
   class_call(hyperspherical_HIS_free(&BIS,ptr->error_message),
              ptr->error_message,
              ptr->error_message);
+
+  /** - no other module reads the sources after this one: release them if requested */
+  if (ppt->release_sources == _TRUE_) {
+    class_call(perturbations_release_sources(ppt),
+               ppt->error_message,
+               ptr->error_message);
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * Free the table of transfer functions as soon as the harmonic
+ * module has computed the \f$ C_l\f$'s.
+ *
+ * Called at the end of harmonic_init() when ptr->release_transfer is
+ * set. The rest of the transfer structure is kept until
+ * transfer_free(), which then skips the released table.
+ *
+ * @param ppt Input: pointer to perturbation structure
+ * @param ptr Input/Output: pointer to transfer structure
+ * @return the error status
+ */
+
+int transfer_release_tables(
+                            struct perturbations * ppt,
+                            struct transfer * ptr
+                            ) {
+
+  int index_md;
+  double size=0.;
+
+  if ((ptr->has_cls == _FALSE_) || (ptr->transfer_released == _TRUE_))
+    return _SUCCESS_;
+
+  for (index_md = 0; index_md < ptr->md_size; index_md++) {
+    free(ptr->transfer[index_md]);
+    ptr->transfer[index_md] = NULL;
+    size += (double)ppt->ic_size[index_md]*ptr->tt_size[index_md]*ptr->l_size[index_md]*ptr->q_size;
+  }
+
+  ptr->transfer_released = _TRUE_;
+
+  if (ptr->transfer_verbose > 0)
+    printf(" -> released transfer functions (%.1f MB)\n",size*sizeof(double)/1024./1024.);
+
   return _SUCCESS_;
+
 }
 
 /**
@@ -446,6 +536,16 @@ int transfer_free(
       free(ptr->k[index_md]);
     }
 
+    if (ptr->has_split == _TRUE_) {
+      for (index_md = 0; index_md < ptr->md_size; index_md++) {
+        free(ptr->transfer_early[index_md]);
+      }
+      free(ptr->transfer_early);
+      free(ptr->split_ic_size);
+      free(ptr->split_key);
+      free(ptr->split_precision);
+    }
+
     free(ptr->tt_size);
     free(ptr->l_size_tt);
     free(ptr->l_size);
@@ -517,6 +617,18 @@ int transfer_indices(
 
   index_tt_common=index_tt;
 
+  /** - when nuisance-separable number counts are requested, the
+      terms of d1, G2 and G5 linear in the magnification bias need
+      their own transfer types (the terms of nc_lens and G4 are
+      proportional to the rest and need none) */
+
+  ptr->has_nc_rsd_mag = _FALSE_;
+  ptr->has_nc_gr_mag = _FALSE_;
+  if (ptr->has_nc_components == _TRUE_) {
+    ptr->has_nc_rsd_mag = ppt->has_nc_rsd;
+    ptr->has_nc_gr_mag = ppt->has_nc_gr;
+  }
+
   /** - type indices for scalars */
 
   if (ppt->has_scalars == _TRUE_) {
@@ -536,6 +648,9 @@ int transfer_indices(
     class_define_index(ptr->index_tt_nc_g3,  ppt->has_nc_gr,                   index_tt,ppt->selection_num);
     class_define_index(ptr->index_tt_nc_g4,  ppt->has_nc_gr,                   index_tt,ppt->selection_num);
     class_define_index(ptr->index_tt_nc_g5,  ppt->has_nc_gr,                   index_tt,ppt->selection_num);
+    class_define_index(ptr->index_tt_d1_mag,   ptr->has_nc_rsd_mag,            index_tt,ppt->selection_num);
+    class_define_index(ptr->index_tt_nc_g2_mag,ptr->has_nc_gr_mag,             index_tt,ppt->selection_num);
+    class_define_index(ptr->index_tt_nc_g5_mag,ptr->has_nc_gr_mag,             index_tt,ppt->selection_num);
     class_define_index(ptr->index_tt_lensing,ppt->has_cl_lensing_potential,    index_tt,ppt->selection_num);
 
     ptr->tt_size[ppt->index_md_scalars]=index_tt;
@@ -682,7 +797,7 @@ int transfer_perturbation_copy_sources_and_nl_corrections(
                   ppt->sources[index_md]
                   [index_ic * ppt->tp_size[index_md] + index_tp]
                   [index_tau * ppt->k_size[index_md] + index_k]
-                  * pfo->nl_corr_density[pfo->index_pk_cb][index_tau * ppt->k_size[index_md] + index_k];
+                  * pfo->nl_corr_density[pfo->index_pk_cb][index_tau * pfo->k_size + index_k];
               }
               else{
                 sources[index_md]
@@ -691,7 +806,7 @@ int transfer_perturbation_copy_sources_and_nl_corrections(
                   ppt->sources[index_md]
                   [index_ic * ppt->tp_size[index_md] + index_tp]
                   [index_tau * ppt->k_size[index_md] + index_k]
-                  * pfo->nl_corr_density[pfo->index_pk_m][index_tau * ppt->k_size[index_md] + index_k];
+                  * pfo->nl_corr_density[pfo->index_pk_m][index_tau * pfo->k_size + index_k];
               }
             }
           }
@@ -962,7 +1077,10 @@ int transfer_get_l_list(
             (_index_tt_in_range_(ptr->index_tt_nc_g2,   ppt->selection_num, ppt->has_nc_gr))  ||
             (_index_tt_in_range_(ptr->index_tt_nc_g3,   ppt->selection_num, ppt->has_nc_gr))  ||
             (_index_tt_in_range_(ptr->index_tt_nc_g4,   ppt->selection_num, ppt->has_nc_gr))  ||
-            (_index_tt_in_range_(ptr->index_tt_nc_g5,   ppt->selection_num, ppt->has_nc_gr))
+            (_index_tt_in_range_(ptr->index_tt_nc_g5,   ppt->selection_num, ppt->has_nc_gr))  ||
+            (_index_tt_in_range_(ptr->index_tt_d1_mag,    ppt->selection_num, ptr->has_nc_rsd_mag)) ||
+            (_index_tt_in_range_(ptr->index_tt_nc_g2_mag, ppt->selection_num, ptr->has_nc_gr_mag))  ||
+            (_index_tt_in_range_(ptr->index_tt_nc_g5_mag, ppt->selection_num, ptr->has_nc_gr_mag))
             )
           l_max=ppt->l_lss_max;
 
@@ -1393,6 +1511,15 @@ int transfer_get_source_correspondence(
         if (_index_tt_in_range_(ptr->index_tt_nc_g5,   ppt->selection_num, ppt->has_nc_gr))
           tp_of_tt[index_md][index_tt]=ppt->index_tp_phi_plus_psi;
 
+        if (_index_tt_in_range_(ptr->index_tt_d1_mag,    ppt->selection_num, ptr->has_nc_rsd_mag))
+          tp_of_tt[index_md][index_tt]=ppt->index_tp_theta_m;
+
+        if (_index_tt_in_range_(ptr->index_tt_nc_g2_mag, ppt->selection_num, ptr->has_nc_gr_mag))
+          tp_of_tt[index_md][index_tt]=ppt->index_tp_phi;
+
+        if (_index_tt_in_range_(ptr->index_tt_nc_g5_mag, ppt->selection_num, ptr->has_nc_gr_mag))
+          tp_of_tt[index_md][index_tt]=ppt->index_tp_phi_plus_psi;
+
         if ((ppt->has_cl_lensing_potential == _TRUE_) && (index_tt >= ptr->index_tt_lensing) && (index_tt < ptr->index_tt_lensing+ppt->selection_num))
           tp_of_tt[index_md][index_tt]=ppt->index_tp_phi_plus_psi;
 
@@ -1578,6 +1705,12 @@ int transfer_source_tau_size(
       if (_index_tt_in_range_(ptr->index_tt_nc_g3,   ppt->selection_num, ppt->has_nc_gr))
         bin = index_tt - ptr->index_tt_nc_g3;
 
+      if (_index_tt_in_range_(ptr->index_tt_d1_mag,    ppt->selection_num, ptr->has_nc_rsd_mag))
+        bin = index_tt - ptr->index_tt_d1_mag;
+
+      if (_index_tt_in_range_(ptr->index_tt_nc_g2_mag, ppt->selection_num, ptr->has_nc_gr_mag))
+        bin = index_tt - ptr->index_tt_nc_g2_mag;
+
       /* time interval for this bin */
       class_call(transfer_selection_times(ppr,
                                           pba,
@@ -1633,6 +1766,9 @@ int transfer_source_tau_size(
       if (_index_tt_in_range_(ptr->index_tt_nc_g5,   ppt->selection_num, ppt->has_nc_gr))
         bin = index_tt - ptr->index_tt_nc_g5;
 
+      if (_index_tt_in_range_(ptr->index_tt_nc_g5_mag, ppt->selection_num, ptr->has_nc_gr_mag))
+        bin = index_tt - ptr->index_tt_nc_g5_mag;
+
       /* time interval for this bin */
       class_call(transfer_selection_times(ppr,
                                           pba,
@@ -1650,7 +1786,8 @@ int transfer_source_tau_size(
 
       /* value of l at which the code switches to Limber approximation
          (necessary for next step) */
-      if (_index_tt_in_range_(ptr->index_tt_nc_g5,   ppt->selection_num, ppt->has_nc_gr)) {
+      if ((_index_tt_in_range_(ptr->index_tt_nc_g5,   ppt->selection_num, ppt->has_nc_gr)) ||
+          (_index_tt_in_range_(ptr->index_tt_nc_g5_mag, ppt->selection_num, ptr->has_nc_gr_mag))) {
         /* Even if G5 is integrated along the line-of-sight, we do not apply the same Limber criteria as for the other integrated terms, because here we have the derivative of the Bessel.  */
         l_limber=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[bin];
         *tau_size=MAX(*tau_size,(int)((tau0-tau_min)/((tau0-tau_mean)/2./MIN(l_limber,ppt->l_lss_max)))*ppr->selection_sampling_bessel);
@@ -1680,6 +1817,32 @@ int transfer_source_tau_size(
   return _SUCCESS_;
 }
 
+/**
+ * This routine computes the transfer functions of all modes, initial
+ * conditions, types and multipoles for a given wavenumber.
+ *
+ * Consecutive types sharing the same time sampling (e.g. the CMB
+ * temperature and polarization types) are processed together with
+ * all initial conditions: their sources are stored side by side in
+ * the workspace, and for each l the hyperspherical Bessel functions
+ * are interpolated only once for all of them in
+ * transfer_compute_for_each_l().
+ *
+ * @param ppr                 Input: pointer to precision structure
+ * @param pba                 Input: pointer to background structure
+ * @param ppt                 Input: pointer to perturbation structure
+ * @param ptr                 Input/output: pointer to transfer structure (result stored there)
+ * @param tp_of_tt            Input: correspondence between transfer types and perturbation sources
+ * @param index_q             Input: index of wavenumber
+ * @param tau_size_max        Input: maximum number of times for transfer sources
+ * @param tau_rec             Input: conformal time at recombination
+ * @param pert_sources        Input: sources of the perturbation module
+ * @param pert_sources_spline Input: their second derivatives with respect to k
+ * @param window              Input: precomputed window functions for number counts and lensing
+ * @param ptw                 Input: pointer to transfer workspace
+ * @return the error status
+ */
+
 int transfer_compute_for_each_q(
                                 struct precision * ppr,
                                 struct background * pba,
@@ -1708,46 +1871,19 @@ int transfer_compute_for_each_q(
   /* running index for multipoles */
   int index_l;
 
-  /** - we deal with workspaces, i.e. with contiguous memory zones (one
-      per thread) containing various fields used by the integration
-      routine */
-
-  /* - first workspace field: perturbation source interpolated from perturbation structure */
-  double * interpolated_sources;
-
-  /* - second workspace field: list of tau0-tau values, tau0_minus_tau[index_tau] */
-  double * tau0_minus_tau;
-
-  /* - third workspace field: list of trapezoidal weights for integration over tau */
-  double * w_trapz;
-
-  /* - fourth workspace field, containing just a double: number of time values */
-  int * tau_size;
-
-  /* - fifth workspace field, identical to above interpolated sources:
-     sources[index_tau] */
-  double * sources;
-
-  /** - for a given l, maximum value of k such that we can convolve
-      the source with Bessel functions j_l(x) without reaching x_max */
-  double q_max_bessel;
-
   /* a value of index_type */
   int previous_type;
 
-  double l;
+  /* number of types in the current group (sharing the same time
+     sampling), whose sources are stored in ptw->source_table */
+  int group_size;
 
-  short neglect;
+  /* number of time values for the type being read */
+  int tau_size_next;
 
-  radial_function_type radial_type;
+  short same_sampling;
 
-  /** - store the sources in the workspace and define all
-      fields in this workspace */
-  interpolated_sources = ptw->interpolated_sources;
-  tau0_minus_tau = ptw->tau0_minus_tau;
-  w_trapz  = ptw->w_trapz;
-  tau_size = &(ptw->tau_size);
-  sources = ptw->sources;
+  double * pointer;
 
   /** - loop over all modes. For each mode */
 
@@ -1757,23 +1893,22 @@ int transfer_compute_for_each_q(
 
     if (ptr->k[index_md][index_q] <= ppt->k[index_md][ppt->k_size_cl[index_md]-1]) {
 
-      /** - loop over initial conditions. */
-      /* For each of them: */
+      /* initialize the previous type index */
+      previous_type=-1;
 
-      for (index_ic = 0; index_ic < ppt->ic_size[index_md]; index_ic++) {
+      group_size = 0;
 
-        /* initialize the previous type index */
-        previous_type=-1;
+      /** - loop over types. For each of them: */
 
-        /* - loop over types. For each of them: */
+      for (index_tt = 0; index_tt < ptr->tt_size[index_md]; index_tt++) {
 
-        for (index_tt = 0; index_tt < ptr->tt_size[index_md]; index_tt++) {
+        /** - --> check if we must now deal with a new source with a
+            new index ppt->index_type. If yes, interpolate it at the
+            right values of k, for all initial conditions. */
 
-          /** - check if we must now deal with a new source with a
-              new index ppt->index_type. If yes, interpolate it at the
-              right values of k. */
+        if (tp_of_tt[index_md][index_tt] != previous_type) {
 
-          if (tp_of_tt[index_md][index_tt] != previous_type) {
+          for (index_ic = 0; index_ic < ppt->ic_size[index_md]; index_ic++) {
 
             class_call(transfer_interpolate_sources(ppt,
                                                     ptr,
@@ -1783,142 +1918,112 @@ int transfer_compute_for_each_q(
                                                     tp_of_tt[index_md][index_tt],
                                                     pert_sources[index_md][index_ic * ppt->tp_size[index_md] + tp_of_tt[index_md][index_tt]],
                                                     pert_sources_spline[index_md][index_ic * ppt->tp_size[index_md] + tp_of_tt[index_md][index_tt]],
-                                                    interpolated_sources),
+                                                    ptw->interpolated_sources+index_ic*ptw->perturbations_tau_size),
                        ptr->error_message,
                        ptr->error_message);
           }
+        }
+
+        previous_type = tp_of_tt[index_md][index_tt];
 
-          previous_type = tp_of_tt[index_md][index_tt];
+        /** - --> compute the transfer sources of this type for all
+            initial conditions, and store them after those of the
+            previous types of the group.
 
-          /* the code makes a distinction between "perturbation
-             sources" (e.g. gravitational potential) and "transfer
-             sources" (e.g. total density fluctuations, obtained
-             through the Poisson equation, and observed with a given
-             selection function).
+            The code makes a distinction between "perturbation
+            sources" (e.g. gravitational potential) and "transfer
+            sources" (e.g. total density fluctuations, obtained
+            through the Poisson equation, and observed with a given
+            selection function). The next routine computes the
+            transfer source given the interpolated perturbation
+            source. The time sampling is written in the "next"
+            arrays, to be compared with that of the group. */
 
-             The next routine computes the transfer source given the
-             interpolated perturbation source, and copies it in the
-             workspace. */
+        class_call(transfer_workspace_source_table(ptr,ptw,group_size+1),
+                   ptr->error_message,
+                   ptr->error_message);
+
+        for (index_ic = 0; index_ic < ppt->ic_size[index_md]; index_ic++) {
 
           class_call(transfer_sources(ppr,
                                       pba,
                                       ppt,
                                       ptr,
-                                      interpolated_sources,
+                                      ptw->interpolated_sources+index_ic*ptw->perturbations_tau_size,
                                       tau_rec,
                                       index_q,
                                       index_md,
                                       index_tt,
-                                      sources,
+                                      ptw->source_table+((size_t)group_size*ptw->ic_size+index_ic)*tau_size_max,
                                       window,
                                       tau_size_max,
-                                      tau0_minus_tau,
-                                      w_trapz,
-                                      tau_size),
-                     ptr->error_message,
-                     ptr->error_message);
-
-          /* now that the array of times tau0_minus_tau is known, we can
-             infer the array of radial coordinates r(tau0_minus_tau) as well as a
-             few other quantities related by trigonometric functions */
-
-          class_call(transfer_radial_coordinates(ptr,ptw,index_md,index_q),
+                                      ptw->tau0_minus_tau_next,
+                                      ptw->w_trapz_next,
+                                      &tau_size_next),
                      ptr->error_message,
                      ptr->error_message);
+        }
 
-          /** - Select radial function type */
-          class_call(transfer_select_radial_function(
-                                                     ppt,
-                                                     ptr,
-                                                     index_md,
-                                                     index_tt,
-                                                     &radial_type),
+        same_sampling = ((group_size > 0) &&
+                         (tau_size_next == ptw->tau_size) &&
+                         (memcmp(ptw->tau0_minus_tau_next,ptw->tau0_minus_tau,tau_size_next*sizeof(double)) == 0) &&
+                         (memcmp(ptw->w_trapz_next,ptw->w_trapz,tau_size_next*sizeof(double)) == 0));
+
+        /** - --> if the sampling differs from that of the group, compute
+            all transfer functions of the group, and start a new group
+            with this type */
+
+        if ((group_size > 0) && (same_sampling == _FALSE_)) {
+
+          class_call(transfer_compute_for_each_sampling(ppr,
+                                                        ppt,
+                                                        ptr,
+                                                        index_q,
+                                                        index_md,
+                                                        index_tt-group_size,
+                                                        group_size,
+                                                        (pba->conformal_age-tau_rec)*ptr->angular_rescaling,
+                                                        ptw),
                      ptr->error_message,
                      ptr->error_message);
 
-          for (index_l = 0; index_l < ptr->l_size[index_md]; index_l++) {
-
-            l = (double)ptr->l[index_l];
-
-            /* neglect transfer function when l is much smaller than k*tau0 */
-            class_call(transfer_can_be_neglected(ppr,
-                                                 ppt,
-                                                 ptr,
-                                                 index_md,
-                                                 index_ic,
-                                                 index_tt,
-                                                 (pba->conformal_age-tau_rec)*ptr->angular_rescaling,
-                                                 ptr->q[index_q],
-                                                 l,
-                                                 &neglect),
-                       ptr->error_message,
-                       ptr->error_message);
+          memcpy(ptw->source_table,
+                 ptw->source_table+(size_t)group_size*ptw->ic_size*tau_size_max,
+                 (size_t)ptw->ic_size*tau_size_max*sizeof(double));
 
-            /* for K>0 (closed), transfer functions only defined for l<nu */
-            if ((ptw->sgnK == 1) && (ptr->l[index_l] >= (int)(ptr->q[index_q]/sqrt(ptw->K)+0.2))) {
-              neglect = _TRUE_;
-            }
-            /* This would maybe go into transfer_can_be_neglected later: */
-            if ((ptw->sgnK != 0) && (index_l>=ptw->HIS.l_size) && (index_q < ptr->index_q_flat_approximation)) {
-              neglect = _TRUE_;
-            }
-            if (neglect == _TRUE_) {
+          group_size = 0;
+        }
 
-              ptr->transfer[index_md][((index_ic * ptr->tt_size[index_md] + index_tt)
-                                       * ptr->l_size[index_md] + index_l)
-                                      * ptr->q_size + index_q] = 0.;
-            }
-            else {
-
-              /* for a given l, maximum value of k such that we can
-                 convolve the source with Bessel functions j_l(x)
-                 without reaching x_max (this is relevant in the flat
-                 case when the bessels are computed with the old bessel
-                 module. otherwise this condition is guaranteed by the
-                 choice of proper xmax when computing bessels) */
-              if (ptw->sgnK == 0) {
-                q_max_bessel = ptw->pBIS->x[ptw->pBIS->x_size-1]/tau0_minus_tau[0];
-              }
-              else {
-                q_max_bessel = ptr->q[ptr->q_size-1];
-              }
+        if (group_size == 0) {
+          pointer = ptw->tau0_minus_tau;
+          ptw->tau0_minus_tau = ptw->tau0_minus_tau_next;
+          ptw->tau0_minus_tau_next = pointer;
+          pointer = ptw->w_trapz;
+          ptw->w_trapz = ptw->w_trapz_next;
+          ptw->w_trapz_next = pointer;
+          ptw->tau_size = tau_size_next;
+        }
 
-              /* neglect late time CMB sources when l is above threshold */
-              class_call(transfer_late_source_can_be_neglected(ppr,
-                                                               ppt,
-                                                               ptr,
-                                                               index_md,
-                                                               index_tt,
-                                                               l,
-                                                               &(ptw->neglect_late_source)),
-                         ptr->error_message,
-                         ptr->error_message);
-
-              /* compute the transfer function for this l */
-              class_call(transfer_compute_for_each_l(
-                                                     ptw,
-                                                     ppr,
-                                                     ppt,
-                                                     ptr,
-                                                     index_q,
-                                                     index_md,
-                                                     index_ic,
-                                                     index_tt,
-                                                     index_l,
-                                                     l,
-                                                     q_max_bessel,
-                                                     radial_type
-                                                     ),
-                         ptr->error_message,
-                         ptr->error_message);
-            }
+        group_size++;
 
-          } /* end of loop over l */
+      } /* end of loop over type */
 
-        } /* end of loop over type */
+      /** - compute the transfer functions of the last group */
 
-      } /* end of loop over initial condition */
+      if (group_size > 0) {
 
+        class_call(transfer_compute_for_each_sampling(ppr,
+                                                      ppt,
+                                                      ptr,
+                                                      index_q,
+                                                      index_md,
+                                                      ptr->tt_size[index_md]-group_size,
+                                                      group_size,
+                                                      (pba->conformal_age-tau_rec)*ptr->angular_rescaling,
+                                                      ptw),
+                   ptr->error_message,
+                   ptr->error_message);
+      }
     }
 
     else {
@@ -1941,6 +2046,94 @@ int transfer_compute_for_each_q(
 
 }
 
+/**
+ * This routine computes the transfer functions for a given mode and
+ * wavenumber, for all initial conditions, all multipoles, and a group
+ * of consecutive types sharing the same time sampling, whose sources
+ * are stored in the workspace.
+ *
+ * @param ppr            Input: pointer to precision structure
+ * @param ppt            Input: pointer to perturbation structure
+ * @param ptr            Input/output: pointer to transfer structure (result stored there)
+ * @param index_q        Input: index of wavenumber
+ * @param index_md       Input: index of mode
+ * @param index_tt_first Input: index of the first type of the group
+ * @param group_size     Input: number of types in the group
+ * @param ra_rec         Input: comoving angular diameter distance to recombination (rescaled)
+ * @param ptw            Input: pointer to transfer workspace
+ * @return the error status
+ */
+
+int transfer_compute_for_each_sampling(
+                                       struct precision * ppr,
+                                       struct perturbations * ppt,
+                                       struct transfer * ptr,
+                                       int index_q,
+                                       int index_md,
+                                       int index_tt_first,
+                                       int group_size,
+                                       double ra_rec,
+                                       struct transfer_workspace * ptw
+                                       ) {
+
+  /* running index for multipoles */
+  int index_l;
+
+  /** - for a given l, maximum value of k such that we can convolve
+      the source with Bessel functions j_l(x) without reaching x_max */
+  double q_max_bessel;
+
+  /** - now that the array of times tau0_minus_tau is known, we can
+      infer the array of radial coordinates r(tau0_minus_tau) as well as a
+      few other quantities related by trigonometric functions */
+
+  class_call(transfer_radial_coordinates(ptr,ptw,index_md,index_q),
+             ptr->error_message,
+             ptr->error_message);
+
+  /** - number of times before tau_split */
+  if (ptr->has_split == _TRUE_) {
+    for (ptw->tau_size_early = 0;
+         (ptw->tau_size_early < ptw->tau_size) && (ptw->tau0_minus_tau[ptw->tau_size_early] > ptr->split_tau0-ptr->tau_split);
+         ptw->tau_size_early++);
+  }
+
+  /* for a given l, maximum value of k such that we can
+     convolve the source with Bessel functions j_l(x)
+     without reaching x_max (this is relevant in the flat
+     case when the bessels are computed with the old bessel
+     module. otherwise this condition is guaranteed by the
+     choice of proper xmax when computing bessels) */
+  if (ptw->sgnK == 0) {
+    q_max_bessel = ptw->pBIS->x[ptw->pBIS->x_size-1]/ptw->tau0_minus_tau[0];
+  }
+  else {
+    q_max_bessel = ptr->q[ptr->q_size-1];
+  }
+
+  /** - loop over l */
+
+  for (index_l = 0; index_l < ptr->l_size[index_md]; index_l++) {
+
+    class_call(transfer_compute_for_each_l(ptw,
+                                           ppr,
+                                           ppt,
+                                           ptr,
+                                           index_q,
+                                           index_md,
+                                           index_tt_first,
+                                           group_size,
+                                           index_l,
+                                           (double)ptr->l[index_l],
+                                           ra_rec,
+                                           q_max_bessel),
+               ptr->error_message,
+               ptr->error_message);
+  }
+
+  return _SUCCESS_;
+}
+
 int transfer_radial_coordinates(
                                 struct transfer * ptr,
                                 struct transfer_workspace * ptw,
@@ -2296,7 +2489,8 @@ int transfer_sources(
           if (_index_tt_in_range_(ptr->index_tt_d0,      ppt->selection_num, ppt->has_nc_rsd))
             rescaling *= 1./ptr->k[index_md][index_q]/ptr->k[index_md][index_q]; // Factor from original ClassGAL paper ( arXiv 1307.1459 )
 
-          if (_index_tt_in_range_(ptr->index_tt_d1,      ppt->selection_num, ppt->has_nc_rsd))
+          if ((_index_tt_in_range_(ptr->index_tt_d1,      ppt->selection_num, ppt->has_nc_rsd)) ||
+              (_index_tt_in_range_(ptr->index_tt_d1_mag,  ppt->selection_num, ptr->has_nc_rsd_mag)))
             rescaling *= 1./ptr->k[index_md][index_q]; // Factor from original ClassGAL paper ( arXiv 1307.1459 )
 
           sources[index_tau] *= rescaling;
@@ -2360,7 +2554,8 @@ int transfer_sources(
           /* copy from input array to output array */
           sources[index_tau] *= window[index_tt*tau_size_max+index_tau];
 
-          if (_index_tt_in_range_(ptr->index_tt_nc_g5, ppt->selection_num, ppt->has_nc_gr))
+          if ((_index_tt_in_range_(ptr->index_tt_nc_g5, ppt->selection_num, ppt->has_nc_gr)) ||
+              (_index_tt_in_range_(ptr->index_tt_nc_g5_mag, ppt->selection_num, ptr->has_nc_gr_mag)))
             sources[index_tau] *= ptr->k[index_md][index_q]; // Factor from chi derivative of d/dchi j_ell(k*chi)= d/d(kchi) j_ell(k chi) * k = k * j_ell'(kchi)
         }
       }
@@ -2967,19 +3162,23 @@ int transfer_selection_compute(
 
 /**
  * This routine computes the transfer functions \f$ \Delta_l^{X} (k) \f$)
- * as a function of wavenumber k for a given mode, initial condition,
- * type and multipole l passed in input.
+ * for a given mode, wavenumber and multipole l, for all initial
+ * conditions and for a group of types sharing the same time sampling
+ * (their sources are stored in the workspace).
+ *
+ * For each source, the transfer function is inferred from the source
+ * function and from Bessel functions, either by convolving them along
+ * tau, or by a Limber approximation, or neglected according to some
+ * approximation scheme designed to find a compromise between
+ * execution time and precision. The approximation scheme is defined
+ * by parameters in the precision structure.
  *
- * For a given value of k, the transfer function is inferred from
- * the source function (passed in input in the array interpolated_sources)
- * and from Bessel functions (passed in input in the bessels structure),
- * either by convolving them along tau, or by a Limber approximation.
- * This elementary task is distributed either to transfer_integrate()
- * or to transfer_limber(). The task of this routine is mainly to
- * loop over k values, and to decide at which k_max the calculation can
- * be stopped, according to some approximation scheme designed to find a
- * compromise between execution time and precision. The approximation scheme
- * is defined by parameters in the precision structure.
+ * The convolution is done in two passes: the first one finds the
+ * range of times needed by each source, the second one interpolates
+ * the hyperspherical Bessel functions once over the union of these
+ * ranges with transfer_radial_basis(), and convolves each source
+ * with its radial function, obtained from them with
+ * transfer_radial_function().
  *
  * @param ptw                   Input: pointer to transfer_workspace structure (allocated in transfer_init() to avoid numerous reallocation)
  * @param ppr                   Input: pointer to precision structure
@@ -2987,12 +3186,12 @@ int transfer_selection_compute(
  * @param ptr                   Input/output: pointer to transfer structure (result stored there)
  * @param index_q               Input: index of wavenumber
  * @param index_md              Input: index of mode
- * @param index_ic              Input: index of initial condition
- * @param index_tt              Input: index of type of transfer
+ * @param index_tt_first        Input: index of the first type of the group
+ * @param group_size            Input: number of types in the group
  * @param index_l               Input: index of multipole
  * @param l                     Input: multipole
+ * @param ra_rec                Input: comoving angular diameter distance to recombination (rescaled)
  * @param q_max_bessel          Input: maximum value of argument q at which Bessel functions are computed
- * @param radial_type           Input: type of radial (Bessel) functions to convolve with
  * @return the error status
  */
 
@@ -3003,12 +3202,12 @@ int transfer_compute_for_each_l(
                                 struct transfer * ptr,
                                 int index_q,
                                 int index_md,
-                                int index_ic,
-                                int index_tt,
+                                int index_tt_first,
+                                int group_size,
                                 int index_l,
                                 double l,
-                                double q_max_bessel,
-                                radial_function_type radial_type
+                                double ra_rec,
+                                double q_max_bessel
                                 ){
 
   /** Summary: */
@@ -3018,232 +3217,435 @@ int transfer_compute_for_each_l(
   /* current wavenumber value */
   double q,k;
 
-  /* value of transfer function */
+  /* value of transfer function, and contribution of times before tau_split */
   double transfer_function;
+  double transfer_early;
+
+  /* index in the tables of transfer functions */
+  size_t index;
 
   /* whether to use the Limber approximation */
   short use_limber;
 
-  /** - return zero transfer function if l is above l_max */
-  if (index_l >= ptr->l_size_tt[index_md][index_tt]) {
+  short neglect;
 
-    ptr->transfer[index_md][((index_ic * ptr->tt_size[index_md] + index_tt)
-                             * ptr->l_size[index_md] + index_l)
-                            * ptr->q_size + index_q] = 0.;
-    return _SUCCESS_;
-  }
+  radial_function_type radial_type;
+
+  int index_group, index_ic, index_tt, index_source;
+
+  /* range of times of the convolution integral for one source, and for all of them */
+  int index_tau_min, index_tau_max;
+  int index_tau_min_all, index_tau_max_all;
+
+  /* derivatives of the Bessel functions needed by one radial function, and by all of them */
+  int derivatives, derivatives_all;
+
+  double tau0_minus_tau_min_bessel=0.;
+
+  double * sources;
 
   q = ptr->q[index_q];
   k = ptr->k[index_md][index_q];
 
-  if (ptr->transfer_verbose > 3)
-    printf("Compute transfer for l=%d type=%d\n",(int)l,index_tt);
-
-  class_call(transfer_use_limber(ppr,
-                                 ppt,
-                                 ptr,
-                                 q_max_bessel,
-                                 index_md,
-                                 index_tt,
-                                 q,
-                                 l,
-                                 &use_limber),
-             ptr->error_message,
-             ptr->error_message);
+  index_tau_min_all = ptw->tau_size;
+  index_tau_max_all = -1;
+  derivatives_all = 0;
 
-  if (use_limber == _TRUE_) {
+  /** - first pass over types and initial conditions: deal with
+      neglected transfer functions and with the Limber approximation,
+      and find the times needed by each convolution integral */
 
-    class_call(transfer_limber(ptr,
-                               ptw,
-                               index_md,
-                               index_q,
-                               l,
-                               q,
-                               radial_type,
-                               &transfer_function),
-               ptr->error_message,
-               ptr->error_message);
+  for (index_group = 0; index_group < group_size; index_group++) {
 
-  }
-  else {
-    class_call(transfer_integrate(
-                                  ppt,
-                                  ptr,
-                                  ptw,
-                                  index_q,
-                                  index_md,
-                                  index_tt,
-                                  l,
-                                  index_l,
-                                  k,
-                                  radial_type,
-                                  &transfer_function
-                                  ),
+    index_tt = index_tt_first + index_group;
+
+    class_call(transfer_select_radial_function(ppt,
+                                               ptr,
+                                               index_md,
+                                               index_tt,
+                                               &radial_type),
                ptr->error_message,
                ptr->error_message);
-  }
 
-  /** - store transfer function in transfer structure */
-  ptr->transfer[index_md][((index_ic * ptr->tt_size[index_md] + index_tt)
-                           * ptr->l_size[index_md] + index_l)
-                          * ptr->q_size + index_q]
-    = transfer_function;
+    for (index_ic = 0; index_ic < ppt->ic_size[index_md]; index_ic++) {
 
-  return _SUCCESS_;
+      index_source = index_group*ptw->ic_size + index_ic;
+      ptw->index_tau_max_table[index_source] = -1;
 
-}
+      index = ((index_ic * ptr->tt_size[index_md] + index_tt)
+               * ptr->l_size[index_md] + index_l)
+        * ptr->q_size + index_q;
 
-int transfer_use_limber(
-                        struct precision * ppr,
-                        struct perturbations * ppt,
-                        struct transfer * ptr,
-                        double q_max_bessel,
-                        int index_md,
-                        int index_tt,
-                        double q,
-                        double l,
-                        short * use_limber) {
+      /* neglect transfer function when l is much smaller than k*tau0 */
+      class_call(transfer_can_be_neglected(ppr,
+                                           ppt,
+                                           ptr,
+                                           index_md,
+                                           index_ic,
+                                           index_tt,
+                                           ra_rec,
+                                           q,
+                                           l,
+                                           &neglect),
+                 ptr->error_message,
+                 ptr->error_message);
+
+      /* for K>0 (closed), transfer functions only defined for l<nu */
+      if ((ptw->sgnK == 1) && (ptr->l[index_l] >= (int)(ptr->q[index_q]/sqrt(ptw->K)+0.2))) {
+        neglect = _TRUE_;
+      }
+      /* This would maybe go into transfer_can_be_neglected later: */
+      if ((ptw->sgnK != 0) && (index_l>=ptw->HIS.l_size) && (index_q < ptr->index_q_flat_approximation)) {
+        neglect = _TRUE_;
+      }
 
+      /* return zero transfer function if neglected or if l is above l_max */
+      if ((neglect == _TRUE_) || (index_l >= ptr->l_size_tt[index_md][index_tt])) {
+        ptr->transfer[index_md][index] = 0.;
+        continue;
+      }
 
-  /* criteria for choosing between integration and Limber
-     must be implemented here */
+      if (ptr->transfer_verbose > 3)
+        printf("Compute transfer for l=%d type=%d\n",(int)l,index_tt);
 
-  *use_limber = _FALSE_;
+      sources = ptw->source_table + (size_t)index_source*ptw->tau_size_max;
 
-  if (q>q_max_bessel) {
-    *use_limber = _TRUE_;
-  }
-  else {
+      class_call(transfer_use_limber(ppr,
+                                     ppt,
+                                     ptr,
+                                     q_max_bessel,
+                                     index_md,
+                                     index_tt,
+                                     q,
+                                     l,
+                                     &use_limber),
+                 ptr->error_message,
+                 ptr->error_message);
 
-    if (_scalars_) {
+      if (use_limber == _TRUE_) {
 
-      //TBC: in principle the Limber condition should be adapted to account for curvature effects
+        ptw->sources = sources;
 
-      if ((ppt->has_cl_cmb_lensing_potential == _TRUE_) && (index_tt == ptr->index_tt_lcmb) && (l>ppr->l_switch_limber)) {
-        *use_limber = _TRUE_;
-      }
-      if (_index_tt_in_range_(ptr->index_tt_density, ppt->selection_num, ppt->has_nc_density) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_density])) {
-        if (ppt->selection != dirac) *use_limber = _TRUE_;
-      }
-      if (_index_tt_in_range_(ptr->index_tt_rsd,     ppt->selection_num, ppt->has_nc_rsd) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_rsd])) {
-        if (ppt->selection != dirac) *use_limber = _TRUE_;
-      }
-      if (_index_tt_in_range_(ptr->index_tt_d0,      ppt->selection_num, ppt->has_nc_rsd) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_d0])) {
-        if (ppt->selection != dirac) *use_limber = _TRUE_;
-      }
-      if (_index_tt_in_range_(ptr->index_tt_d1,      ppt->selection_num, ppt->has_nc_rsd) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_d1])) {
-        if (ppt->selection != dirac) *use_limber = _TRUE_;
-      }
-      if (_index_tt_in_range_(ptr->index_tt_nc_lens, ppt->selection_num, ppt->has_nc_lens) && (l>=ppr->l_switch_limber_for_nc_los_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_lens])) {
-        if (ppt->selection != dirac) *use_limber = _TRUE_;
-      }
-      if (_index_tt_in_range_(ptr->index_tt_nc_g1, ppt->selection_num, ppt->has_nc_gr) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_g1])) {
-        if (ppt->selection != dirac) *use_limber = _TRUE_;
-      }
-      if (_index_tt_in_range_(ptr->index_tt_nc_g2, ppt->selection_num, ppt->has_nc_gr) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_g2])) {
-        if (ppt->selection != dirac) *use_limber = _TRUE_;
-      }
-      if (_index_tt_in_range_(ptr->index_tt_nc_g3, ppt->selection_num, ppt->has_nc_gr) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_g3])) {
-        if (ppt->selection != dirac) *use_limber = _TRUE_;
-      }
-      if (_index_tt_in_range_(ptr->index_tt_nc_g4, ppt->selection_num, ppt->has_nc_gr) && (l>=ppr->l_switch_limber_for_nc_los_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_g4])) {
-        if (ppt->selection != dirac) *use_limber = _TRUE_;
-      }
-      if (_index_tt_in_range_(ptr->index_tt_nc_g5, ppt->selection_num, ppt->has_nc_gr) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_g5])) {
-        if (ppt->selection != dirac) *use_limber = _TRUE_;
-      }
-      if (_index_tt_in_range_(ptr->index_tt_lensing, ppt->selection_num, ppt->has_cl_lensing_potential) && (l>=ppr->l_switch_limber_for_nc_los_over_z*ppt->selection_mean[index_tt-ptr->index_tt_lensing])) {
-        *use_limber = _TRUE_;
+        class_call(transfer_limber(ptr,
+                                   ptw,
+                                   index_md,
+                                   index_q,
+                                   l,
+                                   q,
+                                   radial_type,
+                                   &transfer_function),
+                   ptr->error_message,
+                   ptr->error_message);
+
+        class_call(transfer_store(ptr,index_md,index,transfer_function,0.),
+                   ptr->error_message,
+                   ptr->error_message);
+        continue;
       }
-    }
-  }
 
-  return _SUCCESS_;
-}
+      /* neglect late time CMB sources when l is above threshold */
+      class_call(transfer_late_source_can_be_neglected(ppr,
+                                                       ppt,
+                                                       ptr,
+                                                       index_md,
+                                                       index_tt,
+                                                       l,
+                                                       &(ptw->neglect_late_source)),
+                 ptr->error_message,
+                 ptr->error_message);
 
-/**
- * This routine computes the transfer functions \f$ \Delta_l^{X} (k) \f$)
- * for each mode, initial condition, type, multipole l and wavenumber k,
- * by convolving  the source function (passed in input in the array
- * interpolated_sources) with Bessel functions (passed in input in the
- * bessels structure).
+      class_call(transfer_integration_range(ptr,
+                                            ptw,
+                                            index_q,
+                                            l,
+                                            index_l,
+                                            k,
+                                            sources,
+                                            &index_tau_min,
+                                            &index_tau_max,
+                                            &tau0_minus_tau_min_bessel),
+                 ptr->error_message,
+                 ptr->error_message);
+
+      /* no overlap between sources and Bessel functions */
+      if (index_tau_max < 0) {
+        class_call(transfer_store(ptr,index_md,index,0.,0.),
+                   ptr->error_message,
+                   ptr->error_message);
+        continue;
+      }
+
+      class_call(transfer_radial_derivatives(radial_type,&derivatives),
+                 ptr->error_message,
+                 ptr->error_message);
+
+      ptw->index_tau_min_table[index_source] = index_tau_min;
+      ptw->index_tau_max_table[index_source] = index_tau_max;
+      index_tau_min_all = MIN(index_tau_min_all,index_tau_min);
+      index_tau_max_all = MAX(index_tau_max_all,index_tau_max);
+      derivatives_all |= derivatives;
+    }
+  }
+
+  if (index_tau_max_all < 0)
+    return _SUCCESS_;
+
+  /** - interpolate the Bessel functions over all needed times */
+
+  class_call(transfer_radial_basis(ptw,
+                                   ptr,
+                                   k,
+                                   index_q,
+                                   index_l,
+                                   index_tau_min_all,
+                                   index_tau_max_all,
+                                   derivatives_all),
+             ptr->error_message,
+             ptr->error_message);
+
+  /** - second pass: convolve each source with its radial function */
+
+  for (index_group = 0; index_group < group_size; index_group++) {
+
+    index_tt = index_tt_first + index_group;
+
+    class_call(transfer_select_radial_function(ppt,
+                                               ptr,
+                                               index_md,
+                                               index_tt,
+                                               &radial_type),
+               ptr->error_message,
+               ptr->error_message);
+
+    for (index_ic = 0; index_ic < ppt->ic_size[index_md]; index_ic++) {
+
+      index_source = index_group*ptw->ic_size + index_ic;
+
+      if (ptw->index_tau_max_table[index_source] < 0)
+        continue;
+
+      index_tau_min = ptw->index_tau_min_table[index_source];
+      index_tau_max = ptw->index_tau_max_table[index_source];
+
+      class_call(transfer_radial_function(ptw,
+                                          ppt,
+                                          ptr,
+                                          k,
+                                          index_q,
+                                          index_l,
+                                          index_tau_min,
+                                          index_tau_max+1-index_tau_min,
+                                          ptw->radial_function,
+                                          radial_type),
+                 ptr->error_message,
+                 ptr->error_message);
+
+      class_call(transfer_integrate(ptr,
+                                    ptw,
+                                    ptw->source_table + (size_t)index_source*ptw->tau_size_max,
+                                    ptw->radial_function,
+                                    index_tau_min,
+                                    index_tau_max,
+                                    tau0_minus_tau_min_bessel,
+                                    &transfer_function,
+                                    &transfer_early),
+                 ptr->error_message,
+                 ptr->error_message);
+
+      index = ((index_ic * ptr->tt_size[index_md] + index_tt)
+               * ptr->l_size[index_md] + index_l)
+        * ptr->q_size + index_q;
+
+      class_call(transfer_store(ptr,index_md,index,transfer_function,transfer_early),
+                 ptr->error_message,
+                 ptr->error_message);
+    }
+  }
+
+  return _SUCCESS_;
+
+}
+
+/**
+ * Store a transfer function in the transfer structure, as well as its
+ * early contribution, or add the early contribution taken from a
+ * previous run.
  *
- * @param ppt            Input: pointer to perturbation structure
- * @param ptr            Input: pointer to transfer structure
- * @param ptw            Input: pointer to transfer_workspace structure (allocated in transfer_init() to avoid numerous reallocation)
- * @param index_q        Input: index of wavenumber
- * @param index_md       Input: index of mode
- * @param index_tt       Input: index of type
- * @param l              Input: multipole
- * @param index_l        Input: index of multipole
- * @param k              Input: wavenumber
- * @param radial_type    Input: type of radial (Bessel) functions to convolve with
- * @param trsf           Output: transfer function \f$ \Delta_l(k) \f$
+ * @param ptr               Input/output: pointer to transfer structure
+ * @param index_md          Input: index of mode
+ * @param index             Input: index in the table of transfer functions of this mode
+ * @param transfer_function Input: transfer function (only the late contribution if the early one is reused)
+ * @param transfer_early    Input: contribution of times before tau_split
  * @return the error status
  */
 
-int transfer_integrate(
-                       struct perturbations * ppt,
-                       struct transfer * ptr,
-                       struct transfer_workspace *ptw,
-                       int index_q,
-                       int index_md,
-                       int index_tt,
-                       double l,
-                       int index_l,
-                       double k,
-                       radial_function_type radial_type,
-                       double * trsf
-                       ) {
+int transfer_store(
+                   struct transfer * ptr,
+                   int index_md,
+                   size_t index,
+                   double transfer_function,
+                   double transfer_early
+                   ) {
+
+  /** - store the early contribution, or add the one taken from a previous run */
+  if (ptr->has_split == _TRUE_) {
+    if (ptr->has_early_reused == _TRUE_)
+      transfer_function += ptr->transfer_early[index_md][index];
+    else
+      ptr->transfer_early[index_md][index] = transfer_early;
+  }
 
-  /** Summary: */
+  /** - store transfer function in transfer structure */
+  ptr->transfer[index_md][index] = transfer_function;
 
-  /** - define local variables */
+  return _SUCCESS_;
+}
 
-  double * tau0_minus_tau = ptw->tau0_minus_tau;
-  double * w_trapz = ptw->w_trapz;
-  double * sources = ptw->sources;
+int transfer_use_limber(
+                        struct precision * ppr,
+                        struct perturbations * ppt,
+                        struct transfer * ptr,
+                        double q_max_bessel,
+                        int index_md,
+                        int index_tt,
+                        double q,
+                        double l,
+                        short * use_limber) {
+
+
+  /* criteria for choosing between integration and Limber
+     must be implemented here */
+
+  *use_limber = _FALSE_;
+
+  if (q>q_max_bessel) {
+    *use_limber = _TRUE_;
+  }
+  else {
+
+    if (_scalars_) {
+
+      //TBC: in principle the Limber condition should be adapted to account for curvature effects
+
+      if ((ppt->has_cl_cmb_lensing_potential == _TRUE_) && (index_tt == ptr->index_tt_lcmb) && (l>ppr->l_switch_limber)) {
+        *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_density, ppt->selection_num, ppt->has_nc_density) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_density])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_rsd,     ppt->selection_num, ppt->has_nc_rsd) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_rsd])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_d0,      ppt->selection_num, ppt->has_nc_rsd) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_d0])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_d1,      ppt->selection_num, ppt->has_nc_rsd) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_d1])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_nc_lens, ppt->selection_num, ppt->has_nc_lens) && (l>=ppr->l_switch_limber_for_nc_los_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_lens])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_nc_g1, ppt->selection_num, ppt->has_nc_gr) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_g1])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_nc_g2, ppt->selection_num, ppt->has_nc_gr) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_g2])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_nc_g3, ppt->selection_num, ppt->has_nc_gr) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_g3])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_nc_g4, ppt->selection_num, ppt->has_nc_gr) && (l>=ppr->l_switch_limber_for_nc_los_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_g4])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_nc_g5, ppt->selection_num, ppt->has_nc_gr) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_g5])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_d1_mag, ppt->selection_num, ptr->has_nc_rsd_mag) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_d1_mag])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_nc_g2_mag, ppt->selection_num, ptr->has_nc_gr_mag) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_g2_mag])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_nc_g5_mag, ppt->selection_num, ptr->has_nc_gr_mag) && (l>=ppr->l_switch_limber_for_nc_local_over_z*ppt->selection_mean[index_tt-ptr->index_tt_nc_g5_mag])) {
+        if (ppt->selection != dirac) *use_limber = _TRUE_;
+      }
+      if (_index_tt_in_range_(ptr->index_tt_lensing, ppt->selection_num, ppt->has_cl_lensing_potential) && (l>=ppr->l_switch_limber_for_nc_los_over_z*ppt->selection_mean[index_tt-ptr->index_tt_lensing])) {
+        *use_limber = _TRUE_;
+      }
+    }
+  }
 
-  /* minimum value of \f$ (\tau0-\tau) \f$ at which \f$ j_l(k[\tau_0-\tau]) \f$ is known, given that \f$ j_l(x) \f$ is sampled above some finite value \f$ x_{\min} \f$ (below which it can be approximated by zero) */
-  double tau0_minus_tau_min_bessel;
+  return _SUCCESS_;
+}
 
-  /* index in the source's tau list corresponding to the last point in the overlapping region between sources and bessels. Also the index of possible Bessel truncation. */
-  int index_tau_max, index_tau_max_Bessel;
+/**
+ * This routine finds the range of times over which a source function
+ * must be convolved with Bessel functions, for a given wavenumber and
+ * multipole: the region in which both are non-zero, possibly
+ * shortened by the time cut approximation for late sources, and
+ * starting at tau_split when the early contributions are taken from a
+ * previous run.
+ *
+ * @param ptr                       Input: pointer to transfer structure
+ * @param ptw                       Input: pointer to transfer_workspace structure (time sampling, neglect_late_source flag)
+ * @param index_q                   Input: index of wavenumber
+ * @param l                         Input: multipole
+ * @param index_l                   Input: index of multipole
+ * @param k                         Input: wavenumber
+ * @param sources                   Input: source function sources[index_tau]
+ * @param index_tau_min             Output: index of the first time in the convolution integral
+ * @param index_tau_max             Output: index of the last time in the convolution integral (-1 if the transfer function vanishes)
+ * @param tau0_minus_tau_min_bessel Output: minimum value of (tau0-tau) at which the Bessel functions are known
+ * @return the error status
+ */
+
+int transfer_integration_range(
+                               struct transfer * ptr,
+                               struct transfer_workspace *ptw,
+                               int index_q,
+                               double l,
+                               int index_l,
+                               double k,
+                               double * sources,
+                               int * index_tau_min,
+                               int * index_tau_max,
+                               double * tau0_minus_tau_min_bessel
+                               ) {
 
-  double bessel, *radial_function;
+  double * tau0_minus_tau = ptw->tau0_minus_tau;
 
   double x_turning_point;
 
+  *index_tau_min = 0;
+  *index_tau_max = -1;
+
   /** - find minimum value of (tau0-tau) at which \f$ j_l(k[\tau_0-\tau]) \f$ is known, given that \f$ j_l(x) \f$ is sampled above some finite value \f$ x_{\min} \f$ (below which it can be approximated by zero) */
-  //tau0_minus_tau_min_bessel = x_min_l/k; /* segmentation fault impossible, checked before that k != 0 */
-  //printf("index_l=%d\n",index_l);
   if (ptw->sgnK==0){
-    tau0_minus_tau_min_bessel = ptw->pBIS->chi_at_phimin[index_l]/k; /* segmentation fault impossible, checked before that k != 0 */
+    *tau0_minus_tau_min_bessel = ptw->pBIS->chi_at_phimin[index_l]/k; /* segmentation fault impossible, checked before that k != 0 */
   }
   else{
 
     if (index_q < ptr->index_q_flat_approximation) {
 
-      tau0_minus_tau_min_bessel = ptw->HIS.chi_at_phimin[index_l]/sqrt(ptw->sgnK*ptw->K);
+      *tau0_minus_tau_min_bessel = ptw->HIS.chi_at_phimin[index_l]/sqrt(ptw->sgnK*ptw->K);
 
     }
     else {
 
-      tau0_minus_tau_min_bessel = ptw->pBIS->chi_at_phimin[index_l]/sqrt(ptw->sgnK*ptw->K);
+      *tau0_minus_tau_min_bessel = ptw->pBIS->chi_at_phimin[index_l]/sqrt(ptw->sgnK*ptw->K);
 
       if (ptw->sgnK == 1) {
         x_turning_point = asin(sqrt(l*(l+1.))/ptr->q[index_q]*sqrt(ptw->sgnK*ptw->K));
-        tau0_minus_tau_min_bessel *= x_turning_point/sqrt(l*(l+1.));
+        *tau0_minus_tau_min_bessel *= x_turning_point/sqrt(l*(l+1.));
       }
       else {
         x_turning_point = asinh(sqrt(l*(l+1.))/ptr->q[index_q]*sqrt(ptw->sgnK*ptw->K));
-        tau0_minus_tau_min_bessel *= x_turning_point/sqrt(l*(l+1.));
+        *tau0_minus_tau_min_bessel *= x_turning_point/sqrt(l*(l+1.));
       }
     }
   }
   /** - if there is no overlap between the region in which bessels and sources are non-zero, return zero */
-  if (tau0_minus_tau_min_bessel >= tau0_minus_tau[0]) {
-    *trsf = 0.;
+  if (*tau0_minus_tau_min_bessel >= tau0_minus_tau[0]) {
     return _SUCCESS_;
   }
 
@@ -3252,95 +3654,159 @@ int transfer_integrate(
   /** - --> trivial case: the source is a Dirac function and is sampled in only one point */
   if (ptw->tau_size == 1) {
 
-    class_call(transfer_radial_function(
-                                        ptw,
-                                        ppt,
-                                        ptr,
-                                        k,
-                                        index_q,
-                                        index_l,
-                                        1,
-                                        &bessel,
-                                        radial_type
-                                        ),
-               ptr->error_message,
-               ptr->error_message);
-
-    *trsf = sources[0] * bessel;
+    if ((ptr->has_split == _FALSE_) || (ptr->has_early_reused == _FALSE_) || (ptw->tau_size_early != 1))
+      *index_tau_max = 0;
     return _SUCCESS_;
   }
 
   /** - --> other cases */
 
   /** - ---> (a) find index in the source's tau list corresponding to the last point in the overlapping region. After this step, index_tau_max can be as small as zero, but not negative. */
-  index_tau_max = ptw->tau_size-1;
-  while (tau0_minus_tau[index_tau_max] < tau0_minus_tau_min_bessel)
-    index_tau_max--;
-  /* Set index so we know if the truncation of the convolution integral is due to Bessel and not
-     due to the source. */
-  index_tau_max_Bessel = index_tau_max;
+  *index_tau_max = ptw->tau_size-1;
+  while (tau0_minus_tau[*index_tau_max] < *tau0_minus_tau_min_bessel)
+    (*index_tau_max)--;
 
   /** - ---> (b) the source function can vanish at large \f$ \tau \f$. Check if further points can be eliminated. After this step and if we did not return a null transfer function, index_tau_max can be as small as zero, but not negative. */
-  while (sources[index_tau_max] == 0.) {
-    index_tau_max--;
-    if (index_tau_max < 0) {
-      *trsf = 0.;
+  while (sources[*index_tau_max] == 0.) {
+    (*index_tau_max)--;
+    if (*index_tau_max < 0) {
       return _SUCCESS_;
     }
   }
 
   if (ptw->neglect_late_source == _TRUE_) {
 
-    while (tau0_minus_tau[index_tau_max] < ptw->tau0_minus_tau_cut) {
-      index_tau_max--;
-      if (index_tau_max < 0) {
-        *trsf = 0.;
+    while (tau0_minus_tau[*index_tau_max] < ptw->tau0_minus_tau_cut) {
+      (*index_tau_max)--;
+      if (*index_tau_max < 0) {
         return _SUCCESS_;
       }
     }
   }
 
-  /** - Compute the radial function: */
-  class_alloc(radial_function,sizeof(double)*(index_tau_max+1),ptr->error_message);
+  /** - ---> (c) when the early contributions are taken from a previous
+      run, the convolution starts at the first time after tau_split */
+  if ((ptr->has_split == _TRUE_) && (ptr->has_early_reused == _TRUE_)) {
+    *index_tau_min = MIN(ptw->tau_size_early,*index_tau_max+1);
+    if (*index_tau_min > *index_tau_max) {
+      *index_tau_max = -1;
+      return _SUCCESS_;
+    }
+  }
 
-  class_call(transfer_radial_function(
-                                      ptw,
-                                      ppt,
-                                      ptr,
-                                      k,
-                                      index_q,
-                                      index_l,
-                                      index_tau_max+1,
-                                      radial_function,
-                                      radial_type
-                                      ),
-             ptr->error_message,
-             ptr->error_message);
+  return _SUCCESS_;
+}
 
-  /** - Now we do most of the convolution integral: */
-  class_call(array_trapezoidal_convolution(sources,
-                                           radial_function,
-                                           index_tau_max+1,
-                                           w_trapz,
-                                           trsf,
-                                           ptr->error_message),
-             ptr->error_message,
-             ptr->error_message);
+/**
+ * This routine computes the transfer functions \f$ \Delta_l^{X} (k) \f$)
+ * for each mode, initial condition, type, multipole l and wavenumber k,
+ * by convolving  the source function with the radial (Bessel) function,
+ * over the range of times found by transfer_integration_range().
+ *
+ * @param ptr                       Input: pointer to transfer structure
+ * @param ptw                       Input: pointer to transfer_workspace structure (allocated in transfer_init() to avoid numerous reallocation)
+ * @param sources                   Input: source function sources[index_tau]
+ * @param radial_function           Input: radial function radial_function[index_tau-index_tau_min]
+ * @param index_tau_min             Input: index of the first time in the convolution integral
+ * @param index_tau_max             Input: index of the last time in the convolution integral
+ * @param tau0_minus_tau_min_bessel Input: minimum value of (tau0-tau) at which the Bessel functions are known
+ * @param trsf                      Output: transfer function \f$ \Delta_l(k) \f$ (when the early contributions are taken from a previous run, only the contribution of times after tau_split)
+ * @param trsf_early                Output: contribution of times before tau_split to trsf (zero if early and late contributions are not split, or if the former are taken from a previous run)
+ * @return the error status
+ */
+
+int transfer_integrate(
+                       struct transfer * ptr,
+                       struct transfer_workspace *ptw,
+                       double * sources,
+                       double * radial_function,
+                       int index_tau_min,
+                       int index_tau_max,
+                       double tau0_minus_tau_min_bessel,
+                       double * trsf,
+                       double * trsf_early
+                       ) {
+
+  /** Summary: */
+
+  /** - define local variables */
+
+  double * tau0_minus_tau = ptw->tau0_minus_tau;
+  double * w_trapz = ptw->w_trapz;
+
+  /* index of the first time after tau_split */
+  int index_tau_split;
+
+  double trsf_late, correction;
+
+  *trsf_early = 0.;
+
+  /** - trivial case: the source is a Dirac function and is sampled in only one point */
+  if (ptw->tau_size == 1) {
+
+    *trsf = sources[0] * radial_function[0];
+    if ((ptr->has_split == _TRUE_) && (ptw->tau_size_early == 1))
+      *trsf_early = *trsf;
+    return _SUCCESS_;
+  }
+
+  /** - when early and late contributions are split, find the first time after tau_split */
+  index_tau_split = index_tau_max+1;
+  if (ptr->has_split == _TRUE_) {
+    index_tau_split = MIN(ptw->tau_size_early,index_tau_max+1);
+  }
+
+  /** - Now we do most of the convolution integral (in two parts if early and late contributions are split): */
+  if (ptr->has_split == _FALSE_) {
+
+    class_call(array_trapezoidal_convolution(sources,
+                                             radial_function,
+                                             index_tau_max+1,
+                                             w_trapz,
+                                             trsf,
+                                             ptr->error_message),
+               ptr->error_message,
+               ptr->error_message);
+  }
+  else {
+
+    class_call(array_trapezoidal_convolution(sources+index_tau_min,
+                                             radial_function,
+                                             index_tau_split-index_tau_min,
+                                             w_trapz+index_tau_min,
+                                             trsf_early,
+                                             ptr->error_message),
+               ptr->error_message,
+               ptr->error_message);
+
+    class_call(array_trapezoidal_convolution(sources+index_tau_split,
+                                             radial_function+(index_tau_split-index_tau_min),
+                                             index_tau_max+1-index_tau_split,
+                                             w_trapz+index_tau_split,
+                                             &trsf_late,
+                                             ptr->error_message),
+               ptr->error_message,
+               ptr->error_message);
+
+    *trsf = *trsf_early + trsf_late;
+  }
 
   /** - This integral is correct for the case where no truncation has
       occurred. If it has been truncated at some index_tau_max because
       f[index_tau_max+1]==0, it is still correct. The 'mistake' in using
       the wrong weight w_trapz[index_tau_max] is exactly compensated by the
-      triangle we miss. However, for the Bessel cut off, we must subtract the
-      wrong triangle and add the correct triangle. */
-  if ((index_tau_max!=(ptw->tau_size-1))&&(index_tau_max==index_tau_max_Bessel)){
+      triangle we miss. However, for the Bessel cut off (when the next time
+      is below tau0_minus_tau_min_bessel), we must subtract the wrong
+      triangle and add the correct triangle. */
+  if ((index_tau_max!=(ptw->tau_size-1))&&(tau0_minus_tau[index_tau_max+1] < tau0_minus_tau_min_bessel)){
     //Bessel truncation
-    *trsf -= 0.5*(tau0_minus_tau[index_tau_max+1]-tau0_minus_tau_min_bessel)*
-      radial_function[index_tau_max]*sources[index_tau_max];
+    correction = -0.5*(tau0_minus_tau[index_tau_max+1]-tau0_minus_tau_min_bessel)*
+      radial_function[index_tau_max-index_tau_min]*sources[index_tau_max];
+    *trsf += correction;
+    if ((ptr->has_split == _TRUE_) && (index_tau_max < index_tau_split))
+      *trsf_early += correction;
   }
 
-
-  free(radial_function);
   return _SUCCESS_;
 }
 
@@ -3776,33 +4242,48 @@ int transfer_late_source_can_be_neglected(
 
 }
 
-int transfer_radial_function(
-                             struct transfer_workspace * ptw,
-                             struct perturbations * ppt,
-                             struct transfer * ptr,
-                             double k,
-                             int index_q,
-                             int index_l,
-                             int x_size,
-                             double * radial_function,
-                             radial_function_type radial_type
-                             ){
+/**
+ * This routine interpolates the hyperspherical Bessel functions
+ * (and/or their derivatives) at the radial coordinates of the times
+ * index_tau_min, ..., index_tau_max, for a given wavenumber and
+ * multipole, and stores them in the workspace. They are shared by all
+ * the radial functions built afterwards by transfer_radial_function()
+ * for this (q,l) and this time sampling.
+ *
+ * @param ptw           Input/output: pointer to transfer workspace
+ * @param ptr           Input: pointer to transfer structure
+ * @param k             Input: wavenumber
+ * @param index_q       Input: index of wavenumber
+ * @param index_l       Input: index of multipole
+ * @param index_tau_min Input: first time
+ * @param index_tau_max Input: last time
+ * @param derivatives   Input: functions needed (combination of _RADIAL_PHI_, _RADIAL_DPHI_, _RADIAL_D2PHI_)
+ * @return the error status
+ */
+
+int transfer_radial_basis(
+                          struct transfer_workspace * ptw,
+                          struct transfer * ptr,
+                          double k,
+                          int index_q,
+                          int index_l,
+                          int index_tau_min,
+                          int index_tau_max,
+                          int derivatives
+                          ){
 
   HyperInterpStruct * pHIS;
-  double *chi = ptw->chi;
-  double *cscKgen = ptw->cscKgen;
-  double *cotKgen = ptw->cotKgen;
+  int x_size = index_tau_max+1-index_tau_min;
+  /* radial functions are computed for the times index_tau_min, ..., index_tau_max */
+  double *chi = ptw->chi+index_tau_min;
+  double *Phi = ptw->Phi, *dPhi = ptw->dPhi, *d2Phi = ptw->d2Phi;
+  double *chireverse = ptw->chireverse;
+  double *rescale_function = ptw->rescale_function;
   int j;
-  double *Phi, *dPhi, *d2Phi, *chireverse;
-  double K=0.,k2=1.0;
-  double sqrt_absK_over_k;
-  double absK_over_k2;
+  double K=0.;
   double nu=0., chi_tp=0.;
-  double factor, s0, s2, ssqrt3, si, ssqrt2, ssqrt2i;
-  double l = (double)ptr->l[index_l];
   double rescale_argument;
   double rescale_amplitude;
-  double * rescale_function;
   int (*interpolate_Phi)();
   int (*interpolate_dPhi)();
   int (*interpolate_Phid2Phi)();
@@ -3811,23 +4292,6 @@ int transfer_radial_function(
   enum Hermite_Interpolation_Order HIorder;
 
   K = ptw->K;
-  k2 = k*k;
-
-  if (ptw->sgnK==0){
-    /* This is the choice consistent with chi=k*(tau0-tau) and nu=1 */
-    sqrt_absK_over_k = 1.0;
-  }
-  else {
-    K=ptw->K;
-    sqrt_absK_over_k = sqrt(ptw->sgnK*K)/k;
-  }
-  absK_over_k2 =sqrt_absK_over_k*sqrt_absK_over_k;
-
-  class_alloc(Phi,sizeof(double)*x_size,ptr->error_message);
-  class_alloc(dPhi,sizeof(double)*x_size,ptr->error_message);
-  class_alloc(d2Phi,sizeof(double)*x_size,ptr->error_message);
-  class_alloc(chireverse,sizeof(double)*x_size,ptr->error_message);
-  class_alloc(rescale_function,sizeof(double)*x_size,ptr->error_message);
 
   if (ptw->sgnK == 0) {
     pHIS = ptw->pBIS;
@@ -3880,6 +4344,17 @@ int transfer_radial_function(
     break;
   }
 
+  /* flat Bessel functions which are not tabulated (above
+     hyper_l_flat_asymptotic) are evaluated from their asymptotic
+     expansion */
+  if ((pHIS == ptw->pBIS) && (index_l >= pHIS->l_size_table)) {
+    interpolate_Phi = hyperspherical_asymptotic_vector_Phi;
+    interpolate_dPhi = hyperspherical_asymptotic_vector_dPhi;
+    interpolate_PhidPhi = hyperspherical_asymptotic_vector_PhidPhi;
+    interpolate_Phid2Phi = hyperspherical_asymptotic_vector_Phid2Phi;
+    interpolate_PhidPhid2Phi = hyperspherical_asymptotic_vector_PhidPhid2Phi;
+  }
+
   //Reverse chi
   for (j=0; j<x_size; j++) {
     chireverse[j] = chi[x_size-1-j]*rescale_argument;
@@ -3925,52 +4400,180 @@ int transfer_radial_function(
              pHIS->x[pHIS->x_size-1]
              );
 
-  switch (radial_type){
-  case SCALAR_TEMPERATURE_0:
+  /* the second derivative always comes with the function itself */
+  if (derivatives & _RADIAL_D2PHI_) {
+    if (derivatives & _RADIAL_DPHI_) {
+      class_call(interpolate_PhidPhid2Phi(pHIS, x_size, index_l, chireverse, Phi, dPhi, d2Phi, ptr->error_message),
+                 ptr->error_message, ptr->error_message);
+      derivatives = _RADIAL_PHI_ | _RADIAL_DPHI_ | _RADIAL_D2PHI_;
+    }
+    else {
+      class_call(interpolate_Phid2Phi(pHIS, x_size, index_l, chireverse, Phi, d2Phi, ptr->error_message),
+                 ptr->error_message, ptr->error_message);
+      derivatives = _RADIAL_PHI_ | _RADIAL_D2PHI_;
+    }
+  }
+  else if ((derivatives & _RADIAL_PHI_) && (derivatives & _RADIAL_DPHI_)) {
+    class_call(interpolate_PhidPhi(pHIS, x_size, index_l, chireverse, Phi, dPhi, ptr->error_message),
+               ptr->error_message, ptr->error_message);
+  }
+  else if (derivatives & _RADIAL_DPHI_) {
+    class_call(interpolate_dPhi(pHIS, x_size, index_l, chireverse, dPhi, ptr->error_message),
+               ptr->error_message, ptr->error_message);
+  }
+  else {
     class_call(interpolate_Phi(pHIS, x_size, index_l, chireverse, Phi, ptr->error_message),
                ptr->error_message, ptr->error_message);
-    //hyperspherical_Hermite_interpolation_vector(pHIS, x_size, index_l, chireverse, Phi, NULL, NULL);
+    derivatives = _RADIAL_PHI_;
+  }
+
+  ptw->rescale_argument = rescale_argument;
+  ptw->radial_derivatives = derivatives;
+  ptw->index_tau_min_radial = index_tau_min;
+  ptw->index_tau_max_radial = index_tau_max;
+
+  return _SUCCESS_;
+}
+
+/**
+ * Which of the hyperspherical Bessel functions and of their
+ * derivatives are needed by a given type of radial function.
+ *
+ * @param radial_type Input: type of radial function
+ * @param derivatives Output: combination of _RADIAL_PHI_, _RADIAL_DPHI_, _RADIAL_D2PHI_
+ * @return the error status
+ */
+
+int transfer_radial_derivatives(
+                                radial_function_type radial_type,
+                                int * derivatives
+                                ) {
+
+  switch (radial_type){
+  case SCALAR_TEMPERATURE_1:
+    *derivatives = _RADIAL_DPHI_;
+    break;
+  case SCALAR_TEMPERATURE_2:
+  case NC_RSD:
+    *derivatives = _RADIAL_PHI_ | _RADIAL_D2PHI_;
+    break;
+  case VECTOR_TEMPERATURE_2:
+  case VECTOR_POLARISATION_E:
+  case TENSOR_POLARISATION_B:
+    *derivatives = _RADIAL_PHI_ | _RADIAL_DPHI_;
+    break;
+  case TENSOR_POLARISATION_E:
+    *derivatives = _RADIAL_PHI_ | _RADIAL_DPHI_ | _RADIAL_D2PHI_;
+    break;
+  default:
+    *derivatives = _RADIAL_PHI_;
+  }
+
+  return _SUCCESS_;
+}
+
+/**
+ * This routine computes a radial function of a given type for the
+ * times index_tau_min, ..., index_tau_min+x_size-1, from the
+ * hyperspherical Bessel functions interpolated previously by
+ * transfer_radial_basis() over a range containing these times.
+ *
+ * @param ptw             Input: pointer to transfer workspace
+ * @param ppt             Input: pointer to perturbation structure
+ * @param ptr             Input: pointer to transfer structure
+ * @param k               Input: wavenumber
+ * @param index_q         Input: index of wavenumber
+ * @param index_l         Input: index of multipole
+ * @param index_tau_min   Input: first time
+ * @param x_size          Input: number of times
+ * @param radial_function Output: radial function radial_function[index_tau-index_tau_min]
+ * @param radial_type     Input: type of radial function
+ * @return the error status
+ */
+
+int transfer_radial_function(
+                             struct transfer_workspace * ptw,
+                             struct perturbations * ppt,
+                             struct transfer * ptr,
+                             double k,
+                             int index_q,
+                             int index_l,
+                             int index_tau_min,
+                             int x_size,
+                             double * radial_function,
+                             radial_function_type radial_type
+                             ){
+
+  /* radial functions are computed for the times index_tau_min, ..., index_tau_min+x_size-1 */
+  double *cscKgen = ptw->cscKgen+index_tau_min;
+  double *cotKgen = ptw->cotKgen+index_tau_min;
+  /* the Bessel functions are stored in order of increasing chi, starting at index_tau_max_radial */
+  int index_x_min = ptw->index_tau_max_radial-(index_tau_min+x_size-1);
+  double *Phi = ptw->Phi+index_x_min;
+  double *dPhi = ptw->dPhi+index_x_min;
+  double *d2Phi = ptw->d2Phi+index_x_min;
+  double *rescale_function = ptw->rescale_function+index_x_min;
+  int j;
+  int derivatives;
+  double K=0.,k2=1.0;
+  double sqrt_absK_over_k;
+  double absK_over_k2;
+  double factor, s0, s2, ssqrt3, si, ssqrt2, ssqrt2i;
+  double l = (double)ptr->l[index_l];
+  double rescale_argument = ptw->rescale_argument;
+
+  class_call(transfer_radial_derivatives(radial_type,&derivatives),
+             ptr->error_message,
+             ptr->error_message);
+
+  class_test((index_tau_min < ptw->index_tau_min_radial) ||
+             (index_tau_min+x_size-1 > ptw->index_tau_max_radial) ||
+             ((derivatives & ptw->radial_derivatives) != derivatives),
+             ptr->error_message,
+             "radial function needed for times %d to %d, Bessel functions only interpolated for times %d to %d",
+             index_tau_min,index_tau_min+x_size-1,ptw->index_tau_min_radial,ptw->index_tau_max_radial);
+
+  K = ptw->K;
+  k2 = k*k;
+
+  if (ptw->sgnK==0){
+    /* This is the choice consistent with chi=k*(tau0-tau) and nu=1 */
+    sqrt_absK_over_k = 1.0;
+  }
+  else {
+    K=ptw->K;
+    sqrt_absK_over_k = sqrt(ptw->sgnK*K)/k;
+  }
+  absK_over_k2 =sqrt_absK_over_k*sqrt_absK_over_k;
+
+  switch (radial_type){
+  case SCALAR_TEMPERATURE_0:
     for (j=0; j<x_size; j++)
       radial_function[x_size-1-j] = Phi[j]*rescale_function[j];
     break;
   case SCALAR_TEMPERATURE_1:
-    class_call(interpolate_dPhi(pHIS, x_size, index_l, chireverse, dPhi, ptr->error_message),
-               ptr->error_message, ptr->error_message);
-    //hyperspherical_Hermite_interpolation_vector(pHIS, x_size, index_l, chireverse, NULL, dPhi, NULL);
     for (j=0; j<x_size; j++)
       radial_function[x_size-1-j] = sqrt_absK_over_k*dPhi[j]*rescale_argument*rescale_function[j];
     break;
   case SCALAR_TEMPERATURE_2:
-    class_call(interpolate_Phid2Phi(pHIS, x_size, index_l, chireverse, Phi, d2Phi, ptr->error_message),
-               ptr->error_message, ptr->error_message);
-    //hyperspherical_Hermite_interpolation_vector(pHIS, x_size, index_l, chireverse, Phi, NULL, d2Phi);
     s2 = sqrt(1.0-3.0*K/k2);
     factor = 1.0/(2.0*s2);
     for (j=0; j<x_size; j++)
       radial_function[x_size-1-j] = factor*(3*absK_over_k2*d2Phi[j]*rescale_argument*rescale_argument+Phi[j])*rescale_function[j];
     break;
   case SCALAR_POLARISATION_E:
-    class_call(interpolate_Phi(pHIS, x_size, index_l, chireverse, Phi, ptr->error_message),
-               ptr->error_message, ptr->error_message);
-    //hyperspherical_Hermite_interpolation_vector(pHIS, x_size, index_l, chireverse, Phi, NULL, NULL);
     s2 = sqrt(1.0-3.0*K/k2);
     factor = sqrt(3.0/8.0*(l+2.0)*(l+1.0)*l*(l-1.0))/s2;
     for (j=0; j<x_size; j++)
       radial_function[x_size-1-j] = factor*cscKgen[x_size-1-j]*cscKgen[x_size-1-j]*Phi[j]*rescale_function[j];
     break;
   case VECTOR_TEMPERATURE_1:
-    class_call(interpolate_Phi(pHIS, x_size, index_l, chireverse, Phi, ptr->error_message),
-               ptr->error_message, ptr->error_message);
-    //hyperspherical_Hermite_interpolation_vector(pHIS, x_size, index_l, chireverse, Phi, NULL, NULL);
     s0 = sqrt(1.0+K/k2);
     factor = sqrt(0.5*l*(l+1))/s0;
     for (j=0; j<x_size; j++)
       radial_function[x_size-1-j] = factor*cscKgen[x_size-1-j]*Phi[j]*rescale_function[j];
     break;
   case VECTOR_TEMPERATURE_2:
-    class_call(interpolate_PhidPhi(pHIS, x_size, index_l, chireverse, Phi, dPhi, ptr->error_message),
-               ptr->error_message, ptr->error_message);
-    //hyperspherical_Hermite_interpolation_vector(pHIS, x_size, index_l, chireverse, Phi, dPhi, NULL);
     s0 = sqrt(1.0+K/k2);
     ssqrt3 = sqrt(1.0-2.0*K/k2);
     factor = sqrt(1.5*l*(l+1))/s0/ssqrt3;
@@ -3978,9 +4581,6 @@ int transfer_radial_function(
       radial_function[x_size-1-j] = factor*cscKgen[x_size-1-j]*(sqrt_absK_over_k*dPhi[j]*rescale_argument-cotKgen[j]*Phi[j])*rescale_function[j];
     break;
   case VECTOR_POLARISATION_E:
-    class_call(interpolate_PhidPhi(pHIS, x_size, index_l, chireverse, Phi, dPhi, ptr->error_message),
-               ptr->error_message, ptr->error_message);
-    //    hyperspherical_Hermite_interpolation_vector(pHIS, x_size, index_l, chireverse, Phi, dPhi, NULL);
     s0 = sqrt(1.0+K/k2);
     ssqrt3 = sqrt(1.0-2.0*K/k2);
     factor = 0.5*sqrt((l-1.0)*(l+2.0))/s0/ssqrt3;
@@ -3988,9 +4588,6 @@ int transfer_radial_function(
       radial_function[x_size-1-j] = factor*cscKgen[x_size-1-j]*(cotKgen[j]*Phi[j]+sqrt_absK_over_k*dPhi[j]*rescale_argument)*rescale_function[j];
     break;
   case VECTOR_POLARISATION_B:
-    class_call(interpolate_Phi(pHIS, x_size, index_l, chireverse, Phi, ptr->error_message),
-               ptr->error_message, ptr->error_message);
-    //hyperspherical_Hermite_interpolation_vector(pHIS, x_size, index_l, chireverse, Phi, NULL, NULL);
     s0 = sqrt(1.0+K/k2);
     ssqrt3 = sqrt(1.0-2.0*K/k2);
     si = sqrt(1.0+2.0*K/k2);
@@ -3999,9 +4596,6 @@ int transfer_radial_function(
       radial_function[x_size-1-j] = factor*cscKgen[x_size-1-j]*Phi[j]*rescale_function[j];
     break;
   case TENSOR_TEMPERATURE_2:
-    class_call(interpolate_Phi(pHIS, x_size, index_l, chireverse, Phi, ptr->error_message),
-               ptr->error_message, ptr->error_message);
-    //hyperspherical_Hermite_interpolation_vector(pHIS, x_size, index_l, chireverse, Phi, NULL, NULL);
     ssqrt2 = sqrt(1.0-1.0*K/k2);
     si = sqrt(1.0+2.0*K/k2);
     factor = sqrt(3.0/8.0*(l+2.0)*(l+1.0)*l*(l-1.0))/si/ssqrt2;
@@ -4009,9 +4603,6 @@ int transfer_radial_function(
       radial_function[x_size-1-j] = factor*cscKgen[x_size-1-j]*cscKgen[x_size-1-j]*Phi[j]*rescale_function[j];
     break;
   case TENSOR_POLARISATION_E:
-    class_call(interpolate_PhidPhid2Phi(pHIS, x_size, index_l, chireverse, Phi, dPhi, d2Phi, ptr->error_message),
-               ptr->error_message, ptr->error_message);
-    //hyperspherical_Hermite_interpolation_vector(pHIS, x_size, index_l, chireverse, Phi, NULL, NULL);
     ssqrt2 = sqrt(1.0-1.0*K/k2);
     si = sqrt(1.0+2.0*K/k2);
     factor = 0.25/si/ssqrt2;
@@ -4021,9 +4612,6 @@ int transfer_radial_function(
                                             -(1.0+4*K/k2-2.0*cotKgen[x_size-1-j]*cotKgen[x_size-1-j])*Phi[j])*rescale_function[j];
     break;
   case TENSOR_POLARISATION_B:
-    class_call(interpolate_PhidPhi(pHIS, x_size, index_l, chireverse, Phi, dPhi, ptr->error_message),
-               ptr->error_message, ptr->error_message);
-    //hyperspherical_Hermite_interpolation_vector(pHIS, x_size, index_l, chireverse, Phi, dPhi, NULL);
     ssqrt2i = sqrt(1.0+3.0*K/k2);
     ssqrt2 = sqrt(1.0-1.0*K/k2);
     si = sqrt(1.0+2.0*K/k2);
@@ -4032,9 +4620,6 @@ int transfer_radial_function(
       radial_function[x_size-1-j] = factor*(sqrt_absK_over_k*dPhi[j]*rescale_argument+2.0*cotKgen[x_size-1-j]*Phi[j])*rescale_function[j];
     break;
   case NC_RSD:
-    class_call(interpolate_Phid2Phi(pHIS, x_size, index_l, chireverse, Phi, d2Phi, ptr->error_message),
-               ptr->error_message, ptr->error_message);
-    //hyperspherical_Hermite_interpolation_vector(pHIS, x_size, index_l, chireverse, Phi, NULL, d2Phi);
     //s2 = sqrt(1.0-3.0*K/k2);
     factor = 1.0;
     for (j=0; j<x_size; j++)
@@ -4043,12 +4628,6 @@ int transfer_radial_function(
     break;
   }
 
-  free(Phi);
-  free(dPhi);
-  free(d2Phi);
-  free(chireverse);
-  free(rescale_function);
-
   return _SUCCESS_;
 }
 
@@ -4097,6 +4676,12 @@ int transfer_select_radial_function(
     if (_index_tt_in_range_(ptr->index_tt_nc_g5,   ppt->selection_num, ppt->has_nc_gr))
       *radial_type = SCALAR_TEMPERATURE_1;
 
+    if (_index_tt_in_range_(ptr->index_tt_d1_mag,    ppt->selection_num, ptr->has_nc_rsd_mag))
+      *radial_type = SCALAR_TEMPERATURE_1;
+
+    if (_index_tt_in_range_(ptr->index_tt_nc_g5_mag, ppt->selection_num, ptr->has_nc_gr_mag))
+      *radial_type = SCALAR_TEMPERATURE_1;
+
   }
 
   if (_vectors_) {
@@ -4262,11 +4847,222 @@ int transfer_global_selection_read(
 
 };
 
+/**
+ * Prepare the separate storage of the early contributions to the
+ * transfer functions (from times before split_z), and decide whether
+ * those of a previous run passed in early_from can be used instead of
+ * being computed. This requires the same precision parameters, the
+ * same key of early-time inputs as for the checkpoint of
+ * perturbations (see perturbations_early_key()), the same modes,
+ * initial conditions, types and multipoles, and the same wavenumbers,
+ * conformal age and background/thermodynamical quantities at split_z,
+ * up to the precision parameter tol_transfer_split. Since
+ * reionisation is not part of the key, the CMB sources before split_z
+ * of two such runs may still differ by the factor \f$ e^{-\kappa} \f$ at
+ * split_z: the early contributions of the temperature and
+ * polarisation types are rescaled accordingly.
+ *
+ * @param ppr Input: pointer to precision structure
+ * @param pba Input: pointer to background structure
+ * @param pth Input: pointer to thermodynamics structure
+ * @param ppt Input: pointer to perturbation structure
+ * @param ptr Input/Output: pointer to transfer structure
+ * @return the error status
+ */
+
+int transfer_split_init(
+                        struct precision * ppr,
+                        struct background * pba,
+                        struct thermodynamics * pth,
+                        struct perturbations * ppt,
+                        struct transfer * ptr
+                        ) {
+
+  struct transfer * ptr_old = ptr->early_from;
+  double * pvecback;
+  double * pvecthermo;
+  int last_index=0;
+  int index_md, index_ic, index_tt, index_l, index_key;
+  size_t index_q, index, size;
+  short compatible, is_cmb;
+  double ratio;
+
+  ptr->has_split = _FALSE_;
+  ptr->has_early_reused = _FALSE_;
+
+  if (ptr->split_z <= 0.)
+    return _SUCCESS_;
+
+  /** - find conformal time and background/thermodynamical quantities at split_z */
+
+  class_call(background_tau_of_z(pba,ptr->split_z,&(ptr->tau_split)),
+             pba->error_message,
+             ptr->error_message);
+
+  class_alloc(pvecback,pba->bg_size*sizeof(double),ptr->error_message);
+  class_alloc(pvecthermo,pth->th_size*sizeof(double),ptr->error_message);
+
+  class_call(background_at_tau(pba,
+                               ptr->tau_split,
+                               normal_info,
+                               inter_normal,
+                               &last_index,
+                               pvecback),
+             pba->error_message,
+             ptr->error_message);
+
+  class_call(thermodynamics_at_z(pba,
+                                 pth,
+                                 ptr->split_z,
+                                 inter_normal,
+                                 &last_index,
+                                 pvecback,
+                                 pvecthermo),
+             pth->error_message,
+             ptr->error_message);
+
+  ptr->split_tau0 = pba->conformal_age;
+  ptr->split_a = pvecback[pba->index_bg_a];
+  ptr->split_H = pvecback[pba->index_bg_H];
+  ptr->split_dkappa = pvecthermo[pth->index_th_dkappa];
+  ptr->split_exp_m_kappa = pvecthermo[pth->index_th_exp_m_kappa];
+
+  class_call(perturbations_early_key(ppr,
+                                     pba,
+                                     pth,
+                                     ppt,
+                                     pvecback,
+                                     &(ptr->split_key),
+                                     &(ptr->split_key_size)),
+             ppt->error_message,
+             ptr->error_message);
+
+  free(pvecback);
+  free(pvecthermo);
+
+  class_alloc(ptr->split_precision,sizeof(struct precision),ptr->error_message);
+  *(ptr->split_precision) = *ppr;
+
+  /** - allocate the early contributions */
+
+  class_alloc(ptr->split_ic_size,ptr->md_size*sizeof(int),ptr->error_message);
+  class_alloc(ptr->transfer_early,ptr->md_size*sizeof(double*),ptr->error_message);
+
+  for (index_md = 0; index_md < ptr->md_size; index_md++) {
+    ptr->split_ic_size[index_md] = ppt->ic_size[index_md];
+    class_calloc(ptr->transfer_early[index_md],
+                 ppt->ic_size[index_md] * ptr->tt_size[index_md] * ptr->l_size[index_md] * ptr->q_size,
+                 sizeof(double),
+                 ptr->error_message);
+  }
+
+  ptr->has_split = _TRUE_;
+
+  /** - check whether the early contributions of a previous run can be used */
+
+  if (ptr_old == NULL)
+    return _SUCCESS_;
+
+  compatible = _TRUE_;
+
+  if ((ptr_old->has_cls == _FALSE_) ||
+      (ptr_old->has_split == _FALSE_) ||
+      (ptr_old->md_size != ptr->md_size) ||
+      (ptr_old->q_size != ptr->q_size) ||
+      (ptr_old->l_size_max != ptr->l_size_max) ||
+      (ptr_old->split_key_size != ptr->split_key_size) ||
+      (class_precision_equal(ptr_old->split_precision,ptr->split_precision) == _FALSE_)) {
+    compatible = _FALSE_;
+  }
+
+  /* written such that NaN entries never match */
+  for (index_key = 0; (index_key < ptr->split_key_size) && (compatible == _TRUE_); index_key++) {
+    if (!(fabs(ptr_old->split_key[index_key]-ptr->split_key[index_key])
+          <= _TOLVAR_*ppr->smallest_allowed_variation*fabs(ptr->split_key[index_key])))
+      compatible = _FALSE_;
+  }
+
+  for (index_md = 0; (index_md < ptr->md_size) && (compatible == _TRUE_); index_md++) {
+    if ((ptr_old->split_ic_size[index_md] != ptr->split_ic_size[index_md]) ||
+        (ptr_old->tt_size[index_md] != ptr->tt_size[index_md]) ||
+        (ptr_old->l_size[index_md] != ptr->l_size[index_md])) {
+      compatible = _FALSE_;
+    }
+    for (index_tt = 0; (index_tt < ptr->tt_size[index_md]) && (compatible == _TRUE_); index_tt++) {
+      if (ptr_old->l_size_tt[index_md][index_tt] != ptr->l_size_tt[index_md][index_tt])
+        compatible = _FALSE_;
+    }
+  }
+
+  for (index_l = 0; (index_l < ptr->l_size_max) && (compatible == _TRUE_); index_l++) {
+    if (ptr_old->l[index_l] != ptr->l[index_l])
+      compatible = _FALSE_;
+  }
+
+  for (index_q = 0; (index_q < ptr->q_size) && (compatible == _TRUE_); index_q++) {
+    if (fabs(ptr_old->q[index_q]/ptr->q[index_q]-1.) > ppr->tol_transfer_split)
+      compatible = _FALSE_;
+  }
+
+  if ((compatible == _TRUE_) &&
+      ((fabs(ptr_old->split_tau0/ptr->split_tau0-1.) > ppr->tol_transfer_split) ||
+       (fabs(ptr_old->tau_split/ptr->tau_split-1.) > ppr->tol_transfer_split) ||
+       (fabs(ptr_old->split_a/ptr->split_a-1.) > ppr->tol_transfer_split) ||
+       (fabs(ptr_old->split_H/ptr->split_H-1.) > ppr->tol_transfer_split) ||
+       (fabs(ptr_old->split_dkappa/ptr->split_dkappa-1.) > ppr->tol_transfer_split))) {
+    compatible = _FALSE_;
+  }
+
+  /** - if they can, copy them, rescaling the CMB temperature and polarisation types */
+
+  if (compatible == _TRUE_) {
+
+    ratio = ptr->split_exp_m_kappa/ptr_old->split_exp_m_kappa;
+
+    for (index_md = 0; index_md < ptr->md_size; index_md++) {
+      size = ptr->l_size[index_md] * ptr->q_size;
+      for (index_ic = 0; index_ic < ppt->ic_size[index_md]; index_ic++) {
+        for (index_tt = 0; index_tt < ptr->tt_size[index_md]; index_tt++) {
+
+          if (_scalars_) {
+            is_cmb = (((ppt->has_cl_cmb_temperature == _TRUE_) &&
+                       ((index_tt == ptr->index_tt_t0) || (index_tt == ptr->index_tt_t1) || (index_tt == ptr->index_tt_t2))) ||
+                      ((ppt->has_cl_cmb_polarization == _TRUE_) && (index_tt == ptr->index_tt_e)));
+          }
+          else {
+            is_cmb = _TRUE_;
+          }
+
+          for (index = (index_ic * ptr->tt_size[index_md] + index_tt) * size;
+               index < (index_ic * ptr->tt_size[index_md] + index_tt + 1) * size;
+               index++) {
+            ptr->transfer_early[index_md][index] = ptr_old->transfer_early[index_md][index];
+            if (is_cmb == _TRUE_)
+              ptr->transfer_early[index_md][index] *= ratio;
+          }
+        }
+      }
+    }
+  }
+
+  ptr->has_early_reused = compatible;
+
+  if (ptr->transfer_verbose > 0) {
+    if (compatible == _TRUE_)
+      printf(" -> reusing contributions from z>%g of a previous run, integrating only later times\n",ptr->split_z);
+    else
+      printf(" -> the contributions from z>%g of the previous run cannot be used, integrating all times\n",ptr->split_z);
+  }
+
+  return _SUCCESS_;
+}
+
 int transfer_workspace_init(
                             struct transfer * ptr,
                             struct precision * ppr,
                             struct transfer_workspace **ptw,
                             int perturbations_tau_size,
+                            int ic_size,
                             int tau_size_max,
                             double K,
                             int sgnK,
@@ -4276,6 +5072,8 @@ int transfer_workspace_init(
   class_calloc(*ptw,1,sizeof(struct transfer_workspace),ptr->error_message);
 
   (*ptw)->tau_size_max = tau_size_max;
+  (*ptw)->ic_size = ic_size;
+  (*ptw)->perturbations_tau_size = perturbations_tau_size;
   (*ptw)->l_size = ptr->l_size_max;
   (*ptw)->HIS_allocated=_FALSE_;
   (*ptw)->pBIS = pBIS;
@@ -4284,13 +5082,69 @@ int transfer_workspace_init(
   (*ptw)->tau0_minus_tau_cut = tau0_minus_tau_cut;
   (*ptw)->neglect_late_source = _FALSE_;
 
-  class_alloc((*ptw)->interpolated_sources,perturbations_tau_size*sizeof(double),ptr->error_message);
-  class_alloc((*ptw)->sources,tau_size_max*sizeof(double),ptr->error_message);
+  class_alloc((*ptw)->interpolated_sources,ic_size*perturbations_tau_size*sizeof(double),ptr->error_message);
+  (*ptw)->sources = NULL;
+  (*ptw)->source_table = NULL;
+  (*ptw)->index_tau_min_table = NULL;
+  (*ptw)->index_tau_max_table = NULL;
+  (*ptw)->group_size_max = 0;
   class_alloc((*ptw)->tau0_minus_tau,tau_size_max*sizeof(double),ptr->error_message);
   class_alloc((*ptw)->w_trapz,tau_size_max*sizeof(double),ptr->error_message);
+  class_alloc((*ptw)->tau0_minus_tau_next,tau_size_max*sizeof(double),ptr->error_message);
+  class_alloc((*ptw)->w_trapz_next,tau_size_max*sizeof(double),ptr->error_message);
   class_alloc((*ptw)->chi,tau_size_max*sizeof(double),ptr->error_message);
   class_alloc((*ptw)->cscKgen,tau_size_max*sizeof(double),ptr->error_message);
   class_alloc((*ptw)->cotKgen,tau_size_max*sizeof(double),ptr->error_message);
+  class_alloc((*ptw)->chireverse,tau_size_max*sizeof(double),ptr->error_message);
+  class_alloc((*ptw)->Phi,tau_size_max*sizeof(double),ptr->error_message);
+  class_alloc((*ptw)->dPhi,tau_size_max*sizeof(double),ptr->error_message);
+  class_alloc((*ptw)->d2Phi,tau_size_max*sizeof(double),ptr->error_message);
+  class_alloc((*ptw)->rescale_function,tau_size_max*sizeof(double),ptr->error_message);
+  class_alloc((*ptw)->radial_function,tau_size_max*sizeof(double),ptr->error_message);
+
+  class_call(transfer_workspace_source_table(ptr,*ptw,1),
+             ptr->error_message,
+             ptr->error_message);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Make sure that the table of sources in the workspace can hold the
+ * sources of group_size types (for all initial conditions).
+ *
+ * The table grows with the largest number of consecutive types
+ * sharing the same time sampling (e.g. the CMB temperature and
+ * polarization types), which is only known while looping over types.
+ *
+ * @param ptr        Input: pointer to transfer structure
+ * @param ptw        Input/Output: pointer to transfer workspace
+ * @param group_size Input: number of types
+ * @return the error status
+ */
+
+int transfer_workspace_source_table(
+                                    struct transfer * ptr,
+                                    struct transfer_workspace * ptw,
+                                    int group_size
+                                    ) {
+
+  if (group_size <= ptw->group_size_max)
+    return _SUCCESS_;
+
+  class_realloc(ptw->source_table,
+                ptw->source_table,
+                (size_t)group_size*ptw->ic_size*ptw->tau_size_max*sizeof(double),
+                ptr->error_message);
+  class_realloc(ptw->index_tau_min_table,
+                ptw->index_tau_min_table,
+                (size_t)group_size*ptw->ic_size*sizeof(int),
+                ptr->error_message);
+  class_realloc(ptw->index_tau_max_table,
+                ptw->index_tau_max_table,
+                (size_t)group_size*ptw->ic_size*sizeof(int),
+                ptr->error_message);
+  ptw->group_size_max = group_size;
 
   return _SUCCESS_;
 }
@@ -4307,12 +5161,22 @@ int transfer_workspace_free(
                ptr->error_message);
   }
   free(ptw->interpolated_sources);
-  free(ptw->sources);
+  free(ptw->source_table);
+  free(ptw->index_tau_min_table);
+  free(ptw->index_tau_max_table);
   free(ptw->tau0_minus_tau);
   free(ptw->w_trapz);
+  free(ptw->tau0_minus_tau_next);
+  free(ptw->w_trapz_next);
   free(ptw->chi);
   free(ptw->cscKgen);
   free(ptw->cotKgen);
+  free(ptw->chireverse);
+  free(ptw->Phi);
+  free(ptw->dPhi);
+  free(ptw->d2Phi);
+  free(ptw->rescale_function);
+  free(ptw->radial_function);
 
   free(ptw);
   return _SUCCESS_;
@@ -4638,6 +5502,11 @@ int transfer_precompute_selection(
   /* rescaling factor depending on the background at a given time */
   double rescaling=0.;
 
+  /* light-to-mass bias and magnification bias entering the windows
+     (respectively one and zero for nuisance-separable number counts) */
+  double bias=1.;
+  double magnification_bias=0.;
+
   /* array of selection function values at different times */
   double * selection;
 
@@ -4692,6 +5561,11 @@ int transfer_precompute_selection(
 
       _get_bin_nonintegrated_ncl_(index_tt)
 
+        if (ptr->has_nc_components == _FALSE_) {
+          bias = ptr->selection_bias[bin];
+          magnification_bias = ptr->selection_magnification_bias[bin];
+        }
+
         /* redefine the time sampling */
         class_call(transfer_selection_sampling(ppr,
                                                pba,
@@ -4786,7 +5660,7 @@ int transfer_precompute_selection(
         */
 
         if (_index_tt_in_range_(ptr->index_tt_density, ppt->selection_num, ppt->has_nc_density))
-          rescaling = ptr->selection_bias[bin]*selection[index_tau];
+          rescaling = bias*selection[index_tau];
 
         /* redshift space distortion source = - [- (dz/dtau) W(z)] * (k/H) * theta(k,tau) */
 
@@ -4803,12 +5677,12 @@ int transfer_precompute_selection(
                                             /pvecback[pba->index_bg_a]
                                             /pvecback[pba->index_bg_H]
                                             /pvecback[pba->index_bg_H]
-                                            +(2.-5.*ptr->selection_magnification_bias[bin])
+                                            +(2.-5.*magnification_bias)
                                             // /tau0_minus_tau[index_tau] // in flat space
                                             *cotKgen_source  // in general case
                                             /pvecback[pba->index_bg_a]
                                             /pvecback[pba->index_bg_H]
-                                            +5.*ptr->selection_magnification_bias[bin]
+                                            +5.*magnification_bias
                                             -f_evo
                                             );
 
@@ -4823,7 +5697,7 @@ int transfer_precompute_selection(
                                              /pvecback[pba->index_bg_a]
                                              /pvecback[pba->index_bg_H]
                                              /pvecback[pba->index_bg_H]
-                                             +(2.-5.*ptr->selection_magnification_bias[bin])
+                                             +(2.-5.*magnification_bias)
                                              // /tau0_minus_tau[index_tau]  // in flat space
                                              *cotKgen_source  // in general case
                                              /pvecback[pba->index_bg_a]
@@ -4834,6 +5708,21 @@ int transfer_precompute_selection(
         if (_index_tt_in_range_(ptr->index_tt_nc_g3,   ppt->selection_num, ppt->has_nc_gr))
           rescaling = selection[index_tau]/pvecback[pba->index_bg_a]/pvecback[pba->index_bg_H];
 
+        /* coefficients of the magnification bias in the d1 and G2 terms above */
+
+        if (_index_tt_in_range_(ptr->index_tt_d1_mag,    ppt->selection_num, ptr->has_nc_rsd_mag))
+          rescaling = 5.*selection[index_tau]*(1.
+                                               -cotKgen_source
+                                               /pvecback[pba->index_bg_a]
+                                               /pvecback[pba->index_bg_H]
+                                               );
+
+        if (_index_tt_in_range_(ptr->index_tt_nc_g2_mag, ppt->selection_num, ptr->has_nc_gr_mag))
+          rescaling = 5.*selection[index_tau]
+            *cotKgen_source
+            /pvecback[pba->index_bg_a]
+            /pvecback[pba->index_bg_H];
+
         /* finally store in array */
         (*window)[index_tt*tau_size_max+index_tau] = rescaling;
       }
@@ -4845,6 +5734,10 @@ int transfer_precompute_selection(
 
       _get_bin_integrated_ncl_(index_tt)
 
+        if (ptr->has_nc_components == _FALSE_) {
+          magnification_bias = ptr->selection_magnification_bias[bin];
+        }
+
         /* dirac case */
         if (ppt->selection == dirac) {
           tau_sources_size=1;
@@ -4979,7 +5872,7 @@ int transfer_precompute_selection(
               if (_index_tt_in_range_(ptr->index_tt_nc_lens, ppt->selection_num, ppt->has_nc_lens)) {
 
                 rescaling -=
-                  (2.-5.*ptr->selection_magnification_bias[bin])/2.
+                  (2.-5.*magnification_bias)/2.
                   //  *(tau0_minus_tau[index_tau]-tau0_minus_tau_lensing_sources[index_tau_sources])
                   //  /tau0_minus_tau[index_tau]
                   //  /tau0_minus_tau_lensing_sources[index_tau_sources]
@@ -4993,7 +5886,7 @@ int transfer_precompute_selection(
               if (_index_tt_in_range_(ptr->index_tt_nc_g4, ppt->selection_num, ppt->has_nc_gr)) {
 
                 rescaling +=
-                  (2.-5.*ptr->selection_magnification_bias[bin])
+                  (2.-5.*magnification_bias)
                   // /tau0_minus_tau_lensing_sources[index_tau_sources]
                   * cotKgen_source
                   * selection[index_tau_sources]
@@ -5027,16 +5920,38 @@ int transfer_precompute_selection(
                    /pvecback[pba->index_bg_a]
                    /pvecback[pba->index_bg_H]
                    /pvecback[pba->index_bg_H]
-                   + (2.-5.*ptr->selection_magnification_bias[bin])
+                   + (2.-5.*magnification_bias)
                    //  /tau0_minus_tau_lensing_sources[index_tau_sources]
                    * cotKgen_source
                    /pvecback[pba->index_bg_a]
                    /pvecback[pba->index_bg_H]
-                   + 5.*ptr->selection_magnification_bias[bin]
+                   + 5.*magnification_bias
                    - f_evo)
                   * selection[index_tau_sources]
                   * w_trapz_lensing_sources[index_tau_sources];
               }
+
+              if (_index_tt_in_range_(ptr->index_tt_nc_g5_mag, ppt->selection_num, ptr->has_nc_gr_mag)) {
+
+                /* coefficient of the magnification bias in the G5 term above */
+
+                class_call(background_at_tau(pba,
+                                             tau0-tau0_minus_tau_lensing_sources[index_tau_sources],
+                                             long_info,
+                                             inter_normal,
+                                             &last_index,
+                                             pvecback),
+                           pba->error_message,
+                           ptr->error_message);
+
+                rescaling +=
+                  5.*(1.
+                      - cotKgen_source
+                      /pvecback[pba->index_bg_a]
+                      /pvecback[pba->index_bg_H])
+                  * selection[index_tau_sources]
+                  * w_trapz_lensing_sources[index_tau_sources];
+              }
             }
           }
         }
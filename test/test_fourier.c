@@ -6,6 +6,9 @@
 
 #include "class.h"
 
+/* maximum relative deviation of the analytic tail of P(k) with respect to a full integration */
+#define _TAIL_TOLERANCE_ 1.e-2
+
 int main(int argc, char **argv) {
 
   struct precision pr;        /* for precision parameters */
@@ -21,6 +24,21 @@ int main(int argc, char **argv) {
   struct output op;           /* for output files */
   ErrorMsg errmsg;            /* for error messages */
 
+  /* for the full integration compared with the analytic tail of P(k) */
+  struct precision pr_full;
+  struct background ba_full;
+  struct thermodynamics th_full;
+  struct perturbations pt_full;
+  struct transfer tr_full;
+  struct primordial pm_full;
+  struct harmonic hr_full;
+  struct fourier fo_full;
+  struct lensing le_full;
+  struct distortions sd_full;
+  struct output op_full;
+  int index_pk,index_z;
+  double pk_tail,pk_full,deviation,max_deviation;
+
   if (input_init(argc, argv,&pr,&ba,&th,&pt,&tr,&pm,&hr,&fo,&le,&sd,&op,errmsg) == _FAILURE_) {
     printf("\n\nError running input_init_from_arguments \n=>%s\n",errmsg);
     return _FAILURE_;
@@ -119,6 +137,84 @@ int main(int argc, char **argv) {
     free(pvecback);
   }
 
+  /****** if P(k) was extended by an analytic tail, check it against a full integration ******/
+
+  if (pt.k_max_pk_tail > 0.) {
+
+    printf("Analytic tail of P(k) beyond k=%e 1/Mpc, compared with a full integration up to k=%e 1/Mpc:\n",
+           fo.k[fo.k_size_solved-1],pt.k_max_pk_tail);
+
+    if (input_init(argc, argv,&pr_full,&ba_full,&th_full,&pt_full,&tr_full,&pm_full,&hr_full,&fo_full,&le_full,&sd_full,&op_full,errmsg) == _FAILURE_) {
+      printf("\n\nError running input_init_from_arguments \n=>%s\n",errmsg);
+      return _FAILURE_;
+    }
+
+    pt_full.k_max_for_pk_solved = 0.;
+
+    if (background_init(&pr_full,&ba_full) == _FAILURE_) {
+      printf("\n\nError running background_init \n=>%s\n",ba_full.error_message);
+      return _FAILURE_;
+    }
+
+    if (thermodynamics_init(&pr_full,&ba_full,&th_full) == _FAILURE_) {
+      printf("\n\nError in thermodynamics_init \n=>%s\n",th_full.error_message);
+      return _FAILURE_;
+    }
+
+    if (perturbations_init(&pr_full,&ba_full,&th_full,&pt_full) == _FAILURE_) {
+      printf("\n\nError in perturbations_init \n=>%s\n",pt_full.error_message);
+      return _FAILURE_;
+    }
+
+    if (primordial_init(&pr_full,&pt_full,&pm_full) == _FAILURE_) {
+      printf("\n\nError in primordial_init \n=>%s\n",pm_full.error_message);
+      return _FAILURE_;
+    }
+
+    if (fourier_init(&pr_full,&ba_full,&th_full,&pt_full,&pm_full,&fo_full) == _FAILURE_) {
+      printf("\n\nError in fourier_init \n=>%s\n",fo_full.error_message);
+      return _FAILURE_;
+    }
+
+    for (index_pk=0; index_pk<fo.pk_size; index_pk++) {
+      for (index_z=0; index_z<op.z_pk_num; index_z++) {
+
+        max_deviation = 0.;
+
+        for (index_k=fo.k_size_solved; (index_k<fo.k_size) && (fo.k[index_k]<=fo_full.k[fo_full.k_size-1]); index_k++) {
+
+          if ((fourier_pk_at_k_and_z(&ba,&pm,&fo,pk_linear,fo.k[index_k],op.z_pk[index_z],index_pk,&pk_tail,NULL) == _FAILURE_) ||
+              (fourier_pk_at_k_and_z(&ba_full,&pm_full,&fo_full,pk_linear,fo.k[index_k],op.z_pk[index_z],index_pk,&pk_full,NULL) == _FAILURE_)) {
+            printf("\n\nError in fourier_pk_at_k_and_z \n=>%s\n%s\n",fo.error_message,fo_full.error_message);
+            return _FAILURE_;
+          }
+
+          deviation = fabs(pk_tail/pk_full-1.);
+          max_deviation = MAX(max_deviation,deviation);
+        }
+
+        printf("  P_%s(k,z=%g): max relative deviation %e\n",
+               ((fo.has_pk_cb == _TRUE_) && (index_pk == fo.index_pk_cb)) ? "cb" : "m",
+               op.z_pk[index_z],
+               max_deviation);
+
+        if (max_deviation > _TAIL_TOLERANCE_) {
+          printf("\n\nError: the analytic tail of P(k) deviates by more than %e from the full integration\n",_TAIL_TOLERANCE_);
+          return _FAILURE_;
+        }
+      }
+    }
+
+    if ((fourier_free(&fo_full) == _FAILURE_) ||
+        (primordial_free(&pm_full) == _FAILURE_) ||
+        (perturbations_free(&pt_full) == _FAILURE_) ||
+        (thermodynamics_free(&th_full) == _FAILURE_) ||
+        (background_free(&ba_full) == _FAILURE_)) {
+      printf("\n\nError in freeing the structures of the full integration\n");
+      return _FAILURE_;
+    }
+  }
+
   /****** all calculations done, now free the structures ******/
 
   if (fourier_free(&fo) == _FAILURE_) {
@@ -0,0 +1,844 @@
+/** @file test_kernels.c
+ *
+ * Microbenchmarks of the numerical primitives of tools/, on sizes
+ * recorded from real runs with default precision:
+ *
+ * - lensed Cl's up to l=3000: 126 multipoles up to l=3500 and 10731
+ *   points in the table of flat Bessel functions, about 437 sampled
+ *   times in each line-of-sight integral, and stiff systems of 46
+ *   equations with about 167 non-zero Jacobian entries;
+ * - one massive neutrino species: 136 equations, about 600 non-zero
+ *   Jacobian entries;
+ * - a stiff system of the size of the recombination equations, with
+ *   rates spanning nine orders of magnitude: Robertson's chemical
+ *   kinetics problem (three equations, not the recombination equations
+ *   themselves), integrated with the relative tolerance of the
+ *   thermodynamics module;
+ * - source tables of 642 wavenumbers times 596 times, and 569 times 47
+ *   at late times (z_max_pk = 3).
+ *
+ * Each kernel is called repeatedly with its working set in cache
+ * ("hot") and, when relevant, cycling through copies of its tables
+ * larger than the last level cache ("cold"). The results (ns per call,
+ * throughput, bandwidth) are printed and written in JSON format, so
+ * that an optimisation of a kernel can be validated in isolation.
+ *
+ * Usage: ./test_kernels [output file (default: kernels.json)] [filter on kernel names]
+ */
+
+#include "common.h"
+#include "arrays.h"
+#include "quadrature.h"
+#include "sparse.h"
+#include "evolver_ndf15.h"
+#include "hyperspherical.h"
+
+#include <time.h>
+
+#define _BENCH_MIN_TIME_ 0.05 /**< minimum duration of each timed repeat, in seconds */
+#define _BENCH_REPEATS_ 5 /**< number of timed repeats (the median and the minimum are reported) */
+#define _BENCH_MAX_ 64 /**< maximum number of benchmarks */
+#define _BENCH_COLD_BYTES_ (64*1024*1024) /**< working set of the cold variants, above usual last level caches */
+
+/**
+ * Result of one benchmark
+ */
+
+struct bench_result {
+  char name[64];     /**< name of the kernel */
+  char variant[8];   /**< "hot" or "cold" */
+  char sizes[128];   /**< problem sizes */
+  long calls;        /**< number of calls in each repeat */
+  double ns_per_op;  /**< median time per call over repeats, in ns */
+  double ns_per_op_min; /**< minimum time per call over repeats, in ns */
+  double elements_per_op; /**< number of elements produced per call */
+  double bytes_per_op;    /**< number of bytes read and written per call (0 if not meaningful) */
+};
+
+/**
+ * List of results, and optional filter on kernel names
+ */
+
+struct bench_list {
+  struct bench_result result[_BENCH_MAX_];
+  int size;
+  char * filter;
+};
+
+/** Kernel: performs one call, index counts calls (used to cycle through tables) */
+typedef int (*bench_kernel)(void * data, long index, ErrorMsg errmsg);
+
+double bench_time() {
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+/**
+ * Time a kernel: calibrate the number of calls such that each repeat
+ * lasts at least _BENCH_MIN_TIME_, then time _BENCH_REPEATS_ repeats.
+ */
+
+int bench_run(
+              struct bench_list * pbl,
+              const char * name,
+              const char * variant,
+              const char * sizes,
+              double elements,
+              double bytes,
+              bench_kernel kernel,
+              void * data,
+              ErrorMsg errmsg
+              ) {
+
+  struct bench_result * pbr;
+  double tstart, tspent, times[_BENCH_REPEATS_];
+  long calls=1, call, index=0;
+  int repeat;
+
+  if ((pbl->filter != NULL) && (strstr(name,pbl->filter) == NULL))
+    return _SUCCESS_;
+
+  class_test(pbl->size == _BENCH_MAX_,
+             errmsg,
+             "increase _BENCH_MAX_");
+
+  /* warm-up and calibration */
+  for (;;) {
+    tstart = bench_time();
+    for (call=0; call<calls; call++) {
+      class_call(kernel(data,index++,errmsg),errmsg,errmsg);
+    }
+    tspent = bench_time()-tstart;
+    if (tspent >= _BENCH_MIN_TIME_)
+      break;
+    calls = (tspent > 0.) ? MAX(2*calls,(long)(1.2*calls*_BENCH_MIN_TIME_/tspent)) : 10*calls;
+  }
+
+  for (repeat=0; repeat<_BENCH_REPEATS_; repeat++) {
+    tstart = bench_time();
+    for (call=0; call<calls; call++) {
+      class_call(kernel(data,index++,errmsg),errmsg,errmsg);
+    }
+    times[repeat] = (bench_time()-tstart)/calls*1.e9;
+  }
+  qsort(times,_BENCH_REPEATS_,sizeof(double),compare_doubles);
+
+  pbr = &(pbl->result[pbl->size++]);
+  snprintf(pbr->name,sizeof(pbr->name),"%s",name);
+  snprintf(pbr->variant,sizeof(pbr->variant),"%s",variant);
+  snprintf(pbr->sizes,sizeof(pbr->sizes),"%s",sizes);
+  pbr->calls = calls;
+  pbr->ns_per_op = times[_BENCH_REPEATS_/2];
+  pbr->ns_per_op_min = times[0];
+  pbr->elements_per_op = elements;
+  pbr->bytes_per_op = bytes;
+
+  printf("%-36s %-5s %-28s %12.1f ns/op %10.2f Melem/s",
+         pbr->name,pbr->variant,pbr->sizes,pbr->ns_per_op,pbr->elements_per_op/pbr->ns_per_op*1.e3);
+  if (bytes > 0.)
+    printf(" %8.2f GB/s",pbr->bytes_per_op/pbr->ns_per_op);
+  printf("\n");
+  fflush(stdout);
+
+  return _SUCCESS_;
+}
+
+/**
+ * Write all results in JSON format
+ */
+
+int bench_write_json(
+                     struct bench_list * pbl,
+                     char * filename,
+                     ErrorMsg errmsg
+                     ) {
+
+  FILE * out;
+  struct bench_result * pbr;
+  int i;
+
+  class_open(out,filename,"w",errmsg);
+
+  fprintf(out,"{\n  \"version\": \"%s\",\n",_VERSION_);
+#ifdef _OPENMP
+  fprintf(out,"  \"openmp_max_threads\": %d,\n",omp_get_max_threads());
+#endif
+  fprintf(out,"  \"repeats\": %d,\n  \"benchmarks\": [\n",_BENCH_REPEATS_);
+  for (i=0; i<pbl->size; i++) {
+    pbr = &(pbl->result[i]);
+    fprintf(out,"    {\"name\": \"%s\", \"variant\": \"%s\", \"sizes\": \"%s\", \"calls\": %ld, ",
+            pbr->name,pbr->variant,pbr->sizes,pbr->calls);
+    fprintf(out,"\"ns_per_op\": %.6e, \"ns_per_op_min\": %.6e, \"elements_per_op\": %.0f, \"elements_per_s\": %.6e, ",
+            pbr->ns_per_op,pbr->ns_per_op_min,pbr->elements_per_op,pbr->elements_per_op/pbr->ns_per_op*1.e9);
+    if (pbr->bytes_per_op > 0.)
+      fprintf(out,"\"bytes_per_op\": %.0f, \"bytes_per_s\": %.6e}",pbr->bytes_per_op,pbr->bytes_per_op/pbr->ns_per_op*1.e9);
+    else
+      fprintf(out,"\"bytes_per_op\": null, \"bytes_per_s\": null}");
+    fprintf(out,"%s\n",(i<pbl->size-1) ? "," : "");
+  }
+  fprintf(out,"  ]\n}\n");
+
+  fclose(out);
+
+  return _SUCCESS_;
+}
+
+/** @name - array_interpolate_spline(): sources at one time, for all wavenumbers */
+
+//@{
+
+struct bench_spline {
+  int n_lines;     /**< number of sampled times */
+  int n_columns;   /**< number of wavenumbers */
+  int tables;      /**< number of copies of the table (1 for hot variant) */
+  double * x;      /**< sampled log(tau) */
+  double * y;      /**< tables y[(table*n_lines+index_line)*n_columns+index_column] */
+  double * ddy;    /**< second derivatives, same layout */
+  double * result; /**< interpolated values */
+};
+
+int bench_interpolate_spline(void * data, long index, ErrorMsg errmsg) {
+  struct bench_spline * pbs = data;
+  int table = index % pbs->tables;
+  int last_index;
+  /* irregular sequence of times, as in successive calls to perturbations_sources_at_tau() */
+  double x = pbs->x[0] + (pbs->x[pbs->n_lines-1]-pbs->x[0])*(((index*7919) % 1000)+0.5)/1000.;
+
+  class_call(array_interpolate_spline(pbs->x,
+                                      pbs->n_lines,
+                                      pbs->y+(size_t)table*pbs->n_lines*pbs->n_columns,
+                                      pbs->ddy+(size_t)table*pbs->n_lines*pbs->n_columns,
+                                      pbs->n_columns,
+                                      x,
+                                      &last_index,
+                                      pbs->result,
+                                      pbs->n_columns,
+                                      errmsg),
+             errmsg,
+             errmsg);
+  return _SUCCESS_;
+}
+
+//@}
+
+/** @name - array_spline_table_columns(): spline of sources with respect to k at each time (transfer module) */
+
+//@{
+
+struct bench_spline_columns {
+  int x_size;      /**< number of wavenumbers */
+  int y_size;      /**< number of times */
+  int tables;      /**< number of copies of the table (1 for hot variant) */
+  double * x;      /**< wavenumbers */
+  double * y;      /**< tables y[(table*y_size+index_y)*x_size+index_x] */
+  double * ddy;    /**< second derivatives, same layout */
+  short version2;  /**< use array_spline_table_columns2() */
+};
+
+int bench_spline_table_columns(void * data, long index, ErrorMsg errmsg) {
+  struct bench_spline_columns * pbs = data;
+  size_t offset = (size_t)(index % pbs->tables)*pbs->x_size*pbs->y_size;
+
+  if (pbs->version2 == _TRUE_) {
+    class_call(array_spline_table_columns2(pbs->x,pbs->x_size,pbs->y+offset,pbs->y_size,pbs->ddy+offset,_SPLINE_EST_DERIV_,errmsg),
+               errmsg,
+               errmsg);
+  }
+  else {
+    class_call(array_spline_table_columns(pbs->x,pbs->x_size,pbs->y+offset,pbs->y_size,pbs->ddy+offset,_SPLINE_EST_DERIV_,errmsg),
+               errmsg,
+               errmsg);
+  }
+  return _SUCCESS_;
+}
+
+//@}
+
+/** @name - array_trapezoidal_convolution(): line-of-sight integral of one transfer function */
+
+//@{
+
+struct bench_convolution {
+  int n;           /**< number of sampled times */
+  long blocks;     /**< number of independent blocks of sources and radial functions (1 for hot variant) */
+  double * sources; /**< sources[block*n+index_tau] */
+  double * radial;  /**< radial functions, same layout */
+  double * w_trapz; /**< trapezoidal weights */
+};
+
+int bench_trapezoidal_convolution(void * data, long index, ErrorMsg errmsg) {
+  struct bench_convolution * pbc = data;
+  size_t offset = (size_t)(index % pbc->blocks)*pbc->n;
+  double I;
+
+  class_call(array_trapezoidal_convolution(pbc->sources+offset,
+                                           pbc->radial+offset,
+                                           pbc->n,
+                                           pbc->w_trapz,
+                                           &I,
+                                           errmsg),
+             errmsg,
+             errmsg);
+  return _SUCCESS_;
+}
+
+//@}
+
+/** @name - hyperspherical_Hermite*_interpolation_vector_*(): radial functions for one (q,l) */
+
+//@{
+
+struct bench_hermite {
+  HyperInterpStruct * pHIS;
+  int nxi;          /**< number of sampled times */
+  double * x;       /**< x[index_l*nxi+index_x], sorted for each l */
+  double * Phi;
+  double * dPhi;
+  double * d2Phi;
+  int index_l;      /**< multipole of hot variant, or -1 for the cold variant (multipoles visited in scattered order) */
+  int (*interpolate_Phi)(HyperInterpStruct *,int,int,double *,double *,ErrorMsg);
+  int (*interpolate_PhidPhid2Phi)(HyperInterpStruct *,int,int,double *,double *,double *,double *,ErrorMsg);
+};
+
+int bench_hermite(void * data, long index, ErrorMsg errmsg) {
+  struct bench_hermite * pbh = data;
+  int index_l = pbh->index_l;
+
+  if (index_l < 0)
+    index_l = (int)((index*37) % pbh->pHIS->l_size);
+
+  if (pbh->interpolate_Phi != NULL) {
+    class_call(pbh->interpolate_Phi(pbh->pHIS,pbh->nxi,index_l,pbh->x+(size_t)index_l*pbh->nxi,pbh->Phi,errmsg),
+               errmsg,
+               errmsg);
+  }
+  else {
+    class_call(pbh->interpolate_PhidPhid2Phi(pbh->pHIS,pbh->nxi,index_l,pbh->x+(size_t)index_l*pbh->nxi,pbh->Phi,pbh->dPhi,pbh->d2Phi,errmsg),
+               errmsg,
+               errmsg);
+  }
+  return _SUCCESS_;
+}
+
+//@}
+
+/** @name - quadrature_gauss_legendre(): angular quadrature of the lensing module */
+
+//@{
+
+struct bench_quadrature {
+  int n;
+  double * mu;
+  double * w8;
+};
+
+int bench_gauss_legendre(void * data, long index, ErrorMsg errmsg) {
+  struct bench_quadrature * pbq = data;
+
+  class_call(quadrature_gauss_legendre(pbq->mu,pbq->w8,pbq->n,DBL_EPSILON,errmsg),
+             errmsg,
+             errmsg);
+  return _SUCCESS_;
+}
+
+//@}
+
+/** @name - numjac(), sp_amd(), sp_ludcmp(), sp_refactor(), sp_lusolve(): stiff integration of one wavenumber */
+
+//@{
+
+/**
+ * Model of the perturbation equations with the coupling structure of
+ * the Boltzmann hierarchies: a metric variable coupled to the lowest
+ * multipoles of each species, baryons tightly coupled to photons, and
+ * free-streaming hierarchies coupling l to l-1 and l+1.
+ */
+
+struct bench_system {
+  int neq;
+  int l_size_g;   /**< photon temperature multipoles */
+  int l_size_pol; /**< photon polarisation multipoles */
+  int l_size_ur;  /**< massless neutrino multipoles */
+  int q_size_ncdm; /**< momenta of massive neutrinos (0 if none) */
+  int l_size_ncdm; /**< multipoles for each momentum */
+  double k;
+  double dkappa;
+  double aH;
+  struct jacobian jac;
+  struct numjac_workspace nj_ws;
+  double * y;     /**< state, y[1..neq] */
+  double * fval;  /**< derivative, fval[1..neq] */
+  double * b;     /**< right-hand side of the linear system */
+  double * sol;   /**< solution of the linear system */
+};
+
+/* derivatives of a hierarchy y[0..l_size-1] with free-streaming and damping */
+void bench_hierarchy(double k, double damping, int l_size, double * y, double * dy) {
+  int l;
+  for (l=0; l<l_size; l++) {
+    dy[l] = -damping*y[l];
+    if (l > 0)
+      dy[l] += k*l/(2.*l+1.)*y[l-1];
+    if (l < l_size-1)
+      dy[l] -= k*(l+1.)/(2.*l+1.)*y[l+1];
+  }
+}
+
+int bench_system_derivs(double tau, double * y, double * dy, void * parameters_and_workspace, ErrorMsg errmsg) {
+  struct bench_system * pbs = parameters_and_workspace;
+  int index_eta = 0;
+  int index_b = 1;
+  int index_cdm = 3;
+  int index_g = 4;
+  int index_pol = index_g+pbs->l_size_g;
+  int index_ur = index_pol+pbs->l_size_pol;
+  int index_ncdm = index_ur+pbs->l_size_ur;
+  int index_q, index;
+  double h_prime = 2.*y[index_eta]+0.1*(y[index_g]+y[index_b]+y[index_cdm]+y[index_ur]);
+
+  /* metric */
+  dy[index_eta] = 0.5*(y[index_g+1]+y[index_b+1]+y[index_ur+1]);
+
+  /* baryons and cold dark matter */
+  dy[index_b] = -y[index_b+1]-0.5*h_prime;
+  dy[index_b+1] = -pbs->aH*y[index_b+1]+0.3*pbs->dkappa*(y[index_g+1]-y[index_b+1]);
+  dy[index_cdm] = -0.5*h_prime;
+
+  /* photons (temperature and polarisation), massless neutrinos */
+  bench_hierarchy(pbs->k,pbs->dkappa,pbs->l_size_g,y+index_g,dy+index_g);
+  dy[index_g] += pbs->dkappa*y[index_g]-2./3.*h_prime;
+  dy[index_g+1] += pbs->dkappa*y[index_b+1];
+  dy[index_g+2] += 0.1*pbs->dkappa*(y[index_pol]+y[index_pol+2])+4./15.*h_prime;
+
+  bench_hierarchy(pbs->k,pbs->dkappa,pbs->l_size_pol,y+index_pol,dy+index_pol);
+  dy[index_pol] += 0.5*pbs->dkappa*y[index_g+2];
+
+  bench_hierarchy(pbs->k,0.,pbs->l_size_ur,y+index_ur,dy+index_ur);
+  dy[index_ur] -= 2./3.*h_prime;
+  dy[index_ur+2] += 4./15.*h_prime;
+
+  /* massive neutrinos */
+  for (index_q=0; index_q<pbs->q_size_ncdm; index_q++) {
+    index = index_ncdm+index_q*pbs->l_size_ncdm;
+    bench_hierarchy(pbs->k*(0.8+0.05*index_q),0.,pbs->l_size_ncdm,y+index,dy+index);
+    dy[index] -= 0.1*h_prime;
+    dy[index+2] += 0.05*h_prime;
+    dy[index_eta] += 0.01*y[index+1];
+  }
+
+  return _SUCCESS_;
+}
+
+int bench_system_init(struct bench_system * pbs, int q_size_ncdm, ErrorMsg errmsg) {
+  int i, nfe=0;
+  double hinvGak = 10.;
+
+  pbs->l_size_g = 13;
+  pbs->l_size_pol = 11;
+  pbs->l_size_ur = 18;
+  pbs->q_size_ncdm = q_size_ncdm;
+  pbs->l_size_ncdm = 18;
+  pbs->neq = 4+pbs->l_size_g+pbs->l_size_pol+pbs->l_size_ur+pbs->q_size_ncdm*pbs->l_size_ncdm;
+  pbs->k = 0.1;
+  pbs->dkappa = 50.;
+  pbs->aH = 0.01;
+
+  class_call(initialize_jacobian(&(pbs->jac),pbs->neq,errmsg),errmsg,errmsg);
+  class_call(initialize_numjac_workspace(&(pbs->nj_ws),pbs->neq,errmsg),errmsg,errmsg);
+
+  class_alloc(pbs->y,(pbs->neq+1)*sizeof(double),errmsg);
+  class_alloc(pbs->fval,(pbs->neq+1)*sizeof(double),errmsg);
+  class_alloc(pbs->b,pbs->neq*sizeof(double),errmsg);
+  class_alloc(pbs->sol,pbs->neq*sizeof(double),errmsg);
+
+  for (i=1; i<=pbs->neq; i++)
+    pbs->y[i] = 1.e-3*cos(0.7*i)/(1.+0.1*i);
+  for (i=0; i<pbs->neq; i++)
+    pbs->b[i] = sin(1.3*i);
+
+  class_call(bench_system_derivs(0.,pbs->y+1,pbs->fval+1,pbs,errmsg),errmsg,errmsg);
+
+  /* let numjac() trust the sparsity pattern and group columns, as during an integration */
+  for (i=0; i<=pbs->jac.trust_sparse; i++) {
+    class_call(numjac(bench_system_derivs,0.,pbs->y,pbs->fval,&(pbs->jac),&(pbs->nj_ws),1.e-15,pbs->neq,&nfe,pbs,errmsg),
+               errmsg,
+               errmsg);
+  }
+  class_test(pbs->jac.use_sparse == _FALSE_,
+             errmsg,
+             "the model jacobian is not sparse enough");
+
+  /* build the iteration matrix and do a first full decomposition */
+  class_call(new_linearisation(&(pbs->jac),hinvGak,pbs->neq,errmsg),errmsg,errmsg);
+
+  return _SUCCESS_;
+}
+
+int bench_system_free(struct bench_system * pbs) {
+  uninitialize_jacobian(&(pbs->jac));
+  uninitialize_numjac_workspace(&(pbs->nj_ws));
+  free(pbs->y);
+  free(pbs->fval);
+  free(pbs->b);
+  free(pbs->sol);
+  return _SUCCESS_;
+}
+
+int bench_numjac(void * data, long index, ErrorMsg errmsg) {
+  struct bench_system * pbs = data;
+  int nfe=0;
+  class_call(numjac(bench_system_derivs,0.,pbs->y,pbs->fval,&(pbs->jac),&(pbs->nj_ws),1.e-15,pbs->neq,&nfe,pbs,errmsg),
+             errmsg,
+             errmsg);
+  return _SUCCESS_;
+}
+
+int bench_sp_amd(void * data, long index, ErrorMsg errmsg) {
+  struct bench_system * pbs = data;
+  calc_C(&(pbs->jac));
+  sp_amd(pbs->jac.Cp,pbs->jac.Ci,pbs->neq,pbs->jac.cnzmax,pbs->jac.Numerical->q,pbs->jac.Numerical->wamd);
+  return _SUCCESS_;
+}
+
+int bench_sp_ludcmp(void * data, long index, ErrorMsg errmsg) {
+  struct bench_system * pbs = data;
+  class_test(sp_ludcmp(pbs->jac.Numerical,pbs->jac.spJ,1e-3) == _FAILURE_,
+             errmsg,
+             "failure in sp_ludcmp");
+  return _SUCCESS_;
+}
+
+int bench_sp_refactor(void * data, long index, ErrorMsg errmsg) {
+  struct bench_system * pbs = data;
+  sp_refactor(pbs->jac.Numerical,pbs->jac.spJ);
+  return _SUCCESS_;
+}
+
+int bench_sp_lusolve(void * data, long index, ErrorMsg errmsg) {
+  struct bench_system * pbs = data;
+  sp_lusolve(pbs->jac.Numerical,pbs->b,pbs->sol);
+  return _SUCCESS_;
+}
+
+//@}
+
+/** @name - small stiff system integrated by evolver_ndf15() (size of the recombination equations) */
+
+//@{
+
+struct bench_evolver {
+  int neq;
+  double t_final;
+  double rtol;
+  int used_in_output[3];
+  double t_vec[10];  /**< output times */
+  double y[3];
+  long nfe;          /**< number of calls of the derivatives */
+};
+
+/* Robertson's chemical kinetics, the usual three-variable stiff test
+   problem, with rates differing by nine orders of magnitude like the
+   recombination equations integrated by the thermodynamics module */
+int bench_evolver_derivs(double t, double * y, double * dy, void * parameters_and_workspace, ErrorMsg errmsg) {
+  struct bench_evolver * pbe = parameters_and_workspace;
+  pbe->nfe++;
+  dy[0] = -0.04*y[0]+1.e4*y[1]*y[2];
+  dy[2] = 3.e7*y[1]*y[1];
+  dy[1] = -dy[0]-dy[2];
+  return _SUCCESS_;
+}
+
+int bench_evolver_output(double t, double * y, double * dy, int index_t, void * parameters_and_workspace, ErrorMsg errmsg) {
+  return _SUCCESS_;
+}
+
+int bench_evolver(void * data, long index, ErrorMsg errmsg) {
+  struct bench_evolver * pbe = data;
+  pbe->y[0] = 1.;
+  pbe->y[1] = 0.;
+  pbe->y[2] = 0.;
+  class_call(evolver_ndf15(bench_evolver_derivs,0.,pbe->t_final,pbe->y,pbe->used_in_output,pbe->neq,pbe,
+                            pbe->rtol,0.,NULL,0.,pbe->t_vec,10,bench_evolver_output,NULL,errmsg),
+             errmsg,
+             errmsg);
+  return _SUCCESS_;
+}
+
+//@}
+
+int main(int argc, char **argv) {
+
+  struct bench_list bl;
+  char * filename = "kernels.json";
+  char sizes[128];
+  ErrorMsg errmsg;
+
+  struct bench_spline bs;
+  struct bench_spline_columns bsc;
+  struct bench_convolution bc;
+  struct bench_hermite bh;
+  struct bench_quadrature bq;
+  struct bench_system bsys;
+  struct bench_evolver be;
+  HyperInterpStruct HIS;
+
+  int i, j, table, tables_cold, neq_index;
+  long block, blocks_cold;
+  int l, l_size, *lvec;
+  double xmax, x0;
+  int q_size_ncdm[2] = {0, 5};
+
+  const char * hermite_names[4] = {"hyperspherical_Hermite3_Phi", "hyperspherical_Hermite4_Phi",
+                                   "hyperspherical_Hermite6_Phi", "hyperspherical_asymptotic_Phi"};
+  int (*hermite_Phi[4])(HyperInterpStruct *,int,int,double *,double *,ErrorMsg) = {
+    hyperspherical_Hermite3_interpolation_vector_Phi,
+    hyperspherical_Hermite4_interpolation_vector_Phi,
+    hyperspherical_Hermite6_interpolation_vector_Phi,
+    hyperspherical_asymptotic_vector_Phi};
+
+  if (argc > 1)
+    filename = argv[1];
+  bl.size = 0;
+  bl.filter = (argc > 2) ? argv[2] : NULL;
+
+  printf("%-36s %-5s %-28s %18s %17s %13s\n","kernel","","sizes","time","throughput","bandwidth");
+
+  /** - array_interpolate_spline() */
+
+  bs.n_lines = 47;
+  bs.n_columns = 569;
+  tables_cold = MAX(1,_BENCH_COLD_BYTES_/(2*bs.n_lines*bs.n_columns*sizeof(double)));
+  class_alloc(bs.x,bs.n_lines*sizeof(double),errmsg);
+  class_alloc(bs.y,(size_t)tables_cold*bs.n_lines*bs.n_columns*sizeof(double),errmsg);
+  class_alloc(bs.ddy,(size_t)tables_cold*bs.n_lines*bs.n_columns*sizeof(double),errmsg);
+  class_alloc(bs.result,bs.n_columns*sizeof(double),errmsg);
+  for (i=0; i<bs.n_lines; i++)
+    bs.x[i] = log(9000.)+log(14000./9000.)*i/(bs.n_lines-1.);
+  for (table=0; table<tables_cold; table++) {
+    for (i=0; i<bs.n_lines; i++)
+      for (j=0; j<bs.n_columns; j++)
+        bs.y[((size_t)table*bs.n_lines+i)*bs.n_columns+j] = cos(0.01*j*exp(bs.x[i]-bs.x[0]))/(1.+0.01*j);
+    if (array_spline_table_lines(bs.x,bs.n_lines,bs.y+(size_t)table*bs.n_lines*bs.n_columns,bs.n_columns,
+                                 bs.ddy+(size_t)table*bs.n_lines*bs.n_columns,_SPLINE_EST_DERIV_,errmsg) == _FAILURE_) {
+      printf("\n\nError in array_spline_table_lines \n=>%s\n",errmsg);
+      return _FAILURE_;
+    }
+  }
+  sprintf(sizes,"n_lines=%d n_columns=%d",bs.n_lines,bs.n_columns);
+  bs.tables = 1;
+  if (bench_run(&bl,"array_interpolate_spline","hot",sizes,bs.n_columns,4.*bs.n_columns*sizeof(double),
+                bench_interpolate_spline,&bs,errmsg) == _FAILURE_) {
+    printf("\n\nError in array_interpolate_spline \n=>%s\n",errmsg);
+    return _FAILURE_;
+  }
+  bs.tables = tables_cold;
+  if (bench_run(&bl,"array_interpolate_spline","cold",sizes,bs.n_columns,4.*bs.n_columns*sizeof(double),
+                bench_interpolate_spline,&bs,errmsg) == _FAILURE_) {
+    printf("\n\nError in array_interpolate_spline \n=>%s\n",errmsg);
+    return _FAILURE_;
+  }
+  free(bs.x);
+  free(bs.y);
+  free(bs.ddy);
+  free(bs.result);
+
+  /** - array_spline_table_columns() and array_spline_table_columns2() */
+
+  bsc.x_size = 642;
+  bsc.y_size = 596;
+  tables_cold = MAX(1,_BENCH_COLD_BYTES_/(2*bsc.x_size*bsc.y_size*sizeof(double)));
+  class_alloc(bsc.x,bsc.x_size*sizeof(double),errmsg);
+  class_alloc(bsc.y,(size_t)tables_cold*bsc.x_size*bsc.y_size*sizeof(double),errmsg);
+  class_alloc(bsc.ddy,(size_t)tables_cold*bsc.x_size*bsc.y_size*sizeof(double),errmsg);
+  for (i=0; i<bsc.x_size; i++)
+    bsc.x[i] = 1.e-5*pow(1.e5,(double)i/(bsc.x_size-1.));
+  for (j=0; j<(size_t)tables_cold*bsc.y_size; j++)
+    for (i=0; i<bsc.x_size; i++)
+      bsc.y[(size_t)j*bsc.x_size+i] = sin(bsc.x[i]*(1000.+(j%bsc.y_size)))/(1.+bsc.x[i]);
+  sprintf(sizes,"x_size=%d y_size=%d",bsc.x_size,bsc.y_size);
+  for (i=0; i<2; i++) {
+    bsc.version2 = i;
+    bsc.tables = 1;
+    if (bench_run(&bl,(i==0) ? "array_spline_table_columns" : "array_spline_table_columns2","hot",sizes,
+                  (double)bsc.x_size*bsc.y_size,2.*bsc.x_size*bsc.y_size*sizeof(double),
+                  bench_spline_table_columns,&bsc,errmsg) == _FAILURE_) {
+      printf("\n\nError in array_spline_table_columns \n=>%s\n",errmsg);
+      return _FAILURE_;
+    }
+    bsc.tables = tables_cold;
+    if (bench_run(&bl,(i==0) ? "array_spline_table_columns" : "array_spline_table_columns2","cold",sizes,
+                  (double)bsc.x_size*bsc.y_size,2.*bsc.x_size*bsc.y_size*sizeof(double),
+                  bench_spline_table_columns,&bsc,errmsg) == _FAILURE_) {
+      printf("\n\nError in array_spline_table_columns \n=>%s\n",errmsg);
+      return _FAILURE_;
+    }
+  }
+  free(bsc.x);
+  free(bsc.y);
+  free(bsc.ddy);
+
+  /** - array_trapezoidal_convolution() */
+
+  bc.n = 437;
+  blocks_cold = MAX(1,_BENCH_COLD_BYTES_/(2*bc.n*sizeof(double)));
+  class_alloc(bc.sources,(size_t)blocks_cold*bc.n*sizeof(double),errmsg);
+  class_alloc(bc.radial,(size_t)blocks_cold*bc.n*sizeof(double),errmsg);
+  class_alloc(bc.w_trapz,bc.n*sizeof(double),errmsg);
+  for (block=0; block<blocks_cold; block++) {
+    for (i=0; i<bc.n; i++) {
+      bc.sources[block*bc.n+i] = exp(-0.01*i)*(1.+0.001*(block%97));
+      bc.radial[block*bc.n+i] = sin(0.1*i+0.01*(block%89));
+    }
+  }
+  for (i=0; i<bc.n; i++)
+    bc.w_trapz[i] = (i==0 || i==bc.n-1) ? 0.5 : 1.;
+  sprintf(sizes,"n=%d",bc.n);
+  bc.blocks = 1;
+  if (bench_run(&bl,"array_trapezoidal_convolution","hot",sizes,bc.n,3.*bc.n*sizeof(double),
+                bench_trapezoidal_convolution,&bc,errmsg) == _FAILURE_) {
+    printf("\n\nError in array_trapezoidal_convolution \n=>%s\n",errmsg);
+    return _FAILURE_;
+  }
+  bc.blocks = blocks_cold;
+  if (bench_run(&bl,"array_trapezoidal_convolution","cold",sizes,bc.n,3.*bc.n*sizeof(double),
+                bench_trapezoidal_convolution,&bc,errmsg) == _FAILURE_) {
+    printf("\n\nError in array_trapezoidal_convolution \n=>%s\n",errmsg);
+    return _FAILURE_;
+  }
+  free(bc.sources);
+  free(bc.radial);
+  free(bc.w_trapz);
+
+  /** - hyperspherical_Hermite*_interpolation_vector_*(), on the flat
+      Bessel table of the transfer module (list of multipoles with
+      the default l_logstep=1.12 and l_linstep=40) */
+
+  class_alloc(lvec,200*sizeof(int),errmsg);
+  l_size = 0;
+  l = 2;
+  while (l <= 3500) {
+    lvec[l_size++] = l;
+    l += MAX(1,MIN((int)(l*0.12),40));
+  }
+  xmax = 10731*_TWOPI_/8.;
+  if (hyperspherical_HIS_create(0,1.,l_size,lvec,1.e-5,xmax,8.,lvec[l_size-1]+1,1.e-10,&HIS,errmsg) == _FAILURE_) {
+    printf("\n\nError in hyperspherical_HIS_create \n=>%s\n",errmsg);
+    return _FAILURE_;
+  }
+
+  bh.pHIS = &HIS;
+  bh.nxi = 437;
+  class_alloc(bh.x,(size_t)l_size*bh.nxi*sizeof(double),errmsg);
+  class_alloc(bh.Phi,bh.nxi*sizeof(double),errmsg);
+  class_alloc(bh.dPhi,bh.nxi*sizeof(double),errmsg);
+  class_alloc(bh.d2Phi,bh.nxi*sizeof(double),errmsg);
+  for (i=0; i<l_size; i++) {
+    x0 = MAX(HIS.chi_at_phimin[i],HIS.x[0]);
+    for (j=0; j<bh.nxi; j++)
+      bh.x[(size_t)i*bh.nxi+j] = x0+(0.999*HIS.x[HIS.x_size-1]-x0)*j/(bh.nxi-1.);
+  }
+  sprintf(sizes,"x_size=%d l_size=%d nxi=%d",HIS.x_size,l_size,bh.nxi);
+
+  bh.interpolate_PhidPhid2Phi = NULL;
+  for (i=0; i<4; i++) {
+    bh.interpolate_Phi = hermite_Phi[i];
+    bh.index_l = l_size/2;
+    if (bench_run(&bl,hermite_names[i],"hot",sizes,bh.nxi,0.,bench_hermite,&bh,errmsg) == _FAILURE_) {
+      printf("\n\nError in %s \n=>%s\n",hermite_names[i],errmsg);
+      return _FAILURE_;
+    }
+    bh.index_l = -1;
+    if (bench_run(&bl,hermite_names[i],"cold",sizes,bh.nxi,0.,bench_hermite,&bh,errmsg) == _FAILURE_) {
+      printf("\n\nError in %s \n=>%s\n",hermite_names[i],errmsg);
+      return _FAILURE_;
+    }
+  }
+  bh.interpolate_Phi = NULL;
+  bh.interpolate_PhidPhid2Phi = hyperspherical_Hermite6_interpolation_vector_PhidPhid2Phi;
+  bh.index_l = l_size/2;
+  if (bench_run(&bl,"hyperspherical_Hermite6_PhidPhid2Phi","hot",sizes,3*bh.nxi,0.,bench_hermite,&bh,errmsg) == _FAILURE_) {
+    printf("\n\nError in hyperspherical_Hermite6_PhidPhid2Phi \n=>%s\n",errmsg);
+    return _FAILURE_;
+  }
+  bh.index_l = -1;
+  if (bench_run(&bl,"hyperspherical_Hermite6_PhidPhid2Phi","cold",sizes,3*bh.nxi,0.,bench_hermite,&bh,errmsg) == _FAILURE_) {
+    printf("\n\nError in hyperspherical_Hermite6_PhidPhid2Phi \n=>%s\n",errmsg);
+    return _FAILURE_;
+  }
+  free(bh.x);
+  free(bh.Phi);
+  free(bh.dPhi);
+  free(bh.d2Phi);
+  free(lvec);
+  hyperspherical_HIS_free(&HIS,errmsg);
+
+  /** - quadrature_gauss_legendre() (lensing with l_unlensed_max=3500) */
+
+  bq.n = 3500+70-1;
+  class_alloc(bq.mu,bq.n*sizeof(double),errmsg);
+  class_alloc(bq.w8,bq.n*sizeof(double),errmsg);
+  sprintf(sizes,"n=%d",bq.n);
+  if (bench_run(&bl,"quadrature_gauss_legendre","hot",sizes,bq.n,0.,bench_gauss_legendre,&bq,errmsg) == _FAILURE_) {
+    printf("\n\nError in quadrature_gauss_legendre \n=>%s\n",errmsg);
+    return _FAILURE_;
+  }
+  free(bq.mu);
+  free(bq.w8);
+
+  /** - numjac() and sparse LU decomposition, for a massless and a massive neutrino model */
+
+  for (neq_index=0; neq_index<2; neq_index++) {
+
+    if (bench_system_init(&bsys,q_size_ncdm[neq_index],errmsg) == _FAILURE_) {
+      printf("\n\nError in bench_system_init \n=>%s\n",errmsg);
+      return _FAILURE_;
+    }
+    sprintf(sizes,"neq=%d nnz=%d",bsys.neq,bsys.jac.spJ->Ap[bsys.neq]);
+
+    if ((bench_run(&bl,"numjac","hot",sizes,bsys.jac.spJ->Ap[bsys.neq],0.,bench_numjac,&bsys,errmsg) == _FAILURE_) ||
+        (bench_run(&bl,"sp_amd","hot",sizes,bsys.neq,0.,bench_sp_amd,&bsys,errmsg) == _FAILURE_) ||
+        (bench_run(&bl,"sp_ludcmp","hot",sizes,bsys.jac.spJ->Ap[bsys.neq],0.,bench_sp_ludcmp,&bsys,errmsg) == _FAILURE_) ||
+        (bench_run(&bl,"sp_refactor","hot",sizes,bsys.jac.spJ->Ap[bsys.neq],0.,bench_sp_refactor,&bsys,errmsg) == _FAILURE_) ||
+        (bench_run(&bl,"sp_lusolve","hot",sizes,bsys.neq,0.,bench_sp_lusolve,&bsys,errmsg) == _FAILURE_)) {
+      printf("\n\nError in sparse kernels \n=>%s\n",errmsg);
+      return _FAILURE_;
+    }
+
+    bench_system_free(&bsys);
+  }
+
+  /** - evolver_ndf15() on a small stiff system, with the tolerance
+      of the thermodynamics module (the number of calls of the
+      derivatives per integration is given in the sizes) */
+
+  be.neq = 3;
+  be.t_final = 4.e3;
+  be.rtol = 1.e-6;
+  for (i=0; i<be.neq; i++)
+    be.used_in_output[i] = _TRUE_;
+  for (i=0; i<10; i++)
+    be.t_vec[i] = be.t_final*pow(10.,i-9.);
+  be.nfe = 0;
+  if (bench_evolver(&be,0,errmsg) == _FAILURE_) {
+    printf("\n\nError in evolver_ndf15 \n=>%s\n",errmsg);
+    return _FAILURE_;
+  }
+  sprintf(sizes,"neq=%d nfe=%ld",be.neq,be.nfe);
+  if (bench_run(&bl,"evolver_ndf15","hot",sizes,1.,0.,bench_evolver,&be,errmsg) == _FAILURE_) {
+    printf("\n\nError in evolver_ndf15 \n=>%s\n",errmsg);
+    return _FAILURE_;
+  }
+
+  /** - write results */
+
+  if (bench_write_json(&bl,filename,errmsg) == _FAILURE_) {
+    printf("\n\nError in bench_write_json \n=>%s\n",errmsg);
+    return _FAILURE_;
+  }
+  printf("Results written in %s\n",filename);
+
+  return _SUCCESS_;
+}
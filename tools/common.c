@@ -1,5 +1,9 @@
 #include "common.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
 void class_protect_sprintf(char* dest, char* tpl,...) {
   va_list args;
   va_start(args,tpl);
@@ -114,3 +118,125 @@ int class_version(
   sprintf(version,"%s",_VERSION_);
   return _SUCCESS_;
 }
+
+/**
+ * Get the resident and peak memory of the current process
+ *
+ * On Linux both are read from /proc/self/status (VmRSS and VmHWM);
+ * elsewhere, only the peak is available through getrusage(). Values
+ * which cannot be determined are set to -1.
+ *
+ * @param resident  Output: resident memory in MB
+ * @param peak      Output: peak resident memory in MB
+ * @return the error status
+ */
+
+int class_memory_usage(
+                       double * resident,
+                       double * peak
+                       ) {
+
+  FILE * status;
+  char line[_FILENAMESIZE_];
+  double value;
+
+  *resident = -1.;
+  *peak = -1.;
+
+  status = fopen("/proc/self/status","r");
+  if (status != NULL) {
+    while (fgets(line,_FILENAMESIZE_,status) != NULL) {
+      if (sscanf(line,"VmRSS: %lf",&value) == 1)
+        *resident = value/1024.;
+      if (sscanf(line,"VmHWM: %lf",&value) == 1)
+        *peak = value/1024.;
+    }
+    fclose(status);
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  if (*peak < 0.) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF,&usage) == 0) {
+#ifdef __APPLE__
+      *peak = usage.ru_maxrss/1024./1024.; /* bytes */
+#else
+      *peak = usage.ru_maxrss/1024.; /* kilobytes */
+#endif
+    }
+  }
+#endif
+
+  return _SUCCESS_;
+}
+
+/**
+ * Choose the number of threads of a parallel region from an estimate
+ * of its work
+ *
+ * The duration of a region with n threads is modelled as W/n +
+ * thread_overhead*n, where W = items*cost_per_item is the total work
+ * in seconds on one thread. This is minimal for n = sqrt(W/thread_overhead).
+ * The result is then bounded by the number of independent items and
+ * by the number of available threads.
+ *
+ * @param items             Input: number of independent iterations of the parallel loop
+ * @param cost_per_item     Input: calibrated cost of one iteration, in seconds
+ * @param thread_overhead   Input: cost of each thread, in seconds (if zero or negative, all available threads are used)
+ * @param threads_requested Input: number of threads set by the user for this stage (automatic choice if zero or negative)
+ * @return the number of threads (always one without openmp)
+ */
+
+int class_number_of_threads(
+                            double items,
+                            double cost_per_item,
+                            double thread_overhead,
+                            int threads_requested
+                            ) {
+
+  int number_of_threads=1;
+  double optimal_threads;
+
+#ifdef _OPENMP
+  number_of_threads = omp_get_max_threads();
+
+  if (threads_requested > 0)
+    return threads_requested;
+
+  if (thread_overhead > 0.) {
+    optimal_threads = MIN(sqrt(MAX(items,0.)*cost_per_item/thread_overhead),items);
+    if (optimal_threads < number_of_threads)
+      number_of_threads = MAX((int)optimal_threads,1);
+  }
+#endif
+
+  return number_of_threads;
+}
+
+/**
+ * Compare all precision parameters of two precision structures (the
+ * list is the one of precisions.h, so that new parameters are always
+ * included).
+ *
+ * @param ppr1 Input: pointer to first precision structure
+ * @param ppr2 Input: pointer to second precision structure
+ * @return _TRUE_ if all parameters are equal, _FALSE_ otherwise
+ */
+
+int class_precision_equal(
+                          struct precision * ppr1,
+                          struct precision * ppr2
+                          ) {
+
+  int equal = _TRUE_;
+
+#define class_precision_parameter(NAME,TYPE,DEF_VALUE)  \
+  if (ppr1->NAME != ppr2->NAME) equal = _FALSE_;
+#define class_string_parameter(NAME,DIR,STRING)         \
+  if (strcmp(ppr1->NAME,ppr2->NAME) != 0) equal = _FALSE_;
+#define class_type_parameter(NAME,READ_TP,REAL_TP,DEF_VAL)  \
+  if (ppr1->NAME != ppr2->NAME) equal = _FALSE_;
+#include "precisions.h"
+
+  return equal;
+}
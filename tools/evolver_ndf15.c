@@ -83,6 +83,58 @@ int evolver_ndf15(
                      ErrorMsg error_message),
           ErrorMsg error_message){
 
+  return evolver_ndf15_with_experience(derivs,
+                                       x_ini,
+                                       x_final,
+                                       y_inout,
+                                       used_in_output,
+                                       neq,
+                                       parameters_and_workspace_for_derivs,
+                                       rtol,
+                                       minimum_variation,
+                                       timescale_and_approximation,
+                                       timestep_over_timescale,
+                                       t_vec,
+                                       tres,
+                                       output,
+                                       print_variables,
+                                       NULL,
+                                       error_message);
+}
+
+/* Same as evolver_ndf15, but with an optional array jacvec_inout[0..neq-1]
+   holding the relative increments used by numjac for each column of the
+   Jacobian ("experience gained in previous calls"). Entries set to zero
+   are initialized to the default value sqrt(eps). On output, the array
+   contains the increments reached at the end of the integration, so that
+   they can be passed to the next call (possibly after remapping the
+   variables, e.g. when the perturbation module switches approximation). */
+
+int evolver_ndf15_with_experience(
+          int (*derivs)(double x,double * y,double * dy,
+                void * parameters_and_workspace, ErrorMsg error_message),
+          double x_ini,
+          double x_final,
+          double * y_inout,
+          int * used_in_output,
+          int neq,
+          void * parameters_and_workspace_for_derivs,
+          double rtol,
+          double minimum_variation,
+          int (*timescale_and_approximation)(double x,
+                             void * parameters_and_workspace,
+                             double * timescales,
+                             ErrorMsg error_message),
+          double timestep_over_timescale,
+          double * t_vec,
+          int tres,
+          int (*output)(double x,double y[],double dy[],int index_x,void * parameters_and_workspace,
+                ErrorMsg error_message),
+          int (*print_variables)(double x, double y[], double dy[], void *parameters_and_workspace,
+                     ErrorMsg error_message),
+          double * jacvec_inout,
+          ErrorMsg error_message){
+
   /* Constants: */
   double G[5]={1.0,3.0/2.0,11.0/6.0,25.0/12.0,137.0/60.0};
   double alpha[5]={-37.0/200,-1.0/9.0,-8.23e-2,-4.15e-2, 0};
@@ -186,6 +238,13 @@ int evolver_ndf15(
   /*Initialize the jacobian:*/
   class_call(initialize_jacobian(&jac,neq,error_message),error_message,error_message);
 
+  /* Start from previous experience on the increments, if any: */
+  if (jacvec_inout != NULL){
+    for(ii=1;ii<=neq;ii++){
+      if (jacvec_inout[ii-1] > 0.) jac.jacvec[ii] = jacvec_inout[ii-1];
+    }
+  }
+
   /* Initialize workspace for numjac: */
   class_call(initialize_numjac_workspace(&nj_ws,neq,error_message),error_message,error_message);
 
@@ -678,6 +737,11 @@ int evolver_ndf15(
        stepstat[2],stepstat[3],stepstat[4],stepstat[5]);
   }
 
+  /* Return experience on the increments for the next call: */
+  if (jacvec_inout != NULL){
+    for(ii=1;ii<=neq;ii++) jacvec_inout[ii-1] = jac.jacvec[ii];
+  }
+
   /** Deallocate memory */
 
   free(buffer);
@@ -1078,21 +1142,35 @@ int fzero_Newton(int (*func)(double *x,
                  double tolx,
                  double tolF,
                  void *param,
+                 double *jacobian,
+                 int *has_jacobian,
                  int *fevals,
                  ErrorMsg error_message){
   /**Given an initial guess x[1..n] for a root in n dimensions,
-     take ntrial Newton-Raphson steps to improve the root.
+     take ntrial quasi-Newton steps to improve the root.
      Stop if the root converges in either summed absolute
-     variable increments tolx or summed absolute function values tolf.*/
+     variable increments tolx or summed absolute function values tolf.
+
+     The jacobian jacobian[i*n+j] = dF_i/dx_j is computed by finite
+     differences (n calls of func) only when needed: at the first
+     step if *has_jacobian is _FALSE_ (otherwise the jacobian passed
+     in input is used), and whenever a step did not decrease the
+     summed absolute function values. After the other steps, it gets
+     Broyden's rank one update, which costs no call of func. On
+     output, jacobian contains the last estimate and *has_jacobian is
+     _TRUE_.*/
   int k,i,j,*indx, ntrial=20;
-  double errx,errf,d,*F0,*Fdel,**Fjac,*p, *lu_work;
+  double errx,errf,errf_old=0.,d,*F0,*Fold,*Fdel,**Fjac,*p, *lu_work, ss;
   int has_converged = _FALSE_;
+  int needs_jacobian, fresh_jacobian;
   int funcreturn;
   double toljac = 1e-3;
   double *delx;
 
   /** All arrays are indexed as [0, n-1] with the exception of p, indx,
-      lu_work and Fjac, since they are passed to ludcmp and lubksb. */
+      lu_work and Fjac, since they are passed to ludcmp and lubksb. The
+      jacobian is kept apart from Fjac, which is overwritten by its LU
+      decomposition. */
   class_alloc(indx, sizeof(int)*(x_size+1), error_message);
   class_alloc(p, sizeof(double)*(x_size+1), error_message);
   class_alloc(lu_work, sizeof(double)*(x_size+1), error_message);
@@ -1104,6 +1182,7 @@ int fzero_Newton(int (*func)(double *x,
   }
 
   class_alloc(F0, sizeof(double)*x_size, error_message);
+  class_alloc(Fold, sizeof(double)*x_size, error_message);
   class_alloc(delx, sizeof(double)*x_size, error_message);
   class_alloc(Fdel, sizeof(double)*x_size, error_message);
 
@@ -1111,52 +1190,76 @@ int fzero_Newton(int (*func)(double *x,
     delx[i-1] = toljac*dxdF[i-1];
   }
 
+  needs_jacobian = !(*has_jacobian);
+
   for (k=1;k<=ntrial;k++) {
     /** Compute F(x): */
-    /**printf("x = [%f, %f], delx = [%e, %e]\n",
-       x_inout[0],x_inout[1],delx[0],delx[1]);*/
     class_call(func(x_inout, x_size, param, F0, error_message),
                error_message, error_message);
-    /**    printf("F0 = [%f, %f]\n",F0[0],F0[1]);*/
     *fevals = *fevals + 1;
     errf=0.0; //fvec and Jacobian matrix in fjac.
     for (i=1; i<=x_size; i++)
       errf += fabs(F0[i-1]); //Check function convergence.
+
+    /** Update the jacobian with the last step p and the change of F
+        (Broyden), or ask for a new one if the step did not help: */
+    if (k > 1) {
+      if (errf >= errf_old) {
+        needs_jacobian = _TRUE_;
+      }
+      else {
+        ss = 0.0;
+        for (j=1; j<=x_size; j++)
+          ss += p[j]*p[j];
+        for (i=1; i<=x_size; i++){
+          Fdel[i-1] = F0[i-1]-Fold[i-1];
+          for (j=1; j<=x_size; j++)
+            Fdel[i-1] -= jacobian[(i-1)*x_size+j-1]*p[j];
+          for (j=1; j<=x_size; j++)
+            jacobian[(i-1)*x_size+j-1] += Fdel[i-1]*p[j]/ss;
+        }
+      }
+    }
+
     if (errf <= tolF){
       has_converged = _TRUE_;
       break;
     }
 
-    /**
-    if (k==1){
-      for (i=1; i<=x_size; i++){
-        delx[i-1] *= F0[i-1];
+    fresh_jacobian = _FALSE_;
+    for ( ; ; ) {
+      if (needs_jacobian == _TRUE_) {
+        /** Compute the jacobian of F: */
+        for (i=1; i<=x_size; i++){
+          if (F0[i-1]<0.0)
+            delx[i-1] *= -1;
+          x_inout[i-1] += delx[i-1];
+          class_call(func(x_inout, x_size, param, Fdel, error_message),
+                     error_message, error_message);
+          for (j=1; j<=x_size; j++)
+            jacobian[(j-1)*x_size+i-1] = (Fdel[j-1]-F0[j-1])/delx[i-1];
+          x_inout[i-1] -= delx[i-1];
+        }
+        *fevals = *fevals + x_size;
+        needs_jacobian = _FALSE_;
+        fresh_jacobian = _TRUE_;
+        *has_jacobian = _TRUE_;
       }
+
+      for (i=1; i<=x_size; i++)
+        for (j=1; j<=x_size; j++)
+          Fjac[i][j] = jacobian[(i-1)*x_size+j-1];
+      funcreturn = ludcmp(Fjac, x_size, indx, &d, lu_work); //Solve linear equations using LU decomposition.
+      if (funcreturn == _SUCCESS_)
+        break;
+      /* a singular updated or reused jacobian is replaced, a singular new one is an error */
+      class_test(fresh_jacobian == _TRUE_,error_message,
+                 "Failure in ludcmp. Possibly singular matrix!");
+      needs_jacobian = _TRUE_;
     }
-    */
-
-    /** Compute the jacobian of F: */
-    for (i=1; i<=x_size; i++){
-      if (F0[i-1]<0.0)
-        delx[i-1] *= -1;
-      x_inout[i-1] += delx[i-1];
-
-      /**      printf("x = [%f, %f], delx = [%e, %e]\n",
-               x_inout[0],x_inout[1],delx[0],delx[1]);*/
-      class_call(func(x_inout, x_size, param, Fdel, error_message),
-                 error_message, error_message);
-      /**      printf("F = [%f, %f]\n",Fdel[0],Fdel[1]);*/
-      for (j=1; j<=x_size; j++)
-        Fjac[j][i] = (Fdel[j-1]-F0[j-1])/delx[i-1];
-      x_inout[i-1] -= delx[i-1];
-    }
-    *fevals = *fevals + x_size;
 
     for (i=1; i<=x_size; i++)
       p[i] = -F0[i-1]; //Right-hand side of linear equations.
-    funcreturn = ludcmp(Fjac, x_size, indx, &d, lu_work); //Solve linear equations using LU decomposition.
-    class_test(funcreturn == _FAILURE_,error_message,
-               "Failure in ludcmp. Possibly singular matrix!");
     funcreturn = lubksb(Fjac, x_size, indx, p);
     class_test(funcreturn == _FAILURE_,error_message,
                "Failure in lubksb. Possibly singular matrix!");
@@ -1169,6 +1272,9 @@ int fzero_Newton(int (*func)(double *x,
       has_converged = _TRUE_;
       break;
     }
+    for (i=1; i<=x_size; i++)
+      Fold[i-1] = F0[i-1];
+    errf_old = errf;
   }
 
   free(p);
@@ -1177,6 +1283,7 @@ int fzero_Newton(int (*func)(double *x,
   free(Fjac[1]);
   free(Fjac);
   free(F0);
+  free(Fold);
   free(delx);
   free(Fdel);
 
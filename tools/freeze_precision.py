@@ -0,0 +1,82 @@
+"""
+Generate build/precision_profile.h, the header of compile-time
+constants used when CLASS is compiled with a frozen precision profile
+("make PRECISION_PROFILE=file.pre").
+
+The loop bounds listed in FROZEN are read from the precision file,
+with the defaults of include/precisions.h for those it does not set,
+and written as _PROFILE_<NAME>_ macros. Without argument, an empty
+profile is written. (The generic build, without PRECISION_PROFILE,
+does not call this script: the Makefile then keeps an empty header.)
+
+The header is only rewritten when its content changes, so that make
+recompiles the code only when the profile itself changes.
+
+usage: python freeze_precision.py [file.pre] output.h
+"""
+import os
+import re
+import sys
+
+# precision parameters that are loop bounds of the hot loops
+FROZEN = ['l_max_g', 'l_max_pol_g', 'l_max_ur', 'l_max_ncdm']
+
+
+def read_defaults(precisions_h):
+    defaults = {}
+    pattern = re.compile(r'class_precision_parameter\(\s*(\w+)\s*,\s*\w+\s*,\s*([^)]+)\)')
+    with open(precisions_h) as f:
+        for line in f:
+            match = pattern.match(line.strip())
+            if match:
+                defaults[match.group(1)] = match.group(2).strip()
+    return defaults
+
+
+def read_precision_file(pre):
+    values = {}
+    with open(pre) as f:
+        for line in f:
+            line = line.split('#')[0].strip()
+            if '=' not in line:
+                continue
+            name, value = [s.strip() for s in line.split('=', 1)]
+            values[name] = value
+    return values
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        sys.exit(__doc__)
+    output = argv[-1]
+    here = os.path.dirname(os.path.abspath(__file__))
+
+    lines = ['/* generated by tools/freeze_precision.py, do not edit */',
+             '',
+             '#ifndef __PRECISION_PROFILE__',
+             '#define __PRECISION_PROFILE__',
+             '']
+
+    if len(argv) == 3:
+        pre = argv[1]
+        defaults = read_defaults(os.path.join(here, '..', 'include', 'precisions.h'))
+        values = read_precision_file(pre)
+        lines.append('#define _PROFILE_NAME_ "%s"' % os.path.basename(pre))
+        for name in FROZEN:
+            value = values.get(name, defaults[name])
+            lines.append('#define _PROFILE_%s_ %d' % (name.upper(), int(float(value))))
+        lines.append('')
+
+    lines.append('#endif')
+    content = '\n'.join(lines) + '\n'
+
+    if os.path.exists(output):
+        with open(output) as f:
+            if f.read() == content:
+                return
+    with open(output, 'w') as f:
+        f.write(content)
+
+
+if __name__ == '__main__':
+    main(sys.argv)
@@ -30,6 +30,7 @@ int hyperspherical_HIS_create(int K,
   int j, k, l, nx, lmax, l_recurrence_max;
   int abort;
   int current_chunk, index_x;
+  int number_of_threads;
 
   beta2 = beta*beta;
   lmax = lvec[nl-1];
@@ -52,8 +53,6 @@ int hyperspherical_HIS_create(int K,
   class_alloc(pHIS->x,sizeof(double)*nx,error_message);
   class_alloc(pHIS->sinK,sizeof(double)*nx,error_message);
   class_alloc(pHIS->cotK,sizeof(double)*nx,error_message);
-  class_alloc(pHIS->phi,sizeof(double)*nx*nl,error_message);
-  class_alloc(pHIS->dphi,sizeof(double)*nx*nl,error_message);
 
   //Order needed for trig interpolation: (We are using Taylor's remainder theorem)
   if (0.5*deltax*deltax < _TRIG_PRECISSION_)
@@ -84,6 +83,11 @@ int hyperspherical_HIS_create(int K,
     }
   }
 
+  //Only the l values below l_WKB are tabulated:
+  pHIS->l_size_table = MAX(index_recurrence_max+1,0);
+  class_alloc(pHIS->phi,sizeof(double)*nx*MAX(pHIS->l_size_table,1),error_message);
+  class_alloc(pHIS->dphi,sizeof(double)*nx*MAX(pHIS->l_size_table,1),error_message);
+
   //Create xvector and set x, cotK, sinK, sqrtK and fwdidx:
   switch (K){
   case 0:
@@ -130,14 +134,24 @@ int hyperspherical_HIS_create(int K,
   }
 
   int xfwdidx = (xfwd-xmin)/deltax;
+  //Nothing to compute by recurrence if no l is tabulated:
+  int nx_recurrence = nx;
+  if (pHIS->l_size_table == 0){
+    nx_recurrence = 0;
+    xfwdidx = 0;
+  }
   //Calculate and assign Phi and dPhi values:
 
+  /* number of threads adapted to the amount of work (few threads for short lists of multipoles or small tables) */
+  number_of_threads = class_number_of_threads(nx,(MAX(MIN(l_recurrence_max,lmax),0)+1.)*_HYPER_COST_,_THREAD_OVERHEAD_,0);
+
   abort = _FALSE_;
 
 #pragma omp parallel                                                    \
-  shared(nx,pHIS,xfwd,K,l_recurrence_max,beta,sqrtK,one_over_sqrtK,lvec,nl,xfwdidx,abort,error_message) \
+  shared(nx,nx_recurrence,pHIS,xfwd,K,l_recurrence_max,beta,sqrtK,one_over_sqrtK,lvec,nl,xfwdidx,abort,error_message) \
   private(j,PhiL,k,l,current_chunk,index_x)                           \
-  firstprivate(lmax)
+  firstprivate(lmax)                                                    \
+  num_threads(number_of_threads)
   {
     class_alloc_parallel(PhiL,(lmax+2)*sizeof(double)*_HYPER_CHUNK_,error_message);
 
@@ -155,7 +169,7 @@ int hyperspherical_HIS_create(int K,
 #pragma omp for schedule (dynamic)              \
 
 
-    for (j=0; j<MIN(nx,xfwdidx); j++){
+    for (j=0; j<MIN(nx_recurrence,xfwdidx); j++){
       //Use backwards method:
       hyperspherical_backwards_recurrence(K,
                                           MIN(l_recurrence_max,lmax)+1,
@@ -203,9 +217,9 @@ int hyperspherical_HIS_create(int K,
 
 #pragma omp for schedule (dynamic)              \
 
-    for (j=xfwdidx; j<nx; j+=_HYPER_CHUNK_){
+    for (j=xfwdidx; j<nx_recurrence; j+=_HYPER_CHUNK_){
       //Use forwards method:
-      current_chunk = MIN(_HYPER_CHUNK_,nx-j);
+      current_chunk = MIN(_HYPER_CHUNK_,nx_recurrence-j);
       hyperspherical_forwards_recurrence_chunk(K,
                                                MIN(l_recurrence_max,lmax)+1,
                                                beta,
@@ -255,13 +269,14 @@ int hyperspherical_update_pointers(HyperInterpStruct *pHIS_local,
       pointer points to. */
   int nx=pHIS_local->x_size;
   int nl=pHIS_local->l_size;
+  int nl_table=pHIS_local->l_size_table;
   pHIS_local->l = (int *) (HIS_storage_shared);
   pHIS_local->chi_at_phimin = (double *) (pHIS_local->l+nl);
   pHIS_local->x = pHIS_local->chi_at_phimin+nl;
   pHIS_local->sinK = pHIS_local->x + nx;
   pHIS_local->cotK = pHIS_local->sinK + nx;
   pHIS_local->phi = pHIS_local->cotK +nx;
-  pHIS_local->dphi = pHIS_local->phi+nx*nl;
+  pHIS_local->dphi = pHIS_local->phi+nx*nl_table;
 
   return _SUCCESS_;
 }
@@ -820,6 +835,137 @@ int CF1_from_Gegenbauer(int l,
   return _SUCCESS_;
 }
 
+/**
+ * Flat case: evaluate \f$ \Phi_l(x) = j_l(\beta x) \f$ directly from
+ * the uniform asymptotic (Airy) expansion of \f$ J_{l+1/2} \f$ at
+ * leading order, without any table. The relative error scales like
+ * 1/l, so this is meant for very high multipoles, where tabulating
+ * the Bessel functions over the whole x range would cost too much
+ * memory. The second derivative follows from the Bessel equation. Any
+ * of Phi, dPhi, d2Phi may be NULL.
+ *
+ * @param l      Input: multipole
+ * @param beta   Input: wavenumber (x is multiplied by beta)
+ * @param x_size Input: number of points
+ * @param x      Input: vector of x values
+ * @param Phi    Output: vector of \f$ \Phi_l \f$
+ * @param dPhi   Output: vector of derivatives
+ * @param d2Phi  Output: vector of second derivatives
+ * @return the error status
+ */
+
+int hyperspherical_flat_asymptotic_vector(int l,
+                                          double beta,
+                                          int x_size,
+                                          double * __restrict__ x,
+                                          double * __restrict__ Phi,
+                                          double * __restrict__ dPhi,
+                                          double * __restrict__ d2Phi){
+  int index_x;
+  double bx, phi_l, dphi;
+  double lambda = l*(l+1.);
+
+  for (index_x=0; index_x<x_size; index_x++){
+    bx = beta*x[index_x];
+    if ((dPhi == NULL) && (d2Phi == NULL)){
+      Phi[index_x] = hyperspherical_flat_asymptotic(l+0.5,bx,NULL);
+      continue;
+    }
+    phi_l = hyperspherical_flat_asymptotic(l+0.5,bx,&dphi);
+    dphi *= beta;
+    if (Phi != NULL)
+      Phi[index_x] = phi_l;
+    if (dPhi != NULL)
+      dPhi[index_x] = dphi;
+    if (d2Phi != NULL)
+      d2Phi[index_x] = -2.0/x[index_x]*dphi+beta*beta*(lambda/bx/bx-1.0)*phi_l;
+  }
+  return _SUCCESS_;
+}
+
+/**
+ * Spherical Bessel function \f$ j_{\nu-1/2}(x) \f$ from the leading term
+ * of the uniform asymptotic expansion
+ * \f$ J_\nu(\nu z) \simeq (4\zeta/(1-z^2))^{1/4} \nu^{-1/3} Ai(\nu^{2/3}\zeta) \f$.
+ * The combination \f$ \zeta/(1-z^2) \f$ is computed from a series close
+ * to the turning point z=1, where it would otherwise cancel.
+ *
+ * @param nu   Input: order of the cylindrical Bessel function (l+1/2)
+ * @param x    Input: argument
+ * @param dPhi Output: derivative with respect to x (if not NULL)
+ * @return the value of the Bessel function
+ */
+
+double hyperspherical_flat_asymptotic(double nu, double x, double * dPhi){
+  double z, s, s2, g_over_s3, xi, zeta, nu_one_third;
+  double amplitude, F, dF, dlnamplitude_dx, dxi_dx, Phi;
+
+  if (x <= 0.){
+    if (dPhi != NULL)
+      *dPhi = 0.;
+    return 0.;
+  }
+
+  z = x/nu;
+  if (z < 1.0){
+    s2 = 1.0-z*z;
+    s = sqrt(s2);
+    /* (2/3) zeta^(3/2) = atanh(s) - s */
+    if (s < 0.1)
+      g_over_s3 = 1./3.+s2*(1./5.+s2*(1./7.+s2*(1./9.+s2*(1./11.+s2/13.))));
+    else
+      g_over_s3 = (atanh(s)-s)/(s2*s);
+  }
+  else {
+    s2 = z*z-1.0;
+    s = sqrt(s2);
+    /* (2/3) (-zeta)^(3/2) = s - atan(s) */
+    if (s < 0.1)
+      g_over_s3 = 1./3.-s2*(1./5.-s2*(1./7.-s2*(1./9.-s2*(1./11.-s2/13.))));
+    else
+      g_over_s3 = (s-atan(s))/(s2*s);
+  }
+
+  /* (2/3) |nu^(2/3) zeta|^(3/2), the phase or decay exponent of Ai */
+  xi = nu*g_over_s3*s2*s;
+
+  /* away from the turning point, the prefactors combine into
+     sqrt(pi/(x s nu)) times the scaled Airy function of xi, and the
+     derivative follows from dxi/dx = -+ s/z */
+  if (xi >= _AIRY_XI_MIN_){
+    if (z < 1.0){
+      /* far below the turning point, Ai underflows anyway */
+      if (xi > 700.){
+        if (dPhi != NULL)
+          *dPhi = 0.;
+        return 0.;
+      }
+      F = airy_scaled_decaying(xi,(dPhi == NULL ? NULL : &dF));
+      dlnamplitude_dx = -0.5*(1./x-z/(s2*nu));
+      dxi_dx = -s/z;
+    }
+    else {
+      F = airy_scaled_oscillating(xi,(dPhi == NULL ? NULL : &dF));
+      dlnamplitude_dx = -0.5*(1./x+z/(s2*nu));
+      dxi_dx = s/z;
+    }
+    amplitude = sqrt(_PI_/(x*s*nu));
+    if (dPhi != NULL)
+      *dPhi = amplitude*(dlnamplitude_dx*F+dF*dxi_dx);
+    return amplitude*F;
+  }
+
+  /* close to the turning point, use zeta/(1-z^2) and Ai explicitly, and
+     the recurrence j_l' = (l/x) j_l - j_{l+1} for the derivative */
+  nu_one_third = cbrt(nu);
+  zeta = cbrt(1.5*g_over_s3);
+  zeta *= zeta;
+  Phi = sqrt(0.5*_PI_/x)*sqrt(sqrt(4.0*zeta))/nu_one_third
+    *airy_cheb_approx((z < 1.0 ? 1. : -1.)*nu_one_third*nu_one_third*zeta*s2);
+  if (dPhi != NULL)
+    *dPhi = (nu-0.5)/x*Phi-hyperspherical_flat_asymptotic(nu+1.,x,NULL);
+  return Phi;
+}
 
 int hyperspherical_WKB(int K,int l,double beta,double y, double *Phi){
   double e, w, w2, alpha, alpha2, CscK, ytp, t;
@@ -900,9 +1046,16 @@ double airy_cheb_approx(double z){
   return Ai;
 }
 
+/* Chebyshev coefficients of the asymptotic forms of Ai(z), for z<=-7
+   (coef1) and z>=7 (coef4) */
+static const double airy_coef1_A[5] = {1.1282427601,-0.6803534e-4,0.16687e-6,-0.128e-8,0.2e-10};
+static const double airy_coef1_B[5] = {0.7822108673e-1,-0.6895649e-4,0.32857e-6,-0.37e-8,0.7e-10};
+static const double airy_coef4_A[7] = {0.56265126169,-0.76136219e-3,0.765252e-5,-0.14228e-6,
+                                       0.380e-8,-0.13e-9,0.1e-10};
+
 double coef1(double z){
-  const double A[5] = {1.1282427601,-0.6803534e-4,0.16687e-6,-0.128e-8,0.2e-10};
-  const double B[5] = {0.7822108673e-1,-0.6895649e-4,0.32857e-6,-0.37e-8,0.7e-10};
+  const double * A = airy_coef1_A;
+  const double * B = airy_coef1_B;
   double x,y,t,Ai,zeta,theta,sintheta,costheta,FA,FB;
 
   x = -z;
@@ -969,8 +1122,7 @@ double B[25]={0.47839902387,-0.6881732880e-1,0.20938146768,
 }
 
 double coef4(double z){
-  const double A[7]={0.56265126169,-0.76136219e-3,0.765252e-5,-0.14228e-6,
-            0.380e-8,-0.13e-9,0.1e-10};
+  const double * A = airy_coef4_A;
   /**  double B[7]={1.1316635302,0.166141673e-02,0.1968882e-04,0.47047e-06,
             0.1769e-7,0.94e-9,0.6e-10};
   */
@@ -988,6 +1140,42 @@ double coef4(double z){
   return Ai;
 }
 
+/**
+ * Same as coef1() and coef4(), but without the factor \f$ |z|^{-1/4} \f$,
+ * and as a function of \f$ \xi = (2/3)|z|^{3/2} \f$ (larger than
+ * \f$ (2/3) 7^{3/2} \f$), which avoids any fractional power when
+ * \f$ \xi \f$ is known. If dF is not NULL, it receives the derivative
+ * with respect to \f$ \xi \f$.
+ */
+
+double airy_scaled_oscillating(double xi, double * dF){
+  double theta = xi+0.25*_PI_;
+  double sintheta = sin(theta);
+  double costheta = cos(theta);
+  double y = 343./(2.25*xi*xi);
+  double FA = cheb(y,5,airy_coef1_A);
+  double FB = cheb(y,5,airy_coef1_B)/xi;
+  double dy;
+
+  if (dF != NULL){
+    dy = -2.*y/xi;
+    *dF = costheta*FA+sintheta*FB
+      +sintheta*cheb_derivative(y,5,airy_coef1_A)*dy
+      -costheta*(cheb_derivative(y,5,airy_coef1_B)*dy-FB)/xi;
+  }
+  return sintheta*FA-costheta*FB;
+}
+
+double airy_scaled_decaying(double xi, double * dF){
+  double w = 7.*sqrt(7.)/(1.5*xi);
+  double EY = exp(-xi);
+  double C = cheb(w,7,airy_coef4_A);
+
+  if (dF != NULL)
+    *dF = -EY*(C+cheb_derivative(w,7,airy_coef4_A)*w/xi);
+  return EY*C;
+}
+
 double cheb(double x, int n, const double A[]){
   double b,d,u,y,c,F;
   int j;
@@ -1005,6 +1193,24 @@ double cheb(double x, int n, const double A[]){
   return F;
 }
 
+/**
+ * Derivative of the Chebyshev series evaluated by cheb(), from the
+ * coefficients of the derivative series (the argument is mapped from
+ * [0,1] to [-1,1], hence the factor 2)
+ */
+
+double cheb_derivative(double x, int n, const double A[]){
+  double dA[_CHEB_SIZE_MAX_];
+  int j;
+  dA[n-1] = 0.;
+  dA[n-2] = 2.*(n-1)*A[n-1];
+  for (j=n-3; j>=0; j--)
+    dA[j] = dA[j+2]+2.*(j+1)*A[j+1];
+  for (j=0; j<n; j++)
+    dA[j] *= 2.;
+  return cheb(x,n,dA);
+}
+
 
 double get_value_at_small_phi(int K,int l,double beta,double Phi){
   double nu, lhs, alpha, xval;
@@ -1764,3 +1970,61 @@ int hyperspherical_Hermite6_interpolation_vector_PhidPhid2Phi(HyperInterpStruct
   return _SUCCESS_;
 }
 
+
+/**
+ * Same interface as the Hermite interpolation functions above, for the
+ * l values of a flat interpolation structure that are not tabulated
+ * (those above l_WKB in hyperspherical_HIS_create()). The Bessel
+ * functions are then evaluated with
+ * hyperspherical_flat_asymptotic_vector().
+ */
+
+int hyperspherical_asymptotic_vector_Phi(HyperInterpStruct *pHIS,
+                                         int nxi,
+                                         int lnum,
+                                         double * xinterp,
+                                         double * Phi,
+                                         ErrorMsg error_message) {
+  class_test(pHIS->K != 0,error_message,"table-free Bessel functions only available in the flat case");
+  return hyperspherical_flat_asymptotic_vector(pHIS->l[lnum],pHIS->beta,nxi,xinterp,Phi,NULL,NULL);
+}
+int hyperspherical_asymptotic_vector_dPhi(HyperInterpStruct *pHIS,
+                                          int nxi,
+                                          int lnum,
+                                          double * xinterp,
+                                          double * dPhi,
+                                          ErrorMsg error_message) {
+  class_test(pHIS->K != 0,error_message,"table-free Bessel functions only available in the flat case");
+  return hyperspherical_flat_asymptotic_vector(pHIS->l[lnum],pHIS->beta,nxi,xinterp,NULL,dPhi,NULL);
+}
+int hyperspherical_asymptotic_vector_PhidPhi(HyperInterpStruct *pHIS,
+                                             int nxi,
+                                             int lnum,
+                                             double * xinterp,
+                                             double * Phi,
+                                             double * dPhi,
+                                             ErrorMsg error_message) {
+  class_test(pHIS->K != 0,error_message,"table-free Bessel functions only available in the flat case");
+  return hyperspherical_flat_asymptotic_vector(pHIS->l[lnum],pHIS->beta,nxi,xinterp,Phi,dPhi,NULL);
+}
+int hyperspherical_asymptotic_vector_Phid2Phi(HyperInterpStruct *pHIS,
+                                              int nxi,
+                                              int lnum,
+                                              double * xinterp,
+                                              double * Phi,
+                                              double * d2Phi,
+                                              ErrorMsg error_message) {
+  class_test(pHIS->K != 0,error_message,"table-free Bessel functions only available in the flat case");
+  return hyperspherical_flat_asymptotic_vector(pHIS->l[lnum],pHIS->beta,nxi,xinterp,Phi,NULL,d2Phi);
+}
+int hyperspherical_asymptotic_vector_PhidPhid2Phi(HyperInterpStruct *pHIS,
+                                                  int nxi,
+                                                  int lnum,
+                                                  double * xinterp,
+                                                  double * Phi,
+                                                  double * dPhi,
+                                                  double * d2Phi,
+                                                  ErrorMsg error_message) {
+  class_test(pHIS->K != 0,error_message,"table-free Bessel functions only available in the flat case");
+  return hyperspherical_flat_asymptotic_vector(pHIS->l[lnum],pHIS->beta,nxi,xinterp,Phi,dPhi,d2Phi);
+}
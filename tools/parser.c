@@ -75,6 +75,63 @@ int parser_free(struct file_content * pfc) {
   return _SUCCESS_;
 }
 
+/* Set the names and values of pfc from packed lists: size null-terminated
+   strings, one after the other, as built by the python wrapper. If names is
+   NULL, the names of the previous call are kept and only the values are
+   copied. pfc must have been set before (e.g. with size 0), its filename is
+   not changed. */
+int parser_set_packed(struct file_content * pfc,
+                      int size,
+                      char * names,
+                      char * values,
+                      ErrorMsg errmsg) {
+
+  int index;
+  size_t length;
+
+  if (names != NULL) {
+    if (size != pfc->size) {
+      if (pfc->size > 0) {
+        free(pfc->name);
+        free(pfc->value);
+        free(pfc->read);
+      }
+      pfc->size = 0;
+      if (size > 0) {
+        class_alloc(pfc->name,size*sizeof(FileArg),errmsg);
+        class_alloc(pfc->value,size*sizeof(FileArg),errmsg);
+        class_alloc(pfc->read,size*sizeof(short),errmsg);
+      }
+      pfc->size = size;
+    }
+    for (index=0; index<size; index++) {
+      length = strlen(names);
+      class_test(length >= _ARGUMENT_LENGTH_MAX_,
+                 errmsg,
+                 "parameter name %s is longer than %d characters",names,_ARGUMENT_LENGTH_MAX_-1);
+      memcpy(pfc->name[index],names,length+1);
+      names += length+1;
+    }
+  }
+  else {
+    class_test(size != pfc->size,
+               errmsg,
+               "%d values passed for %d parameter names",size,pfc->size);
+  }
+
+  for (index=0; index<size; index++) {
+    length = strlen(values);
+    class_test(length >= _ARGUMENT_LENGTH_MAX_,
+               errmsg,
+               "value of parameter %s is longer than %d characters",pfc->name[index],_ARGUMENT_LENGTH_MAX_-1);
+    memcpy(pfc->value[index],values,length+1);
+    pfc->read[index] = _FALSE_;
+    values += length+1;
+  }
+
+  return _SUCCESS_;
+}
+
 int parser_read_line(char * line,
                      int * is_data,
                      char * name,
@@ -71,13 +71,82 @@ int get_qsampling(double *x,
 		  void * params_for_function,
 		  ErrorMsg errmsg) {
 
+  /* Build the adaptive trees for this tolerance only, and sample from them: */
+  qss_trees trees;
+  int status;
+
+  if (get_qsampling_trees(&trees,rtol,qvec,qsiz,(*test),(*function),params_for_function,errmsg) == _FAILURE_)
+    return _FAILURE_;
+  status = get_qsampling_from_trees(x,w,N,N_max,rtol,qvec,qsiz,(*test),(*function),params_for_function,&trees,errmsg);
+  free_qsampling_trees(&trees);
+
+  return status;
+}
+
+int get_qsampling_trees(qss_trees *trees,
+			double rtol,
+			double *qvec,
+			int qsiz,
+			int (*test)(void * params_for_function, double q, double *psi),
+			int (*function)(void * params_for_function, double q, double *f0),
+			void * params_for_function,
+			ErrorMsg errmsg) {
+
+  /* Build the two adaptive Gauss-Kronrod trees of get_qsampling_from_trees
+     for the tolerance rtol. Since gk_adapt only splits a node whose relative
+     error exceeds the tolerance at its depth, the tree obtained for a larger
+     tolerance is a pruned copy of this one: several samplings of the same
+     distribution (e.g. for the background and for the perturbations) can
+     share these trees, provided that they are built for the smallest rtol. */
+
+  trees->rtol = rtol;
+  trees->root = NULL;
+  trees->root_comb = NULL;
+
+  class_call(gk_adapt(&(trees->root),(*test),(*function), params_for_function,
+		      rtol*1e-4, 1, 0.0, 1.0, _TRUE_, errmsg),
+	     errmsg,
+	     errmsg);
+
+  if ((qvec!=NULL)&&(qsiz>1)){
+    class_call(gk_adapt(&(trees->root_comb),(*test),(*function), params_for_function,
+			rtol*1e-2, 1, qvec[0], qvec[qsiz-1], _FALSE_, errmsg),
+	       errmsg,
+	       errmsg);
+  }
+
+  return _SUCCESS_;
+}
+
+int free_qsampling_trees(qss_trees *trees){
+  burn_tree(trees->root);
+  burn_tree(trees->root_comb);
+  trees->root = NULL;
+  trees->root_comb = NULL;
+  return _SUCCESS_;
+}
+
+int get_qsampling_from_trees(double *x,
+			     double *w,
+			     int *N,
+			     int N_max,
+			     double rtol,
+			     double *qvec,
+			     int qsiz,
+			     int (*test)(void * params_for_function, double q, double *psi),
+			     int (*function)(void * params_for_function, double q, double *f0),
+			     void * params_for_function,
+			     qss_trees *trees,
+			     ErrorMsg errmsg) {
+
   /* This routine returns the fewest possible number of abscissas and weights under
      the requirement that a test function folded with the neutrino distribution function
      can be integrated to an accuracy of rtol. If the distribution function is Fermi-Dirac
      or close, a Laguerre quadrature formula is often the best choice.
 
      This function combines two completely different strategies: Adaptive Gauss-Kronrod
-     quadrature and Laguerres quadrature formula. */
+     quadrature and Laguerres quadrature formula. The adaptive trees are pruned copies
+     of the ones in trees, which must have been built for a tolerance <= rtol. */
 
   int i, NL=2,NR,level,Nadapt=0,NLag,NLag_max,Nold=NL;
   int adapt_converging=_FALSE_,Laguerre_converging=_FALSE_,combined_converging=_FALSE_;
@@ -104,6 +173,10 @@ int get_qsampling(double *x,
   w_leg[1] = w_leg[2];
   w_leg[0] = w_leg[3];
 
+  class_test(rtol < trees->rtol,
+	     errmsg,
+	     "adaptive trees built for a tolerance of %g cannot be used for %g",trees->rtol,rtol);
+
   /* Allocate storage for Laguerre coefficients: */
   class_alloc(b,N_max*sizeof(double),errmsg);
   class_alloc(c,N_max*sizeof(double),errmsg);
@@ -118,8 +191,9 @@ int get_qsampling(double *x,
   }
 
   /* First do the adaptive quadrature - this will also give the value of the integral: */
-  gk_adapt(&root,(*test),(*function), params_for_function,
-	   rtol*1e-4, 1, 0.0, 1.0, _TRUE_, errmsg);
+  class_call(prune_tree(&root,trees->root,rtol*1e-4,errmsg),
+	     errmsg,
+	     errmsg);
   /* Do a leaf count: */
   leaf_count(root);
   /* I can get the integral now: */
@@ -181,8 +255,9 @@ int get_qsampling(double *x,
     }
 
     /* Do the adaptive quadrature - this will also give the main part of the integral: */
-    gk_adapt(&root_comb,(*test),(*function), params_for_function,
-	     rtol*1e-2, 1, qmin, qmax, _FALSE_, errmsg);
+    class_call(prune_tree(&root_comb,trees->root_comb,rtol*1e-2,errmsg),
+	       errmsg,
+	       errmsg);
     /* Do a leaf count: */
     leaf_count(root_comb);
     /* Starting from the top, move down in levels until tolerance is met: */
@@ -454,6 +529,40 @@ int burn_tree(qss_node *node){
   return _SUCCESS_;
 }
 
+int prune_tree(qss_node **copy, qss_node *node, double tol, ErrorMsg errmsg){
+  /* Copy node and its subnodes into *copy, stopping where gk_adapt would have
+     stopped the recursion for the tolerance tol: the copy is the tree that
+     gk_adapt would have built for tol, without evaluating the integrand. */
+  int k;
+  class_alloc(*copy,sizeof(qss_node),errmsg);
+  (*copy)->I = node->I;
+  (*copy)->err = node->err;
+  (*copy)->x = NULL;
+  (*copy)->w = NULL;
+  (*copy)->left = NULL; (*copy)->right = NULL;
+  if (node->x!=NULL){
+    class_alloc((*copy)->x,15*sizeof(double),errmsg);
+    class_alloc((*copy)->w,15*sizeof(double),errmsg);
+    for(k=0;k<15;k++){
+      (*copy)->x[k] = node->x[k];
+      (*copy)->w[k] = node->w[k];
+    }
+  }
+  if ((fabs(node->err/node->I) < tol)||(tol>=1.0)){
+    return _SUCCESS_;
+  }
+  class_test(node->left==NULL,
+	     errmsg,
+	     "adaptive tree not refined enough for a tolerance of %g",tol);
+  class_call(prune_tree(&((*copy)->left),node->left,1.5*tol,errmsg),
+	     errmsg,
+	     errmsg);
+  class_call(prune_tree(&((*copy)->right),node->right,1.5*tol,errmsg),
+	     errmsg,
+	     errmsg);
+  return _SUCCESS_;
+}
+
 int leaf_count(qss_node *node){
   /* Count the amount of leafs under a given node and write the number in the node. */
   /* We call recursively, until a node is a leaf - then we add the numbers on our